@@ -131,6 +131,16 @@ public struct TransactionDetail: Identifiable, Hashable, Codable, Sendable {
         self.memo = transaction.memo
     }
     
+    /// Create from a transaction with category paths already worked out (see CategoryTree.displayPaths)
+    public init(transaction: MoneyTransaction, payees: [Int: MoneyPayee], categoryPaths: [Int: String]) {
+        self.id = transaction.id
+        self.date = transaction.date
+        self.amount = transaction.amount
+        self.payeeName = transaction.payeeId.flatMap { payees[$0]?.name }
+        self.categoryName = transaction.categoryId.flatMap { categoryPaths[$0] }
+        self.memo = transaction.memo
+    }
+    
     /// Build full category path by following parent relationships
     private static func buildCategoryPath(categoryId: Int, categories: [Int: MoneyCategory]) -> String? {
         guard let category = categories[categoryId] else {
@@ -0,0 +1,113 @@
+//
+//  CategoryTree.swift
+//  CheckbookApp
+//
+//  The CAT hierarchy, materialized by the engine (tree.c)
+//
+
+import Foundation
+
+/// Categories with their parent links, depth, full path and sorted children worked out once.
+///
+/// The engine saves the tree under Caches with a checksum of every CAT page and, when
+/// opened again, decodes only the rows of pages that changed. Pickers and reports read
+/// paths and children from here instead of rebuilding them from flat rows on every use.
+final class CategoryTree {
+
+    struct Node {
+        let category: MoneyCategory
+        let rootId: Int
+        let depth: Int
+        /// Names from the root down, e.g. "EXPENSE : Automobile : Gasoline"
+        let path: String
+        /// Path shown to the user: below the INCOME and EXPENSE roots, e.g. "Automobile : Gasoline"
+        let displayPath: String
+        let childIds: [Int]
+    }
+
+    static let incomeId = 130
+    static let expenseId = 131
+
+    /// Every category, parents before their children and siblings by name
+    let nodes: [Node]
+    private let index: [Int: Int]
+    let rootIds: [Int]
+
+    private init(nodes: [Node], rootIds: [Int]) {
+        self.nodes = nodes
+        self.rootIds = rootIds
+        self.index = Dictionary(uniqueKeysWithValues: nodes.enumerated().map { ($1.category.id, $0) })
+    }
+
+    /// Open the saved tree for a Money file, updating it from CAT pages that changed.
+    /// - Parameters:
+    ///   - path: Decrypted .mdb produced by MoneyDecryptorBridge
+    ///   - name: Names the saved tree, e.g. the Money file's name
+    static func open(path: String, name: String) throws -> CategoryTree {
+        let tree = try EngineCache.withMoneyFile(path: path, file: "\(name).categories") { mdb, cachePath in
+            guard let tree = mdb_tree_open(mdb, "CAT", "hcat", "hcatParent", "szFull", " : ", cachePath) else {
+                throw EngineCache.CacheError.buildFailed("categories")
+            }
+            return tree
+        }
+        defer { mdb_tree_free(tree) }
+
+        // Copy the nodes out depth first, following the engine's sorted children
+        var nodes: [Node] = []
+        nodes.reserveCapacity(Int(mdb_tree_num_nodes(tree)))
+
+        func children(_ n: Int32) -> [Int32] {
+            var count: UInt32 = 0
+            guard let list = mdb_tree_children(tree, n, &count) else { return [] }
+            return (0..<Int(count)).map { Int32(list[$0]) }
+        }
+
+        func visit(_ n: Int32) {
+            guard let node = mdb_tree_node(tree, n)?.pointee else { return }
+            let root = mdb_tree_node(tree, node.root)!.pointee
+            let childNumbers = children(n)
+            let name = String(cString: node.name)
+            let parentId = node.parent >= 0 ? Int(node.parent_id) : nil
+            let rootName = String(cString: root.name)
+            let underMoneyRoot = node.depth > 0 && (rootName == "INCOME" || rootName == "EXPENSE")
+
+            nodes.append(Node(
+                category: MoneyCategory(id: Int(node.id), name: name, parentId: parentId, level: Int(node.depth)),
+                rootId: Int(root.id),
+                depth: Int(node.depth),
+                path: String(cString: node.path),
+                displayPath: underMoneyRoot ? String(cString: node.subpath) : String(cString: node.path),
+                childIds: childNumbers.compactMap { mdb_tree_node(tree, $0).map { Int($0.pointee.id) } }
+            ))
+            childNumbers.forEach(visit)
+        }
+
+        let roots = children(-1)
+        roots.forEach(visit)
+        return CategoryTree(nodes: nodes,
+                            rootIds: roots.compactMap { mdb_tree_node(tree, $0).map { Int($0.pointee.id) } })
+    }
+
+    func node(id: Int) -> Node? {
+        index[id].map { nodes[$0] }
+    }
+
+    func children(of id: Int) -> [Node] {
+        node(id: id)?.childIds.compactMap { node(id: $0) } ?? []
+    }
+
+    /// true under EXPENSE, false under INCOME, nil elsewhere or for the roots themselves
+    func isExpense(_ id: Int) -> Bool? {
+        guard let node = node(id: id), node.depth > 0 else { return nil }
+        switch node.rootId {
+        case Self.expenseId: return true
+        case Self.incomeId: return false
+        default: return nil
+        }
+    }
+
+    /// Display paths by category id, e.g. for TransactionDetail
+    var displayPaths: [Int: String] {
+        Dictionary(uniqueKeysWithValues: nodes.map { ($0.category.id, $0.displayPath) })
+    }
+}
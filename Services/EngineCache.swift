@@ -0,0 +1,44 @@
+//
+//  EngineCache.swift
+//  CheckbookApp
+//
+//  Opening a Money file for the engine's saved structures (prefix.c, tree.c)
+//
+
+import Foundation
+
+/// Shared setup for structures the engine builds from a Money file and saves under Caches.
+enum EngineCache {
+
+    enum CacheError: Error, LocalizedError {
+        case openFailed(String)
+        case buildFailed(String)
+
+        var errorDescription: String? {
+            switch self {
+            case .openFailed(let path): return "Failed to open MDB: \(path)"
+            case .buildFailed(let what): return "Failed to read \(what)"
+            }
+        }
+    }
+
+    /// Open a Money file with its catalog read and pass it to `body` with the Caches file
+    /// to save to; the file is closed when `body` returns.
+    /// - Parameters:
+    ///   - path: Decrypted .mdb produced by MoneyDecryptorBridge
+    ///   - file: Name of the saved structure under Caches, e.g. "<Money file>.payees"
+    static func withMoneyFile<T>(path: String, file: String,
+                                 _ body: (UnsafeMutablePointer<MdbHandle>, String) throws -> T) throws -> T {
+        guard let mdb = mdb_open(path, MDB_NOFLAGS) else {
+            throw CacheError.openFailed(path)
+        }
+        defer { mdb_close(mdb) }
+
+        guard mdb_read_catalog(mdb, Int32(MDB_TABLE)) != nil else {
+            throw CacheError.openFailed(path)
+        }
+
+        let caches = FileManager.default.urls(for: .cachesDirectory, in: .userDomainMask)[0]
+        return try body(mdb, caches.appendingPathComponent(file).path)
+    }
+}
@@ -0,0 +1,80 @@
+//
+//  EngineLog.swift
+//  CheckbookApp
+//
+//  Leveled log lines kept in the engine's log ring (log.c)
+//
+
+import Foundation
+
+/// Log for the sync and Money file writer, shared with the engine's own lines.
+///
+/// Lines go to the engine's ring, where the latest ones can be read back with
+/// `records(since:)`. Debug lines are compiled out of release builds; the others
+/// are dropped before the message is built unless their category's level allows
+/// them (`mdb_log_set_level`, warnings and errors to start with).
+enum EngineLog {
+
+    enum Category {
+        case write
+        case sync
+
+        fileprivate var engine: MdbLogCategory {
+            switch self {
+            case .write: return MDB_LOG_WRITE
+            case .sync: return MDB_LOG_SYNC
+            }
+        }
+    }
+
+    struct Record {
+        let date: Date
+        let category: String
+        let level: Int
+        let message: String
+    }
+
+    static func debug(_ category: Category, _ message: @autoclosure () -> String) {
+        #if DEBUG
+        log(category, MDB_LOG_DEBUG, message)
+        #endif
+    }
+
+    static func info(_ category: Category, _ message: @autoclosure () -> String) {
+        log(category, MDB_LOG_INFO, message)
+    }
+
+    static func warn(_ category: Category, _ message: @autoclosure () -> String) {
+        log(category, MDB_LOG_WARN, message)
+    }
+
+    static func error(_ category: Category, _ message: @autoclosure () -> String) {
+        log(category, MDB_LOG_ERROR, message)
+    }
+
+    /// Lines from every category logged since `since`, oldest first
+    /// - Parameter since: 0 at first; moved past the lines returned
+    static func records(since: inout UInt64) -> [Record] {
+        var buffer = [MdbLogRecord](repeating: MdbLogRecord(), count: 256)
+        var records: [Record] = []
+        while true {
+            let count = Int(mdb_log_read(&since, &buffer, UInt32(buffer.count)))
+            records += buffer.prefix(count).map { record in
+                var record = record
+                let message = withUnsafeBytes(of: &record.msg) {
+                    String(cString: $0.baseAddress!.assumingMemoryBound(to: CChar.self))
+                }
+                return Record(date: Date(timeIntervalSince1970: Double(record.usec) / 1_000_000),
+                              category: String(cString: mdb_log_category_name(record.cat)),
+                              level: Int(record.level.rawValue),
+                              message: message)
+            }
+            if count < buffer.count { return records }
+        }
+    }
+
+    private static func log(_ category: Category, _ level: MdbLogLevel, _ message: () -> String) {
+        guard mdb_log_enabled(category.engine, level) != 0 else { return }
+        mdb_log_message(category.engine, level, message())
+    }
+}
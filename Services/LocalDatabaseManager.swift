@@ -266,8 +266,42 @@ class LocalDatabaseManager {
         )
         """
         
+        // Page checksums of the Money file as of the last mirror, per table
+        let createMirrorPagesTable = """
+        CREATE TABLE IF NOT EXISTS mirror_pages (
+            tbl TEXT NOT NULL,
+            pg INTEGER NOT NULL,
+            sum INTEGER NOT NULL,
+            PRIMARY KEY (tbl, pg)
+        )
+        """
+        
+        // Monthly totals of the mirrored TRN rows, kept in step with mirror_TRN
+        let createSummaryAccountTable = """
+        CREATE TABLE IF NOT EXISTS summary_month_account (
+            yyyymm INTEGER NOT NULL,
+            hacct INTEGER NOT NULL,
+            cents INTEGER NOT NULL,
+            count INTEGER NOT NULL,
+            PRIMARY KEY (yyyymm, hacct)
+        ) WITHOUT ROWID
+        """
+        
+        let createSummaryCategoryTable = """
+        CREATE TABLE IF NOT EXISTS summary_month_category (
+            yyyymm INTEGER NOT NULL,
+            hcat INTEGER NOT NULL,
+            cents INTEGER NOT NULL,
+            count INTEGER NOT NULL,
+            PRIMARY KEY (yyyymm, hcat)
+        ) WITHOUT ROWID
+        """
+        
         try execute(createTrnTable)
         try execute(createPayTable)
+        try execute(createMirrorPagesTable)
+        try execute(createSummaryAccountTable)
+        try execute(createSummaryCategoryTable)
         
         #if DEBUG
         print("[LocalDatabaseManager] ✅ Tables created successfully")
@@ -803,6 +837,467 @@ class LocalDatabaseManager {
         #endif
     }
     
+    // MARK: - Money File Mirror
+    
+    /// Money tables copied into SQLite by `mirrorMoneyFile(at:)`, as mirror_<name>
+    static let mirroredTables = ["ACCT", "TRN", "PAY", "CAT"]
+    
+    /// Indexes built on each mirror table once its rows are loaded
+    private static let mirrorIndexes: [String: [[String]]] = [
+        "ACCT": [["hacct"]],
+        "TRN": [["htrn"], ["hacct", "dt"], ["lHpay"], ["hcat"]],
+        "PAY": [["hpay"], ["szFull"]],
+        "CAT": [["hcat"], ["hcatParent"]]
+    ]
+    
+    /// Mirror ACCT, TRN, PAY and CAT from a decrypted Money file.
+    ///
+    /// The first run copies every row, typed, in one transaction and builds the
+    /// indexes afterwards. Later runs compare per-page checksums with the last
+    /// mirror and only rescan the data pages that were added or rewritten.
+    /// Money is stored as INTEGER ten-thousandths and dates as INTEGER milliseconds since 1970;
+    /// `_pg` records the Money data page each row came from.
+    /// - Parameter mdbPath: Decrypted .mdb produced by MoneyDecryptorBridge
+    /// - Returns: Number of rows written
+    @discardableResult
+    func mirrorMoneyFile(at mdbPath: String) throws -> Int {
+        guard let mdb = mdb_open(mdbPath, MDB_NOFLAGS) else {
+            throw DatabaseError.openFailed("Cannot open \(mdbPath)")
+        }
+        defer { mdb_close(mdb) }
+        
+        guard mdb_read_catalog(mdb, Int32(MDB_TABLE)) != nil else {
+            throw DatabaseError.queryFailed("Failed to read Money catalog")
+        }
+        
+        try execute("BEGIN IMMEDIATE")
+        do {
+            var rows = 0
+            for name in Self.mirroredTables {
+                rows += try mirrorTable(name, from: mdb)
+            }
+            try execute("COMMIT")
+            
+            #if DEBUG
+            print("[LocalDatabaseManager] ✅ Mirrored \(rows) rows from \(mdbPath)")
+            #endif
+            
+            return rows
+        } catch {
+            try? execute("ROLLBACK")
+            throw error
+        }
+    }
+    
+    /// Drop every mirror table so the next mirror starts from scratch
+    func clearMirror() throws {
+        for name in Self.mirroredTables {
+            try execute("DROP TABLE IF EXISTS mirror_\(name)")
+        }
+        try execute("DELETE FROM mirror_pages")
+        try execute("DELETE FROM summary_month_account")
+        try execute("DELETE FROM summary_month_category")
+    }
+    
+    private func mirrorTable(_ name: String, from mdb: UnsafeMutablePointer<MdbHandle>) throws -> Int {
+        var tableName = name.utf8CString
+        let tableDef = tableName.withUnsafeMutableBufferPointer { buffer in
+            mdb_read_table_by_name(mdb, buffer.baseAddress, Int32(MDB_TABLE))
+        }
+        guard let table = tableDef else {
+            throw DatabaseError.queryFailed("Table \(name) not found in Money file")
+        }
+        defer { mdb_free_tabledef(table) }
+        
+        guard mdb_read_columns(table) != nil else {
+            throw DatabaseError.queryFailed("Failed to read columns of \(name)")
+        }
+        
+        let mirror = "mirror_\(name)"
+        let numCols = Int(table.pointee.num_cols)
+        
+        var sumsPtr: UnsafeMutablePointer<MdbPageSum>?
+        let numPages = Int(mdb_table_page_sums(table, &sumsPtr))
+        defer { mdb_free_page_sums(sumsPtr) }
+        let sums = UnsafeBufferPointer(start: sumsPtr, count: numPages)
+        
+        let batch = mdb_alloc_batch(table, 0)!
+        defer { mdb_free_batch(batch) }
+        
+        // A mirror with other column types predates a schema change, or a change
+        // in how values are stored
+        var previous: [UInt32: UInt32]? = nil
+        let types = (0..<numCols).map { mirrorColumnType(batch.pointee.columns![$0]) } + ["INTEGER"]
+        if mirrorColumnTypes(mirror) == types {
+            previous = try loadPageSums(name)
+        } else {
+            try execute("DROP TABLE IF EXISTS \(mirror)")
+            try execute("DELETE FROM mirror_pages WHERE tbl = '\(name)'")
+        }
+        
+        // Summaries follow TRN page by page, unless there are none to update yet
+        let summarize = name == "TRN"
+        let rebuildSummaries = summarize && (previous == nil || !summariesExist())
+        
+        var rows = 0
+        if let previous = previous {
+            let current = Set(sums.map { $0.pg })
+            let changed = sums.filter { previous[$0.pg] != $0.sum }.map { $0.pg }.sorted()
+            let dropped = previous.keys.filter { !current.contains($0) }
+            
+            if summarize && !rebuildSummaries {
+                try applySummaries(pages: changed + dropped, sign: -1)
+            }
+            try deleteMirrorRows(mirror, pages: changed + dropped)
+            if !changed.isEmpty {
+                rows = try changed.withUnsafeBufferPointer { filter in
+                    batch.pointee.page_filter = filter.baseAddress
+                    batch.pointee.num_page_filter = UInt32(filter.count)
+                    defer { batch.pointee.page_filter = nil }
+                    return try insertMirrorRows(mirror, table: table, batch: batch)
+                }
+            }
+            if summarize && !rebuildSummaries {
+                try applySummaries(pages: changed, sign: 1)
+                try execute("DELETE FROM summary_month_account WHERE count = 0")
+                try execute("DELETE FROM summary_month_category WHERE count = 0")
+            }
+            
+            #if DEBUG
+            print("[LocalDatabaseManager] \(name): \(changed.count) changed, \(dropped.count) dropped of \(numPages) pages")
+            #endif
+        } else {
+            try createMirrorTable(mirror, batch: batch)
+            rows = try insertMirrorRows(mirror, table: table, batch: batch)
+            try createMirrorIndexes(name, batch: batch)
+        }
+        if rebuildSummaries {
+            try buildSummaries()
+        }
+        
+        try savePageSums(name, sums)
+        return rows
+    }
+    
+    /// Declared types of the mirror's columns, empty when it doesn't exist
+    private func mirrorColumnTypes(_ mirror: String) -> [String] {
+        var statement: OpaquePointer?
+        var types: [String] = []
+        if sqlite3_prepare_v2(db, "PRAGMA table_info(\(mirror))", -1, &statement, nil) == SQLITE_OK {
+            while sqlite3_step(statement) == SQLITE_ROW {
+                types.append(columnString(statement, 2) ?? "")
+            }
+            sqlite3_finalize(statement)
+        }
+        return types
+    }
+    
+    private func mirrorColumnName(_ column: MdbBatchColumn) -> String {
+        let name = withUnsafeBytes(of: column.col!.pointee.name) { buffer in
+            String(cString: buffer.baseAddress!.assumingMemoryBound(to: CChar.self))
+        }
+        return "\"" + name.replacingOccurrences(of: "\"", with: "\"\"") + "\""
+    }
+    
+    private func mirrorColumnType(_ column: MdbBatchColumn) -> String {
+        switch column.kind {
+        case MDB_BATCH_INT32, MDB_BATCH_INT64, MDB_BATCH_BOOL, MDB_BATCH_TIMESTAMP: return "INTEGER"
+        case MDB_BATCH_DOUBLE: return "REAL"
+        case MDB_BATCH_BINARY: return "BLOB"
+        default: return "TEXT"
+        }
+    }
+    
+    private func createMirrorTable(_ mirror: String, batch: UnsafeMutablePointer<MdbBatch>) throws {
+        var columns: [String] = []
+        for i in 0..<Int(batch.pointee.num_cols) {
+            let column = batch.pointee.columns![i]
+            columns.append("\(mirrorColumnName(column)) \(mirrorColumnType(column))")
+        }
+        columns.append("_pg INTEGER NOT NULL")
+        try execute("CREATE TABLE \(mirror) (\(columns.joined(separator: ", ")))")
+    }
+    
+    private func createMirrorIndexes(_ name: String, batch: UnsafeMutablePointer<MdbBatch>) throws {
+        var available = Set<String>()
+        for i in 0..<Int(batch.pointee.num_cols) {
+            available.insert(mirrorColumnName(batch.pointee.columns![i]))
+        }
+        
+        try execute("CREATE INDEX mirror_\(name)__pg ON mirror_\(name) (_pg)")
+        for columns in Self.mirrorIndexes[name] ?? [] {
+            let quoted = columns.map { "\"\($0)\"" }
+            guard quoted.allSatisfy({ available.contains($0) }) else { continue }
+            try execute("""
+                CREATE INDEX mirror_\(name)_\(columns.joined(separator: "_"))
+                ON mirror_\(name) (\(quoted.joined(separator: ", ")))
+                """)
+        }
+    }
+    
+    /// Stream every row the batch scan yields into the mirror table
+    private func insertMirrorRows(_ mirror: String, table: UnsafeMutablePointer<MdbTableDef>, batch: UnsafeMutablePointer<MdbBatch>) throws -> Int {
+        let numCols = Int(batch.pointee.num_cols)
+        let placeholders = Array(repeating: "?", count: numCols + 1).joined(separator: ", ")
+        let sql = "INSERT INTO \(mirror) VALUES (\(placeholders))"
+        
+        var statement: OpaquePointer?
+        guard sqlite3_prepare_v2(db, sql, -1, &statement, nil) == SQLITE_OK else {
+            let errmsg = String(cString: sqlite3_errmsg(db))
+            throw DatabaseError.prepareFailed(errmsg)
+        }
+        defer { sqlite3_finalize(statement) }
+        
+        var rows = 0
+        _ = mdb_rewind_table(table)
+        while mdb_fetch_batch(table, batch) != 0 {
+            let b = batch.pointee
+            for row in 0..<Int(b.num_rows) {
+                for i in 0..<numCols {
+                    bindBatchValue(statement, Int32(i + 1), b.columns![i], row)
+                }
+                sqlite3_bind_int64(statement, Int32(numCols + 1), Int64(b.pages![row]))
+                
+                guard sqlite3_step(statement) == SQLITE_DONE else {
+                    let errmsg = String(cString: sqlite3_errmsg(db))
+                    throw DatabaseError.executeFailed(errmsg)
+                }
+                sqlite3_reset(statement)
+            }
+            rows += Int(b.num_rows)
+            // A short last batch ends the table; don't fetch again
+            if b.at_end != 0 { break }
+        }
+        return rows
+    }
+    
+    /// Bind one value of a batch column; strings are only valid until the next fetch
+    private func bindBatchValue(_ statement: OpaquePointer?, _ index: Int32, _ column: MdbBatchColumn, _ row: Int) {
+        let bit = UInt8(1 << (row & 7))
+        guard column.validity![row >> 3] & bit != 0 else {
+            sqlite3_bind_null(statement, index)
+            return
+        }
+        switch column.kind {
+        case MDB_BATCH_INT32:
+            sqlite3_bind_int(statement, index, column.values!.assumingMemoryBound(to: Int32.self)[row])
+        case MDB_BATCH_INT64:
+            // Money, exact in ten-thousandths
+            sqlite3_bind_int64(statement, index, column.values!.assumingMemoryBound(to: Int64.self)[row])
+        case MDB_BATCH_DOUBLE:
+            sqlite3_bind_double(statement, index, column.values!.assumingMemoryBound(to: Double.self)[row])
+        case MDB_BATCH_BOOL:
+            let bits = column.values!.assumingMemoryBound(to: UInt8.self)
+            sqlite3_bind_int(statement, index, bits[row >> 3] & bit != 0 ? 1 : 0)
+        case MDB_BATCH_TIMESTAMP:
+            sqlite3_bind_int64(statement, index, column.values!.assumingMemoryBound(to: Int64.self)[row])
+        default:
+            let start = Int(column.offsets![row])
+            let length = Int32(column.offsets![row + 1]) - Int32(start)
+            if column.kind == MDB_BATCH_BINARY {
+                sqlite3_bind_blob(statement, index, column.data! + start, length, nil)
+            } else {
+                sqlite3_bind_text(statement, index, column.data! + start, length, nil)
+            }
+        }
+    }
+    
+    private func deleteMirrorRows(_ mirror: String, pages: [UInt32]) throws {
+        guard !pages.isEmpty else { return }
+        
+        var statement: OpaquePointer?
+        guard sqlite3_prepare_v2(db, "DELETE FROM \(mirror) WHERE _pg = ?", -1, &statement, nil) == SQLITE_OK else {
+            let errmsg = String(cString: sqlite3_errmsg(db))
+            throw DatabaseError.prepareFailed(errmsg)
+        }
+        defer { sqlite3_finalize(statement) }
+        
+        for pg in pages {
+            sqlite3_bind_int64(statement, 1, Int64(pg))
+            guard sqlite3_step(statement) == SQLITE_DONE else {
+                let errmsg = String(cString: sqlite3_errmsg(db))
+                throw DatabaseError.executeFailed(errmsg)
+            }
+            sqlite3_reset(statement)
+        }
+    }
+    
+    private func loadPageSums(_ name: String) throws -> [UInt32: UInt32] {
+        var statement: OpaquePointer?
+        guard sqlite3_prepare_v2(db, "SELECT pg, sum FROM mirror_pages WHERE tbl = ?", -1, &statement, nil) == SQLITE_OK else {
+            let errmsg = String(cString: sqlite3_errmsg(db))
+            throw DatabaseError.prepareFailed(errmsg)
+        }
+        defer { sqlite3_finalize(statement) }
+        
+        bindText(statement, 1, name)
+        var sums: [UInt32: UInt32] = [:]
+        while sqlite3_step(statement) == SQLITE_ROW {
+            sums[UInt32(sqlite3_column_int64(statement, 0))] = UInt32(sqlite3_column_int64(statement, 1))
+        }
+        return sums
+    }
+    
+    private func savePageSums(_ name: String, _ sums: UnsafeBufferPointer<MdbPageSum>) throws {
+        try execute("DELETE FROM mirror_pages WHERE tbl = '\(name)'")
+        
+        var statement: OpaquePointer?
+        guard sqlite3_prepare_v2(db, "INSERT INTO mirror_pages (tbl, pg, sum) VALUES (?, ?, ?)", -1, &statement, nil) == SQLITE_OK else {
+            let errmsg = String(cString: sqlite3_errmsg(db))
+            throw DatabaseError.prepareFailed(errmsg)
+        }
+        defer { sqlite3_finalize(statement) }
+        
+        for sum in sums {
+            bindText(statement, 1, name)
+            sqlite3_bind_int64(statement, 2, Int64(sum.pg))
+            sqlite3_bind_int64(statement, 3, Int64(sum.sum))
+            guard sqlite3_step(statement) == SQLITE_DONE else {
+                let errmsg = String(cString: sqlite3_errmsg(db))
+                throw DatabaseError.executeFailed(errmsg)
+            }
+            sqlite3_reset(statement)
+        }
+    }
+    
+    // MARK: - Monthly Summaries
+    
+    /// Total of the mirrored transactions counted in balances for one month and account or category
+    struct MonthlyTotal {
+        /// Year and month as yyyymm, e.g. 202403
+        let month: Int
+        /// hacct, or hcat with -1 for transactions without a category
+        let key: Int
+        let cents: Int64
+        let count: Int
+    }
+    
+    enum SummaryKey {
+        case account
+        case category
+        
+        fileprivate var table: String {
+            self == .account ? "summary_month_account" : "summary_month_category"
+        }
+        
+        fileprivate var column: String {
+            self == .account ? "hacct" : "hcat"
+        }
+        
+        /// Key expression over mirror_TRN
+        fileprivate var source: String {
+            self == .account ? "hacct" : "COALESCE(hcat, -1)"
+        }
+    }
+    
+    /// Month of a mirrored `dt`, which holds the Money wall-clock date as milliseconds since 1970
+    private static let summaryMonth = "CAST(strftime('%Y%m', dt / 1000, 'unixepoch') AS INTEGER)"
+    
+    /// Mirrored `amt` in cents, rounded half away from zero in integer arithmetic
+    private static let summaryCents = "((amt + CASE WHEN amt < 0 THEN -50 ELSE 50 END) / 100)"
+    
+    /// Same rows as MoneyFileParser.shouldCountInBalance: posted, not a recurring template
+    private static let summaryFilter = """
+        dt IS NOT NULL AND amt IS NOT NULL AND hacct IS NOT NULL
+        AND COALESCE(frq, -1) = -1 AND (COALESCE(grftt, 0) < 64 OR iinst >= 0)
+        """
+    
+    /// Monthly totals of the mirrored Money transactions, oldest month first.
+    ///
+    /// Built in one grouped pass on the first mirror and adjusted by the rows of
+    /// the TRN pages each later mirror rescans. Transactions entered in the app
+    /// and not synced yet are not included.
+    /// - Parameters:
+    ///   - key: Group by account or by category
+    ///   - from: First month as yyyymm, or nil for the earliest
+    ///   - to: Last month as yyyymm, or nil for the latest
+    ///   - id: Only this hacct or hcat, or nil for all of them
+    func monthlyTotals(by key: SummaryKey, from: Int? = nil, to: Int? = nil, id: Int? = nil) throws -> [MonthlyTotal] {
+        let sql = """
+            SELECT yyyymm, \(key.column), cents, count FROM \(key.table)
+            WHERE yyyymm >= ?1 AND yyyymm <= ?2 AND (?3 IS NULL OR \(key.column) = ?3)
+            ORDER BY yyyymm, \(key.column)
+            """
+        
+        var statement: OpaquePointer?
+        guard sqlite3_prepare_v2(db, sql, -1, &statement, nil) == SQLITE_OK else {
+            let errmsg = String(cString: sqlite3_errmsg(db))
+            throw DatabaseError.prepareFailed(errmsg)
+        }
+        defer { sqlite3_finalize(statement) }
+        
+        sqlite3_bind_int64(statement, 1, Int64(from ?? 0))
+        sqlite3_bind_int64(statement, 2, Int64(to ?? 999999))
+        bindIntOrNull(statement, 3, id)
+        
+        var totals: [MonthlyTotal] = []
+        while sqlite3_step(statement) == SQLITE_ROW {
+            totals.append(MonthlyTotal(
+                month: Int(sqlite3_column_int64(statement, 0)),
+                key: Int(sqlite3_column_int64(statement, 1)),
+                cents: sqlite3_column_int64(statement, 2),
+                count: Int(sqlite3_column_int64(statement, 3))
+            ))
+        }
+        return totals
+    }
+    
+    private func summariesExist() -> Bool {
+        var statement: OpaquePointer?
+        var exists = false
+        if sqlite3_prepare_v2(db, "SELECT 1 FROM summary_month_account LIMIT 1", -1, &statement, nil) == SQLITE_OK {
+            exists = sqlite3_step(statement) == SQLITE_ROW
+            sqlite3_finalize(statement)
+        }
+        return exists
+    }
+    
+    /// Recompute both summaries from mirror_TRN in one grouped pass each
+    private func buildSummaries() throws {
+        for key in [SummaryKey.account, .category] {
+            try execute("DELETE FROM \(key.table)")
+            try execute("""
+                INSERT INTO \(key.table) (yyyymm, \(key.column), cents, count)
+                SELECT \(Self.summaryMonth), \(key.source), SUM(\(Self.summaryCents)), COUNT(*)
+                FROM mirror_TRN WHERE \(Self.summaryFilter)
+                GROUP BY 1, 2
+                """)
+        }
+    }
+    
+    /// Add (sign 1) or take away (sign -1) the rows mirror_TRN holds for `pages`
+    private func applySummaries(pages: [UInt32], sign: Int64) throws {
+        guard !pages.isEmpty else { return }
+        
+        for key in [SummaryKey.account, .category] {
+            let sql = """
+                INSERT INTO \(key.table) (yyyymm, \(key.column), cents, count)
+                SELECT \(Self.summaryMonth), \(key.source), ?2 * SUM(\(Self.summaryCents)), ?2 * COUNT(*)
+                FROM mirror_TRN WHERE _pg = ?1 AND \(Self.summaryFilter)
+                GROUP BY 1, 2
+                ON CONFLICT (yyyymm, \(key.column)) DO UPDATE
+                SET cents = cents + excluded.cents, count = count + excluded.count
+                """
+            
+            var statement: OpaquePointer?
+            guard sqlite3_prepare_v2(db, sql, -1, &statement, nil) == SQLITE_OK else {
+                let errmsg = String(cString: sqlite3_errmsg(db))
+                throw DatabaseError.prepareFailed(errmsg)
+            }
+            defer { sqlite3_finalize(statement) }
+            
+            for pg in pages {
+                sqlite3_bind_int64(statement, 1, Int64(pg))
+                sqlite3_bind_int64(statement, 2, sign)
+                guard sqlite3_step(statement) == SQLITE_DONE else {
+                    let errmsg = String(cString: sqlite3_errmsg(db))
+                    throw DatabaseError.executeFailed(errmsg)
+                }
+                sqlite3_reset(statement)
+            }
+        }
+    }
+    
     // MARK: - Helper Methods for Reading Columns
     
     private func columnString(_ statement: OpaquePointer?, _ index: Int32) -> String? {
@@ -0,0 +1,145 @@
+//
+//  MDBQueryJob.swift
+//  CheckbookApp
+//
+//  Asynchronous table scans and SQL queries on the mdbtools job pool
+//
+
+import Foundation
+
+/// A scan or query running on the engine's worker threads (async.c).
+///
+/// Nothing blocks the caller: rows arrive through `onBatch`/`onRow` and the
+/// outcome through `completion`, all on an engine thread, so hop to the main
+/// queue before touching UI state. Hold on to the job and call `cancel()` when
+/// its results are no longer wanted, e.g. when the user leaves the register;
+/// the scan then stops at its next batch or row.
+final class MDBQueryJob {
+
+    enum JobError: Error, LocalizedError {
+        case openFailed(String)
+        case submitFailed
+        case failed
+
+        var errorDescription: String? {
+            switch self {
+            case .openFailed(let path): return "Failed to open MDB: \(path)"
+            case .submitFailed: return "Failed to start engine job"
+            case .failed: return "Engine job failed"
+            }
+        }
+    }
+
+    /// Callbacks for one job; retained by the engine until its done callback
+    private final class Context {
+        let onBatch: ((UnsafeMutablePointer<MdbBatch>) -> Bool)?
+        let onRow: (([String?]) -> Bool)?
+        let completion: (Result<Bool, Error>) -> Void
+
+        init(onBatch: ((UnsafeMutablePointer<MdbBatch>) -> Bool)?,
+             onRow: (([String?]) -> Bool)?,
+             completion: @escaping (Result<Bool, Error>) -> Void) {
+            self.onBatch = onBatch
+            self.onRow = onRow
+            self.completion = completion
+        }
+    }
+
+    private let job: OpaquePointer
+
+    private init(job: OpaquePointer) {
+        self.job = job
+    }
+
+    deinit {
+        // The job keeps running unless cancelled; this only drops our reference
+        mdb_job_release(job)
+    }
+
+    /// Stop the job at its next batch or row; `completion` still runs, with `.success(false)`
+    func cancel() {
+        mdb_job_cancel(job)
+    }
+
+    /// Scan a table in column batches.
+    /// - Parameters:
+    ///   - path: Decrypted .mdb produced by MoneyDecryptorBridge
+    ///   - table: Table to scan, e.g. "TRN"
+    ///   - batchRows: Rows per batch, or 0 for the engine default
+    ///   - onBatch: Called for each batch, which is only valid during the call; return false to stop
+    ///   - completion: `.success(true)` when the scan finished, `.success(false)` if it was cancelled
+    static func scan(path: String, table: String, batchRows: Int = 0,
+                     onBatch: @escaping (UnsafeMutablePointer<MdbBatch>) -> Bool,
+                     completion: @escaping (Result<Bool, Error>) -> Void) throws -> MDBQueryJob {
+        let context = Context(onBatch: onBatch, onRow: nil, completion: completion)
+        return try submit(path: path, context: context) { mdb, user in
+            mdb_job_scan_table(mdb, table, UInt32(batchRows), { job, batch, user in
+                let context = Unmanaged<Context>.fromOpaque(user!).takeUnretainedValue()
+                return context.onBatch!(batch!) ? 1 : 0
+            }, MDBQueryJob.jobDone, user)
+        }
+    }
+
+    /// Run a SELECT (see mdbsql.c for the supported syntax), e.g. an aggregate.
+    /// A repeated query is answered from the engine's result cache (cache.c)
+    /// for as long as its table's pages are unchanged.
+    /// - Parameters:
+    ///   - path: Decrypted .mdb produced by MoneyDecryptorBridge
+    ///   - sql: Query without `?` parameters
+    ///   - onRow: Called with each row's values as text; return false to stop
+    ///   - completion: `.success(true)` when the query finished, `.success(false)` if it was cancelled
+    static func query(path: String, sql: String,
+                      onRow: @escaping ([String?]) -> Bool,
+                      completion: @escaping (Result<Bool, Error>) -> Void) throws -> MDBQueryJob {
+        _ = useIndexes
+        let context = Context(onBatch: nil, onRow: onRow, completion: completion)
+        return try submit(path: path, context: context) { mdb, user in
+            mdb_job_query(mdb, sql, { job, values, count, user in
+                let context = Unmanaged<Context>.fromOpaque(user!).takeUnretainedValue()
+                let row = (0..<Int(count)).map { i in values?[i].map { String(cString: $0) } }
+                return context.onRow!(row) ? 1 : 0
+            }, MDBQueryJob.jobDone, user)
+        }
+    }
+
+    /// The engine leaves indexes unused until MDB_USE_INDEX is set; queries
+    /// use them to find rows by their WHERE clause and to stop an
+    /// ORDER BY ... LIMIT after the rows it returns. Set before the first job.
+    private static let useIndexes: Void = {
+        mdb_set_option(UInt(MDB_USE_INDEX), 1)
+    }()
+
+    /// Open the file, hand it to `start` (which clones it) and close our copy
+    private static func submit(path: String, context: Context,
+                               start: (UnsafeMutablePointer<MdbHandle>, UnsafeMutableRawPointer) -> OpaquePointer?) throws -> MDBQueryJob {
+        guard let mdb = mdb_open(path, MDB_NOFLAGS) else {
+            throw JobError.openFailed(path)
+        }
+        // The job's clone holds its own reference to the file
+        defer { mdb_close(mdb) }
+
+        guard mdb_read_catalog(mdb, Int32(MDB_TABLE)) != nil else {
+            throw JobError.openFailed(path)
+        }
+
+        let user = Unmanaged.passRetained(context).toOpaque()
+        guard let job = start(mdb, user) else {
+            Unmanaged<Context>.fromOpaque(user).release()
+            throw JobError.submitFailed
+        }
+        return MDBQueryJob(job: job)
+    }
+
+    /// Done callback shared by every job; balances the retain in `submit`
+    private static let jobDone: MdbJobDoneFunc = { job, status, user in
+        let context = Unmanaged<Context>.fromOpaque(user!).takeRetainedValue()
+        switch Int(status) {
+        case MDB_JOB_OK:
+            context.completion(.success(true))
+        case MDB_JOB_CANCELLED:
+            context.completion(.success(false))
+        default:
+            context.completion(.failure(JobError.failed))
+        }
+    }
+}
@@ -512,11 +512,9 @@ class MDBToolsWriter {
                 
             default:
                 // Unknown fields - set to NULL
-                #if DEBUG
                 if col.col_type != 0 {  // Skip if actually defined
-                    print("[MDBToolsWriter] ⚠️  Unknown TRN field '\(colName)' at column \(i), type=\(col.col_type)")
+                    EngineLog.debug(.write, "Unknown TRN field '\(colName)' at column \(i), type=\(col.col_type)")
                 }
-                #endif
                 fields[i].value = nil
                 fields[i].siz = 0
                 fields[i].is_null = 1
@@ -1142,41 +1140,27 @@ class MDBToolsWriter {
         
         let tableDefPageNum = Int(table.pointee.entry.pointee.table_pg)
         
-        #if DEBUG
-        print("[MDBToolsWriter] Searching \(ownedPages.count) owned pages for space (\(rowSpaceUsage) bytes needed)")
-        print("[MDBToolsWriter] Table def page: \(tableDefPageNum)")
-        print("[MDBToolsWriter] Owned pages: \(ownedPages)")
-        #endif
+        EngineLog.debug(.write, "Searching \(ownedPages.count) owned pages of table def page \(tableDefPageNum) for \(rowSpaceUsage) bytes")
         
         // Search owned pages in reverse order (newest pages likely have more space)
         for pageNum in ownedPages.reversed() {
-            #if DEBUG
-            print("[MDBToolsWriter] Checking page \(pageNum)...")
-            #endif
-            
             // Skip non-data pages (page 0 is header, pages 1-14 are typically system)
             guard pageNum >= 15 else {
-                #if DEBUG
-                print("  → Skipped (system page < 15)")
-                #endif
+                EngineLog.debug(.write, "Page \(pageNum) skipped (system page < 15)")
                 continue
             }
             
             // Read page
             try fileHandle.seek(toOffset: UInt64(pageNum * pageSize))
             guard let pageData = try fileHandle.read(upToCount: pageSize) else {
-                #if DEBUG
-                print("  → Skipped (could not read)")
-                #endif
+                EngineLog.debug(.write, "Page \(pageNum) skipped (could not read)")
                 continue
             }
             
             // Check if it's a data page (type 0x01)
             let pageType = pageData[0]
             guard pageType == 0x01 else {
-                #if DEBUG
-                print("  → Skipped (page type \(pageType) != 0x01 DATA)")
-                #endif
+                EngineLog.debug(.write, "Page \(pageNum) skipped (page type \(pageType) != 0x01 DATA)")
                 continue
             }
             
@@ -1184,35 +1168,19 @@ class MDBToolsWriter {
             let pageTableDefPage = Int(pageData[4]) | (Int(pageData[5]) << 8) | 
                                   (Int(pageData[6]) << 16) | (Int(pageData[7]) << 24)
             
-            #if DEBUG
-            print("  → Page type: 0x01 (DATA)")
-            print("  → Page table def: \(pageTableDefPage) (expected \(tableDefPageNum))")
-            #endif
-            
             guard pageTableDefPage == tableDefPageNum else {
-                #if DEBUG
-                print("  → Skipped (wrong table)")
-                #endif
+                EngineLog.debug(.write, "Page \(pageNum) skipped (table def \(pageTableDefPage))")
                 continue
             }
             
             // Check free space
             let freeSpace = Int(pageData[2]) | (Int(pageData[3]) << 8)
             
-            #if DEBUG
-            print("  → Free space: \(freeSpace) bytes (need \(rowSpaceUsage))")
-            #endif
-            
             if freeSpace >= rowSpaceUsage {
-                #if DEBUG
-                print("[MDBToolsWriter] ✅ SELECTED page \(pageNum) with \(freeSpace) bytes free")
-                #endif
+                EngineLog.debug(.write, "Selected page \(pageNum) with \(freeSpace) bytes free")
                 return (pageNum, pageData)
-            } else {
-                #if DEBUG
-                print("  → Skipped (not enough space)")
-                #endif
             }
+            EngineLog.debug(.write, "Page \(pageNum) skipped (\(freeSpace) bytes free)")
         }
         
         throw WriteError.insertFailed("No suitable data page found among \(ownedPages.count) owned pages")
@@ -1232,12 +1200,7 @@ class MDBToolsWriter {
         
         let numRows = Int(table.pointee.num_rows)
         
-        #if DEBUG
-        print("[MDBToolsWriter] MANUAL WRITE TO .mny - PAYEE")
-        print("Table: \(tableName)")
-        print("Table reports \(numRows) existing rows")
-        print("Row size to write: \(rowSize) bytes")
-        #endif
+        EngineLog.debug(.write, "Writing \(rowSize) byte row to \(tableName) (\(numRows) rows)")
         
         // Step 1: Read usage map to find owned pages
         let ownedPages = try readUsageMap(fileHandle: fileHandle, table: table)
@@ -1304,16 +1267,10 @@ class MDBToolsWriter {
         try fileHandle.write(contentsOf: mutablePageData)
         try fileHandle.synchronize()
         
-        #if DEBUG
-        print("✅ Successfully wrote payee row to page \(pageNumber)")
-        #endif
-        
         // Step 11: Update table definition row count
         try updateTableDefinitionRowCount(fileHandle: fileHandle, table: table, newRowCount: numRows + 1)
         
-        #if DEBUG
-        print("✅ Payee table definition updated")
-        #endif
+        EngineLog.debug(.write, "Wrote \(tableName) row to page \(pageNumber)")
     }
     
     /// Write packed row data to .mny file manually
@@ -1331,21 +1288,7 @@ class MDBToolsWriter {
         
         let numRows = Int(table.pointee.num_rows)
         
-        #if DEBUG
-        print("═══════════════════════════════════════════════════════════════")
-        print("[MDBToolsWriter] HYBRID MODE: MANUAL WRITE + C INDEX UPDATES")
-        print("═══════════════════════════════════════════════════════════════")
-        print("Table: \(tableName)")
-        print("Table reports \(numRows) existing rows")
-        print("Row size to write: \(rowSize) bytes")
-        print("")
-        print("📋 STRATEGY:")
-        print("   1. Write data row to .mny manually (unencrypted pages 15+)")
-        print("   2. Update table definition (row count + index entry counts)")
-        print("   3. Let mdbtools C update indexes in .mdb (decrypted)")
-        print("   4. Copy updated index pages from .mdb to .mny with MSISAM encryption")
-        print("")
-        #endif
+        EngineLog.debug(.write, "Writing \(rowSize) byte row to \(tableName) (\(numRows) rows)")
         
         // Step 1: Read usage map to find owned pages
         let ownedPages = try readUsageMap(fileHandle: fileHandle, table: table)
@@ -1369,11 +1312,6 @@ class MDBToolsWriter {
         let rowCount = Int(mutablePageData[rowCountOffset]) | (Int(mutablePageData[rowCountOffset + 1]) << 8)
         let freeSpacePtr = Int(mutablePageData[2]) | (Int(mutablePageData[3]) << 8)
         
-        #if DEBUG
-        print("Current page row count: \(rowCount)")
-        print("Current free space: \(freeSpacePtr) bytes")
-        #endif
-        
         // Step 4: Calculate where to insert new row
         let rowOffsetTableStart = rowCountOffset + 2
         var insertOffset = pageSize
@@ -1386,10 +1324,6 @@ class MDBToolsWriter {
         
         insertOffset -= rowSize
         
-        #if DEBUG
-        print("Inserting row at offset: \(insertOffset)")
-        #endif
-        
         // Step 5: Verify space
         let newRowCount = rowCount + 1
         let rowOffsetTableEnd = rowOffsetTableStart + (newRowCount * 2)
@@ -1415,10 +1349,7 @@ class MDBToolsWriter {
         mutablePageData[2] = UInt8(freeSpace & 0xFF)
         mutablePageData[3] = UInt8((freeSpace >> 8) & 0xFF)
         
-        #if DEBUG
-        print("Updated row count: \(rowCount) → \(newRowCount)")
-        print("Updated free space: \(freeSpacePtr) → \(freeSpace)")
-        #endif
+        EngineLog.debug(.write, "Page \(pageNumber): row \(rowCount) at offset \(insertOffset), free space \(freeSpacePtr) → \(freeSpace)")
         
         // Step 10: Write page back to .mny
         let pageOffset = UInt64(pageNumber * pageSize)
@@ -1426,41 +1357,16 @@ class MDBToolsWriter {
         try fileHandle.write(contentsOf: mutablePageData)
         try fileHandle.synchronize()
         
-        #if DEBUG
-        print("✅ Successfully wrote row to page \(pageNumber)")
-        print("")
-        print("ℹ️  Updating table definition row count and ALL index entry counts...")
-        #endif
-        
         // Step 11: Update table definition row count AND all index entry counts
         // This is CRITICAL - without this, Money won't see the new row!
         do {
             try updateTableDefinitionRowCount(fileHandle: fileHandle, table: table, newRowCount: numRows + 1)
-            #if DEBUG
-            print("✅ Table definition row count update completed successfully")
-            #endif
         } catch {
-            #if DEBUG
-            print("❌ FATAL: Table definition update FAILED: \(error)")
-            #endif
+            EngineLog.error(.write, "Table definition update failed for \(tableName): \(error)")
             throw error  // Re-throw to stop execution
         }
         
-        #if DEBUG
-        print("✅ Table definition and index entry counts updated")
-        print("")
-        print("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━")
-        print("🔑 NEXT: CALL MDBTOOLS C TO UPDATE INDEXES")
-        print("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━")
-        print("ℹ️  We'll call mdb_update_indexes() from the C library")
-        print("ℹ️  It will update indexes in the .mdb file (decrypted)")
-        print("ℹ️  Then we copy index pages to .mny with MSISAM encryption")
-        print("")
-        print("⚠️  NOTE: mdbtools writes to .mdb, NOT .mny")
-        print("   We'll handle MSISAM encryption separately")
-        print("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━")
-        print("")
-        #endif
+        EngineLog.debug(.write, "Table definition of \(tableName) updated to \(numRows + 1) rows")
         
         // Step 12: Let mdbtools C update the indexes
         // NOTE: This updates the .mdb file (decrypted), not the .mny
@@ -1471,18 +1377,10 @@ class MDBToolsWriter {
         
         // Get the mdb handle from table
         guard let mdbHandle = table.pointee.entry.pointee.mdb else {
-            #if DEBUG
-            print("❌ No MDB handle available for index updates")
-            #endif
+            EngineLog.error(.write, "No MDB handle available for index updates")
             throw WriteError.insertFailed("No MDB handle")
         }
         
-        #if DEBUG
-        print("[MDBToolsWriter] 🔧 Calling mdb_update_indexes() from C...")
-        print("   Page: \(pageNumber), Row: \(newRowCount - 1)")
-        print("   Table has \(table.pointee.num_idxs) indexes")
-        #endif
-        
         // Reconstruct MdbField array for C function
         // We need to pass the same fields we used for packing the row
         let numCols = Int(table.pointee.num_cols)
@@ -1515,54 +1413,15 @@ class MDBToolsWriter {
         }
         
         if result == 0 {
-            #if DEBUG
-            print("❌ mdb_update_indexes() returned 0 (failure)")
-            #endif
+            EngineLog.error(.write, "mdb_update_indexes failed for page \(pageNumber), row \(newRowCount - 1)")
             throw WriteError.insertFailed("mdb_update_indexes failed")
         }
         
-        #if DEBUG
-        print("✅ mdb_update_indexes() completed successfully")
-        print("")
-        print("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━")
-        print("⚠️  INDEX UPDATES SKIPPED")
-        print("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━")
-        print("ℹ️  Indexes NOT updated (too complex for mdbtools)")
-        print("ℹ️  Money Desktop will rebuild them automatically")
-        print("")
-        print("📋 USER ACTION REQUIRED:")
-        print("   After syncing, open Money Desktop and run:")
-        print("   File → Validate and Repair Money File")
-        print("   (This rebuilds all indexes)")
-        print("")
-        print("🎯 RESULT:")
-        print("   ✓ Data row written correctly")
-        print("   ✓ Table row count updated")
-        print("   ⚠️  Indexes stale (need rebuild)")
-        print("   ⚠️  Transaction NOT visible until repair")
-        print("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━")
-        #endif
-        
         // Step 13: SKIP index page copying (no indexes were updated)
         // Since mdb_update_indexes() returns early without updating anything,
         // there's nothing to copy. Money will rebuild indexes on next open.
         
-        #if DEBUG
-        print("")
-        print("═══════════════════════════════════════════════════════════════")
-        print("✅ DATA WRITE COMPLETE")
-        print("═══════════════════════════════════════════════════════════════")
-        print("✓ Transaction data written to .mny")
-        print("✓ Table definition updated (row count)")
-        print("⚠️  Indexes need rebuild (user action required)")
-        print("")
-        print("🔧 Next Steps:")
-        print("   1. Upload test file to OneDrive ✓")
-        print("   2. Open in Money Desktop")
-        print("   3. Run 'Validate and Repair'")
-        print("   4. Transaction will appear after repair")
-        print("═══════════════════════════════════════════════════════════════")
-        #endif
+        EngineLog.debug(.write, "Wrote \(tableName) row to page \(pageNumber); indexes left for Money to rebuild")
     }
     
     /// Copy index pages from .mdb to .mny with MSISAM encryption
@@ -1686,15 +1545,6 @@ class MDBToolsWriter {
         let pageSize = 4096
         let tableDefPageNum = Int(table.pointee.entry.pointee.table_pg)
         
-        #if DEBUG
-        print("[MDBToolsWriter] ═══════════════════════════════════════════")
-        print("[MDBToolsWriter] UPDATE TABLE DEFINITION - DIAGNOSTIC")
-        print("[MDBToolsWriter] ═══════════════════════════════════════════")
-        print("[MDBToolsWriter] Table def page number: \(tableDefPageNum)")
-        print("[MDBToolsWriter] Metadata says: \(table.pointee.num_rows) rows")
-        print("[MDBToolsWriter] New row count parameter: \(newRowCount)")
-        #endif
-        
         // NOTE: Table definition pages for user tables (like TRN) can be > 14
         // Only the system catalog (MSysObjects, etc.) is in pages 1-14
         // So page 397 for TRN is perfectly normal!
@@ -1710,37 +1560,11 @@ class MDBToolsWriter {
         // They are written as plain data pages
         // Only system pages 1-14 use MSISAM encryption
         
-        #if DEBUG
-        print("[MDBToolsWriter] ℹ️  Page \(tableDefPageNum) - User table definition (NOT encrypted)")
-        #endif
-        
         // Check page type to confirm this is actually a table definition page
         let pageType = pageData[0]
-        
-        #if DEBUG
-        print("[MDBToolsWriter] Page type byte: 0x\(String(format: "%02X", pageType))")
-        print("[MDBToolsWriter] Expected: 0x02 (TABLE DEFINITION)")
-        
-        // Also verify the magic number at offset 12
-        let magicNumber = Int(pageData[12]) |
-                         (Int(pageData[13]) << 8) |
-                         (Int(pageData[14]) << 16) |
-                         (Int(pageData[15]) << 24)
-        print("[MDBToolsWriter] Magic number at offset 12: \(magicNumber)")
-        print("[MDBToolsWriter] Expected: 1625 (0x659)")
-        #endif
-        
         if pageType != 0x02 {
-            #if DEBUG
-            print("[MDBToolsWriter] ❌ ERROR: Page type is 0x\(String(format: "%02X", pageType)), not 0x02!")
-            print("[MDBToolsWriter] This is NOT a table definition page!")
-            print("[MDBToolsWriter] First 64 bytes of page:")
-            for i in 0..<4 {
-                let offset = i * 16
-                let bytes = (0..<16).map { String(format: "%02X", pageData[offset + $0]) }.joined(separator: " ")
-                print("[MDBToolsWriter]   \(String(format: "%04X", offset)): \(bytes)")
-            }
-            #endif
+            EngineLog.debug(.write, "Page \(tableDefPageNum) starts " +
+                            pageData.prefix(64).map { String(format: "%02X", $0) }.joined(separator: " "))
             throw WriteError.insertFailed("Page \(tableDefPageNum) is not a table definition page (type 0x\(String(format: "%02X", pageType)))")
         }
         
@@ -1755,24 +1579,13 @@ class MDBToolsWriter {
                              (Int(pageData[rowCountOffset + 2]) << 16) |
                              (Int(pageData[rowCountOffset + 3]) << 24)
         
-        #if DEBUG
-        print("[MDBToolsWriter] Current row count in table def: \(currentRowCount)")
-        
-        if currentRowCount < 100 || currentRowCount > 1000 {
-            print("[MDBToolsWriter] ⚠️  WARNING: Row count \(currentRowCount) is outside expected range!")
-            print("[MDBToolsWriter] Expected around 203 rows for TRN table")
-            print("[MDBToolsWriter] Proceeding anyway, but verify this is correct...")
-        }
-        #endif
-        
         // CRITICAL FIX: Use the CURRENT row count from the file, not from metadata!
         // The metadata (from decrypted .mdb) may be stale
         // The actual .mny file knows the real count
         let actualNewRowCount = currentRowCount + 1
         
-        #if DEBUG
-        print("[MDBToolsWriter] 🔧 CORRECTED: Using actual count \(actualNewRowCount) instead of \(newRowCount)")
-        #endif
+        EngineLog.debug(.write, "Table definition page \(tableDefPageNum): \(currentRowCount) rows in the file, " +
+                        "\(table.pointee.num_rows) in the metadata, \(newRowCount) requested; writing \(actualNewRowCount)")
         
         // Update row count
         pageData[rowCountOffset] = UInt8(actualNewRowCount & 0xFF)
@@ -1799,11 +1612,6 @@ class MDBToolsWriter {
         let tabColsStartOffset = 63  // Jet4 constant
         let tabRidxEntrySize = 12    // Jet4 constant
         
-        #if DEBUG
-        print("[MDBToolsWriter] 🔑 UPDATING INDEX ENTRY COUNTS (CRITICAL FOR VISIBILITY)")
-        print("[MDBToolsWriter] Number of indexes: \(numIndexes)")
-        #endif
-        
         for i in 0..<numIndexes {
             let indexOffset = tabColsStartOffset + (i * tabRidxEntrySize)
             
@@ -1821,16 +1629,9 @@ class MDBToolsWriter {
             pageData[indexOffset + 2] = UInt8((newIndexCount >> 16) & 0xFF)
             pageData[indexOffset + 3] = UInt8((newIndexCount >> 24) & 0xFF)
             
-            #if DEBUG
-            print("[MDBToolsWriter]   Index \(i): \(currentIndexCount) → \(newIndexCount) (offset \(indexOffset))")
-            #endif
+            EngineLog.debug(.write, "Index \(i) row count \(currentIndexCount) → \(newIndexCount) (offset \(indexOffset))")
         }
         
-        #if DEBUG
-        print("[MDBToolsWriter] ✅ Updated ALL index entry counts")
-        print("[MDBToolsWriter] ℹ️  Writing modified page back to disk...")
-        #endif
-        
         // NOTE: User table definition pages (page > 14) are NOT encrypted
         // They are written as plain data pages
         // Only system pages 1-14 use MSISAM encryption
@@ -1841,51 +1642,27 @@ class MDBToolsWriter {
         try fileHandle.synchronize()
         
         #if DEBUG
-        print("[MDBToolsWriter] ✅ Updated table definition:")
-        print("[MDBToolsWriter]   - Row count: \(currentRowCount) → \(actualNewRowCount)")
-        print("[MDBToolsWriter]   - \(numIndexes) index entry counts updated")
-        print("[MDBToolsWriter]   - Page \(tableDefPageNum) written back to disk")
-        
-        // VERIFICATION: Read back the table definition to confirm
+        // Read the page back to confirm the counts landed
         try fileHandle.seek(toOffset: pageOffset)
         if let verifyData = try fileHandle.read(upToCount: pageSize) {
-            // User table pages (> 14) are NOT encrypted, read directly
-            
             let verifyRowCount = Int(verifyData[rowCountOffset]) |
                                 (Int(verifyData[rowCountOffset + 1]) << 8) |
                                 (Int(verifyData[rowCountOffset + 2]) << 16) |
                                 (Int(verifyData[rowCountOffset + 3]) << 24)
-            
-            print("[MDBToolsWriter] 🔍 VERIFICATION: Read back row count = \(verifyRowCount)")
-            
-            if verifyRowCount == actualNewRowCount {
-                print("[MDBToolsWriter] ✅ ✅ ✅ VERIFIED: Row count updated correctly!")
-                
-                // Also verify index counts
-                var allIndexesCorrect = true
-                for i in 0..<numIndexes {
-                    let indexOffset = tabColsStartOffset + (i * tabRidxEntrySize)
-                    let verifyIndexCount = Int(verifyData[indexOffset]) |
-                                          (Int(verifyData[indexOffset + 1]) << 8) |
-                                          (Int(verifyData[indexOffset + 2]) << 16) |
-                                          (Int(verifyData[indexOffset + 3]) << 24)
-                    
-                    if verifyIndexCount != currentRowCount + 1 {
-                        print("[MDBToolsWriter] ❌ Index \(i) verification FAILED: expected \(currentRowCount + 1), got \(verifyIndexCount)")
-                        allIndexesCorrect = false
-                    }
-                }
-                
-                if allIndexesCorrect {
-                    print("[MDBToolsWriter] ✅ All \(numIndexes) index counts verified!")
-                }
-                
-            } else {
-                print("[MDBToolsWriter] ❌ ❌ ❌ VERIFICATION FAILED!")
-                print("[MDBToolsWriter]     Expected: \(actualNewRowCount)")
-                print("[MDBToolsWriter]     Got: \(verifyRowCount)")
+            guard verifyRowCount == actualNewRowCount else {
+                EngineLog.error(.write, "Table definition page \(tableDefPageNum) reads back \(verifyRowCount) rows, expected \(actualNewRowCount)")
                 throw WriteError.insertFailed("Table definition row count verification failed!")
             }
+            for i in 0..<numIndexes {
+                let indexOffset = tabColsStartOffset + (i * tabRidxEntrySize)
+                let verifyIndexCount = Int(verifyData[indexOffset]) |
+                                      (Int(verifyData[indexOffset + 1]) << 8) |
+                                      (Int(verifyData[indexOffset + 2]) << 16) |
+                                      (Int(verifyData[indexOffset + 3]) << 24)
+                if verifyIndexCount != currentRowCount + 1 {
+                    EngineLog.warn(.write, "Index \(i) reads back \(verifyIndexCount) rows, expected \(currentRowCount + 1)")
+                }
+            }
         }
         #endif
     }
@@ -179,6 +179,13 @@ public enum MoneyFileService {
         let decryptedPath = try MoneyDecryptorBridge.decryptToTempFile(fromFile: url.path, password: password)
         print("[MoneyFileService] Decrypted file path: \(decryptedPath)")
         
+        // Bring the SQLite mirror up to date; only changed pages are rescanned
+        do {
+            try LocalDatabaseManager.shared.mirrorMoneyFile(at: decryptedPath)
+        } catch {
+            print("[MoneyFileService] ⚠️ Mirror refresh failed: \(error)")
+        }
+        
         // TODO: MDBToolsWrapper requires Process API which doesn't work on iOS device
         // Using SimpleMDBParser with mdbtools library compiled for iOS
         print("[MoneyFileService] Using MoneyFileParser (mdbtools)")
@@ -0,0 +1,75 @@
+//
+//  PayeeIndex.swift
+//  CheckbookApp
+//
+//  Payee autocomplete backed by the engine's prefix index (prefix.c)
+//
+
+import Foundation
+
+/// Case-insensitive prefix search over PAY names, ranked by how many TRN rows use each payee.
+///
+/// The index is saved under Caches and reused while PAY and TRN are unchanged, so
+/// opening it does not decode PAY again and each keystroke is a lookup in memory.
+/// Payees and uses created in the app are added in place and saved with it.
+final class PayeeIndex {
+
+    private let index: OpaquePointer
+    private let cachePath: String
+
+    private init(index: OpaquePointer, cachePath: String) {
+        self.index = index
+        self.cachePath = cachePath
+    }
+
+    deinit {
+        mdb_prefix_index_free(index)
+    }
+
+    /// Load the saved index for a Money file, or build it from PAY and TRN if either changed.
+    /// - Parameters:
+    ///   - path: Decrypted .mdb produced by MoneyDecryptorBridge
+    ///   - name: Names the saved index, e.g. the Money file's name
+    static func open(path: String, name: String) throws -> PayeeIndex {
+        try EngineCache.withMoneyFile(path: path, file: "\(name).payees") { mdb, cachePath in
+            guard let index = mdb_prefix_index_open(mdb, "PAY", "hpay", "szFull", "TRN", "lHpay", cachePath) else {
+                throw EngineCache.CacheError.buildFailed("payees")
+            }
+            return PayeeIndex(index: index, cachePath: cachePath)
+        }
+    }
+
+    /// Most payees a search returns unless told otherwise, enough to fill the suggestion list
+    static let defaultLimit = 50
+
+    /// Payees with a word starting with `text`, most used first; every payee when `text` is empty
+    /// - Parameter limit: Most payees to return, or 0 for all of them
+    func search(_ text: String, limit: Int = PayeeIndex.defaultLimit) -> [MoneyPayee] {
+        let capacity = limit > 0 ? limit : Int(mdb_prefix_index_count(index))
+        guard capacity > 0 else { return [] }
+        var matches = [MdbPrefixMatch](repeating: MdbPrefixMatch(), count: capacity)
+        let count = mdb_prefix_index_lookup(index, text, &matches, UInt32(capacity))
+        defer { mdb_prefix_index_free_matches(&matches, count) }
+        return matches.prefix(Int(count)).map { MoneyPayee(id: Int($0.id), name: String(cString: $0.name)) }
+    }
+
+    /// Add a payee created in the app, or rename one, and save the index
+    func add(_ payee: MoneyPayee) {
+        mdb_prefix_index_add(index, Int32(payee.id), payee.name)
+        save()
+    }
+
+    /// Count a new transaction for `payeeId` so it ranks higher, and save the index
+    func recordUse(payeeId: Int) {
+        mdb_prefix_index_use(index, Int32(payeeId))
+        save()
+    }
+
+    private func save() {
+        if mdb_prefix_index_save(index, cachePath) == 0 {
+            #if DEBUG
+            print("[PayeeIndex] Failed to save \(cachePath)")
+            #endif
+        }
+    }
+}
@@ -0,0 +1,88 @@
+//
+//  RunningBalance.swift
+//  CheckbookApp
+//
+//  Register running balances backed by the engine's ledger (ledger.c)
+//
+
+import Foundation
+
+/// Per-account running balances of posted transactions, in (date, htrn) order.
+///
+/// The engine keeps each account's rows in blocks with prefix sums over them, so the
+/// balance at any row, or a whole page of a register, is found without summing the
+/// rows before it, and adding or removing a transaction does not redo the others.
+final class RunningBalance {
+
+    struct Entry {
+        let transactionId: Int
+        /// Account balance after this transaction, opening balance included
+        let balance: Decimal
+    }
+
+    private let ledger: OpaquePointer
+
+    init() {
+        ledger = mdb_ledger_new()
+    }
+
+    /// Ledger of the transactions that count in balances (see shouldCountInBalance)
+    convenience init(transactions: [MoneyTransaction]) {
+        self.init()
+        transactions.filter { $0.shouldCountInBalance }.forEach { insert($0) }
+    }
+
+    deinit {
+        mdb_ledger_free(ledger)
+    }
+
+    func insert(_ transaction: MoneyTransaction) {
+        mdb_ledger_insert(ledger, Int32(transaction.accountId), Self.key(transaction.date),
+                          Int32(transaction.id), Self.units(transaction.amount))
+    }
+
+    func remove(_ transaction: MoneyTransaction) {
+        mdb_ledger_remove(ledger, Int32(transaction.accountId), Self.key(transaction.date), Int32(transaction.id))
+    }
+
+    func count(accountId: Int) -> Int {
+        Int(mdb_ledger_count(ledger, Int32(accountId)))
+    }
+
+    /// Balance at the start of `date`, i.e. after every transaction dated earlier
+    func balance(accountId: Int, before date: Date, opening: Decimal = 0) -> Decimal {
+        let rank = mdb_ledger_rank(ledger, Int32(accountId), Self.key(date), Int32.min)
+        return opening + Self.decimal(mdb_ledger_balance(ledger, Int32(accountId), rank))
+    }
+
+    /// One page of a register shown newest first
+    /// - Parameters:
+    ///   - offset: Rows to skip from the newest
+    ///   - limit: Most rows to return
+    ///   - opening: The account's opening balance, added to every row
+    func page(accountId: Int, offset: Int, limit: Int, opening: Decimal = 0) -> [Entry] {
+        let total = count(accountId: accountId)
+        guard offset < total, limit > 0 else { return [] }
+        let end = total - offset
+        let start = max(0, end - limit)
+
+        var entries = [MdbLedgerEntry](repeating: MdbLedgerEntry(), count: end - start)
+        let filled = Int(mdb_ledger_entries(ledger, Int32(accountId), UInt32(start), &entries, UInt32(entries.count)))
+        return entries.prefix(filled).reversed().map {
+            Entry(transactionId: Int($0.id), balance: opening + Self.decimal($0.balance))
+        }
+    }
+
+    // Money amounts have four decimal places; the ledger sums them as integers
+    private static func units(_ amount: Decimal) -> Int64 {
+        NSDecimalNumber(decimal: amount * 10000).int64Value
+    }
+
+    private static func decimal(_ units: Int64) -> Decimal {
+        Decimal(units) / 10000
+    }
+
+    private static func key(_ date: Date) -> Int64 {
+        Int64((date.timeIntervalSince1970 * 1000).rounded(.down))
+    }
+}
@@ -162,9 +162,7 @@ class SyncService {
         var payeeIdMapping: [Int: Int] = [:]  // oldId -> newId
         
         for payee in payees {
-            #if DEBUG
-            print("[SyncService] Reassigning payee ID: \(payee.hpay) → \(nextPayeeId)")
-            #endif
+            EngineLog.debug(.sync, "Reassigning payee ID: \(payee.hpay) → \(nextPayeeId)")
             
             payeesWithNewIds.append((payee, nextPayeeId))
             payeeIdMapping[payee.hpay] = nextPayeeId  // Save mapping
@@ -176,14 +174,7 @@ class SyncService {
         var transactionsWithNewIds: [(transaction: LocalTransaction, newId: Int)] = []
         
         for transaction in transactions {
-            #if DEBUG
-            print("[SyncService] Reassigning transaction ID: \(transaction.htrn) → \(nextId)")
-            
-            // Check if this transaction references a payee that was just created
-            if let oldPayeeId = transaction.lHpay, let newPayeeId = payeeIdMapping[oldPayeeId] {
-                print("[SyncService]   → Remapping payee ID: \(oldPayeeId) → \(newPayeeId)")
-            }
-            #endif
+            EngineLog.debug(.sync, "Reassigning transaction ID: \(transaction.htrn) → \(nextId)")
             
             transactionsWithNewIds.append((transaction, nextId))
             nextId += 1
@@ -210,9 +201,7 @@ class SyncService {
         
         // Insert payees first (transactions may reference them) with reassigned sequential IDs
         for (originalPayee, newId) in payeesWithNewIds {
-            #if DEBUG
-            print("[SyncService] Inserting payee: \(originalPayee.szFull) (ID: \(newId), was \(originalPayee.hpay))")
-            #endif
+            EngineLog.debug(.sync, "Inserting payee: \(originalPayee.szFull) (ID: \(newId), was \(originalPayee.hpay))")
             
             // CRITICAL: Set dtLast to the transaction date if this payee is used in a transaction
             // Find the earliest transaction date that uses this payee
@@ -221,9 +210,7 @@ class SyncService {
                 if transaction.lHpay == originalPayee.hpay {
                     // Found a transaction using this payee
                     payeeLastUsedDate = transaction.dt
-                    #if DEBUG
-                    print("[SyncService]   → Payee last used on: \(transaction.dt)")
-                    #endif
+                    EngineLog.debug(.sync, "Payee \(newId) last used on: \(transaction.dt)")
                     break
                 }
             }
@@ -276,17 +263,13 @@ class SyncService {
         
         // Insert transactions with reassigned sequential IDs
         for (originalTransaction, newId) in transactionsWithNewIds {
-            #if DEBUG
-            print("[SyncService] Inserting transaction: ID=\(newId) (was \(originalTransaction.htrn)), Amount=\(originalTransaction.amt)")
-            #endif
+            EngineLog.debug(.sync, "Inserting transaction: ID=\(newId) (was \(originalTransaction.htrn)), Amount=\(originalTransaction.amt)")
             
             // CRITICAL: Remap payee ID if this transaction references a newly created payee
             let remappedPayeeId: Int?
             if let oldPayeeId = originalTransaction.lHpay {
                 if let newPayeeId = payeeIdMapping[oldPayeeId] {
-                    #if DEBUG
-                    print("[SyncService]   → Using remapped payee ID: \(oldPayeeId) → \(newPayeeId)")
-                    #endif
+                    EngineLog.debug(.sync, "Transaction \(newId) uses remapped payee ID: \(oldPayeeId) → \(newPayeeId)")
                     remappedPayeeId = newPayeeId
                 } else {
                     // Payee already existed in Money file, use original ID
@@ -8,6 +8,8 @@ struct UIAccount: Identifiable, Hashable {
     var currentBalance: Decimal
     var hasUnsyncedTransactions: Bool = false
     var isFavorite: Bool = false
+    /// Net of this month's posted transactions, from the mirror's monthly summary
+    var monthChange: Decimal? = nil
 }
 
 struct AccountsView: View {
@@ -103,6 +105,12 @@ struct AccountsView: View {
                                     VStack(alignment: .leading, spacing: 4) {
                                         Text(account.name)
                                         
+                                        if let change = account.monthChange {
+                                            (Text("This month: ") + Text(change, format: .currency(code: Locale.current.currencyCode ?? "USD")))
+                                                .font(.caption2)
+                                                .foregroundColor(.secondary)
+                                        }
+                                        
                                         if account.hasUnsyncedTransactions {
                                             HStack(spacing: 4) {
                                                 Image(systemName: "exclamationmark.triangle.fill")
@@ -271,7 +279,7 @@ struct AccountsView: View {
                         let enhancedSummaries = try AccountBalanceService.readAccountSummariesWithLocal()
                         
                         // Map to UIAccount
-                        let uiAccounts = enhancedSummaries.map { s in
+                        let uiAccounts = Self.withMonthChanges(enhancedSummaries.map { s in
                             UIAccount(
                                 id: s.id,
                                 name: s.name,
@@ -280,7 +288,7 @@ struct AccountsView: View {
                                 hasUnsyncedTransactions: s.hasUnsyncedTransactions,
                                 isFavorite: s.isFavorite
                             )
-                        }
+                        })
                         
                         DispatchQueue.main.async {
                             self.accounts = uiAccounts
@@ -415,7 +423,7 @@ struct AccountsView: View {
                 let enhancedSummaries = try AccountBalanceService.readAccountSummariesWithLocal()
                 
                 // Map to UIAccount
-                let uiAccounts = enhancedSummaries.map { s in
+                let uiAccounts = Self.withMonthChanges(enhancedSummaries.map { s in
                     UIAccount(
                         id: s.id,
                         name: s.name,
@@ -424,7 +432,7 @@ struct AccountsView: View {
                         hasUnsyncedTransactions: s.hasUnsyncedTransactions,
                         isFavorite: s.isFavorite
                     )
-                }
+                })
                 
                 DispatchQueue.main.async {
                     self.accounts = uiAccounts
@@ -445,6 +453,24 @@ struct AccountsView: View {
         }
     }
     
+    /// Fill in each account's net change this month from the mirror's monthly summary.
+    /// The mirror holds synced transactions only; accounts without any this month get none.
+    private static func withMonthChanges(_ accounts: [UIAccount]) -> [UIAccount] {
+        // Summary months are of Money's wall-clock dates, so take today's here too
+        let now = Calendar.current.dateComponents([.year, .month], from: Date())
+        let month = now.year! * 100 + now.month!
+        
+        guard let totals = try? LocalDatabaseManager.shared.monthlyTotals(by: .account, from: month, to: month) else {
+            return accounts
+        }
+        let changes = Dictionary(totals.map { ($0.key, Decimal($0.cents) / 100) }, uniquingKeysWith: +)
+        return accounts.map { account in
+            var account = account
+            account.monthChange = changes[account.id]
+            return account
+        }
+    }
+    
     /// Async version of refresh for pull-to-refresh
     private func refreshAccountsAsync() async {
         await withCheckedContinuation { continuation in
@@ -16,9 +16,10 @@ struct NewTransactionView: View {
     @State private var selectedCategory: CategoryWithType?
     @State private var selectedPayee: MoneyPayee?
     
-    @State private var categories: [MoneyCategory] = []
+    @State private var categories: [CategoryWithType] = []  // Income and expense categories, in tree order
     @State private var payees: [MoneyPayee] = []
     @State private var localPayees: [MoneyPayee] = []  // Payees from local DB
+    @State private var payeeIndex: PayeeIndex?  // Autocomplete over PAY, see PayeeIndex
     
     @State private var showingCategoryPicker = false
     @State private var showingPayeePicker = false
@@ -154,6 +155,7 @@ struct NewTransactionView: View {
             .sheet(isPresented: $showingPayeePicker) {
                 PayeePickerView(
                     payees: allPayees,
+                    index: payeeIndex,
                     selectedPayee: $selectedPayee,
                     onAddNew: { newPayeeName in
                         addNewPayee(name: newPayeeName)
@@ -270,16 +272,29 @@ struct NewTransactionView: View {
                 #endif
                 
                 let parser = MoneyFileParser(filePath: decryptedPath)
-                let cats = try parser.parseCategories()
-                let pays = try parser.parsePayees()
+                let fileName = url.deletingPathExtension().lastPathComponent
+                
+                // Paths and parents come from the saved category tree, which
+                // only rereads CAT pages that changed since it was saved
+                let tree = try CategoryTree.open(path: decryptedPath, name: fileName)
+                let cats = tree.nodes.compactMap { node -> CategoryWithType? in
+                    guard let isExpense = tree.isExpense(node.category.id) else { return nil }
+                    return CategoryWithType(category: node.category, isExpense: isExpense, displayPath: node.displayPath)
+                }
+                
+                // The payee index is reused while PAY and TRN are unchanged;
+                // only fall back to reading PAY if it can't be opened
+                let index = try? PayeeIndex.open(path: decryptedPath, name: fileName)
+                let pays = index == nil ? try parser.parsePayees() : []
                 
                 #if DEBUG
-                print("[NewTransactionView] ✅ Successfully loaded \(cats.count) categories, \(pays.count) payees")
+                print("[NewTransactionView] ✅ Successfully loaded \(cats.count) categories, \(index != nil ? "payee index" : "\(pays.count) payees")")
                 #endif
                 
                 DispatchQueue.main.async {
                     self.categories = cats
                     self.payees = pays
+                    self.payeeIndex = index
                     self.isLoading = false
                     
                     #if DEBUG
@@ -318,6 +333,7 @@ struct NewTransactionView: View {
         
         isSaving = true
         errorMessage = nil
+        let index = payeeIndex
         
         DispatchQueue.global(qos: .userInitiated).async {
             do {
@@ -363,6 +379,10 @@ struct NewTransactionView: View {
                 
                 print("✅✅✅ DATABASE INSERT COMPLETED! ✅✅✅")
                 
+                if let payeeId = transaction.lHpay {
+                    index?.recordUse(payeeId: payeeId)
+                }
+                
                 DispatchQueue.main.async {
                     self.isSaving = false
                     
@@ -393,6 +413,8 @@ struct NewTransactionView: View {
         print("[NewTransactionView] addNewPayee called with name: '\(name)'")
         #endif
         
+        let index = payeeIndex
+        
         DispatchQueue.global(qos: .userInitiated).async {
             do {
                 let nextId = try LocalDatabaseManager.shared.getNextPayeeId()
@@ -415,6 +437,7 @@ struct NewTransactionView: View {
                 
                 // Add to local payees list
                 let moneyPayee = MoneyPayee(id: nextId, name: name)
+                index?.add(moneyPayee)
                 DispatchQueue.main.async {
                     self.localPayees.append(moneyPayee)
                     self.selectedPayee = moneyPayee
@@ -446,7 +469,7 @@ struct CategoryWithType: Identifiable {
 // MARK: - Category Picker View
 
 struct CategoryPickerView: View {
-    let categories: [MoneyCategory]
+    let categories: [CategoryWithType]
     @Binding var selectedCategory: CategoryWithType?
     @Environment(\.dismiss) private var dismiss
     
@@ -506,105 +529,20 @@ struct CategoryPickerView: View {
     }
     
     private var filteredCategories: [CategoryWithType] {
-        let lookup = Dictionary(uniqueKeysWithValues: categories.map { ($0.id, $0) })
-        
-        // Filter out root categories (INCOME, EXPENSE)
-        let nonRootCategories = categories.filter { cat in
-            cat.name != "INCOME" && cat.name != "EXPENSE"
-        }
-        
-        // Map to CategoryWithType with full path
-        let categoriesWithType = nonRootCategories.compactMap { cat -> CategoryWithType? in
-            guard let typeInfo = determineType(for: cat, lookup: lookup) else {
-                return nil
-            }
-            
-            // Build display path
-            let displayPath = buildCategoryPath(for: cat, lookup: lookup)
-            
-            return CategoryWithType(category: cat, isExpense: typeInfo, displayPath: displayPath)
-        }
-        
-        // Filter by search text
+        // Already in tree order, each parent followed by its children by name
         if searchText.isEmpty {
-            return categoriesWithType.sorted { $0.displayPath < $1.displayPath }
+            return categories
         } else {
-            return categoriesWithType
-                .filter { $0.displayPath.localizedCaseInsensitiveContains(searchText) }
-                .sorted { $0.displayPath < $1.displayPath }
+            return categories.filter { $0.displayPath.localizedCaseInsensitiveContains(searchText) }
         }
     }
-    
-    /// Build full category path like "Automobile : Gasoline"
-    private func buildCategoryPath(for category: MoneyCategory, lookup: [Int: MoneyCategory]) -> String {
-        var path: [String] = []
-        var current = category
-        var visited: Set<Int> = []
-        
-        // Add current category
-        path.append(current.name)
-        visited.insert(current.id)
-        
-        // Walk up the parent chain
-        while let parentId = current.parentId {
-            // Prevent infinite loops
-            guard !visited.contains(parentId) else { break }
-            visited.insert(parentId)
-            
-            guard let parent = lookup[parentId] else { break }
-            
-            // Skip root categories (INCOME, EXPENSE)
-            if parent.name == "INCOME" || parent.name == "EXPENSE" {
-                break
-            }
-            
-            // Add parent to front of path
-            path.insert(parent.name, at: 0)
-            current = parent
-        }
-        
-        return path.joined(separator: " : ")
-    }
-    
-    /// Determine if category is expense (131) or income (130) by walking up parent chain
-    private func determineType(for category: MoneyCategory, lookup: [Int: MoneyCategory]) -> Bool? {
-        var current = category
-        var visited: Set<Int> = []
-        
-        // Walk up the parent chain
-        while let parentId = current.parentId {
-            // Prevent infinite loops
-            guard !visited.contains(parentId) else { break }
-            visited.insert(parentId)
-            
-            // Check if this is the EXPENSE or INCOME root
-            if parentId == 131 {
-                return true  // Expense
-            } else if parentId == 130 {
-                return false  // Income
-            }
-            
-            // Move to parent
-            guard let parent = lookup[parentId] else { break }
-            current = parent
-        }
-        
-        // If we didn't find 130 or 131, check the category ID itself
-        if category.id == 131 || category.parentId == 131 {
-            return true  // Expense
-        } else if category.id == 130 || category.parentId == 130 {
-            return false  // Income
-        }
-        
-        // Default to nil if we can't determine
-        return nil
-    }
 }
 
 // MARK: - Payee Picker View
 
 struct PayeePickerView: View {
     let payees: [MoneyPayee]
+    var index: PayeeIndex? = nil  // When set, searched instead of `payees`
     @Binding var selectedPayee: MoneyPayee?
     let onAddNew: (String) -> Void
     
@@ -695,7 +633,10 @@ struct PayeePickerView: View {
     }
     
     private var filteredPayees: [MoneyPayee] {
-        if searchText.isEmpty {
+        if let index = index {
+            // Word prefixes, most used first; payees added in the app are in the index too
+            return index.search(searchText)
+        } else if searchText.isEmpty {
             return payees.sorted { $0.name < $1.name }
         } else {
             return payees
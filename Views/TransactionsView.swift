@@ -6,6 +6,8 @@ struct TransactionsView: View {
     
     @State private var transactions: [TransactionDetail] = []
     @State private var localTransactions: [TransactionDetail] = []  // From local DB
+    @State private var runningBalance: RunningBalance?
+    @State private var balances: [Int: Decimal] = [:]  // By htrn, for the pages shown
     @State private var isLoading = false
     @State private var errorMessage: String?
     @State private var showingNewTransaction = false
@@ -64,13 +66,15 @@ struct TransactionsView: View {
                     if !transactions.isEmpty {
                         Section(localTransactions.isEmpty ? "" : "Synced Transactions") {
                             ForEach(paginatedTransactions) { transaction in
-                                TransactionRow(transaction: transaction, isLocal: false)
+                                TransactionRow(transaction: transaction, isLocal: false,
+                                               balance: balances[transaction.id])
                             }
                             
                             // Load more button
                             if hasMorePages {
                                 Button {
                                     currentPage += 1
+                                    loadBalances(page: currentPage)
                                 } label: {
                                     HStack {
                                         Spacer()
@@ -125,6 +129,15 @@ struct TransactionsView: View {
         (currentPage + 1) * pageSize < transactions.count
     }
     
+    /// Running balances of one page of the register, newest first like `transactions`
+    private func loadBalances(page: Int) {
+        guard let runningBalance = runningBalance else { return }
+        for entry in runningBalance.page(accountId: account.id, offset: page * pageSize,
+                                         limit: pageSize, opening: account.openingBalance) {
+            balances[entry.transactionId] = entry.balance
+        }
+    }
+    
     private func loadTransactions() {
         isLoading = true
         errorMessage = nil
@@ -141,11 +154,11 @@ struct TransactionsView: View {
                 
                 // Parse all needed data
                 let allTransactions = try parser.parseTransactions()
-                let categories = try parser.parseCategories()
+                let categoryPaths = try CategoryTree.open(path: decryptedPath,
+                                                          name: url.deletingPathExtension().lastPathComponent).displayPaths
                 let payees = try parser.parsePayees()
                 
                 // Create lookup dictionaries
-                let categoryLookup = Dictionary(uniqueKeysWithValues: categories.map { ($0.id, $0) })
                 let payeeLookup = Dictionary(uniqueKeysWithValues: payees.map { ($0.id, $0) })
                 
                 // Filter posted transactions for this account
@@ -153,15 +166,16 @@ struct TransactionsView: View {
                     transaction.accountId == account.id && transaction.shouldCountInBalance
                 }
                 
-                // Sort by date (newest first)
-                let sorted = filtered.sorted { $0.date > $1.date }
+                // Newest first, in the same (date, htrn) order as the running balances
+                let sorted = filtered.sorted { ($0.date, $0.id) > ($1.date, $1.id) }
+                let ledger = RunningBalance(transactions: filtered)
                 
                 // Convert to TransactionDetail with names
                 let details = sorted.map { transaction in
                     TransactionDetail(
                         transaction: transaction,
                         payees: payeeLookup,
-                        categories: categoryLookup
+                        categoryPaths: categoryPaths
                     )
                 }
                 
@@ -180,7 +194,7 @@ struct TransactionsView: View {
                     let date = dateFormatter.date(from: localTxn.dt) ?? Date()
                     
                     let payeeName = localTxn.lHpay.flatMap { payeeLookup[$0]?.name }
-                    let categoryName = localTxn.hcat.flatMap { categoryLookup[$0]?.name }
+                    let categoryName = localTxn.hcat.flatMap { categoryPaths[$0] }
                     
                     #if DEBUG
                     print("🔍 Converting LocalTransaction:")
@@ -213,6 +227,9 @@ struct TransactionsView: View {
                 DispatchQueue.main.async {
                     self.transactions = details
                     self.localTransactions = localDetails
+                    self.runningBalance = ledger
+                    self.balances = [:]
+                    self.loadBalances(page: 0)
                     self.isLoading = false
                     
                     #if DEBUG
@@ -237,6 +254,7 @@ struct TransactionsView: View {
 struct TransactionRow: View {
     let transaction: TransactionDetail
     let isLocal: Bool
+    var balance: Decimal? = nil
     
     private var formattedDate: String {
         let formatter = DateFormatter()
@@ -295,10 +313,19 @@ struct TransactionRow: View {
             
             Spacer()
             
-            // Amount
-            Text(transaction.amount, format: .currency(code: Locale.current.currencyCode ?? "USD"))
-                .font(.headline)
-                .foregroundColor(transaction.amount >= 0 ? .green : .red)
+            VStack(alignment: .trailing, spacing: 4) {
+                // Amount
+                Text(transaction.amount, format: .currency(code: Locale.current.currencyCode ?? "USD"))
+                    .font(.headline)
+                    .foregroundColor(transaction.amount >= 0 ? .green : .red)
+                
+                // Running balance after this transaction
+                if let balance = balance {
+                    Text(balance, format: .currency(code: Locale.current.currencyCode ?? "USD"))
+                        .font(.caption)
+                        .foregroundColor(.secondary)
+                }
+            }
         }
         .padding(.vertical, 4)
     }
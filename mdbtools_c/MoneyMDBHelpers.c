@@ -17,12 +17,13 @@ int money_mdb_num_columns(MdbTableDef* table) {
     return table ? table->num_cols : 0;
 }
 
-MdbSQL* money_mdb_run_query(const char* sql) {
-    MdbSQL *sqlh = mdb_sql_init();   // no args in 1.0.1
+// Opens the file and runs a query against it; read rows with
+// mdb_sql_fetch_row() and release everything with mdb_sql_exit().
+MdbSQL* money_mdb_run_query(const char* path, const char* query) {
+    MdbSQL *sqlh = mdb_sql_init();
     if (!sqlh) return NULL;
-    MdbSQL *result = mdb_sql_run_query(sqlh, sql);
-    // Note: don’t call mdb_sql_exit(sqlh) here if you want to use result
-    return result;
+    if (!mdb_sql_open(sqlh, (char *)path)) return sqlh;  // error_msg is set
+    return mdb_sql_run_query(sqlh, query);
 }
 /* ========== Missing mdbtools functions implementation ========== */
 
@@ -49,6 +50,13 @@ int mdb_get_option(unsigned long optnum) {
     return (mdb_options & optnum) ? 1 : 0;
 }
 
+void mdb_set_option(unsigned long optnum, int on) {
+    if (on)
+        mdb_options |= optnum;
+    else
+        mdb_options &= ~optnum;
+}
+
 void mdb_buffer_dump(const void *buf, off_t start, size_t len) {
 #if MDB_DEBUG
     const unsigned char *p = (const unsigned char *)buf + start;
@@ -36,6 +36,9 @@ const char* money_mdb_col_get_string(void* data);
 int money_mdb_read_catalog(MdbHandle* mdb, int obj_type);
 MdbCatalogEntry* money_mdb_get_catalog_entry(MdbHandle* mdb, int idx);
 
+// SQL queries (see mdbsql.h)
+MdbSQL* money_mdb_run_query(const char* path, const char* query);
+
 #ifdef __cplusplus
 }
 #endif
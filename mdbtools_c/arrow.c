@@ -0,0 +1,645 @@
+/* MDB Tools - A library for reading MS Access database file
+ * Copyright (C) 2000 Brian Bruns
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Columnar export in the Apache Arrow IPC streaming format.
+ *
+ * Each table becomes one stream: a Schema message, then for every batch
+ * from mdb_fetch_batch() any new dictionary entries followed by a
+ * RecordBatch.  Text columns are dictionary encoded (payees, categories
+ * and memos repeat a lot), with later batches sending only delta
+ * dictionaries.  Money is written as decimal(19,4), dates as millisecond
+ * timestamps.
+ *
+ * The flatbuffer metadata is built by hand with the small writer below
+ * so there is no dependency on the Arrow or flatbuffers libraries.  It
+ * lays tables out front to back: a parent is written first with its
+ * offset fields zeroed, and each is patched once the child it points to
+ * has been appended.  Values are written in host byte order, which is
+ * little endian on every platform we ship.
+ */
+
+#include "mdbtools.h"
+
+#define ARROW_MSG_SCHEMA 1
+#define ARROW_MSG_DICTIONARY_BATCH 2
+#define ARROW_MSG_RECORD_BATCH 3
+
+#define ARROW_TYPE_INT 2
+#define ARROW_TYPE_FLOATING_POINT 3
+#define ARROW_TYPE_BINARY 4
+#define ARROW_TYPE_UTF8 5
+#define ARROW_TYPE_BOOL 6
+#define ARROW_TYPE_DECIMAL 7
+#define ARROW_TYPE_TIMESTAMP 10
+
+#define ARROW_METADATA_V5 4
+#define ARROW_PRECISION_DOUBLE 2
+#define ARROW_TIMEUNIT_MILLISECOND 1
+
+#define FB_MAX_SLOTS 8
+
+typedef struct {
+	unsigned char *buf;
+	size_t len;
+	size_t size;
+} MdbFlatBuf;
+
+/* fields of one flatbuffer table, indexed by vtable slot; size 0 = absent */
+typedef struct {
+	int nslots;
+	int size[FB_MAX_SLOTS];
+	guint64 value[FB_MAX_SLOTS];
+	size_t pos[FB_MAX_SLOTS];
+} MdbFlatTable;
+
+typedef struct {
+	guint32 *slots;		/* open addressing, entry index + 1; 0 is empty */
+	guint32 nslots;
+	guint32 count;
+	guint32 emitted;	/* entries already sent */
+	guint32 *offsets;	/* count + 1 */
+	size_t offsets_size;
+	char *data;
+	size_t data_len;
+	size_t data_size;
+	gint32 *indices;	/* per row of the current batch */
+} MdbArrowDict;
+
+typedef struct {
+	MdbExportWriter *w;
+	MdbFlatBuf meta;
+	MdbFlatBuf body;
+	gint64 (*nodes)[2];
+	unsigned int num_nodes;
+	gint64 (*buffers)[2];
+	unsigned int num_buffers;
+} MdbArrowStream;
+
+static void
+fb_reserve(MdbFlatBuf *fb, size_t len)
+{
+	if (fb->len + len <= fb->size)
+		return;
+	if (!fb->size)
+		fb->size = 1024;
+	while (fb->len + len > fb->size)
+		fb->size *= 2;
+	fb->buf = g_realloc(fb->buf, fb->size);
+}
+static size_t
+fb_pad(MdbFlatBuf *fb, size_t align)
+{
+	size_t pad = (align - fb->len % align) % align;
+
+	if (!pad)
+		return fb->len;
+	fb_reserve(fb, pad);
+	memset(fb->buf + fb->len, 0, pad);
+	fb->len += pad;
+	return fb->len;
+}
+static void
+fb_set(MdbFlatBuf *fb, size_t pos, guint64 value, int size)
+{
+	int i;
+
+	for (i = 0; i < size; i++)
+		fb->buf[pos + i] = (value >> (8 * i)) & 0xFF;
+}
+static size_t
+fb_put(MdbFlatBuf *fb, guint64 value, int size)
+{
+	size_t pos;
+
+	fb_pad(fb, size);
+	fb_reserve(fb, size);
+	pos = fb->len;
+	fb_set(fb, pos, value, size);
+	fb->len += size;
+	return pos;
+}
+static void
+fb_put_bytes(MdbFlatBuf *fb, const void *data, size_t len)
+{
+	fb_reserve(fb, len);
+	memcpy(fb->buf + fb->len, data, len);
+	fb->len += len;
+}
+/* point the uoffset at field_pos to target, which must lie after it */
+static void
+fb_patch(MdbFlatBuf *fb, size_t field_pos, size_t target)
+{
+	fb_set(fb, field_pos, target - field_pos, 4);
+}
+static void
+fb_field(MdbFlatTable *t, int slot, int size, guint64 value)
+{
+	t->size[slot] = size;
+	t->value[slot] = value;
+	if (slot >= t->nslots)
+		t->nslots = slot + 1;
+}
+/* write the vtable and then the table; field positions land in t->pos */
+static size_t
+fb_table(MdbFlatBuf *fb, MdbFlatTable *t)
+{
+	int field_off[FB_MAX_SLOTS];
+	size_t vt, tbl, off = 4, align = 4;
+	int size, slot;
+
+	/* largest fields first keeps padding to the one gap after the soffset */
+	for (size = 8; size >= 1; size /= 2) {
+		for (slot = 0; slot < t->nslots; slot++) {
+			if (t->size[slot] != size)
+				continue;
+			off = (off + size - 1) / size * size;
+			field_off[slot] = off;
+			off += size;
+			if (size > (int)align)
+				align = size;
+		}
+	}
+
+	vt = fb_put(fb, 4 + 2 * t->nslots, 2);
+	fb_put(fb, off, 2);
+	for (slot = 0; slot < t->nslots; slot++)
+		fb_put(fb, t->size[slot] ? field_off[slot] : 0, 2);
+
+	tbl = fb_pad(fb, align);
+	fb_reserve(fb, off);
+	memset(fb->buf + tbl, 0, off);
+	fb_set(fb, tbl, tbl - vt, 4);
+	for (slot = 0; slot < t->nslots; slot++) {
+		if (!t->size[slot])
+			continue;
+		t->pos[slot] = tbl + field_off[slot];
+		fb_set(fb, t->pos[slot], t->value[slot], t->size[slot]);
+	}
+	fb->len = tbl + off;
+	return tbl;
+}
+/* vector length prefix, placed so the elements that follow are aligned */
+static size_t
+fb_vector(MdbFlatBuf *fb, guint32 count, size_t elem_align)
+{
+	size_t pos;
+
+	fb_pad(fb, 4);
+	while ((fb->len + 4) % elem_align)
+		fb_put(fb, 0, 4);
+	pos = fb_put(fb, count, 4);
+	return pos;
+}
+static size_t
+fb_string(MdbFlatBuf *fb, const char *str)
+{
+	size_t len = strlen(str);
+	size_t pos = fb_put(fb, len, 4);
+
+	fb_put_bytes(fb, str, len + 1);
+	return pos;
+}
+/* Message header; returns the position of its header offset field */
+static size_t
+arrow_message(MdbFlatBuf *fb, int header_type, gint64 body_len)
+{
+	MdbFlatTable t;
+
+	memset(&t, 0, sizeof(t));
+	fb->len = 0;
+	fb_put(fb, 0, 4);	/* root offset */
+	fb_field(&t, 0, 2, ARROW_METADATA_V5);
+	fb_field(&t, 1, 1, header_type);
+	fb_field(&t, 2, 4, 0);
+	fb_field(&t, 3, 8, body_len);
+	fb_patch(fb, 0, fb_table(fb, &t));
+	return t.pos[2];
+}
+static size_t
+arrow_int_type(MdbFlatBuf *fb, int bit_width)
+{
+	MdbFlatTable t;
+
+	memset(&t, 0, sizeof(t));
+	fb_field(&t, 0, 4, bit_width);
+	fb_field(&t, 1, 1, 1);	/* is_signed */
+	return fb_table(fb, &t);
+}
+static size_t
+arrow_field(MdbFlatBuf *fb, MdbBatchColumn *bc, int dict_id)
+{
+	MdbFlatTable ft, tt, dt;
+	size_t tbl;
+	int type;
+
+	memset(&ft, 0, sizeof(ft));
+	memset(&tt, 0, sizeof(tt));
+	switch (bc->kind) {
+		case MDB_BATCH_INT32:
+			type = ARROW_TYPE_INT;
+			fb_field(&tt, 0, 4, 32);
+			fb_field(&tt, 1, 1, 1);
+			break;
+		case MDB_BATCH_INT64:
+			if (bc->scale) {
+				type = ARROW_TYPE_DECIMAL;
+				fb_field(&tt, 0, 4, 19);	/* precision */
+				fb_field(&tt, 1, 4, bc->scale);
+				fb_field(&tt, 2, 4, 128);	/* bitWidth */
+			} else {
+				type = ARROW_TYPE_INT;
+				fb_field(&tt, 0, 4, 64);
+				fb_field(&tt, 1, 1, 1);
+			}
+			break;
+		case MDB_BATCH_DOUBLE:
+			type = ARROW_TYPE_FLOATING_POINT;
+			fb_field(&tt, 0, 2, ARROW_PRECISION_DOUBLE);
+			break;
+		case MDB_BATCH_BOOL:
+			type = ARROW_TYPE_BOOL;
+			break;
+		case MDB_BATCH_TIMESTAMP:
+			type = ARROW_TYPE_TIMESTAMP;
+			fb_field(&tt, 0, 2, ARROW_TIMEUNIT_MILLISECOND);
+			break;
+		case MDB_BATCH_BINARY:
+			type = ARROW_TYPE_BINARY;
+			break;
+		case MDB_BATCH_STRING:
+		default:
+			type = ARROW_TYPE_UTF8;
+			break;
+	}
+
+	fb_field(&ft, 0, 4, 0);		/* name */
+	fb_field(&ft, 1, 1, 1);		/* nullable */
+	fb_field(&ft, 2, 1, type);
+	fb_field(&ft, 3, 4, 0);		/* type */
+	if (dict_id >= 0)
+		fb_field(&ft, 4, 4, 0);	/* dictionary */
+	fb_field(&ft, 5, 4, 0);		/* children, required even if empty */
+	tbl = fb_table(fb, &ft);
+
+	fb_patch(fb, ft.pos[0], fb_string(fb, bc->col->name));
+	fb_patch(fb, ft.pos[3], fb_table(fb, &tt));
+	if (dict_id >= 0) {
+		memset(&dt, 0, sizeof(dt));
+		fb_field(&dt, 0, 8, dict_id);
+		fb_field(&dt, 1, 4, 0);		/* indexType */
+		fb_patch(fb, ft.pos[4], fb_table(fb, &dt));
+		fb_patch(fb, dt.pos[1], arrow_int_type(fb, 32));
+	}
+	fb_patch(fb, ft.pos[5], fb_vector(fb, 0, 4));
+	return tbl;
+}
+/* RecordBatch table from the nodes and buffers collected in the stream */
+static size_t
+arrow_record_batch(MdbArrowStream *s, gint64 length)
+{
+	MdbFlatBuf *fb = &s->meta;
+	MdbFlatTable t;
+	size_t tbl, vec;
+	unsigned int i;
+
+	memset(&t, 0, sizeof(t));
+	fb_field(&t, 0, 8, length);
+	fb_field(&t, 1, 4, 0);	/* nodes */
+	fb_field(&t, 2, 4, 0);	/* buffers */
+	tbl = fb_table(fb, &t);
+
+	vec = fb_vector(fb, s->num_nodes, 8);
+	fb_patch(fb, t.pos[1], vec);
+	for (i = 0; i < s->num_nodes; i++) {
+		fb_put(fb, s->nodes[i][0], 8);
+		fb_put(fb, s->nodes[i][1], 8);
+	}
+	vec = fb_vector(fb, s->num_buffers, 8);
+	fb_patch(fb, t.pos[2], vec);
+	for (i = 0; i < s->num_buffers; i++) {
+		fb_put(fb, s->buffers[i][0], 8);
+		fb_put(fb, s->buffers[i][1], 8);
+	}
+	return tbl;
+}
+static void
+arrow_node(MdbArrowStream *s, gint64 length, gint64 null_count)
+{
+	s->nodes[s->num_nodes][0] = length;
+	s->nodes[s->num_nodes][1] = null_count;
+	s->num_nodes++;
+}
+/* append a body buffer, 8-byte aligned as the format requires */
+static void
+arrow_buffer(MdbArrowStream *s, const void *data, size_t len)
+{
+	s->buffers[s->num_buffers][0] = s->body.len;
+	s->buffers[s->num_buffers][1] = len;
+	s->num_buffers++;
+	if (len)
+		fb_put_bytes(&s->body, data, len);
+	fb_pad(&s->body, 8);
+}
+static void
+arrow_start_body(MdbArrowStream *s)
+{
+	s->body.len = 0;
+	s->num_nodes = 0;
+	s->num_buffers = 0;
+}
+/* frame the metadata in s->meta and the body in s->body as one message */
+static void
+arrow_emit(MdbArrowStream *s)
+{
+	unsigned char prefix[8];
+
+	fb_pad(&s->meta, 8);
+	memset(prefix, 0xFF, 4);	/* continuation marker */
+	prefix[4] = s->meta.len & 0xFF;
+	prefix[5] = (s->meta.len >> 8) & 0xFF;
+	prefix[6] = (s->meta.len >> 16) & 0xFF;
+	prefix[7] = (s->meta.len >> 24) & 0xFF;
+	mdb_export_write(s->w, (char *)prefix, 8);
+	mdb_export_write(s->w, (char *)s->meta.buf, s->meta.len);
+	if (s->body.len)
+		mdb_export_write(s->w, (char *)s->body.buf, s->body.len);
+}
+static void
+arrow_emit_schema(MdbArrowStream *s, MdbBatch *batch)
+{
+	MdbFlatBuf *fb = &s->meta;
+	MdbFlatTable t;
+	size_t hdr, vec;
+	unsigned int i;
+
+	hdr = arrow_message(fb, ARROW_MSG_SCHEMA, 0);
+	memset(&t, 0, sizeof(t));
+	fb_field(&t, 1, 4, 0);	/* fields; endianness defaults to little */
+	fb_patch(fb, hdr, fb_table(fb, &t));
+
+	vec = fb_vector(fb, batch->num_cols, 4);
+	fb_patch(fb, t.pos[1], vec);
+	for (i = 0; i < batch->num_cols; i++)
+		fb_put(fb, 0, 4);
+	for (i = 0; i < batch->num_cols; i++) {
+		MdbBatchColumn *bc = &batch->columns[i];
+		fb_patch(fb, vec + 4 + 4 * i,
+			arrow_field(fb, bc, bc->kind == MDB_BATCH_STRING ? (int)i : -1));
+	}
+	arrow_start_body(s);
+	arrow_emit(s);
+}
+static guint32
+arrow_dict_hash(const char *str, size_t len)
+{
+	guint32 h = 2166136261u;	/* FNV-1a */
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		h = (h ^ (unsigned char)str[i]) * 16777619u;
+	return h;
+}
+static void
+arrow_dict_rehash(MdbArrowDict *d)
+{
+	guint32 i, h;
+
+	g_free(d->slots);
+	d->nslots = d->nslots ? d->nslots * 2 : 1024;
+	d->slots = g_malloc0(d->nslots * sizeof(guint32));
+	for (i = 0; i < d->count; i++) {
+		h = arrow_dict_hash(d->data + d->offsets[i], d->offsets[i+1] - d->offsets[i]);
+		while (d->slots[h & (d->nslots - 1)])
+			h++;
+		d->slots[h & (d->nslots - 1)] = i + 1;
+	}
+}
+static gint32
+arrow_dict_lookup(MdbArrowDict *d, const char *str, size_t len)
+{
+	guint32 h, idx;
+
+	if ((d->count + 1) * 2 > d->nslots)
+		arrow_dict_rehash(d);
+	for (h = arrow_dict_hash(str, len); (idx = d->slots[h & (d->nslots - 1)]); h++) {
+		idx--;
+		if (d->offsets[idx+1] - d->offsets[idx] == len
+				&& !memcmp(d->data + d->offsets[idx], str, len))
+			return idx;
+	}
+
+	/* new entry */
+	if ((d->count + 2) * sizeof(guint32) > d->offsets_size) {
+		d->offsets_size = d->offsets_size ? d->offsets_size * 2 : 1024 * sizeof(guint32);
+		d->offsets = g_realloc(d->offsets, d->offsets_size);
+		if (!d->count)
+			d->offsets[0] = 0;
+	}
+	if (d->data_len + len > d->data_size) {
+		d->data_size = d->data_size ? d->data_size : 4096;
+		while (d->data_len + len > d->data_size)
+			d->data_size *= 2;
+		d->data = g_realloc(d->data, d->data_size);
+	}
+	memcpy(d->data + d->data_len, str, len);
+	d->data_len += len;
+	d->offsets[d->count + 1] = d->data_len;
+	d->slots[h & (d->nslots - 1)] = d->count + 1;
+	return d->count++;
+}
+/* DictionaryBatch with the entries added since the last one */
+static void
+arrow_emit_dictionary(MdbArrowStream *s, MdbArrowDict *d, int dict_id, int is_delta)
+{
+	MdbFlatBuf *fb = &s->meta;
+	MdbFlatTable t;
+	guint32 n = d->count - d->emitted;
+	guint32 base = d->count ? d->offsets[d->emitted] : 0;
+	guint32 i, off;
+	size_t hdr, tbl;
+
+	arrow_start_body(s);
+	arrow_node(s, n, 0);
+	arrow_buffer(s, NULL, 0);	/* no nulls */
+	s->buffers[s->num_buffers][0] = s->body.len;
+	s->buffers[s->num_buffers][1] = (n + 1) * sizeof(guint32);
+	s->num_buffers++;
+	for (i = 0; i <= n; i++) {
+		off = d->count ? d->offsets[d->emitted + i] - base : 0;
+		fb_put_bytes(&s->body, &off, sizeof(off));
+	}
+	fb_pad(&s->body, 8);
+	arrow_buffer(s, d->count ? d->data + base : NULL,
+		d->count ? d->data_len - base : 0);
+
+	hdr = arrow_message(fb, ARROW_MSG_DICTIONARY_BATCH, s->body.len);
+	memset(&t, 0, sizeof(t));
+	fb_field(&t, 0, 8, dict_id);
+	fb_field(&t, 1, 4, 0);	/* data */
+	fb_field(&t, 2, 1, is_delta);
+	tbl = fb_table(fb, &t);
+	fb_patch(fb, hdr, tbl);
+	fb_patch(fb, t.pos[1], arrow_record_batch(s, n));
+	arrow_emit(s);
+	d->emitted = d->count;
+}
+static void
+arrow_emit_batch(MdbArrowStream *s, MdbBatch *batch, MdbArrowDict *dicts)
+{
+	unsigned int rows = batch->num_rows;
+	size_t bitmap_sz = (rows + 7) / 8;
+	unsigned int i, r;
+	size_t hdr;
+
+	arrow_start_body(s);
+	for (i = 0; i < batch->num_cols; i++) {
+		MdbBatchColumn *bc = &batch->columns[i];
+
+		arrow_node(s, rows, bc->null_count);
+		arrow_buffer(s, bc->validity, bc->null_count ? bitmap_sz : 0);
+		switch (bc->kind) {
+			case MDB_BATCH_INT32:
+				arrow_buffer(s, bc->values, rows * sizeof(gint32));
+				break;
+			case MDB_BATCH_INT64:
+				if (!bc->scale) {
+					arrow_buffer(s, bc->values, rows * sizeof(gint64));
+					break;
+				}
+				/* decimal128: the scaled value, sign extended */
+				s->buffers[s->num_buffers][0] = s->body.len;
+				s->buffers[s->num_buffers][1] = rows * 16;
+				s->num_buffers++;
+				for (r = 0; r < rows; r++) {
+					gint64 v[2];
+					v[0] = ((gint64 *)bc->values)[r];
+					v[1] = v[0] < 0 ? -1 : 0;
+					fb_put_bytes(&s->body, v, sizeof(v));
+				}
+				break;
+			case MDB_BATCH_DOUBLE:
+				arrow_buffer(s, bc->values, rows * sizeof(double));
+				break;
+			case MDB_BATCH_TIMESTAMP:
+				arrow_buffer(s, bc->values, rows * sizeof(gint64));
+				break;
+			case MDB_BATCH_BOOL:
+				arrow_buffer(s, bc->values, bitmap_sz);
+				break;
+			case MDB_BATCH_BINARY:
+				arrow_buffer(s, bc->offsets, (rows + 1) * sizeof(guint32));
+				arrow_buffer(s, bc->data, bc->data_len);
+				break;
+			case MDB_BATCH_STRING:
+				arrow_buffer(s, dicts[i].indices, rows * sizeof(gint32));
+				break;
+		}
+	}
+	hdr = arrow_message(&s->meta, ARROW_MSG_RECORD_BATCH, s->body.len);
+	fb_patch(&s->meta, hdr, arrow_record_batch(s, rows));
+	arrow_emit(s);
+}
+/**
+ * mdb_export_table_arrow:
+ * @table: table whose columns have been read with mdb_read_columns()
+ * @w: writer to append the stream to
+ * @batch_rows: rows per record batch, or 0 for MDB_BATCH_ROWS
+ *
+ * Writes every row of @table as an Arrow IPC stream, readable with e.g.
+ * pyarrow.ipc.open_stream().  The scan uses mdb_fetch_batch(), so no
+ * values are formatted as text along the way.
+ *
+ * pyarrow is not part of the tree; to check a stream, install it with
+ * "pip install pyarrow" and read the file back.
+ *
+ * Return value: number of rows exported, or -1 on error.
+ */
+long
+mdb_export_table_arrow(MdbTableDef *table, MdbExportWriter *w, unsigned int batch_rows)
+{
+	MdbArrowStream s;
+	MdbArrowDict *dicts;
+	MdbBatch *batch;
+	long rows = 0;
+	int dicts_sent = 0;
+	unsigned int i, r;
+	static const guint32 eos[2] = { 0xFFFFFFFF, 0 };
+
+	batch = mdb_alloc_batch(table, batch_rows);
+	dicts = g_malloc0(batch->num_cols * sizeof(MdbArrowDict));
+	memset(&s, 0, sizeof(s));
+	s.w = w;
+	s.nodes = g_malloc(batch->num_cols * sizeof(*s.nodes));
+	s.buffers = g_malloc(3 * batch->num_cols * sizeof(*s.buffers));
+	for (i = 0; i < batch->num_cols; i++)
+		if (batch->columns[i].kind == MDB_BATCH_STRING)
+			dicts[i].indices = g_malloc(batch->capacity * sizeof(gint32));
+
+	arrow_emit_schema(&s, batch);
+
+	mdb_rewind_table(table);
+	while (mdb_fetch_batch(table, batch)) {
+		for (i = 0; i < batch->num_cols; i++) {
+			MdbBatchColumn *bc = &batch->columns[i];
+			if (bc->kind != MDB_BATCH_STRING)
+				continue;
+			for (r = 0; r < batch->num_rows; r++) {
+				if (!(bc->validity[r >> 3] & (1 << (r & 7)))) {
+					dicts[i].indices[r] = 0;
+					continue;
+				}
+				dicts[i].indices[r] = arrow_dict_lookup(&dicts[i],
+					bc->data + bc->offsets[r], bc->offsets[r+1] - bc->offsets[r]);
+			}
+		}
+		/* the first dictionary for every field must precede any batch */
+		for (i = 0; i < batch->num_cols; i++) {
+			if (batch->columns[i].kind == MDB_BATCH_STRING
+					&& (!dicts_sent || dicts[i].count > dicts[i].emitted))
+				arrow_emit_dictionary(&s, &dicts[i], i, dicts_sent);
+		}
+		dicts_sent = 1;
+		arrow_emit_batch(&s, batch, dicts);
+		rows += batch->num_rows;
+		if (batch->at_end)
+			break;
+	}
+	if (!dicts_sent) {
+		for (i = 0; i < batch->num_cols; i++)
+			if (batch->columns[i].kind == MDB_BATCH_STRING)
+				arrow_emit_dictionary(&s, &dicts[i], i, 0);
+	}
+	mdb_export_write(w, (const char *)eos, sizeof(eos));
+	if (mdb_export_writer_flush(w))
+		rows = -1;
+
+	for (i = 0; i < batch->num_cols; i++) {
+		g_free(dicts[i].slots);
+		g_free(dicts[i].offsets);
+		g_free(dicts[i].data);
+		g_free(dicts[i].indices);
+	}
+	g_free(dicts);
+	g_free(s.nodes);
+	g_free(s.buffers);
+	g_free(s.meta.buf);
+	g_free(s.body.buf);
+	mdb_free_batch(batch);
+	return rows;
+}
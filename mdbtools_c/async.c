@@ -0,0 +1,388 @@
+/* MDB Tools - A library for reading MS Access database file
+ * Copyright (C) 2000 Brian Bruns
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Asynchronous jobs.  Work is queued as tasks on the engine scheduler
+ * (sched.c) and reported through callbacks on its worker threads, so a
+ * caller can keep many reads in flight without parking a thread of its own
+ * on each one.
+ *
+ * A job that reads the database works on its own mdb_clone_handle(),
+ * made on the submitting thread, so the caller's handle stays usable (or
+ * can be closed) while the job runs.  Cancellation is cooperative: long
+ * running jobs poll mdb_job_cancelled() between batches or rows.
+ */
+
+#include "mdbtools.h"
+#include "mdbsql.h"
+
+struct MdbJob {
+	MdbJobFunc func;
+	void *arg;
+	void (*free_arg)(void *arg);
+	MdbJobDoneFunc done;
+	void *user;
+	int cancelled;		/* set with __atomic builtins */
+	int finished;		/* under job_lock */
+	int status;
+	int refs;		/* caller and scheduler; __atomic */
+	pthread_cond_t cond;	/* signalled when finished */
+};
+
+static pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void
+mdb_job_unref(MdbJob *job)
+{
+	if (__atomic_sub_fetch(&job->refs, 1, __ATOMIC_ACQ_REL))
+		return;
+	pthread_cond_destroy(&job->cond);
+	g_free(job);
+}
+static void
+mdb_job_run(void *data)
+{
+	MdbJob *job = data;
+	int status;
+
+	if (mdb_job_cancelled(job))
+		status = MDB_JOB_CANCELLED;
+	else
+		status = job->func(job, job->arg);
+	if (job->done)
+		job->done(job, status, job->user);
+	if (job->free_arg)
+		job->free_arg(job->arg);
+
+	pthread_mutex_lock(&job_lock);
+	job->status = status;
+	job->finished = 1;
+	pthread_cond_broadcast(&job->cond);
+	pthread_mutex_unlock(&job_lock);
+	mdb_job_unref(job);
+}
+static MdbJob *
+mdb_job_queue(MdbJobFunc func, void *arg, void (*free_arg)(void *arg),
+	MdbJobDoneFunc done, void *user)
+{
+	MdbJob *job;
+
+	job = g_malloc0(sizeof(MdbJob));
+	job->func = func;
+	job->arg = arg;
+	job->free_arg = free_arg;
+	job->done = done;
+	job->user = user;
+	job->refs = 2;
+	pthread_cond_init(&job->cond, NULL);
+
+	if (!mdb_task_spawn(NULL, mdb_job_run, job)) {
+		fprintf(stderr, "Unable to queue job\n");
+		pthread_cond_destroy(&job->cond);
+		g_free(job);
+		return NULL;
+	}
+	return job;
+}
+/**
+ * mdb_job_submit:
+ * @func: work to run on a worker thread; returns the job's status
+ * @arg: passed to @func
+ * @done: called on the worker thread once @func returns (or the job is
+ *   cancelled before it starts), or NULL
+ * @user: passed to @done
+ *
+ * Queues a job.  @func should return MDB_JOB_OK, MDB_JOB_FAILED, or
+ * MDB_JOB_CANCELLED if it stopped because mdb_job_cancelled() was set.
+ *
+ * Return value: the job, which the caller must mdb_job_release(); NULL if
+ * the scheduler could not be started.
+ */
+MdbJob *
+mdb_job_submit(MdbJobFunc func, void *arg, MdbJobDoneFunc done, void *user)
+{
+	return mdb_job_queue(func, arg, NULL, done, user);
+}
+/**
+ * mdb_job_cancel:
+ * @job: submitted job
+ *
+ * Asks the job to stop.  A job that has not started yet is skipped, and
+ * its done callback gets MDB_JOB_CANCELLED; a running one stops at its
+ * next check.  Callbacks already running are not interrupted.
+ */
+void
+mdb_job_cancel(MdbJob *job)
+{
+	__atomic_store_n(&job->cancelled, 1, __ATOMIC_RELAXED);
+}
+int
+mdb_job_cancelled(MdbJob *job)
+{
+	return __atomic_load_n(&job->cancelled, __ATOMIC_RELAXED);
+}
+/**
+ * mdb_job_wait:
+ * @job: submitted job
+ *
+ * Blocks until the job and its done callback have finished.  Must not be
+ * called from a worker thread.
+ *
+ * Return value: the job's status.
+ */
+int
+mdb_job_wait(MdbJob *job)
+{
+	int status;
+
+	pthread_mutex_lock(&job_lock);
+	while (!job->finished)
+		pthread_cond_wait(&job->cond, &job_lock);
+	status = job->status;
+	pthread_mutex_unlock(&job_lock);
+	return status;
+}
+/**
+ * mdb_job_release:
+ * @job: submitted job
+ *
+ * Drops the caller's reference.  The job keeps running unless cancelled.
+ */
+void
+mdb_job_release(MdbJob *job)
+{
+	if (job)
+		mdb_job_unref(job);
+}
+
+/* Table scans */
+
+typedef struct {
+	MdbHandle *mdb;
+	char *table_name;
+	unsigned int batch_rows;
+	MdbJobBatchFunc on_batch;
+	void *user;
+} MdbScanJob;
+
+static void
+mdb_scan_job_free(void *arg)
+{
+	MdbScanJob *scan = arg;
+
+	mdb_close(scan->mdb);
+	g_free(scan->table_name);
+	g_free(scan);
+}
+static int
+mdb_scan_job_run(MdbJob *job, void *arg)
+{
+	MdbScanJob *scan = arg;
+	MdbTableDef *table;
+	MdbBatch *batch;
+	int status = MDB_JOB_OK;
+
+	table = mdb_read_table_by_name(scan->mdb, scan->table_name, MDB_TABLE);
+	if (!table) {
+		fprintf(stderr, "Table %s not found\n", scan->table_name);
+		return MDB_JOB_FAILED;
+	}
+	mdb_read_columns(table);
+	mdb_rewind_table(table);
+	batch = mdb_alloc_batch(table, scan->batch_rows);
+
+	/* the batch says when the table is done; a short last batch is not
+	 * followed by another fetch */
+	while (!batch->at_end) {
+		if (mdb_job_cancelled(job)) {
+			status = MDB_JOB_CANCELLED;
+			break;
+		}
+		if (!mdb_fetch_batch(table, batch))
+			break;
+		if (!scan->on_batch(job, batch, scan->user)) {
+			status = MDB_JOB_CANCELLED;
+			break;
+		}
+	}
+	mdb_free_batch(batch);
+	mdb_free_tabledef(table);
+	return status;
+}
+/**
+ * mdb_job_scan_table:
+ * @mdb: open database; it is cloned, not used by the job
+ * @table_name: table to scan
+ * @batch_rows: rows per batch, or 0 for MDB_BATCH_ROWS
+ * @on_batch: called on a worker thread with each batch; the batch is only
+ *   valid during the call.  Return 0 to stop the scan.
+ * @done: called once the scan ends, or NULL
+ * @user: passed to both callbacks
+ *
+ * Return value: the job, to be released with mdb_job_release().
+ */
+MdbJob *
+mdb_job_scan_table(MdbHandle *mdb, const char *table_name, unsigned int batch_rows,
+	MdbJobBatchFunc on_batch, MdbJobDoneFunc done, void *user)
+{
+	MdbScanJob *scan;
+	MdbJob *job;
+
+	scan = g_malloc0(sizeof(MdbScanJob));
+	scan->mdb = mdb_clone_handle(mdb);
+	scan->table_name = g_strdup(table_name);
+	scan->batch_rows = batch_rows;
+	scan->on_batch = on_batch;
+	scan->user = user;
+
+	job = mdb_job_queue(mdb_scan_job_run, scan, mdb_scan_job_free, done, user);
+	if (!job)
+		mdb_scan_job_free(scan);
+	return job;
+}
+
+/* SQL queries */
+
+typedef struct {
+	MdbSQL *sql;
+	char *query;
+	MdbJobRowFunc on_row;
+	void *user;
+} MdbQueryJob;
+
+static void
+mdb_query_job_free(void *arg)
+{
+	MdbQueryJob *q = arg;
+
+	/* closes the cloned handle too */
+	mdb_sql_exit(q->sql);
+	g_free(q->query);
+	g_free(q);
+}
+/* hand a cached result to the caller as if the query had run */
+static int
+mdb_query_job_replay(MdbJob *job, MdbQueryJob *q, MdbResult *res)
+{
+	unsigned int i, row, num_cols = mdb_result_num_cols(res);
+	char **values;
+	int status = MDB_JOB_OK;
+
+	values = g_malloc(num_cols * sizeof(char *) + 1);
+	for (row = 0; row < mdb_result_num_rows(res); row++) {
+		for (i = 0; i < num_cols; i++)
+			values[i] = (char *) mdb_result_value(res, row, i);
+		if (mdb_job_cancelled(job) || !q->on_row(job, values, num_cols, q->user)) {
+			status = MDB_JOB_CANCELLED;
+			break;
+		}
+	}
+	g_free(values);
+	return status;
+}
+static int
+mdb_query_job_run(MdbJob *job, void *arg)
+{
+	MdbQueryJob *q = arg;
+	MdbSQL *sql = q->sql;
+	MdbSQLColumn *sqlcol;
+	MdbResult *res = NULL;
+	char **values, *key = NULL;
+	MdbCacheStamp stamp;
+	unsigned int i;
+	int status = MDB_JOB_OK;
+
+	if (mdb_sql_prepare(sql, q->query)) {
+		fprintf(stderr, "Query failed: %s\n", sql->error_msg);
+		return MDB_JOB_FAILED;
+	}
+	/* a SELECT reads one table, which the cache can fingerprint; EXPLAIN
+	 * describes this run, and ANALYZE its timings, so neither is kept */
+	if (sql->stmt_type == MDB_SQL_SELECT && !sql->explain &&
+	    sql->cur_table && !sql->cur_table->is_temp_table)
+		key = mdb_result_cache_key(sql->mdb, q->query);
+	if (key) {
+		res = mdb_result_cache_lookup(key, sql->cur_table, &stamp);
+		if (res) {
+			status = mdb_query_job_replay(job, q, res);
+			mdb_result_unref(res);
+			g_free(key);
+			return status;
+		}
+	}
+	if (mdb_sql_execute(sql)) {
+		fprintf(stderr, "Query failed: %s\n", sql->error_msg);
+		g_free(key);
+		return MDB_JOB_FAILED;
+	}
+	values = g_malloc(sql->num_columns * sizeof(char *) + 1);
+	for (i = 0; i < sql->num_columns; i++) {
+		sqlcol = g_ptr_array_index(sql->columns, i);
+		values[i] = sqlcol->bind_addr;
+	}
+	if (key)
+		res = mdb_result_new(sql->num_columns);
+	while (mdb_sql_fetch_row(sql, sql->cur_table)) {
+		if (res)
+			mdb_result_append_row(res, values);
+		if (mdb_job_cancelled(job) || !q->on_row(job, values, sql->num_columns, q->user)) {
+			status = MDB_JOB_CANCELLED;
+			break;
+		}
+	}
+	/* only a query that ran to the end is worth keeping */
+	if (res && status == MDB_JOB_OK)
+		mdb_result_cache_insert(key, sql->cur_table, &stamp, res);
+	else
+		mdb_result_unref(res);
+	g_free(values);
+	g_free(key);
+	return status;
+}
+/**
+ * mdb_job_query:
+ * @mdb: open database; it is cloned, not used by the job
+ * @query: SELECT statement (see parse_sql()) without parameters
+ * @on_row: called on a worker thread with each row's values as text; they
+ *   are only valid during the call.  Return 0 to stop.
+ * @done: called once the query ends, or NULL
+ * @user: passed to both callbacks
+ *
+ * Runs a query, such as an aggregate, off the calling thread.
+ *
+ * Return value: the job, to be released with mdb_job_release().
+ */
+MdbJob *
+mdb_job_query(MdbHandle *mdb, const char *query, MdbJobRowFunc on_row,
+	MdbJobDoneFunc done, void *user)
+{
+	MdbQueryJob *q;
+	MdbJob *job;
+
+	q = g_malloc0(sizeof(MdbQueryJob));
+	q->sql = mdb_sql_init();
+	q->sql->mdb = mdb_clone_handle(mdb);
+	q->query = g_strdup(query);
+	q->on_row = on_row;
+	q->user = user;
+
+	job = mdb_job_queue(mdb_query_job_run, q, mdb_query_job_free, done, user);
+	if (!job)
+		mdb_query_job_free(q);
+	return job;
+}
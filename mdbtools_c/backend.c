@@ -190,7 +190,7 @@ gchar *mdb_normalise_and_replace(MdbHandle *mdb, gchar **str) {
         /* Free and replace the old string only and only if a new string was created at a different memory location
          * so that we can account for the case where strings a just passed through unchanged.
          */
-        free(*str);
+        g_free(*str);
         *str = normalised_str;
     }
     return *str;
@@ -548,7 +548,7 @@ int mdb_set_default_backend(MdbHandle *mdb, const char *backend_name)
 /**
  * Generates index name based on backend.
  *
- * You should free() the returned value once you are done with it.
+ * You should g_free() the returned value once you are done with it.
  *
  * @param backend backend we are generating indexes for
  * @param table table being processed
@@ -668,7 +668,7 @@ mdb_print_indexes(FILE* outfile, MdbTableDef *table, char *dbnamespace)
 			}
 		}
 		g_free(quoted_name);
-		free(index_name);
+		g_free(index_name);
 
 		for (j=0;j<idx->num_keys;j++) {
 			if (j)
@@ -915,7 +915,7 @@ generate_table_schema(FILE *outfile, MdbCatalogEntry *entry, char *dbnamespace,
 				fprintf(outfile,
 					mdb->default_backend->per_column_comment_statement,
 					comment);
-				free(comment);
+				g_free(comment);
 			}
 		}
 
@@ -940,14 +940,14 @@ generate_table_schema(FILE *outfile, MdbCatalogEntry *entry, char *dbnamespace,
 					/* ugly hack to detect the type */
 					if (defval[0]=='"' && defval[def_len-1]=='"') {
 						/* this is a string */
-						gchar *output_default = malloc(def_len-1);
+						gchar *output_default = g_malloc(def_len-1);
 						gchar *output_default_escaped;
 						memcpy(output_default, defval+1, def_len-2);
 						output_default[def_len-2] = 0;
 						output_default_escaped = quote_with_squotes(output_default);
 						fputs(output_default_escaped, outfile);
 						g_free(output_default_escaped);
-						free(output_default);
+						g_free(output_default);
 					} else if (!strcmp(defval, "Yes"))
 						fputs("TRUE", outfile);
 					else if (!strcmp(defval, "No"))
@@ -980,7 +980,7 @@ generate_table_schema(FILE *outfile, MdbCatalogEntry *entry, char *dbnamespace,
 			char *comment = quote_with_squotes(prop_value);
 			fputs(" ", outfile);
 			fprintf(outfile, mdb->default_backend->per_table_comment_statement, comment);
-			free(comment);
+			g_free(comment);
 		}
 	}
 	fputs(";\n", outfile);
@@ -1099,71 +1099,17 @@ mdb_print_schema(MdbHandle *mdb, FILE *outfile, char *tabname, char *dbnamespace
 	return success;
 }
 
-#define MDB_BINEXPORT_MASK 0x0F
-#define is_binary_type(x) (x==MDB_OLE || x==MDB_BINARY || x==MDB_REPID)
-#define is_quote_type(x) (is_binary_type(x) || x==MDB_TEXT || x==MDB_MEMO || x==MDB_DATETIME)
-//#define DONT_ESCAPE_ESCAPE
 void
 mdb_print_col(FILE *outfile, gchar *col_val, int quote_text, int col_type, int bin_len,
 		char *quote_char, char *escape_char, int flags)
 /* quote_text: Don't quote if 0.
  */
 {
-	size_t quote_len = strlen(quote_char); /* multibyte */
-
-	size_t orig_escape_len = escape_char ? strlen(escape_char) : 0;
-	int quoting = quote_text && is_quote_type(col_type);
-    int bin_mode = (flags & MDB_BINEXPORT_MASK);
-    int escape_cr_lf = !!(flags & MDB_EXPORT_ESCAPE_CONTROL_CHARS);
-
-	/* double the quote char if no escape char passed */
-	if (!escape_char)
-		escape_char = quote_char;
-
-	if (quoting)
-		fputs(quote_char, outfile);
-
-	while (1) {
-		if (is_binary_type(col_type)) {
-			if (bin_mode == MDB_BINEXPORT_STRIP)
-				break;
-			if (!bin_len--)
-				break;
-		} else /* use \0 sentry */
-			if (!*col_val)
-				break;
+	char buf[1024];
+	MdbExportWriter w;
 
-		if (is_binary_type(col_type) && bin_mode == MDB_BINEXPORT_OCTAL) {
-			fprintf(outfile, "\\%03o", *(unsigned char*)col_val++);
-		} else if (is_binary_type(col_type) && bin_mode == MDB_BINEXPORT_HEXADECIMAL) {
-			fprintf(outfile, "%02X", *(unsigned char*)col_val++);
-		} else if (quoting && quote_len && !strncmp(col_val, quote_char, quote_len)) {
-			fprintf(outfile, "%s%s", escape_char, quote_char);
-			col_val += quote_len;
-#ifndef DONT_ESCAPE_ESCAPE
-		} else if (quoting && orig_escape_len && !strncmp(col_val, escape_char, orig_escape_len)) {
-			fprintf(outfile, "%s%s", escape_char, escape_char);
-			col_val += orig_escape_len;
-#endif
-		} else if (escape_cr_lf && is_quote_type(col_type) && *col_val=='\r') {
-			col_val++;
-			putc('\\', outfile);
-			putc('r', outfile);
-		} else if (escape_cr_lf && is_quote_type(col_type) && *col_val=='\n') {
-			col_val++;
-			putc('\\', outfile);
-			putc('n', outfile);
-		} else if (escape_cr_lf && is_quote_type(col_type) && *col_val=='\t') {
-			col_val++;
-			putc('\\', outfile);
-			putc('t', outfile);
-		} else if (escape_cr_lf && is_quote_type(col_type) && *col_val=='\\') {
-			col_val++;
-			putc('\\', outfile);
-			putc('\\', outfile);
-		} else
-			putc(*col_val++, outfile);
-	}
-	if (quoting)
-		fputs(quote_char, outfile);
+	mdb_export_writer_init_stream(&w, outfile, buf, sizeof(buf));
+	mdb_export_col(&w, col_val, quote_text, col_type, bin_len,
+		quote_char, escape_char, flags);
+	mdb_export_writer_flush(&w);
 }
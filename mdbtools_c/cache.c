@@ -0,0 +1,495 @@
+/* MDB Tools - A library for reading MS Access database files
+ * Copyright (C) 2000 Brian Bruns
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Query result cache.  Screens tend to rerun the same reads (the account
+ * list, the category tree, a register) against a file that has not changed
+ * in between, so finished results are kept, column by column, in one
+ * process-wide cache with a least recently used byte budget.
+ *
+ * An entry is keyed by the normalized query text together with the
+ * handle's formatting options, and remembers two stamps of the table it
+ * read.  The quick one mixes the table definition page, row count and
+ * usage map with the file's size and modification time; while it matches,
+ * a lookup costs one fstat().  Any write to the file moves it, so on a
+ * mismatch the table's data pages are checksummed (mdb_table_fingerprint())
+ * and the entry is kept if they are unchanged.  Writes to other tables, in
+ * this process or another, thus leave an entry alone, while writes through
+ * write.c drop the table's entries at once.  Memory streams have no
+ * modification time and always take the checksum.
+ *
+ * Results are reference counted and never change once cached, so one
+ * thread can replay a result while another evicts it.
+ */
+
+#define MDB_MEM_TAG MDB_MEM_RESULT_CACHE
+
+#include "mdbtools.h"
+
+typedef struct {
+	guint32 *offsets;	/* num_rows+1 offsets into data */
+	unsigned char *validity;	/* one bit per row, set meaning not null */
+	char *data;		/* values, each NUL terminated */
+	size_t data_len;
+	size_t data_size;
+} MdbResultColumn;
+
+struct MdbResult {
+	unsigned int num_cols;
+	unsigned int num_rows;
+	unsigned int rows_size;
+	MdbResultColumn *columns;
+	size_t bytes;
+	int refs;		/* __atomic */
+};
+
+typedef struct MdbCacheEntry {
+	struct MdbCacheEntry *prev;	/* towards the most recently used */
+	struct MdbCacheEntry *next;
+	char *key;
+	guint32 hash;
+	unsigned long table_pg;
+	MdbCacheStamp stamp;
+	MdbResult *result;
+} MdbCacheEntry;
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static MdbCacheEntry *cache_head, *cache_tail;
+static size_t cache_bytes;
+static size_t cache_budget = MDB_RESULT_CACHE_BUDGET;
+
+/* Results */
+
+/**
+ * mdb_result_new:
+ * @num_cols: number of columns
+ *
+ * Return value: an empty result holding one reference.
+ */
+MdbResult *
+mdb_result_new(unsigned int num_cols)
+{
+	MdbResult *res;
+
+	res = g_malloc0(sizeof(MdbResult));
+	res->num_cols = num_cols;
+	res->columns = g_malloc0(num_cols * sizeof(MdbResultColumn) + 1);
+	res->refs = 1;
+	res->bytes = sizeof(MdbResult) + num_cols * sizeof(MdbResultColumn);
+	return res;
+}
+void
+mdb_result_unref(MdbResult *res)
+{
+	unsigned int i;
+
+	if (!res || __atomic_sub_fetch(&res->refs, 1, __ATOMIC_ACQ_REL))
+		return;
+	for (i = 0; i < res->num_cols; i++) {
+		g_free(res->columns[i].offsets);
+		g_free(res->columns[i].validity);
+		g_free(res->columns[i].data);
+	}
+	g_free(res->columns);
+	g_free(res);
+}
+/**
+ * mdb_result_append_row:
+ * @res: result being built, not yet cached
+ * @values: one NUL terminated value per column; NULL for a null
+ *
+ * Copies a row to the end of @res.
+ */
+void
+mdb_result_append_row(MdbResult *res, char **values)
+{
+	MdbResultColumn *rc;
+	unsigned int i, row = res->num_rows, size;
+	size_t len, data_size;
+
+	if (row == res->rows_size) {
+		size = res->rows_size ? res->rows_size * 2 : 64;
+		for (i = 0; i < res->num_cols; i++) {
+			rc = &res->columns[i];
+			rc->offsets = g_realloc(rc->offsets, (size + 1) * sizeof(guint32));
+			rc->validity = g_realloc(rc->validity, size / 8);
+			memset(rc->validity + res->rows_size / 8, 0, (size - res->rows_size) / 8);
+			if (!row)
+				rc->offsets[0] = 0;
+		}
+		res->bytes += (size - res->rows_size) * res->num_cols * sizeof(guint32) +
+			(size - res->rows_size) / 8 * res->num_cols;
+		res->rows_size = size;
+	}
+	for (i = 0; i < res->num_cols; i++) {
+		rc = &res->columns[i];
+		if (values[i]) {
+			len = strlen(values[i]) + 1;
+			if (rc->data_len + len > rc->data_size) {
+				data_size = MAX(rc->data_size * 2, rc->data_len + len);
+				data_size = MAX(data_size, 256);
+				rc->data = g_realloc(rc->data, data_size);
+				res->bytes += data_size - rc->data_size;
+				rc->data_size = data_size;
+			}
+			memcpy(rc->data + rc->data_len, values[i], len);
+			rc->data_len += len;
+			rc->validity[row / 8] |= 1 << (row % 8);
+		}
+		rc->offsets[row + 1] = rc->data_len;
+	}
+	res->num_rows++;
+}
+unsigned int
+mdb_result_num_rows(MdbResult *res)
+{
+	return res->num_rows;
+}
+unsigned int
+mdb_result_num_cols(MdbResult *res)
+{
+	return res->num_cols;
+}
+/**
+ * mdb_result_value:
+ * @res: result
+ * @row: row number
+ * @col: column number
+ *
+ * Return value: the value as text, valid while @res is referenced, or
+ * NULL for a null.
+ */
+const char *
+mdb_result_value(MdbResult *res, unsigned int row, unsigned int col)
+{
+	MdbResultColumn *rc = &res->columns[col];
+
+	if (!(rc->validity[row / 8] >> (row % 8) & 1))
+		return NULL;
+	return rc->data + rc->offsets[row];
+}
+
+/* Cache */
+
+static guint32
+mdb_cache_hash(const char *key)
+{
+	guint32 h = 2166136261u;	/* FNV-1a */
+
+	while (*key)
+		h = (h ^ (unsigned char)*key++) * 16777619u;
+	return h;
+}
+static guint64
+mdb_cache_mix(guint64 h, guint32 value)
+{
+	int i;
+
+	for (i = 0; i < 4; i++, value >>= 8)
+		h = (h ^ (value & 0xff)) * 1099511628211ull;
+	return h;
+}
+/**
+ * mdb_table_fingerprint:
+ * @table: table whose columns have been read with mdb_read_columns()
+ *
+ * Identifies the table's current contents from its definition page, row
+ * count and data page checksums.  Resets the table's scan position.
+ *
+ * Return value: the fingerprint.
+ */
+guint64
+mdb_table_fingerprint(MdbTableDef *table)
+{
+	MdbPageSum *sums;
+	unsigned int i, count;
+	guint64 h = 14695981039346656037ull;	/* FNV-1a 64 */
+
+	count = mdb_table_page_sums(table, &sums);
+	h = mdb_cache_mix(h, table->entry->table_pg);
+	h = mdb_cache_mix(h, table->num_rows);
+	h = mdb_cache_mix(h, count);
+	for (i = 0; i < count; i++) {
+		h = mdb_cache_mix(h, sums[i].pg);
+		h = mdb_cache_mix(h, sums[i].sum);
+	}
+	mdb_free_page_sums(sums);
+	return h;
+}
+/* the quick stamp, see the top; 0 when the file can't be stat'ed */
+static guint64
+mdb_cache_stat_stamp(MdbTableDef *table)
+{
+	MdbFile *f = table->entry->mdb->f;
+	struct stat status;
+	guint64 h = 14695981039346656037ull;	/* FNV-1a 64 */
+	long nsec;
+	size_t i;
+
+	if (f->fd < 0 || fstat(f->fd, &status))
+		return 0;
+#ifdef __APPLE__
+	nsec = status.st_mtimespec.tv_nsec;
+#else
+	nsec = status.st_mtim.tv_nsec;
+#endif
+	h = mdb_cache_mix(h, status.st_ino);
+	h = mdb_cache_mix(h, status.st_size);
+	h = mdb_cache_mix(h, (guint64)status.st_size >> 32);
+	h = mdb_cache_mix(h, status.st_mtime);
+	h = mdb_cache_mix(h, (guint64)status.st_mtime >> 32);
+	h = mdb_cache_mix(h, nsec);
+	h = mdb_cache_mix(h, table->entry->table_pg);
+	h = mdb_cache_mix(h, table->num_rows);
+	for (i = 0; i < table->map_sz; i++)
+		h = mdb_cache_mix(h, table->usage_map[i]);
+	return h;
+}
+/* callers hold cache_lock */
+static void
+mdb_cache_unlink(MdbCacheEntry *e)
+{
+	if (e->prev)
+		e->prev->next = e->next;
+	else
+		cache_head = e->next;
+	if (e->next)
+		e->next->prev = e->prev;
+	else
+		cache_tail = e->prev;
+	e->prev = e->next = NULL;
+}
+static void
+mdb_cache_push(MdbCacheEntry *e)
+{
+	e->prev = NULL;
+	e->next = cache_head;
+	if (cache_head)
+		cache_head->prev = e;
+	else
+		cache_tail = e;
+	cache_head = e;
+}
+static void
+mdb_cache_drop(MdbCacheEntry *e)
+{
+	mdb_cache_unlink(e);
+	cache_bytes -= e->result->bytes;
+	mdb_result_unref(e->result);
+	g_free(e->key);
+	g_free(e);
+}
+static void
+mdb_cache_trim(void)
+{
+	while (cache_tail && cache_bytes > cache_budget)
+		mdb_cache_drop(cache_tail);
+}
+static MdbCacheEntry *
+mdb_cache_find(const char *key, guint32 hash)
+{
+	MdbCacheEntry *e;
+
+	for (e = cache_head; e; e = e->next)
+		if (e->hash == hash && !strcmp(e->key, key))
+			return e;
+	return NULL;
+}
+static int
+mdb_cache_word_char(char c)
+{
+	return c && (isalnum((unsigned char)c) || strchr("_$.[]'\"", c));
+}
+/**
+ * mdb_result_cache_key:
+ * @mdb: handle the query runs on
+ * @query: query text
+ *
+ * Builds the cache key for @query.  Outside quoted literals case is
+ * folded and white space dropped, except for one blank between words.
+ * The handle's date and boolean formats are appended, since they change
+ * the text of the results.
+ *
+ * Return value: the key, to be freed with g_free(), or NULL when the
+ * cache is disabled.
+ */
+char *
+mdb_result_cache_key(MdbHandle *mdb, const char *query)
+{
+	char *text, *key, quote = 0;
+	const char *p;
+	size_t len = 0;
+
+	if (!__atomic_load_n(&cache_budget, __ATOMIC_RELAXED))
+		return NULL;
+	text = g_malloc(strlen(query) + 1);
+	for (p = query; *p; p++) {
+		if (quote) {
+			if (*p == quote)
+				quote = 0;
+			text[len++] = *p;
+		} else if (*p == '\'' || *p == '"') {
+			quote = *p;
+			text[len++] = *p;
+		} else if (isspace((unsigned char)*p)) {
+			/* white space only matters between two words */
+			while (isspace((unsigned char)p[1]))
+				p++;
+			if (len && mdb_cache_word_char(text[len-1]) && mdb_cache_word_char(p[1]))
+				text[len++] = ' ';
+		} else {
+			text[len++] = tolower((unsigned char)*p);
+		}
+	}
+	text[len] = '\0';
+	key = g_strdup_printf("%s\n%s\n%s\n%s\n%s\n%d", text, mdb->date_fmt, mdb->shortdate_fmt,
+		mdb->boolean_false_value, mdb->boolean_true_value, (int)mdb->repid_fmt);
+	g_free(text);
+	return key;
+}
+/**
+ * mdb_result_cache_lookup:
+ * @key: key from mdb_result_cache_key()
+ * @table: the table the query reads
+ * @stamp: receives the table's stamps, to pass to
+ *   mdb_result_cache_insert() on a miss
+ *
+ * Stamps @table and looks for a result cached under @key for the same
+ * contents.  An entry made before the table changed is dropped.  Unless
+ * the quick stamp matches, this checksums the table's data pages and
+ * resets its scan position.
+ *
+ * Return value: a reference to the cached result, to be released with
+ * mdb_result_unref(), or NULL on a miss.
+ */
+MdbResult *
+mdb_result_cache_lookup(const char *key, MdbTableDef *table, MdbCacheStamp *stamp)
+{
+	MdbCacheEntry *e;
+	MdbResult *res = NULL;
+	guint32 hash = mdb_cache_hash(key);
+
+	stamp->stat = mdb_cache_stat_stamp(table);
+	stamp->contents = 0;
+
+	pthread_mutex_lock(&cache_lock);
+	e = mdb_cache_find(key, hash);
+	if (e && (e->table_pg != table->entry->table_pg ||
+	    !stamp->stat || e->stamp.stat != stamp->stat)) {
+		/* the file changed, maybe elsewhere; look at this table's pages,
+		 * without holding up other lookups */
+		pthread_mutex_unlock(&cache_lock);
+		stamp->contents = mdb_table_fingerprint(table);
+		pthread_mutex_lock(&cache_lock);
+		e = mdb_cache_find(key, hash);
+		if (e && (e->table_pg != table->entry->table_pg ||
+		    e->stamp.contents != stamp->contents)) {
+			mdb_cache_drop(e);
+			e = NULL;
+		} else if (e) {
+			e->stamp.stat = stamp->stat;
+		}
+	}
+	if (e) {
+		mdb_cache_unlink(e);
+		mdb_cache_push(e);
+		res = e->result;
+		__atomic_add_fetch(&res->refs, 1, __ATOMIC_RELAXED);
+	}
+	pthread_mutex_unlock(&cache_lock);
+	/* a result cached after this miss needs the checksum too */
+	if (!res && !stamp->contents)
+		stamp->contents = mdb_table_fingerprint(table);
+	return res;
+}
+/**
+ * mdb_result_cache_insert:
+ * @key: key from mdb_result_cache_key()
+ * @table: the table the query read
+ * @stamp: from the mdb_result_cache_lookup() that missed
+ * @res: the complete result; the cache takes the caller's reference
+ *
+ * Caches @res, evicting the least recently used results to stay within
+ * the budget.  A result larger than the whole budget is not kept.
+ */
+void
+mdb_result_cache_insert(const char *key, MdbTableDef *table, const MdbCacheStamp *stamp, MdbResult *res)
+{
+	MdbCacheEntry *e;
+	guint32 hash = mdb_cache_hash(key);
+
+	pthread_mutex_lock(&cache_lock);
+	if (res->bytes > cache_budget) {
+		pthread_mutex_unlock(&cache_lock);
+		mdb_result_unref(res);
+		return;
+	}
+	if ((e = mdb_cache_find(key, hash)))
+		mdb_cache_drop(e);
+	e = g_malloc0(sizeof(MdbCacheEntry));
+	e->key = g_strdup(key);
+	e->hash = hash;
+	e->table_pg = table->entry->table_pg;
+	e->stamp = *stamp;
+	e->result = res;
+	mdb_cache_push(e);
+	cache_bytes += res->bytes;
+	mdb_cache_trim();
+	pthread_mutex_unlock(&cache_lock);
+}
+/**
+ * mdb_result_cache_invalidate:
+ * @table: table that was written to
+ *
+ * Drops every cached result read from @table.
+ */
+void
+mdb_result_cache_invalidate(MdbTableDef *table)
+{
+	MdbCacheEntry *e, *next;
+
+	pthread_mutex_lock(&cache_lock);
+	for (e = cache_head; e; e = next) {
+		next = e->next;
+		if (e->table_pg == table->entry->table_pg)
+			mdb_cache_drop(e);
+	}
+	pthread_mutex_unlock(&cache_lock);
+}
+/**
+ * mdb_result_cache_set_budget:
+ * @bytes: most memory cached results may take; 0 disables the cache
+ *
+ * The default is MDB_RESULT_CACHE_BUDGET.
+ */
+void
+mdb_result_cache_set_budget(size_t bytes)
+{
+	pthread_mutex_lock(&cache_lock);
+	cache_budget = bytes;
+	mdb_cache_trim();
+	pthread_mutex_unlock(&cache_lock);
+}
+void
+mdb_result_cache_clear(void)
+{
+	pthread_mutex_lock(&cache_lock);
+	while (cache_head)
+		mdb_cache_drop(cache_head);
+	pthread_mutex_unlock(&cache_lock);
+}
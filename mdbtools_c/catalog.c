@@ -16,6 +16,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#define MDB_MEM_TAG MDB_MEM_CATALOG
+
 #include "mdbtools.h"
 
 const char *
@@ -82,11 +84,11 @@ GPtrArray *mdb_read_catalog (MdbHandle *mdb, int objtype)
 	mdb->catalog = g_ptr_array_new();
 	mdb->num_catalog = 0;
 
-	obj_id = malloc(mdb->bind_size);
-	obj_name = malloc(mdb->bind_size);
-	obj_type = malloc(mdb->bind_size);
-	obj_flags = malloc(mdb->bind_size);
-	obj_props = malloc(mdb->bind_size);
+	obj_id = mdb_mem_malloc(MDB_MEM_BIND, mdb->bind_size);
+	obj_name = mdb_mem_malloc(MDB_MEM_BIND, mdb->bind_size);
+	obj_type = mdb_mem_malloc(MDB_MEM_BIND, mdb->bind_size);
+	obj_flags = mdb_mem_malloc(MDB_MEM_BIND, mdb->bind_size);
+	obj_props = mdb_mem_malloc(MDB_MEM_BIND, mdb->bind_size);
 
 	/* dummy up a catalog entry so we may read the table def */
 	memset(&msysobj, 0, sizeof(MdbCatalogEntry));
@@ -147,7 +149,7 @@ GPtrArray *mdb_read_catalog (MdbHandle *mdb, int objtype)
 				//mdb_buffer_dump(kkd, 0, kkd_len);
 				if (kkd) {
 					entry->props = mdb_kkd_to_props(mdb, kkd, kkd_len);
-					free(kkd);
+					g_free(kkd);
 				}
 			}
 		}
@@ -158,11 +160,11 @@ cleanup:
 	if (table)
 		mdb_free_tabledef(table);
 
-	free(obj_id);
-	free(obj_name);
-	free(obj_type);
-	free(obj_flags);
-	free(obj_props);
+	g_free(obj_id);
+	g_free(obj_name);
+	g_free(obj_type);
+	g_free(obj_flags);
+	g_free(obj_props);
 
     return mdb->catalog;
 }
@@ -16,10 +16,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
-// reallocf is available on macOS/iOS (BSD extension)
-#if defined(__APPLE__)
-#define HAVE_REALLOCF 1
-#endif
+#define MDB_MEM_TAG MDB_MEM_BIND
 
 #include "mdbtools.h"
 
@@ -35,17 +32,6 @@ static char *mdb_date_to_string(MdbHandle *mdb, const char *fmt, void *buf, int
 static size_t mdb_copy_ole(MdbHandle *mdb, void *dest, int start, int size);
 #endif
 
-#ifndef HAVE_REALLOCF
-static void *reallocf(void *ptr, size_t len) {
-	void *ptr2 = realloc(ptr, len);
-	if (!ptr2) {
-		free(ptr);
-		return NULL;
-	}
-	return ptr2;
-}
-#endif
-
 static const int noleap_cal[] = {0,31,59,90,120,151,181,212,243,273,304,334,365};
 static const int leap_cal[]   = {0,31,60,91,121,152,182,213,244,274,305,335,366};
 
@@ -315,15 +301,19 @@ int ret;
 	}
 	return 0;
 }
-int mdb_read_row(MdbTableDef *table, unsigned int row)
+/*
+ * Locate row on the current page and crack it into fields, which must have
+ * room for num_cols entries.  Deleted rows (unless noskip_del is set) and
+ * rows failing the sargs are skipped.
+ *
+ * Return value: number of fields, or 0 if the row should be skipped.
+ */
+static int mdb_crack_visible_row(MdbTableDef *table, unsigned int row, MdbField *fields)
 {
 	MdbHandle *mdb = table->entry->mdb;
-	MdbColumn *col;
-	unsigned int i;
 	int row_start;
 	size_t row_size = 0;
 	int delflag, lookupflag;
-	MdbField *fields;
 	int num_fields;
 
 	if (table->num_cols == 0 || !table->columns)
@@ -353,14 +343,17 @@ int mdb_read_row(MdbTableDef *table, unsigned int row)
 		return 0;
 	}
 
-	fields = malloc(sizeof(MdbField) * table->num_cols);
-
 	num_fields = mdb_crack_row(table, row_start, row_size, fields);
-	if (num_fields < 0 || !mdb_test_sargs(table, fields, num_fields)) {
-		free(fields);
+	if (num_fields < 0)
+		return 0;
+	if (mdb->stats && mdb->stats->collect)
+		mdb->stats->rows_visited++;
+	if (!mdb_test_sargs(table, fields, num_fields)) {
+		if (mdb->stats && mdb->stats->collect)
+			mdb->stats->rows_filtered++;
 		return 0;
 	}
-	
+
 #if MDB_DEBUG
 	fprintf(stdout,"sarg test passed row %d \n", row);
 #endif 
@@ -368,6 +361,24 @@ int mdb_read_row(MdbTableDef *table, unsigned int row)
 #if MDB_DEBUG
 	mdb_buffer_dump(mdb->pg_buf, row_start, row_size);
 #endif
+	return num_fields;
+}
+int mdb_read_row(MdbTableDef *table, unsigned int row)
+{
+	MdbHandle *mdb = table->entry->mdb;
+	MdbColumn *col;
+	unsigned int i;
+	MdbField *fields;
+
+	if (table->num_cols == 0 || !table->columns)
+		return 0;
+
+	fields = g_malloc(sizeof(MdbField) * table->num_cols);
+
+	if (!mdb_crack_visible_row(table, row, fields)) {
+		g_free(fields);
+		return 0;
+	}
 
 	/* take advantage of mdb_crack_row() to clean up binding */
 	/* use num_cols instead of num_fields -- bsb 03/04/02 */
@@ -377,7 +388,7 @@ int mdb_read_row(MdbTableDef *table, unsigned int row)
 			fields[i].start, fields[i].siz);
 	}
 
-	free(fields);
+	g_free(fields);
 
 	return 1;
 }
@@ -387,6 +398,7 @@ static int _mdb_attempt_bind(MdbHandle *mdb,
 	int offset, 
 	int len)
 {
+	col->cur_value_null = isnull && col->col_type != MDB_BOOL;
 	if (col->col_type == MDB_BOOL) {
 		mdb_xfer_bound_bool(mdb, col, isnull);
 	} else if (isnull) {
@@ -450,66 +462,96 @@ int mdb_rewind_table(MdbTableDef *table)
 	table->cur_pg_num=0;
 	table->cur_phys_pg=0;
 	table->cur_row=0;
+	table->scan_done=0;
 
 	return 0;
 }
-int 
-mdb_fetch_row(MdbTableDef *table)
+/*
+ * Position the table on the next candidate row slot, reading a new page
+ * into mdb->pg_buf when the current one is exhausted.  The slot may still
+ * turn out to be deleted or filtered out.
+ *
+ * Return value: 1 with *row set, or 0 at the end of the table.
+ */
+static int
+mdb_next_row_slot(MdbTableDef *table, unsigned int *row)
 {
 	MdbHandle *mdb = table->entry->mdb;
 	MdbFormatConstants *fmt = mdb->fmt;
 	unsigned int rows;
-	int rc;
 	guint32 pg;
 
 	/* initialize */
 	if (!table->cur_pg_num) {
 		table->cur_pg_num=1;
 		table->cur_row=0;
-		if ((!table->is_temp_table)&&(table->strategy!=MDB_INDEX_SCAN))
-			if (!mdb_read_next_dpg(table)) return 0;
+		table->scan_done=0;
+		if ((!table->is_temp_table)&&(table->strategy==MDB_TABLE_SCAN)
+		 && !mdb_read_next_dpg(table)) {
+			table->scan_done=1;
+			return 0;
+		}
 	}
 
-	do {
-		if (table->is_temp_table) {
-			GPtrArray *pages = table->temp_table_pages;
-			if (pages->len == 0)
-				return 0;
-			rows = mdb_get_int16(
-				g_ptr_array_index(pages, table->cur_pg_num-1),
-				fmt->row_count_offset);
-			if (table->cur_row >= rows) {
-				table->cur_row = 0;
-				if (++table->cur_pg_num > (unsigned int)pages->len)
-					return 0;
-			}
-			memcpy(mdb->pg_buf,
-				g_ptr_array_index(pages, table->cur_pg_num-1),
-				fmt->pg_size);
-		} else if (table->strategy==MDB_INDEX_SCAN) {
-		
-			if (!mdb_index_find_next(table->mdbidx, table->scan_idx, table->chain, &pg, (guint16 *) &(table->cur_row))) {
-				mdb_index_scan_free(table);
+	if (table->is_temp_table) {
+		/* stays past the end once exhausted, for callers that ask again;
+		 * the page is only copied in when the cursor moves onto it */
+		if (!mdb_temp_table_read_pg(table, table->cur_pg_num))
+			return 0;
+		rows = mdb_get_int16(mdb->pg_buf, fmt->row_count_offset);
+		if (table->cur_row >= rows) {
+			table->cur_row = 0;
+			if (!mdb_temp_table_read_pg(table, ++table->cur_pg_num))
 				return 0;
-			}
-			mdb_read_pg(mdb, pg);
-		} else {
-			rows = mdb_get_int16(mdb->pg_buf,fmt->row_count_offset);
+		}
+	} else if (table->strategy!=MDB_TABLE_SCAN) {
+		guint16 idx_row;
+		int found;
 
-			/* if at end of page, find a new data page */
-			if (table->cur_row >= rows) {
-				table->cur_row=0;
-	
-				if (!mdb_read_next_dpg(table)) {
-					return 0;
-				}
+		/* the chain is freed once the index runs out */
+		if (!table->chain)
+			return 0;
+		if (table->strategy==MDB_LEAF_SCAN)
+			found = mdb_index_leaf_next(table->mdbidx, table->scan_idx, table->chain, &pg, &idx_row);
+		else
+			found = mdb_index_find_next(table->mdbidx, table->scan_idx, table->chain, &pg, &idx_row);
+		if (!found) {
+			mdb_index_scan_free(table);
+			return 0;
+		}
+		table->cur_row = idx_row;
+		mdb_read_pg(mdb, pg);
+		table->cur_phys_pg = pg;
+	} else {
+		/* stays at the end once the last page is done: mdb->pg_buf still
+		 * holds that page, or whatever was read past it */
+		if (table->scan_done)
+			return 0;
+		rows = mdb_get_int16(mdb->pg_buf,fmt->row_count_offset);
+
+		/* if at end of page, find a new data page */
+		if (table->cur_row >= rows) {
+			if (!mdb_read_next_dpg(table)) {
+				table->scan_done=1;
+				return 0;
 			}
+			table->cur_row=0;
 		}
+	}
+
+	/* printf("page %d row %d\n",table->cur_phys_pg, table->cur_row); */
+	*row = table->cur_row++;
+	return 1;
+}
+int 
+mdb_fetch_row(MdbTableDef *table)
+{
+	unsigned int row;
 
-		/* printf("page %d row %d\n",table->cur_phys_pg, table->cur_row); */
-		rc = mdb_read_row(table, table->cur_row);
-		table->cur_row++;
-	} while (!rc);
+	do {
+		if (!mdb_next_row_slot(table, &row))
+			return 0;
+	} while (!mdb_read_row(table, row));
 
 	return 1;
 }
@@ -517,7 +559,7 @@ void mdb_data_dump(MdbTableDef *table)
 {
 	unsigned int i;
 	int ret;
-	char **bound_values = calloc(table->num_cols, sizeof(char *));
+	char **bound_values = g_malloc0(table->num_cols * sizeof(char *));
 
 	for (i=0;i<table->num_cols;i++) {
 		bound_values[i] = g_malloc(MDB_BIND_SIZE);
@@ -539,7 +581,7 @@ void mdb_data_dump(MdbTableDef *table)
 	for (i=0;i<table->num_cols;i++) {
 		g_free(bound_values[i]);
 	}
-	free(bound_values);
+	g_free(bound_values);
 }
 
 int mdb_is_fixed_col(MdbColumn *col)
@@ -667,14 +709,14 @@ mdb_ole_read(MdbHandle *mdb, MdbColumn *col, void *ole_ptr, size_t chunk_size)
 /*
  * mdb_ole_read_full calls mdb_ole_read then loop over mdb_ole_read_next as much as necessary.
  * returns the result in a big buffer.
- * The call must free it.
+ * The caller must g_free it.
  * Note that this function is not idempotent: It may be called only once per column after each bind.
  */
 void*
 mdb_ole_read_full(MdbHandle *mdb, MdbColumn *col, size_t *size)
 {
 	char ole_ptr[MDB_MEMO_OVERHEAD];
-	char *result = malloc(OLE_BUFFER_SIZE);
+	char *result = mdb_mem_malloc(MDB_MEM_MEMO, OLE_BUFFER_SIZE);
 	size_t result_buffer_size = OLE_BUFFER_SIZE;
 	size_t len, pos;
 
@@ -685,11 +727,14 @@ mdb_ole_read_full(MdbHandle *mdb, MdbColumn *col, size_t *size)
 	pos = len;
 	while ((len = mdb_ole_read_next(mdb, col, ole_ptr))) {
 		if (pos+len >= result_buffer_size) {
+			char *grown;
 			result_buffer_size += OLE_BUFFER_SIZE;
-			if ((result = reallocf(result, result_buffer_size)) == NULL) {
+			if ((grown = g_realloc(result, result_buffer_size)) == NULL) {
 				fprintf(stderr, "Out of memory while reading OLE object\n");
+				g_free(result);
 				return NULL;
 			}
+			result = grown;
 		}
 		memcpy(result + pos, col->bind_ptr, len);
 		pos += len;
@@ -770,7 +815,7 @@ static char *mdb_memo_to_string(MdbHandle *mdb, int start, int size)
 	gint32 row_start, pg_row;
 	size_t len;
 	void *buf, *pg_buf = mdb->pg_buf;
-	char *text = g_malloc(mdb->bind_size);
+	char *text = mdb_mem_malloc(MDB_MEM_MEMO, mdb->bind_size);
 
 	if (size<MDB_MEMO_OVERHEAD) {
 		strcpy(text, "");
@@ -814,7 +859,7 @@ static char *mdb_memo_to_string(MdbHandle *mdb, int start, int size)
 		guint32 tmpoff = 0;
 		char *tmp;
 
-		tmp = g_malloc(memo_len);
+		tmp = mdb_mem_malloc(MDB_MEM_MEMO, memo_len);
 		pg_row = mdb_get_int32(pg_buf, start+4);
 		do {
 #if MDB_DEBUG
@@ -1149,3 +1194,416 @@ int mdb_col_fixed_size(MdbColumn *col)
 	}
 	return 0;
 }
+
+/* Columnar batch scan */
+
+static MdbBatchKind
+mdb_batch_kind(MdbColumn *col)
+{
+	switch (col->col_type) {
+		case MDB_BYTE:
+		case MDB_INT:
+		case MDB_LONGINT:
+		case MDB_COMPLEX:
+			return MDB_BATCH_INT32;
+		case MDB_MONEY:
+			return MDB_BATCH_INT64;
+		case MDB_FLOAT:
+		case MDB_DOUBLE:
+			return MDB_BATCH_DOUBLE;
+		case MDB_BOOL:
+			return MDB_BATCH_BOOL;
+		case MDB_DATETIME:
+			return MDB_BATCH_TIMESTAMP;
+		case MDB_BINARY:
+		case MDB_OLE:
+			return MDB_BATCH_BINARY;
+	}
+	return MDB_BATCH_STRING;
+}
+/**
+ * mdb_alloc_batch:
+ * @table: table whose columns have been read with mdb_read_columns()
+ * @capacity: rows per batch, or 0 for MDB_BATCH_ROWS
+ *
+ * Allocates the column vectors for mdb_fetch_batch().  A batch is reused
+ * for every fetch; its contents are only valid until the next one.
+ *
+ * Return value: the batch, to be released with mdb_free_batch().
+ */
+MdbBatch *
+mdb_alloc_batch(MdbTableDef *table, unsigned int capacity)
+{
+	MdbHandle *mdb = table->entry->mdb;
+	MdbBatch *batch;
+	MdbBatchColumn *bc;
+	size_t bitmap_sz;
+	unsigned int i;
+
+	if (!capacity)
+		capacity = MDB_BATCH_ROWS;
+	bitmap_sz = (capacity + 7) / 8;
+
+	batch = g_malloc0(sizeof(MdbBatch));
+	batch->table = table;
+	batch->capacity = capacity;
+	batch->num_cols = table->num_cols;
+	batch->columns = g_malloc0(table->num_cols * sizeof(MdbBatchColumn));
+	batch->fields = g_malloc(table->num_cols * sizeof(MdbField));
+	batch->scratch = g_malloc(mdb->bind_size);
+	batch->pages = g_malloc(capacity * sizeof(guint32));
+
+	for (i = 0; i < table->num_cols; i++) {
+		bc = &batch->columns[i];
+		bc->col = g_ptr_array_index(table->columns, i);
+		bc->kind = mdb_batch_kind(bc->col);
+		bc->validity = g_malloc0(bitmap_sz);
+		switch (bc->kind) {
+			case MDB_BATCH_INT32:
+				bc->values = g_malloc0(capacity * sizeof(gint32));
+				break;
+			case MDB_BATCH_INT64:
+				bc->scale = 4;
+				bc->values = g_malloc0(capacity * sizeof(gint64));
+				break;
+			case MDB_BATCH_TIMESTAMP:
+				bc->values = g_malloc0(capacity * sizeof(gint64));
+				break;
+			case MDB_BATCH_DOUBLE:
+				bc->values = g_malloc0(capacity * sizeof(double));
+				break;
+			case MDB_BATCH_BOOL:
+				bc->values = g_malloc0(bitmap_sz);
+				break;
+			case MDB_BATCH_STRING:
+			case MDB_BATCH_BINARY:
+				bc->offsets = g_malloc0((capacity + 1) * sizeof(guint32));
+				bc->data_size = capacity * 16;
+				bc->data = g_malloc(bc->data_size);
+				break;
+		}
+	}
+	return batch;
+}
+void
+mdb_free_batch(MdbBatch *batch)
+{
+	unsigned int i;
+
+	if (!batch)
+		return;
+	for (i = 0; i < batch->num_cols; i++) {
+		g_free(batch->columns[i].validity);
+		g_free(batch->columns[i].values);
+		g_free(batch->columns[i].offsets);
+		g_free(batch->columns[i].data);
+	}
+	g_free(batch->columns);
+	g_free(batch->fields);
+	g_free(batch->scratch);
+	g_free(batch->pages);
+	mdb_free_page_rows(batch->page_rows);
+	g_free(batch);
+}
+static void
+mdb_batch_reserve(MdbBatchColumn *bc, size_t len)
+{
+	if (bc->data_len + len <= bc->data_size)
+		return;
+	while (bc->data_len + len > bc->data_size)
+		bc->data_size *= 2;
+	bc->data = g_realloc(bc->data, bc->data_size);
+}
+static void
+mdb_batch_append_bytes(MdbBatchColumn *bc, const void *src, size_t len)
+{
+	mdb_batch_reserve(bc, len);
+	memcpy(bc->data + bc->data_len, src, len);
+	bc->data_len += len;
+}
+/* mdb_unicode2ascii() produces Latin-1; widen bytes >= 0x80 to UTF-8 */
+static void
+mdb_batch_append_latin1(MdbBatchColumn *bc, const char *src, size_t len)
+{
+	unsigned char *out;
+	size_t i;
+
+	mdb_batch_reserve(bc, len * 2);
+	out = (unsigned char *)bc->data + bc->data_len;
+	for (i = 0; i < len; i++) {
+		unsigned char c = src[i];
+		if (c < 0x80) {
+			*out++ = c;
+		} else {
+			*out++ = 0xC0 | (c >> 6);
+			*out++ = 0x80 | (c & 0x3F);
+		}
+	}
+	bc->data_len = (char *)out - bc->data;
+}
+static void
+mdb_batch_append_ole(MdbHandle *mdb, MdbBatch *batch, MdbBatchColumn *bc, MdbField *f)
+{
+	MdbColumn *col = bc->col;
+	void *saved_bind = col->bind_ptr;
+	void *value;
+	size_t len = 0;
+
+	if (f->siz < MDB_MEMO_OVERHEAD)
+		return;
+	/* mdb_ole_read_full() works from the bound copy of the OLE header */
+	memcpy(batch->scratch, mdb->pg_buf + f->start, MDB_MEMO_OVERHEAD);
+	col->bind_ptr = batch->scratch;
+	col->cur_value_start = f->start;
+	col->cur_value_len = f->siz;
+	value = mdb_ole_read_full(mdb, col, &len);
+	col->bind_ptr = saved_bind;
+	if (value) {
+		mdb_batch_append_bytes(bc, value, len);
+		g_free(value);
+	}
+}
+static void
+mdb_batch_append_row(MdbTableDef *table, MdbBatch *batch, MdbField *fields)
+{
+	MdbHandle *mdb = table->entry->mdb;
+	unsigned int row = batch->num_rows;
+	unsigned char bit = 1 << (row & 7);
+	size_t byte = row >> 3;
+	unsigned int i;
+
+	/* use num_cols instead of num_fields, as mdb_read_row() does */
+	for (i = 0; i < table->num_cols; i++) {
+		MdbField *f = &fields[i];
+		MdbBatchColumn *bc = &batch->columns[f->colnum];
+		MdbColumn *col = bc->col;
+		void *pg = mdb->pg_buf;
+		char *str = NULL;
+		double td;
+		int len;
+
+		if (bc->kind == MDB_BATCH_BOOL) {
+			/* booleans live in the null mask: a set bit means true */
+			bc->validity[byte] |= bit;
+			if (!f->is_null)
+				((unsigned char *)bc->values)[byte] |= bit;
+			continue;
+		}
+		if (f->is_null) {
+			bc->null_count++;
+			if (bc->offsets)
+				bc->offsets[row+1] = bc->data_len;
+			continue;
+		}
+		bc->validity[byte] |= bit;
+
+		switch (bc->kind) {
+			case MDB_BATCH_INT32:
+				if (col->col_type == MDB_BYTE)
+					((gint32 *)bc->values)[row] = mdb_get_byte(pg, f->start);
+				else if (col->col_type == MDB_INT)
+					((gint32 *)bc->values)[row] = (short)mdb_get_int16(pg, f->start);
+				else
+					((gint32 *)bc->values)[row] = (gint32)mdb_get_int32(pg, f->start);
+				break;
+			case MDB_BATCH_INT64:
+				/* money is a little-endian 64 bit count of 1/10000ths */
+				((gint64 *)bc->values)[row] = (gint64)
+					(((guint64)(guint32)mdb_get_int32(pg, f->start + 4) << 32)
+					| (guint32)mdb_get_int32(pg, f->start));
+				break;
+			case MDB_BATCH_DOUBLE:
+				((double *)bc->values)[row] = col->col_type == MDB_FLOAT ?
+					mdb_get_single(pg, f->start) : mdb_get_double(pg, f->start);
+				break;
+			case MDB_BATCH_TIMESTAMP:
+				/* days since 1899-12-30 to milliseconds since 1970-01-01 */
+				td = (mdb_get_double(pg, f->start) - 25569.0) * 86400000.0;
+				((gint64 *)bc->values)[row] = (gint64)(td < 0 ? td - 0.5 : td + 0.5);
+				break;
+			case MDB_BATCH_BINARY:
+				if (col->col_type == MDB_OLE)
+					mdb_batch_append_ole(mdb, batch, bc, f);
+				else if (f->siz > 0)
+					mdb_batch_append_bytes(bc, (char *)pg + f->start, f->siz);
+				break;
+			case MDB_BATCH_STRING:
+				if (col->col_type == MDB_TEXT) {
+					len = mdb_unicode2ascii(mdb, (char *)pg + f->start, f->siz,
+						batch->scratch, mdb->bind_size);
+					mdb_batch_append_latin1(bc, batch->scratch, len);
+				} else if (col->col_type == MDB_MEMO) {
+					str = mdb_memo_to_string(mdb, f->start, f->siz);
+				} else if (col->col_type == MDB_NUMERIC) {
+					str = mdb_numeric_to_string(mdb, f->start, col->col_scale, col->col_prec);
+				} else {
+					str = mdb_col_to_string(mdb, pg, f->start, col->col_type, f->siz);
+				}
+				if (str) {
+					mdb_batch_append_latin1(bc, str, strlen(str));
+					g_free(str);
+				}
+				break;
+			case MDB_BATCH_BOOL:
+				break;
+		}
+		if (bc->offsets)
+			bc->offsets[row+1] = bc->data_len;
+	}
+	batch->num_rows++;
+}
+/* page the current row slot lives on; temp tables number theirs from 1 */
+static guint32
+mdb_batch_cur_page(MdbTableDef *table)
+{
+	return table->is_temp_table ? table->cur_pg_num : table->cur_phys_pg;
+}
+static int
+mdb_batch_page_wanted(MdbBatch *batch, guint32 pg)
+{
+	unsigned int lo = 0, hi = batch->num_page_filter, mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (batch->page_filter[mid] < pg)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo < batch->num_page_filter && batch->page_filter[lo] == pg;
+}
+/**
+ * mdb_fetch_batch:
+ * @table: table to scan, positioned like mdb_fetch_row()
+ * @batch: batch from mdb_alloc_batch() for this table
+ *
+ * Decodes up to batch->capacity rows into the batch's column vectors.
+ * It advances the same cursor as mdb_fetch_row() and honours the same
+ * sargs and scan strategy, but nothing is written to bound columns.
+ * If batch->page_filter is set, rows on any other page are skipped
+ * without being decoded.
+ *
+ * batch->at_end is set once the scan has run out of rows, so callers can
+ * stop after a short last batch instead of asking again.
+ *
+ * Return value: number of rows fetched; 0 at the end of the table.
+ */
+int
+mdb_fetch_batch(MdbTableDef *table, MdbBatch *batch)
+{
+	MdbHandle *mdb = table->entry->mdb;
+	size_t bitmap_sz = (batch->capacity + 7) / 8;
+	MdbBatchColumn *bc;
+	MdbPageRows *pr;
+	unsigned int i, row;
+	int num_fields, have_page, filtered = 0;
+	guint32 pg;
+
+	batch->num_rows = 0;
+	batch->at_end = 0;
+	for (i = 0; i < batch->num_cols; i++) {
+		bc = &batch->columns[i];
+		memset(bc->validity, 0, bitmap_sz);
+		if (bc->kind == MDB_BATCH_BOOL)
+			memset(bc->values, 0, bitmap_sz);
+		bc->null_count = 0;
+		bc->data_len = 0;
+	}
+
+	/* sequential scans decode and filter each page's rows in one go; the
+	 * page may have been rewritten since the last call, so start afresh */
+	pr = NULL;
+	if (table->strategy == MDB_TABLE_SCAN && table->num_cols && table->columns) {
+		if (!batch->page_rows)
+			batch->page_rows = mdb_alloc_page_rows();
+		pr = batch->page_rows;
+	}
+	have_page = 0;
+
+	while (batch->num_rows < batch->capacity) {
+		if (!mdb_next_row_slot(table, &row)) {
+			batch->at_end = 1;
+			break;
+		}
+		pg = mdb_batch_cur_page(table);
+		if (batch->page_filter && !mdb_batch_page_wanted(batch, pg)) {
+			/* jump to the end of the page; index scans go row by row */
+			if (table->strategy == MDB_TABLE_SCAN)
+				table->cur_row = mdb_get_int16(mdb->pg_buf, mdb->fmt->row_count_offset);
+			continue;
+		}
+		if (pr) {
+			if (!have_page || pr->pg != pg) {
+				mdb_crack_page(table, pr);
+				filtered = mdb_filter_page(table, pr);
+				pr->pg = pg;
+				have_page = 1;
+			}
+			/* rows the page filter dropped are never materialized */
+			if (row >= pr->num_rows || !(pr->selection[row >> 6] >> (row & 63) & 1))
+				continue;
+			num_fields = mdb_page_row_fields(table, pr, row, batch->fields);
+			if (num_fields <= 0 ||
+			    (!filtered && !mdb_test_sargs(table, batch->fields, num_fields)))
+				continue;
+		} else if (!mdb_crack_visible_row(table, row, batch->fields)) {
+			continue;
+		}
+		batch->pages[batch->num_rows] = pg;
+		mdb_batch_append_row(table, batch, batch->fields);
+	}
+	return batch->num_rows;
+}
+static guint32
+mdb_page_sum(const unsigned char *buf, size_t len)
+{
+	guint32 h = 2166136261u;	/* FNV-1a */
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		h = (h ^ buf[i]) * 16777619u;
+	return h;
+}
+/**
+ * mdb_table_page_sums:
+ * @table: table to examine
+ * @sums: receives an array of (page, checksum) pairs in scan order
+ *
+ * Checksums every data page of the table.  Comparing the result with
+ * that of an earlier call gives the pages that were added, dropped or
+ * rewritten, which can then be rescanned alone via batch->page_filter.
+ * The table's scan position is reset.
+ *
+ * Return value: number of pages; free *sums with mdb_free_page_sums().
+ */
+unsigned int
+mdb_table_page_sums(MdbTableDef *table, MdbPageSum **sums)
+{
+	MdbHandle *mdb = table->entry->mdb;
+	unsigned int count = 0, size = 64;
+
+	*sums = g_malloc(size * sizeof(MdbPageSum));
+	mdb_rewind_table(table);
+	while (1) {
+		if (table->is_temp_table) {
+			if (!mdb_temp_table_read_pg(table, count + 1))
+				break;
+		} else if (!mdb_read_next_dpg(table)) {
+			break;
+		}
+		if (count == size) {
+			size *= 2;
+			*sums = g_realloc(*sums, size * sizeof(MdbPageSum));
+		}
+		(*sums)[count].pg = table->is_temp_table ? count + 1 : table->cur_phys_pg;
+		(*sums)[count].sum = mdb_page_sum(mdb->pg_buf, mdb->fmt->pg_size);
+		count++;
+	}
+	mdb_rewind_table(table);
+	return count;
+}
+void
+mdb_free_page_sums(MdbPageSum *sums)
+{
+	g_free(sums);
+}
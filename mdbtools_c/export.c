@@ -0,0 +1,603 @@
+/* MDB Tools - A library for reading MS Access database file
+ * Copyright (C) 2000 Brian Bruns
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Buffered table export: delimited text and SQL INSERT statements.
+ *
+ * Rows are formatted into one large reusable buffer which is handed to the
+ * OS with a single write() each time it fills.  Values are scanned for bytes
+ * that may need escaping - with memchr when only one byte is special, or a
+ * 256-entry lookup table otherwise - and the clean spans in between are
+ * copied in bulk.  Binary columns are hex/octal encoded from a table rather
+ * than through printf.
+ */
+
+#include <errno.h>
+#include "mdbtools.h"
+
+#define MDB_BINEXPORT_MASK 0x0F
+#define is_binary_type(x) (x==MDB_OLE || x==MDB_BINARY || x==MDB_REPID)
+#define is_quote_type(x) (is_binary_type(x) || x==MDB_TEXT || x==MDB_MEMO || x==MDB_DATETIME)
+//#define DONT_ESCAPE_ESCAPE
+
+/* smallest buffer that still fits one encoded byte in every mode */
+#define MDB_EXPORT_MIN_BUF 64
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+static void
+mdb_export_sink(MdbExportWriter *w, const char *data, size_t len)
+{
+	if (w->error || !len)
+		return;
+	if (w->stream) {
+		if (fwrite(data, 1, len, w->stream) != len)
+			w->error = errno ? errno : EIO;
+		return;
+	}
+	while (len) {
+		ssize_t n = write(w->fd, data, len);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			w->error = errno;
+			return;
+		}
+		data += n;
+		len -= n;
+	}
+}
+/**
+ * mdb_export_writer_new:
+ * @fd: file descriptor to write to
+ * @buf_size: size of the output buffer, or 0 for MDB_EXPORT_BUF_SIZE
+ *
+ * Allocates a writer that batches output into @buf_size chunks.  The
+ * descriptor is not closed by mdb_export_writer_free().
+ *
+ * Return value: the writer, or NULL if out of memory.
+ */
+MdbExportWriter *
+mdb_export_writer_new(int fd, size_t buf_size)
+{
+	MdbExportWriter *w;
+
+	if (!buf_size)
+		buf_size = MDB_EXPORT_BUF_SIZE;
+	if (buf_size < MDB_EXPORT_MIN_BUF)
+		buf_size = MDB_EXPORT_MIN_BUF;
+
+	w = g_malloc0(sizeof(MdbExportWriter));
+	if (!w)
+		return NULL;
+	w->buf = g_malloc(buf_size);
+	if (!w->buf) {
+		g_free(w);
+		return NULL;
+	}
+	w->fd = fd;
+	w->size = buf_size;
+	w->owns_buf = 1;
+	return w;
+}
+/**
+ * mdb_export_writer_init_stream:
+ * @w: writer to initialise, usually on the stack
+ * @stream: stdio stream to drain to
+ * @buf: caller-owned buffer of at least MDB_EXPORT_MIN_BUF bytes
+ * @size: size of @buf
+ *
+ * Sets up a writer over caller-provided storage; nothing is allocated, so
+ * mdb_export_writer_flush() is all that is needed when done.
+ */
+void
+mdb_export_writer_init_stream(MdbExportWriter *w, FILE *stream, char *buf, size_t size)
+{
+	memset(w, 0, sizeof(MdbExportWriter));
+	w->fd = -1;
+	w->stream = stream;
+	w->buf = buf;
+	w->size = size;
+}
+/**
+ * mdb_export_writer_flush:
+ * @w: writer
+ *
+ * Hands any buffered bytes to the underlying descriptor or stream.
+ *
+ * Return value: 0 on success, -1 if this or any earlier write failed.
+ */
+int
+mdb_export_writer_flush(MdbExportWriter *w)
+{
+	mdb_export_sink(w, w->buf, w->len);
+	w->len = 0;
+	return w->error ? -1 : 0;
+}
+/**
+ * mdb_export_writer_free:
+ * @w: writer from mdb_export_writer_new()
+ *
+ * Flushes and frees the writer.
+ *
+ * Return value: the result of the final flush.
+ */
+int
+mdb_export_writer_free(MdbExportWriter *w)
+{
+	int ret;
+
+	if (!w)
+		return 0;
+	ret = mdb_export_writer_flush(w);
+	if (w->owns_buf)
+		g_free(w->buf);
+	g_free(w);
+	return ret;
+}
+void
+mdb_export_write(MdbExportWriter *w, const char *data, size_t len)
+{
+	if (w->len + len <= w->size) {
+		memcpy(w->buf + w->len, data, len);
+		w->len += len;
+		return;
+	}
+	mdb_export_writer_flush(w);
+	if (len < w->size) {
+		memcpy(w->buf, data, len);
+		w->len = len;
+	} else {
+		/* larger than the whole buffer: skip the copy */
+		mdb_export_sink(w, data, len);
+	}
+}
+void
+mdb_export_puts(MdbExportWriter *w, const char *str)
+{
+	mdb_export_write(w, str, strlen(str));
+}
+/* room for at least len bytes at w->buf + w->len; len must not exceed w->size */
+static char *
+mdb_export_reserve(MdbExportWriter *w, size_t len)
+{
+	if (w->len + len > w->size)
+		mdb_export_writer_flush(w);
+	return w->buf + w->len;
+}
+static void
+mdb_export_hex(MdbExportWriter *w, const unsigned char *p, size_t len)
+{
+	while (len) {
+		size_t chunk = MIN(len, w->size / 2);
+		char *out = mdb_export_reserve(w, chunk * 2);
+		size_t i;
+
+		for (i = 0; i < chunk; i++) {
+			*out++ = hex_digits[p[i] >> 4];
+			*out++ = hex_digits[p[i] & 0x0F];
+		}
+		w->len += chunk * 2;
+		p += chunk;
+		len -= chunk;
+	}
+}
+static void
+mdb_export_octal(MdbExportWriter *w, const unsigned char *p, size_t len)
+{
+	while (len) {
+		size_t chunk = MIN(len, w->size / 4);
+		char *out = mdb_export_reserve(w, chunk * 4);
+		size_t i;
+
+		for (i = 0; i < chunk; i++) {
+			*out++ = '\\';
+			*out++ = '0' + (p[i] >> 6);
+			*out++ = '0' + ((p[i] >> 3) & 7);
+			*out++ = '0' + (p[i] & 7);
+		}
+		w->len += chunk * 4;
+		p += chunk;
+		len -= chunk;
+	}
+}
+/**
+ * mdb_export_col:
+ * @w: writer to append to
+ * @col_val: the value; NUL-terminated unless @col_type is a binary type
+ * @quote_text: quote text-like values if non-zero
+ * @col_type: MDB column type of the value
+ * @bin_len: length of @col_val for binary types
+ * @quote_char: quote string, possibly multibyte
+ * @escape_char: escape string, or NULL to double the quote instead
+ * @flags: one of MDB_BINEXPORT_*, optionally OR'ed with
+ * MDB_EXPORT_ESCAPE_CONTROL_CHARS
+ *
+ * Appends one value, quoted and escaped exactly as mdb_print_col() does.
+ */
+void
+mdb_export_col(MdbExportWriter *w, const char *col_val, int quote_text, int col_type,
+	int bin_len, const char *quote_char, const char *escape_char, int flags)
+{
+	size_t quote_len = strlen(quote_char); /* multibyte */
+	size_t orig_escape_len = escape_char ? strlen(escape_char) : 0;
+	size_t escape_len;
+	int quoting = quote_text && is_quote_type(col_type);
+	int bin_mode = (flags & MDB_BINEXPORT_MASK);
+	int escape_cr_lf = (flags & MDB_EXPORT_ESCAPE_CONTROL_CHARS) && is_quote_type(col_type);
+	const unsigned char *p = (const unsigned char *)col_val;
+	const unsigned char *end;
+	unsigned char special[256];
+	unsigned char only = 0;
+	int nspecial = 0;
+
+	/* double the quote char if no escape char passed */
+	if (!escape_char)
+		escape_char = quote_char;
+	escape_len = strlen(escape_char);
+
+	if (quoting)
+		mdb_export_write(w, quote_char, quote_len);
+
+	if (is_binary_type(col_type)) {
+		if (bin_mode == MDB_BINEXPORT_STRIP || bin_len <= 0)
+			goto done;
+		if (bin_mode == MDB_BINEXPORT_OCTAL) {
+			mdb_export_octal(w, p, bin_len);
+			goto done;
+		}
+		if (bin_mode == MDB_BINEXPORT_HEXADECIMAL) {
+			mdb_export_hex(w, p, bin_len);
+			goto done;
+		}
+		end = p + bin_len;
+	} else
+		end = p + strlen(col_val);
+
+	/* bytes that can start an escape sequence */
+	memset(special, 0, sizeof(special));
+#define MARK(c) do { if (!special[(unsigned char)(c)]) { \
+		special[(unsigned char)(c)] = 1; only = (c); nspecial++; } } while (0)
+	if (quoting && quote_len)
+		MARK(quote_char[0]);
+#ifndef DONT_ESCAPE_ESCAPE
+	if (quoting && orig_escape_len)
+		MARK(escape_char[0]);
+#endif
+	if (escape_cr_lf) {
+		MARK('\r');
+		MARK('\n');
+		MARK('\t');
+		MARK('\\');
+	}
+#undef MARK
+
+	while (p < end) {
+		const unsigned char *span = p;
+
+		if (nspecial == 0) {
+			p = end;
+		} else if (nspecial == 1) {
+			p = memchr(p, only, end - p);
+			if (!p)
+				p = end;
+		} else {
+			while (p < end && !special[*p])
+				p++;
+		}
+		if (p > span)
+			mdb_export_write(w, (const char *)span, p - span);
+		if (p == end)
+			break;
+
+		if (quoting && quote_len && (size_t)(end - p) >= quote_len
+				&& !memcmp(p, quote_char, quote_len)) {
+			mdb_export_write(w, escape_char, escape_len);
+			mdb_export_write(w, quote_char, quote_len);
+			p += quote_len;
+#ifndef DONT_ESCAPE_ESCAPE
+		} else if (quoting && orig_escape_len && (size_t)(end - p) >= orig_escape_len
+				&& !memcmp(p, escape_char, orig_escape_len)) {
+			mdb_export_write(w, escape_char, escape_len);
+			mdb_export_write(w, escape_char, escape_len);
+			p += orig_escape_len;
+#endif
+		} else if (escape_cr_lf && (*p == '\r' || *p == '\n' || *p == '\t' || *p == '\\')) {
+			char seq[2];
+			seq[0] = '\\';
+			seq[1] = *p == '\r' ? 'r' : *p == '\n' ? 'n' : *p == '\t' ? 't' : '\\';
+			mdb_export_write(w, seq, 2);
+			p++;
+		} else {
+			/* first byte of a multibyte quote/escape that didn't match */
+			mdb_export_write(w, (const char *)p, 1);
+			p++;
+		}
+	}
+done:
+	if (quoting)
+		mdb_export_write(w, quote_char, quote_len);
+}
+/* bind every column of table to its own reusable buffer */
+static int
+mdb_export_bind(MdbTableDef *table, char ***values, int **lens)
+{
+	MdbHandle *mdb = table->entry->mdb;
+	unsigned int i;
+
+	*values = g_malloc0(table->num_cols * sizeof(char *));
+	*lens = g_malloc0(table->num_cols * sizeof(int));
+	for (i = 0; i < table->num_cols; i++) {
+		(*values)[i] = mdb_mem_malloc(MDB_MEM_BIND, mdb->bind_size);
+		if (mdb_bind_column(table, i+1, (*values)[i], &(*lens)[i]) == -1) {
+			fprintf(stderr, "error binding column %d\n", i+1);
+			return -1;
+		}
+	}
+	return 0;
+}
+static void
+mdb_export_unbind(MdbTableDef *table, char **values, int *lens)
+{
+	MdbColumn *col;
+	unsigned int i;
+
+	for (i = 0; i < table->num_cols; i++) {
+		col = g_ptr_array_index(table->columns, i);
+		if (values[i] && col->bind_ptr == values[i]) {
+			col->bind_ptr = NULL;
+			col->len_ptr = NULL;
+		}
+		g_free(values[i]);
+	}
+	g_free(values);
+	g_free(lens);
+}
+/**
+ * mdb_export_table:
+ * @table: table whose columns have been read with mdb_read_columns()
+ * @w: writer to append to
+ * @delimiter: column separator
+ * @row_delimiter: row terminator
+ * @quote_char: quote string
+ * @escape_char: escape string, or NULL to double quotes
+ * @header_row: emit the column names first if non-zero
+ * @flags: as for mdb_export_col()
+ *
+ * Exports every row of @table.  NULLs are written as empty, unquoted
+ * fields.  Each column is bound to a single reusable buffer for the whole
+ * scan, and the bindings are removed again before returning.
+ *
+ * Return value: number of rows exported, or -1 on error.
+ */
+long
+mdb_export_table(MdbTableDef *table, MdbExportWriter *w, const char *delimiter,
+	const char *row_delimiter, const char *quote_char, const char *escape_char,
+	int header_row, int flags)
+{
+	MdbHandle *mdb = table->entry->mdb;
+	MdbColumn *col;
+	char **bound_values;
+	int *bound_lens;
+	size_t delim_len = strlen(delimiter);
+	size_t row_delim_len = strlen(row_delimiter);
+	long rows = 0;
+	unsigned int i;
+
+	if (mdb_export_bind(table, &bound_values, &bound_lens)) {
+		rows = -1;
+		goto cleanup;
+	}
+
+	if (header_row) {
+		for (i = 0; i < table->num_cols; i++) {
+			col = g_ptr_array_index(table->columns, i);
+			if (i)
+				mdb_export_write(w, delimiter, delim_len);
+			mdb_export_puts(w, col->name);
+		}
+		mdb_export_write(w, row_delimiter, row_delim_len);
+	}
+
+	mdb_rewind_table(table);
+	while (mdb_fetch_row(table)) {
+		for (i = 0; i < table->num_cols; i++) {
+			if (i)
+				mdb_export_write(w, delimiter, delim_len);
+			col = g_ptr_array_index(table->columns, i);
+			/* don't quote NULLs */
+			if (col->cur_value_null)
+				continue;
+			if (col->col_type == MDB_OLE) {
+				size_t len;
+				void *value = mdb_ole_read_full(mdb, col, &len);
+				if (value) {
+					mdb_export_col(w, value, 1, col->col_type, len,
+						quote_char, escape_char, flags);
+					g_free(value);
+				}
+			} else if (col->col_type == MDB_BINARY) {
+				/* the bound copy stops at the first NUL; take the raw bytes */
+				mdb_export_col(w, (char *)mdb->pg_buf + col->cur_value_start, 1,
+					col->col_type, col->cur_value_len, quote_char, escape_char, flags);
+			} else {
+				mdb_export_col(w, bound_values[i], 1, col->col_type,
+					bound_lens[i], quote_char, escape_char, flags);
+			}
+		}
+		mdb_export_write(w, row_delimiter, row_delim_len);
+		rows++;
+	}
+	if (mdb_export_writer_flush(w))
+		rows = -1;
+
+cleanup:
+	mdb_export_unbind(table, bound_values, bound_lens);
+	return rows;
+}
+
+/* dialect differences that matter for literal values */
+typedef struct {
+	const char *escape_char;	/* NULL doubles the quote */
+	const char *bin_prefix;
+	const char *bin_suffix;
+} MdbSqlLiteralFmt;
+
+static const MdbSqlLiteralFmt mdb_sql_literal_standard = { NULL, "X'", "'" };
+static const MdbSqlLiteralFmt mdb_sql_literal_postgres = { NULL, "'\\x", "'" };
+/* MySQL treats backslash as an escape inside string literals */
+static const MdbSqlLiteralFmt mdb_sql_literal_mysql = { "\\", "X'", "'" };
+
+static void
+mdb_export_sql_value(MdbExportWriter *w, MdbHandle *mdb, MdbColumn *col,
+	const char *value, int len, const MdbSqlLiteralFmt *fmt)
+{
+	switch (col->col_type) {
+		case MDB_BOOL:
+			mdb_export_puts(w, strcmp(value, mdb->boolean_true_value) ? "FALSE" : "TRUE");
+			break;
+		case MDB_BYTE:
+		case MDB_INT:
+		case MDB_LONGINT:
+		case MDB_COMPLEX:
+		case MDB_MONEY:
+		case MDB_FLOAT:
+		case MDB_DOUBLE:
+		case MDB_NUMERIC:
+			mdb_export_write(w, value, len);
+			break;
+		case MDB_BINARY:
+			/* the bound copy stops at the first NUL; take the raw bytes */
+			mdb_export_puts(w, fmt->bin_prefix);
+			mdb_export_hex(w, (unsigned char *)mdb->pg_buf + col->cur_value_start,
+				col->cur_value_len);
+			mdb_export_puts(w, fmt->bin_suffix);
+			break;
+		case MDB_OLE: {
+			size_t ole_len = 0;
+			void *ole = mdb_ole_read_full(mdb, col, &ole_len);
+			mdb_export_puts(w, fmt->bin_prefix);
+			if (ole)
+				mdb_export_hex(w, ole, ole_len);
+			mdb_export_puts(w, fmt->bin_suffix);
+			g_free(ole);
+			break;
+		}
+		default:
+			mdb_export_col(w, value, 1, MDB_TEXT, 0, "'", fmt->escape_char,
+				MDB_BINEXPORT_RAW);
+			break;
+	}
+}
+/**
+ * mdb_export_table_sql:
+ * @table: table whose columns have been read with mdb_read_columns()
+ * @w: writer to append to
+ * @dbnamespace: schema to qualify the table name with, or NULL
+ * @batch_size: rows per INSERT statement
+ *
+ * Exports every row of @table as INSERT statements for the handle's
+ * default backend.  Table and column names are quoted and case-normalised
+ * the same way mdb_print_schema() does, so the output loads into the
+ * schema it generates.  Values are typed: numbers and booleans are
+ * written bare, text and dates as string literals and binary data as hex.
+ *
+ * When the backend advertises MDB_SHEXP_BULK_INSERT, up to @batch_size
+ * rows share one multi-row INSERT; otherwise one statement is written per
+ * row.
+ *
+ * Return value: number of rows exported, or -1 on error.
+ */
+long
+mdb_export_table_sql(MdbTableDef *table, MdbExportWriter *w, const char *dbnamespace,
+	int batch_size)
+{
+	MdbHandle *mdb = table->entry->mdb;
+	const MdbSqlLiteralFmt *fmt = &mdb_sql_literal_standard;
+	MdbColumn *col;
+	GString *prefix;
+	char **bound_values;
+	int *bound_lens;
+	char *quoted_name;
+	long rows = 0;
+	int in_batch = 0;
+	unsigned int i;
+
+	if (batch_size < 1 || !(mdb->default_backend->capabilities & MDB_SHEXP_BULK_INSERT))
+		batch_size = 1;
+	if (!strcmp(mdb->backend_name, "postgres"))
+		fmt = &mdb_sql_literal_postgres;
+	else if (!strcmp(mdb->backend_name, "mysql"))
+		fmt = &mdb_sql_literal_mysql;
+
+	/* "INSERT INTO t (a, b) VALUES " is the same for every statement */
+	quoted_name = mdb->default_backend->quote_schema_name(dbnamespace, table->name);
+	quoted_name = mdb_normalise_and_replace(mdb, &quoted_name);
+	prefix = g_string_new("INSERT INTO ");
+	g_string_append(prefix, quoted_name);
+	g_string_append(prefix, " (");
+	g_free(quoted_name);
+	for (i = 0; i < table->num_cols; i++) {
+		col = g_ptr_array_index(table->columns, i);
+		quoted_name = mdb->default_backend->quote_schema_name(NULL, col->name);
+		quoted_name = mdb_normalise_and_replace(mdb, &quoted_name);
+		if (i)
+			g_string_append(prefix, ", ");
+		g_string_append(prefix, quoted_name);
+		g_free(quoted_name);
+	}
+	g_string_append(prefix, ") VALUES ");
+
+	if (mdb_export_bind(table, &bound_values, &bound_lens)) {
+		rows = -1;
+		goto cleanup;
+	}
+
+	mdb_rewind_table(table);
+	while (mdb_fetch_row(table)) {
+		if (in_batch)
+			mdb_export_write(w, ",\n", 2);
+		else
+			mdb_export_write(w, prefix->str, prefix->len);
+		mdb_export_write(w, "(", 1);
+		for (i = 0; i < table->num_cols; i++) {
+			col = g_ptr_array_index(table->columns, i);
+			if (i)
+				mdb_export_write(w, ", ", 2);
+			if (col->cur_value_null)
+				mdb_export_write(w, "NULL", 4);
+			else
+				mdb_export_sql_value(w, mdb, col, bound_values[i], bound_lens[i], fmt);
+		}
+		mdb_export_write(w, ")", 1);
+		rows++;
+		if (++in_batch == batch_size) {
+			mdb_export_write(w, ";\n", 2);
+			in_batch = 0;
+		}
+	}
+	if (in_batch)
+		mdb_export_write(w, ";\n", 2);
+	if (mdb_export_writer_flush(w))
+		rows = -1;
+
+cleanup:
+	mdb_export_unbind(table, bound_values, bound_lens);
+	g_string_free(prefix, TRUE);
+	return rows;
+}
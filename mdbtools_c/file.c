@@ -18,6 +18,7 @@
 
 #include <inttypes.h>
 #include <stddef.h>
+#include <errno.h>
 #include "mdbtools.h"
 #include "mdbprivate.h"
 
@@ -124,7 +125,7 @@ static char *mdb_find_file(const char *file_name)
  * Return value: The handle on success, NULL on failure
  */
 static MdbHandle *mdb_handle_from_stream(FILE *stream, MdbFileFlags flags) {
-	MdbHandle *mdb = g_malloc0(sizeof(MdbHandle));
+	MdbHandle *mdb = mdb_mem_malloc0(MDB_MEM_PAGE_CACHE, sizeof(MdbHandle));
 	mdb_set_default_backend(mdb, "access");
     mdb_set_date_fmt(mdb, "%x %X");
     mdb_set_shortdate_fmt(mdb, "%x");
@@ -140,6 +141,9 @@ static MdbHandle *mdb_handle_from_stream(FILE *stream, MdbFileFlags flags) {
 	mdb->f = g_malloc0(sizeof(MdbFile));
 	mdb->f->refs = 1;
 	mdb->f->stream = stream;
+	mdb->f->fd = fileno(stream);
+	pthread_mutex_init(&mdb->f->lock, NULL);
+	mdbi_snapshot_init(mdb->f);
 	if (flags & MDB_WRITABLE) {
 		mdb->f->writable = TRUE;
     }
@@ -271,13 +275,13 @@ mdb_close(MdbHandle *mdb)
 	g_free(mdb->stats);
 	g_free(mdb->backend_name);
 
-	if (mdb->f) {
-		if (mdb->f->refs > 1) {
-			mdb->f->refs--;
-		} else {
-			if (mdb->f->stream) fclose(mdb->f->stream);
-			g_free(mdb->f);
-		}
+	if (mdb->f)
+		mdb_snapshot_release(mdb);
+	if (mdb->f && !__atomic_sub_fetch(&mdb->f->refs, 1, __ATOMIC_ACQ_REL)) {
+		if (mdb->f->stream) fclose(mdb->f->stream);
+		pthread_mutex_destroy(&mdb->f->lock);
+		mdbi_snapshot_free(mdb->f);
+		g_free(mdb->f);
 	}
 
 	mdb_iconv_close(mdb);
@@ -292,6 +296,11 @@ mdb_close(MdbHandle *mdb)
  * Clones an existing database handle.  Cloned handle shares the file descriptor
  * but has its own page buffer, page position, and similar internal variables.
  *
+ * The clone may be used on a different thread from @mdb; see the threading
+ * notes above MdbFile.  Cloning itself reads @mdb, so it must not race with
+ * a thread using @mdb.  A clone of a pinned handle is pinned to the same
+ * snapshot and released on its own.
+ *
  * Return value: new handle to the database.
  */
 MdbHandle *mdb_clone_handle(MdbHandle *mdb)
@@ -300,14 +309,14 @@ MdbHandle *mdb_clone_handle(MdbHandle *mdb)
 	MdbCatalogEntry *entry, *data;
 	unsigned int i;
 
-	newmdb = (MdbHandle *) g_memdup2(mdb, sizeof(MdbHandle));
+	newmdb = (MdbHandle *) mdb_mem_memdup(MDB_MEM_PAGE_CACHE, mdb, sizeof(MdbHandle));
 
 	memset(&newmdb->catalog, 0, sizeof(MdbHandle) - offsetof(MdbHandle, catalog));
 
 	newmdb->catalog = g_ptr_array_new();
 	for (i=0;i<mdb->num_catalog;i++) {
 		entry = g_ptr_array_index(mdb->catalog,i);
-		data = g_memdup2(entry,sizeof(MdbCatalogEntry));
+		data = mdb_mem_memdup(MDB_MEM_CATALOG, entry, sizeof(MdbCatalogEntry));
 		data->mdb = newmdb;
 		data->props = NULL;
 		g_ptr_array_add(newmdb->catalog, data);
@@ -323,11 +332,51 @@ MdbHandle *mdb_clone_handle(MdbHandle *mdb)
 	mdb_set_repid_fmt(newmdb, mdb->repid_fmt);
 
 	if (mdb->f) {
-		mdb->f->refs++;
+		__atomic_add_fetch(&mdb->f->refs, 1, __ATOMIC_RELAXED);
+		if (newmdb->snapshot)
+			mdbi_snapshot_share(newmdb);
 	}
 
 	return newmdb;
 }
+/**
+ * mdb_open_cursor:
+ * @mdb: Handle to open MDB database file
+ *
+ * Creates a page cursor for walking one part of the file (an index, say)
+ * while @mdb stays positioned on another.  Unlike mdb_clone_handle() the
+ * cursor borrows the catalog, backends and character set conversion of
+ * @mdb instead of copying them; only the page buffer is its own.  It
+ * belongs to the same thread as @mdb and must not outlive it.
+ *
+ * Return value: the cursor, to be freed with mdb_close_cursor().
+ */
+MdbHandle *mdb_open_cursor(MdbHandle *mdb)
+{
+	MdbHandle *cursor;
+
+	/* the page buffers are the bulk of the handle and need no copying */
+	cursor = mdb_mem_malloc(MDB_MEM_PAGE_CACHE, sizeof(MdbHandle));
+	memcpy(cursor, mdb, offsetof(MdbHandle, pg_buf));
+	memcpy(&cursor->fmt, &mdb->fmt, sizeof(MdbHandle) - offsetof(MdbHandle, fmt));
+	cursor->cur_pg = 0;
+	cursor->cur_pos = 0;
+	__atomic_add_fetch(&mdb->f->refs, 1, __ATOMIC_RELAXED);
+	return cursor;
+}
+/**
+ * mdb_close_cursor:
+ * @cursor: cursor from mdb_open_cursor()
+ *
+ * Frees the cursor, leaving everything it borrowed to its parent handle.
+ */
+void mdb_close_cursor(MdbHandle *cursor)
+{
+	if (!cursor) return;
+	/* the parent still holds a reference, so this is never the last */
+	__atomic_sub_fetch(&cursor->f->refs, 1, __ATOMIC_ACQ_REL);
+	g_free(cursor);
+}
 
 /* 
 ** mdb_read a wrapper for read that bails if anything is wrong 
@@ -336,7 +385,11 @@ ssize_t mdb_read_pg(MdbHandle *mdb, unsigned long pg)
 {
 	ssize_t len;
 
-	if (pg && mdb->cur_pg == pg) return mdb->fmt->pg_size;
+	if (pg && mdb->cur_pg == pg) {
+		if (mdb->stats && mdb->stats->collect)
+			mdb->stats->pg_hits++;
+		return mdb->fmt->pg_size;
+	}
 
 	len = _mdb_read_pg(mdb, mdb->pg_buf, pg);
 	//fprintf(stderr, "read page %ld type %02x\n", pg, mdb->pg_buf[0]);
@@ -349,29 +402,98 @@ ssize_t mdb_read_alt_pg(MdbHandle *mdb, unsigned long pg)
 {
 	return _mdb_read_pg(mdb, mdb->alt_pg_buf, pg);
 }
+/*
+ * Positional I/O on the shared file, safe to call from several handles at
+ * once.  Files use pread/pwrite on the descriptor and never touch the
+ * stdio buffer; memory streams have no descriptor, so their seek and
+ * transfer are done together under f->lock.
+ */
+off_t mdbi_file_size(MdbFile *f)
+{
+	struct stat status;
+	off_t size;
+
+	if (f->fd >= 0)
+		return fstat(f->fd, &status) ? -1 : status.st_size;
+	pthread_mutex_lock(&f->lock);
+	size = fseeko(f->stream, 0, SEEK_END) ? -1 : ftello(f->stream);
+	pthread_mutex_unlock(&f->lock);
+	return size;
+}
+ssize_t mdbi_read_at(MdbFile *f, void *buf, size_t len, off_t offset)
+{
+	ssize_t n, total = 0;
+
+	if (f->fd >= 0) {
+		while ((size_t)total < len) {
+			n = pread(f->fd, (char *)buf + total, len - total, offset + total);
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n < 0)
+				return -1;
+			if (n == 0)
+				break;
+			total += n;
+		}
+		return total;
+	}
+	pthread_mutex_lock(&f->lock);
+	if (fseeko(f->stream, offset, SEEK_SET) == -1) {
+		total = -1;
+	} else {
+		total = fread(buf, 1, len, f->stream);
+		if (ferror(f->stream))
+			total = -1;
+	}
+	pthread_mutex_unlock(&f->lock);
+	return total;
+}
+ssize_t mdbi_write_at(MdbFile *f, const void *buf, size_t len, off_t offset)
+{
+	ssize_t n, total = 0;
+
+	if (f->fd >= 0) {
+		while ((size_t)total < len) {
+			n = pwrite(f->fd, (const char *)buf + total, len - total, offset + total);
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n <= 0)
+				return -1;
+			total += n;
+		}
+		return total;
+	}
+	pthread_mutex_lock(&f->lock);
+	if (fseeko(f->stream, offset, SEEK_SET) == -1) {
+		total = -1;
+	} else {
+		total = fwrite(buf, 1, len, f->stream);
+		if (ferror(f->stream))
+			total = -1;
+	}
+	pthread_mutex_unlock(&f->lock);
+	return total;
+}
 static ssize_t _mdb_read_pg(MdbHandle *mdb, void *pg_buf, unsigned long pg)
 {
 	ssize_t len;
 	off_t offset = pg * mdb->fmt->pg_size;
+	off_t size = mdbi_file_size(mdb->f);
 
-    if (fseeko(mdb->f->stream, 0, SEEK_END) == -1) {
-        fprintf(stderr, "Unable to seek to end of file\n");
+    if (size == -1) {
+        fprintf(stderr, "Unable to find the end of file\n");
         return 0;
     }
-    if (ftello(mdb->f->stream) < offset) { 
+    if (size < offset) { 
         fprintf(stderr,"offset %" PRIu64 " is beyond EOF\n",(uint64_t)offset);
         return 0;
     }
 	if (mdb->stats && mdb->stats->collect) 
 		mdb->stats->pg_reads++;
 
-	if (fseeko(mdb->f->stream, offset, SEEK_SET) == -1) {
-        fprintf(stderr, "Unable to seek to page %lu\n", pg);
-        return 0;
-    }
-	len = fread(pg_buf, 1, mdb->fmt->pg_size, mdb->f->stream);
-	if (ferror(mdb->f->stream)) {
-		perror("read");
+	len = mdbi_read_page(mdb, pg_buf, pg, offset);
+	if (len == -1) {
+		fprintf(stderr, "Unable to read page %lu: %s\n", pg, strerror(errno));
 		return 0;
 	}
     memset(pg_buf + len, 0, mdb->fmt->pg_size - len);
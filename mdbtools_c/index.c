@@ -16,6 +16,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#define MDB_MEM_TAG MDB_MEM_TABLEDEF
+
 #include "mdbtools.h"
 #include "mdbprivate.h"
 #ifdef HAVE_LIBMSWSTR
@@ -444,7 +446,10 @@ mdb_index_cache_sarg(MdbColumn *col, MdbSarg *sarg, MdbSarg *idx_sarg)
 
 	switch (col->col_type) {
 		case MDB_TEXT:
+		/* room for the two byte sort keys of a Jet4 linguistic hash */
+		idx_sarg->value.s = mdb_mem_malloc0(MDB_MEM_SARG, (sarg->value.len + 1) * 2);
 		mdb_index_hash_text(col->table->mdbidx, sarg->value.s, idx_sarg->value.s);
+		idx_sarg->value.len = strlen(idx_sarg->value.s);
 		break;
 
 		case MDB_LONGINT:
@@ -528,7 +533,9 @@ mdb_index_test_sargs(MdbHandle *mdb, MdbIndex *idx, char *buf, int len)
 			col->idx_sarg_cache = g_ptr_array_new();
 			for (j=0;j<col->num_sargs;j++) {
 				sarg = g_ptr_array_index (col->sargs, j);
-				idx_sarg = g_memdup2(sarg,sizeof(MdbSarg));
+				idx_sarg = mdb_mem_memdup(MDB_MEM_SARG, sarg, sizeof(MdbSarg));
+				idx_sarg->value.s = NULL;
+				idx_sarg->value.len = 0;
 				//printf("calling mdb_index_cache_sarg\n");
 				mdb_index_cache_sarg(col, sarg, idx_sarg);
 				g_ptr_array_add(col->idx_sarg_cache, idx_sarg);
@@ -540,6 +547,18 @@ mdb_index_test_sargs(MdbHandle *mdb, MdbIndex *idx, char *buf, int len)
 			/* XXX - kludge */
 			node.op = sarg->op;
 			node.value = sarg->value;
+			/* integer columns only get integer sargs */
+			switch (col->col_type) {
+				case MDB_BOOL:
+				case MDB_BYTE:
+				case MDB_INT:
+				case MDB_LONGINT:
+					node.val_type = MDB_INT;
+					break;
+				default:
+					node.val_type = MDB_DOUBLE;
+					break;
+			}
 			//field.value = &mdb->pg_buf[offset + c_offset];
 			field.value = buf;
 		       	field.siz = c_len;
@@ -598,44 +617,79 @@ mdb_index_pack_bitmap(MdbHandle *mdb, MdbIndexPage *ipg)
 }
 /*
  * unpack the pages bitmap
+ *
+ * Each set bit marks the start of an entry, as an offset from the first
+ * entry (whose own start, bit 0, is implicit).  The bits are counted first
+ * so idx_starts is sized to the page rather than to the largest possible
+ * page.
  */
 int
 mdb_index_unpack_bitmap(MdbHandle *mdb, MdbIndexPage *ipg)
 {
-	int mask_bit = 0;
 	int mask_pos = IS_JET3(mdb)?0x16:0x1b;
-	int mask_byte;
 	int jet_start = IS_JET3(mdb)?0xf8:0x1e0;
-	int start = jet_start;
-	int elem = 0;
-	int len = 0;
-
-	ipg->idx_starts[elem++]=start;
+	unsigned int count = 1;
+	unsigned int elem = 0;
+	unsigned int mask_byte;
+	int pos;
+
+	for (pos = mask_pos; pos < jet_start; pos++) {
+		mask_byte = mdb->pg_buf[pos];
+		if (pos == mask_pos) mask_byte &= 0xfe;
+		count += __builtin_popcount(mask_byte);
+	}
+	/* plus the terminating zero */
+	mdb_index_page_reserve(ipg, count + 1);
 
 	//fprintf(stdout, "Unpacking index page %lu\n", ipg->pg);
-	do {
-		len = 0;
-		do {
-			mask_bit++;
-			if (mask_bit==8) {
-				mask_bit=0;
-				mask_pos++;
-			}
-			mask_byte = mdb->pg_buf[mask_pos];
-			len++;
-		} while (mask_pos <= jet_start && !((1 << mask_bit) & mask_byte));
-		//fprintf(stdout, "%d %d %d %d\n", mask_pos, mask_bit, mask_byte, len);
-
-		start += len;
-		if (mask_pos < jet_start) ipg->idx_starts[elem++]=start;
-
-	} while (mask_pos < jet_start);
+	ipg->idx_starts[elem++] = jet_start;
+	for (pos = mask_pos; pos < jet_start; pos++) {
+		mask_byte = mdb->pg_buf[pos];
+		if (pos == mask_pos) mask_byte &= 0xfe;
+		while (mask_byte) {
+			ipg->idx_starts[elem++] = jet_start + (pos - mask_pos) * 8
+				+ __builtin_ctz(mask_byte);
+			mask_byte &= mask_byte - 1;
+		}
+	}
 
-	/* if we zero the next element, so we don't pick up the last pages starts*/
-	ipg->idx_starts[elem]=0;
+	/* zero the next element, so we don't pick up the last pages starts */
+	ipg->idx_starts[elem] = 0;
+	ipg->num_starts = elem;
 
 	return elem;
 }
+/**
+ * mdb_index_page_reserve:
+ * @ipg: Index page of a chain
+ * @num_starts: Entries needed in idx_starts, counting the terminating zero
+ *
+ * Grows the page's idx_starts buffer to hold at least @num_starts entries,
+ * keeping the ones already there.
+ *
+ * Return value: the idx_starts buffer.
+ */
+guint16 *
+mdb_index_page_reserve(MdbIndexPage *ipg, unsigned int num_starts)
+{
+	if (num_starts > ipg->starts_size) {
+		ipg->idx_starts = g_realloc(ipg->idx_starts, num_starts * sizeof(guint16));
+		ipg->starts_size = num_starts;
+	}
+	return ipg->idx_starts;
+}
+/* cache_value grown to hold size bytes; a compressed entry only overwrites
+ * the tail of the previous key, so the existing bytes are kept */
+static unsigned char *
+mdb_index_page_cache(MdbIndexPage *ipg, unsigned int size)
+{
+	if (size > ipg->cache_size) {
+		ipg->cache_value = g_realloc(ipg->cache_value, size);
+		memset(ipg->cache_value + ipg->cache_size, 0, size - ipg->cache_size);
+		ipg->cache_size = size;
+	}
+	return ipg->cache_value;
+}
 /*
  * find the next entry on a page (either index or leaf). Uses state information
  * stored in the MdbIndexPage across calls.
@@ -646,7 +700,7 @@ mdb_index_find_next_on_page(MdbHandle *mdb, MdbIndexPage *ipg)
 	if (!ipg->pg) return 0;
 
 	/* if this page has not been unpacked to it */
-	if (!ipg->idx_starts[0]){
+	if (!ipg->num_starts){
 		//fprintf(stdout, "Unpacking page %d\n", ipg->pg);
 		mdb_index_unpack_bitmap(mdb, ipg);
 	}
@@ -664,11 +718,13 @@ void mdb_index_page_reset(MdbHandle *mdb, MdbIndexPage *ipg)
 	ipg->offset = IS_JET3(mdb)?0xf8:0x1e0; /* start byte of the index entries */
 	ipg->start_pos=0;
 	ipg->len = 0; 
-	ipg->idx_starts[0]=0;
+	ipg->num_starts = 0;
 }
+/* only the traversal state is reset; the buffers stay for the next page */
 void mdb_index_page_init(MdbHandle *mdb, MdbIndexPage *ipg)
 {
-	memset(ipg, 0, sizeof(MdbIndexPage));
+	ipg->pg = 0;
+	ipg->rc = 0;
 	mdb_index_page_reset(mdb, ipg);
 }
 /*
@@ -725,6 +781,28 @@ mdb_find_next_leaf(MdbHandle *mdb, MdbIndex *idx, MdbIndexChain *chain)
 	return NULL;
 
 }
+/* page at depth (0 based) of the chain, allocated on first use */
+static MdbIndexPage *
+mdb_chain_page(MdbIndexChain *chain, int depth)
+{
+	if (!chain->pages[depth])
+		chain->pages[depth] = g_malloc0(sizeof(MdbIndexPage));
+	return chain->pages[depth];
+}
+void
+mdb_free_index_chain(MdbIndexChain *chain)
+{
+	int i;
+
+	if (!chain) return;
+	for (i=0;i<MDB_MAX_INDEX_DEPTH;i++) {
+		if (!chain->pages[i]) continue;
+		g_free(chain->pages[i]->idx_starts);
+		g_free(chain->pages[i]->cache_value);
+		g_free(chain->pages[i]);
+	}
+	g_free(chain);
+}
 static MdbIndexPage *
 mdb_chain_add_page(MdbHandle *mdb, MdbIndexChain *chain, guint32 pg)
 {
@@ -735,7 +813,7 @@ mdb_chain_add_page(MdbHandle *mdb, MdbIndexChain *chain, guint32 pg)
 		fprintf(stderr,"Error! maximum index depth of %d exceeded.  This is probably due to a programming bug, If you are confident that your indexes really are this deep, adjust MDB_MAX_INDEX_DEPTH in mdbtools.h and recompile.\n", MDB_MAX_INDEX_DEPTH);
 		return NULL;
 	}
-	ipg = &(chain->pages[chain->cur_depth - 1]);
+	ipg = mdb_chain_page(chain, chain->cur_depth - 1);
 	mdb_index_page_init(mdb, ipg);
 	ipg->pg = pg;
 
@@ -754,14 +832,14 @@ mdb_index_read_bottom_pg(MdbHandle *mdb, MdbIndex *idx, MdbIndexChain *chain)
 	 * if it's new use the root index page (idx->first_pg)
 	 */
 	if (!chain->cur_depth) {
-		ipg = &(chain->pages[0]);
+		ipg = mdb_chain_page(chain, 0);
 		mdb_index_page_init(mdb, ipg);
 		chain->cur_depth = 1;
 		ipg->pg = idx->first_pg;
 		if (!(ipg = mdb_find_next_leaf(mdb, idx, chain)))
 			return 0;
 	} else {
-		ipg = &(chain->pages[chain->cur_depth - 1]);
+		ipg = chain->pages[chain->cur_depth - 1];
 		ipg->len = 0; 
 	}
 
@@ -848,7 +926,7 @@ mdb_index_find_next(MdbHandle *mdb, MdbIndex *idx, MdbIndexChain *chain, guint32
 				mdb_read_pg(mdb, chain->last_leaf_found);
 				/* reuse the chain for cleanup mode */
 				chain->cur_depth = 1;
-				ipg = &chain->pages[0];
+				ipg = mdb_chain_page(chain, 0);
 				mdb_index_page_init(mdb, ipg);
 				ipg->pg = chain->last_leaf_found;
 				//printf("next on page %d\n",
@@ -868,10 +946,12 @@ mdb_index_find_next(MdbHandle *mdb, MdbIndex *idx, MdbIndexChain *chain, guint32
 		if (idx->num_keys==1 && idx_sz>0 && compress_bytes > 1 && ipg->start_pos>1 /*ipg->len - 4 < idx_sz*/) {
 			//printf("short index found\n");
 			//mdb_buffer_dump(ipg->cache_value, 0, idx_sz);
+			mdb_index_page_cache(ipg, MAX(idx_sz, compress_bytes - 1 + ipg->len));
 			memcpy(&ipg->cache_value[compress_bytes-1], &mdb->pg_buf[ipg->offset], ipg->len);
 			//mdb_buffer_dump(ipg->cache_value, 0, idx_sz);
 		} else {
 			idx_start = ipg->offset + (ipg->len - 4 - idx_sz);
+			mdb_index_page_cache(ipg, MAX(idx_sz, 1));
 			memcpy(ipg->cache_value, &mdb->pg_buf[idx_start], idx_sz);
 		}
 
@@ -887,6 +967,99 @@ mdb_index_find_next(MdbHandle *mdb, MdbIndex *idx, MdbIndexChain *chain, guint32
 
 	return ipg->len;
 }
+/*
+ * Leaf scans read the rows in index order by walking the leaf level alone:
+ * down the first (or last) entry of each node page to reach the end leaf,
+ * then along the leaves' next (or prev) page links.  Only the pages
+ * holding the entries actually read are visited, so a caller that stops
+ * after N rows reads about N rows' worth of leaves.
+ */
+static int
+mdb_index_leaf_first(MdbHandle *mdb, MdbIndex *idx, MdbIndexChain *chain)
+{
+	MdbIndexPage *ipg = mdb_chain_page(chain, 0);
+	guint32 pg = idx->first_pg, next;
+	int depth, entry;
+
+	for (depth = 0; ; depth++) {
+		if (depth >= MDB_MAX_INDEX_DEPTH || !mdb_read_pg(mdb, pg))
+			return 0;
+		if (mdb->pg_buf[0] == MDB_PAGE_LEAF)
+			break;
+		if (mdb->pg_buf[0] != MDB_PAGE_INDEX)
+			return 0;
+		mdb_index_page_init(mdb, ipg);
+		ipg->pg = pg;
+		/* the last start is the end of the last entry */
+		if (mdb_index_unpack_bitmap(mdb, ipg) < 2)
+			return 0;
+		entry = chain->reverse ? ipg->num_starts - 2 : 0;
+		ipg->offset = ipg->idx_starts[entry];
+		ipg->len = ipg->idx_starts[entry + 1] - ipg->offset;
+		pg = mdb_get_int32_msb(mdb->pg_buf, ipg->offset + ipg->len - 3) >> 8;
+	}
+	/* leaves can follow the last one the tree knows about */
+	if (chain->reverse) {
+		while ((next = mdb_get_int32(mdb->pg_buf, 0x0c))) {
+			if (!mdb_read_pg(mdb, next) || mdb->pg_buf[0] != MDB_PAGE_LEAF)
+				return 0;
+			pg = next;
+		}
+	}
+	mdb_index_page_init(mdb, ipg);
+	ipg->pg = pg;
+	chain->cur_depth = 1;
+	return 1;
+}
+/**
+ * mdb_index_leaf_next:
+ * @mdb: handle to read index pages with, see mdb_open_cursor()
+ * @idx: index to scan
+ * @chain: scan state, zeroed before the first call; set chain->reverse
+ *   to go from the last entry to the first
+ * @pg: receives the data page of the next entry's row
+ * @row: receives the row number on @pg
+ *
+ * Steps a leaf scan (MDB_LEAF_SCAN) to the next index entry.  Unlike
+ * mdb_index_find_next() no sargs are applied; every entry is returned.
+ *
+ * Return value: length of the entry, or 0 at the end of the index.
+ */
+int
+mdb_index_leaf_next(MdbHandle *mdb, MdbIndex *idx, MdbIndexChain *chain, guint32 *pg, guint16 *row)
+{
+	MdbIndexPage *ipg;
+	guint32 next, pg_row;
+	int entry;
+
+	if (!chain->cur_depth && !mdb_index_leaf_first(mdb, idx, chain))
+		return 0;
+	ipg = chain->pages[0];
+
+	while (1) {
+		if (!mdb_read_pg(mdb, ipg->pg) || mdb->pg_buf[0] != MDB_PAGE_LEAF)
+			return 0;
+		if (!ipg->num_starts)
+			mdb_index_unpack_bitmap(mdb, ipg);
+		if (ipg->start_pos < (int)ipg->num_starts - 1)
+			break;
+		next = mdb_get_int32(mdb->pg_buf, chain->reverse ? 0x08 : 0x0c);
+		if (!next)
+			return 0;
+		mdb_index_page_init(mdb, ipg);
+		ipg->pg = next;
+	}
+
+	entry = chain->reverse ? (int)ipg->num_starts - 2 - ipg->start_pos : ipg->start_pos;
+	ipg->start_pos++;
+	ipg->offset = ipg->idx_starts[entry];
+	ipg->len = ipg->idx_starts[entry + 1] - ipg->offset;
+	pg_row = mdb_get_int32_msb(mdb->pg_buf, ipg->offset + ipg->len - 4);
+	*row = pg_row & 0xff;
+	*pg = pg_row >> 8;
+
+	return ipg->len;
+}
 /*
  * XXX - FIX ME
  * This function is grossly inefficient.  It scans the entire index building 
@@ -1017,7 +1190,7 @@ int mdb_index_compute_cost(MdbTableDef *table, MdbIndex *idx)
 
 	/*
 	 * a like with a wild card first is useless as a sarg */
-	if ((sarg->op == MDB_LIKE || sarg->op == MDB_ILIKE) && sarg->value.s[0]=='%')
+	if ((sarg->op == MDB_LIKE || sarg->op == MDB_ILIKE) && sarg->value.s && sarg->value.s[0]=='%')
 		return 0;
 
 	/*
@@ -1120,21 +1293,75 @@ mdb_index_scan_init(MdbHandle *mdb, MdbTableDef *table)
 		table->strategy = MDB_INDEX_SCAN;
 		table->scan_idx = g_ptr_array_index (table->indices, i);
 		table->chain = g_malloc0(sizeof(MdbIndexChain));
-		table->mdbidx = mdb_clone_handle(mdb);
+		table->mdbidx = mdb_open_cursor(mdb);
 		mdb_read_pg(table->mdbidx, table->scan_idx->first_pg);
 		//printf("best index is %s\n",table->scan_idx->name);
 	}
 	//printf("TABLE SCAN? %d\n", table->strategy);
 }
+/**
+ * mdb_index_leaf_scan_init:
+ * @mdb: database handle
+ * @table: table to scan
+ * @col: column the rows should come back ordered by
+ * @desc: nonzero for descending order
+ *
+ * Switches @table to a leaf scan (MDB_LEAF_SCAN) of an index on @col alone,
+ * so rows are fetched already in @col order and a scan that stops early
+ * reads only the pages it needs.  Only numeric and date columns qualify,
+ * whose index order matches the order the SQL layer sorts in; text keys
+ * are ordered by Jet's collation instead.  Sargs are still tested on each
+ * row.  Like index scans, this is off unless MDB_USE_INDEX is set, see
+ * mdb_set_option().
+ *
+ * Return value: 1 if the table will be scanned in index order, else 0.
+ */
+int
+mdb_index_leaf_scan_init(MdbHandle *mdb, MdbTableDef *table, MdbColumn *col, int desc)
+{
+	MdbIndex *idx;
+	unsigned int i;
+
+	if (!mdb_get_option(MDB_USE_INDEX) || table->is_temp_table)
+		return 0;
+	switch (col->col_type) {
+		case MDB_BYTE:
+		case MDB_INT:
+		case MDB_LONGINT:
+		case MDB_MONEY:
+		case MDB_FLOAT:
+		case MDB_DOUBLE:
+		case MDB_DATETIME:
+			break;
+		default:
+			return 0;
+	}
+	for (i=0;i<table->num_idxs;i++) {
+		idx = g_ptr_array_index (table->indices, i);
+		if (idx->num_keys == 1 &&
+		    g_ptr_array_index(table->columns, idx->key_col_num[0]-1) == col)
+			break;
+	}
+	if (i == table->num_idxs)
+		return 0;
+
+	mdb_index_scan_free(table);
+	table->strategy = MDB_LEAF_SCAN;
+	table->scan_idx = idx;
+	table->chain = g_malloc0(sizeof(MdbIndexChain));
+	table->chain->reverse = (desc != 0) != (idx->key_col_order[0] == MDB_DESC);
+	table->mdbidx = mdb_open_cursor(mdb);
+	return 1;
+}
 void 
 mdb_index_scan_free(MdbTableDef *table)
 {
 	if (table->chain) {
-		g_free(table->chain);
+		mdb_free_index_chain(table->chain);
 		table->chain = NULL;
 	}
 	if (table->mdbidx) {
-		mdb_close(table->mdbidx);
+		mdb_close_cursor(table->mdbidx);
 		table->mdbidx = NULL;
 	}
 }
@@ -0,0 +1,534 @@
+/* MDB Tools - A library for reading MS Access database files
+ * Copyright (C) 2000 Brian Bruns
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Running balances for registers.  Each account keeps its rows ordered by
+ * (date, id) in blocks of at most MDB_LEDGER_BLOCK rows, and two Fenwick
+ * trees over the blocks hold how many rows and how much money come before
+ * each one.  The balance before any row, or the row at any position, is
+ * a walk down the Fenwick trees plus a scan of one block, so a register
+ * can show any page of an account without summing its history.
+ *
+ * Inserting or removing a row moves at most one block's rows and updates
+ * the two trees along one path.  A full block is split in two and an
+ * empty one dropped, which rebuilds that account's trees; rows added in
+ * order fill blocks up instead of splitting them.
+ *
+ * Amounts are whatever integer unit the caller uses, e.g. the currency
+ * value of a Money column (1/10000 of a unit).  A ledger has its own lock,
+ * so one thread may update it while another reads.
+ */
+
+#define MDB_MEM_TAG MDB_MEM_LEDGER
+
+#include "mdbtools.h"
+
+#define MDB_LEDGER_BLOCK 128
+
+typedef struct {
+	gint64 dt;
+	gint64 amount;
+	gint32 id;
+} MdbLedgerRow;
+
+typedef struct {
+	MdbLedgerRow rows[MDB_LEDGER_BLOCK];
+	unsigned int num_rows;
+	gint64 sum;
+} MdbLedgerBlock;
+
+typedef struct {
+	gint32 acct;
+	MdbLedgerBlock **blocks;
+	unsigned int num_blocks;
+	unsigned int blocks_size;
+	unsigned int *fen_count;	/* Fenwick trees over the blocks, 1-based */
+	gint64 *fen_sum;
+	unsigned int num_rows;
+} MdbLedgerAccount;
+
+struct MdbLedger {
+	pthread_mutex_t lock;
+	MdbLedgerAccount **accounts;	/* sorted by acct */
+	unsigned int num_accounts;
+};
+
+static int
+mdb_ledger_row_cmp(const MdbLedgerRow *row, gint64 dt, gint32 id)
+{
+	if (row->dt != dt)
+		return row->dt < dt ? -1 : 1;
+	if (row->id != id)
+		return row->id < id ? -1 : 1;
+	return 0;
+}
+/* position of acct in the account list, or where it would go */
+static unsigned int
+mdb_ledger_find_account(MdbLedger *ledger, gint32 acct, int *found)
+{
+	unsigned int lo = 0, hi = ledger->num_accounts, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (ledger->accounts[mid]->acct < acct)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	*found = lo < ledger->num_accounts && ledger->accounts[lo]->acct == acct;
+	return lo;
+}
+static MdbLedgerAccount *
+mdb_ledger_account(MdbLedger *ledger, gint32 acct)
+{
+	int found;
+	unsigned int pos = mdb_ledger_find_account(ledger, acct, &found);
+
+	return found ? ledger->accounts[pos] : NULL;
+}
+static void
+mdb_ledger_rebuild(MdbLedgerAccount *a)
+{
+	unsigned int i, j;
+
+	a->fen_count[0] = 0;
+	a->fen_sum[0] = 0;
+	for (i = 1; i <= a->num_blocks; i++) {
+		a->fen_count[i] = a->blocks[i - 1]->num_rows;
+		a->fen_sum[i] = a->blocks[i - 1]->sum;
+	}
+	for (i = 1; i <= a->num_blocks; i++) {
+		j = i + (i & -i);
+		if (j <= a->num_blocks) {
+			a->fen_count[j] += a->fen_count[i];
+			a->fen_sum[j] += a->fen_sum[i];
+		}
+	}
+}
+static void
+mdb_ledger_fen_add(MdbLedgerAccount *a, unsigned int b, int count, gint64 amount)
+{
+	unsigned int i;
+
+	for (i = b + 1; i <= a->num_blocks; i += i & -i) {
+		a->fen_count[i] += count;
+		a->fen_sum[i] += amount;
+	}
+}
+/* rows and money in the blocks before block b */
+static unsigned int
+mdb_ledger_fen_prefix(MdbLedgerAccount *a, unsigned int b, gint64 *sum)
+{
+	unsigned int count = 0, i;
+
+	*sum = 0;
+	for (i = b; i > 0; i -= i & -i) {
+		count += a->fen_count[i];
+		*sum += a->fen_sum[i];
+	}
+	return count;
+}
+/* fills in the trees' entry for a new, empty last block */
+static void
+mdb_ledger_fen_append(MdbLedgerAccount *a)
+{
+	unsigned int i = a->num_blocks, low = i - (i & -i), count;
+	gint64 sum, low_sum;
+
+	count = mdb_ledger_fen_prefix(a, i - 1, &sum) - mdb_ledger_fen_prefix(a, low, &low_sum);
+	a->fen_count[i] = count;
+	a->fen_sum[i] = sum - low_sum;
+}
+/*
+ * Block holding the row at position n (n < num_rows); *offset is its place
+ * in the block and *sum the money in the blocks before it.
+ */
+static unsigned int
+mdb_ledger_fen_find(MdbLedgerAccount *a, unsigned int n, unsigned int *offset, gint64 *sum)
+{
+	unsigned int pos = 0, step = 1;
+
+	while (step * 2 <= a->num_blocks)
+		step *= 2;
+	*sum = 0;
+	for (; step; step /= 2) {
+		if (pos + step <= a->num_blocks && a->fen_count[pos + step] <= n) {
+			pos += step;
+			n -= a->fen_count[pos];
+			*sum += a->fen_sum[pos];
+		}
+	}
+	*offset = n;
+	return pos;
+}
+/* first block whose last row is not before (dt, id); the last block if none */
+static unsigned int
+mdb_ledger_find_block(MdbLedgerAccount *a, gint64 dt, gint32 id)
+{
+	unsigned int lo = 0, hi = a->num_blocks - 1, mid;
+	MdbLedgerBlock *block;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		block = a->blocks[mid];
+		if (mdb_ledger_row_cmp(&block->rows[block->num_rows - 1], dt, id) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+/* first row of the block not before (dt, id) */
+static unsigned int
+mdb_ledger_find_row(MdbLedgerBlock *block, gint64 dt, gint32 id)
+{
+	unsigned int lo = 0, hi = block->num_rows, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (mdb_ledger_row_cmp(&block->rows[mid], dt, id) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+static void
+mdb_ledger_insert_block(MdbLedgerAccount *a, unsigned int b, MdbLedgerBlock *block)
+{
+	if (a->num_blocks == a->blocks_size) {
+		a->blocks_size = a->blocks_size ? a->blocks_size * 2 : 16;
+		a->blocks = g_realloc(a->blocks, a->blocks_size * sizeof(MdbLedgerBlock *));
+		a->fen_count = g_realloc(a->fen_count, (a->blocks_size + 1) * sizeof(unsigned int));
+		a->fen_sum = g_realloc(a->fen_sum, (a->blocks_size + 1) * sizeof(gint64));
+	}
+	memmove(&a->blocks[b + 1], &a->blocks[b], (a->num_blocks - b) * sizeof(MdbLedgerBlock *));
+	a->blocks[b] = block;
+	a->num_blocks++;
+}
+/* moves the upper half of block b into a new block after it */
+static void
+mdb_ledger_split(MdbLedgerAccount *a, unsigned int b)
+{
+	MdbLedgerBlock *block = a->blocks[b], *next;
+	unsigned int keep = block->num_rows / 2, i;
+
+	next = g_malloc0(sizeof(MdbLedgerBlock));
+	next->num_rows = block->num_rows - keep;
+	memcpy(next->rows, &block->rows[keep], next->num_rows * sizeof(MdbLedgerRow));
+	for (i = 0; i < next->num_rows; i++)
+		next->sum += next->rows[i].amount;
+	block->num_rows = keep;
+	block->sum -= next->sum;
+	mdb_ledger_insert_block(a, b + 1, next);
+}
+static void
+mdb_ledger_free_account(MdbLedgerAccount *a)
+{
+	unsigned int i;
+
+	for (i = 0; i < a->num_blocks; i++)
+		g_free(a->blocks[i]);
+	g_free(a->blocks);
+	g_free(a->fen_count);
+	g_free(a->fen_sum);
+	g_free(a);
+}
+
+/**
+ * mdb_ledger_new:
+ *
+ * Return value: an empty ledger, to be freed with mdb_ledger_free()
+ */
+MdbLedger *
+mdb_ledger_new(void)
+{
+	MdbLedger *ledger;
+
+	ledger = g_malloc0(sizeof(MdbLedger));
+	pthread_mutex_init(&ledger->lock, NULL);
+	return ledger;
+}
+void
+mdb_ledger_free(MdbLedger *ledger)
+{
+	unsigned int i;
+
+	if (!ledger)
+		return;
+	for (i = 0; i < ledger->num_accounts; i++)
+		mdb_ledger_free_account(ledger->accounts[i]);
+	g_free(ledger->accounts);
+	pthread_mutex_destroy(&ledger->lock);
+	g_free(ledger);
+}
+/**
+ * mdb_ledger_insert:
+ * @ledger: the ledger
+ * @acct: account the row belongs to
+ * @dt: date of the row, in any unit that sorts by time
+ * @id: row id, ordering rows of the same date
+ * @amount: money the row adds to the balance
+ *
+ * Adds a row to an account.  To change a row's date or amount, remove it
+ * and insert it again.
+ *
+ * Return value: 1 on success, 0 if the account already has a row with
+ * this date and id
+ */
+int
+mdb_ledger_insert(MdbLedger *ledger, gint32 acct, gint64 dt, gint32 id, gint64 amount)
+{
+	MdbLedgerAccount *a;
+	MdbLedgerBlock *block;
+	unsigned int pos, b, r;
+	int found, rebuild = 0;
+
+	pthread_mutex_lock(&ledger->lock);
+	pos = mdb_ledger_find_account(ledger, acct, &found);
+	if (found) {
+		a = ledger->accounts[pos];
+	} else {
+		a = g_malloc0(sizeof(MdbLedgerAccount));
+		a->acct = acct;
+		ledger->accounts = g_realloc(ledger->accounts,
+			(ledger->num_accounts + 1) * sizeof(MdbLedgerAccount *));
+		memmove(&ledger->accounts[pos + 1], &ledger->accounts[pos],
+			(ledger->num_accounts - pos) * sizeof(MdbLedgerAccount *));
+		ledger->accounts[pos] = a;
+		ledger->num_accounts++;
+	}
+
+	if (!a->num_blocks) {
+		mdb_ledger_insert_block(a, 0, g_malloc0(sizeof(MdbLedgerBlock)));
+		rebuild = 1;
+	}
+	b = mdb_ledger_find_block(a, dt, id);
+	block = a->blocks[b];
+	r = mdb_ledger_find_row(block, dt, id);
+	if (r < block->num_rows && !mdb_ledger_row_cmp(&block->rows[r], dt, id)) {
+		if (rebuild)
+			mdb_ledger_rebuild(a);
+		pthread_mutex_unlock(&ledger->lock);
+		return 0;
+	}
+
+	if (block->num_rows == MDB_LEDGER_BLOCK) {
+		if (b == a->num_blocks - 1 && r == block->num_rows) {
+			/* appending in order: start a new block, keep this one full */
+			mdb_ledger_insert_block(a, ++b, g_malloc0(sizeof(MdbLedgerBlock)));
+			mdb_ledger_fen_append(a);
+			r = 0;
+		} else {
+			mdb_ledger_split(a, b);
+			if (r > block->num_rows) {
+				r -= block->num_rows;
+				b++;
+			}
+			rebuild = 1;
+		}
+		block = a->blocks[b];
+	}
+
+	memmove(&block->rows[r + 1], &block->rows[r], (block->num_rows - r) * sizeof(MdbLedgerRow));
+	block->rows[r].dt = dt;
+	block->rows[r].id = id;
+	block->rows[r].amount = amount;
+	block->num_rows++;
+	block->sum += amount;
+	a->num_rows++;
+	if (rebuild)
+		mdb_ledger_rebuild(a);
+	else
+		mdb_ledger_fen_add(a, b, 1, amount);
+	pthread_mutex_unlock(&ledger->lock);
+	return 1;
+}
+/**
+ * mdb_ledger_remove:
+ * @ledger: the ledger
+ * @acct: account of the row
+ * @dt: date the row was inserted with
+ * @id: row id
+ *
+ * Return value: 1 if the row was removed, 0 if there is no such row
+ */
+int
+mdb_ledger_remove(MdbLedger *ledger, gint32 acct, gint64 dt, gint32 id)
+{
+	MdbLedgerAccount *a;
+	MdbLedgerBlock *block;
+	unsigned int b, r;
+	gint64 amount;
+
+	pthread_mutex_lock(&ledger->lock);
+	a = mdb_ledger_account(ledger, acct);
+	if (!a || !a->num_blocks) {
+		pthread_mutex_unlock(&ledger->lock);
+		return 0;
+	}
+	b = mdb_ledger_find_block(a, dt, id);
+	block = a->blocks[b];
+	r = mdb_ledger_find_row(block, dt, id);
+	if (r == block->num_rows || mdb_ledger_row_cmp(&block->rows[r], dt, id)) {
+		pthread_mutex_unlock(&ledger->lock);
+		return 0;
+	}
+
+	amount = block->rows[r].amount;
+	memmove(&block->rows[r], &block->rows[r + 1], (block->num_rows - r - 1) * sizeof(MdbLedgerRow));
+	block->num_rows--;
+	block->sum -= amount;
+	a->num_rows--;
+	if (block->num_rows) {
+		mdb_ledger_fen_add(a, b, -1, -amount);
+	} else {
+		g_free(block);
+		a->num_blocks--;
+		memmove(&a->blocks[b], &a->blocks[b + 1], (a->num_blocks - b) * sizeof(MdbLedgerBlock *));
+		mdb_ledger_rebuild(a);
+	}
+	pthread_mutex_unlock(&ledger->lock);
+	return 1;
+}
+/**
+ * mdb_ledger_count:
+ *
+ * Return value: number of rows of the account
+ */
+unsigned int
+mdb_ledger_count(MdbLedger *ledger, gint32 acct)
+{
+	MdbLedgerAccount *a;
+	unsigned int count;
+
+	pthread_mutex_lock(&ledger->lock);
+	a = mdb_ledger_account(ledger, acct);
+	count = a ? a->num_rows : 0;
+	pthread_mutex_unlock(&ledger->lock);
+	return count;
+}
+/**
+ * mdb_ledger_rank:
+ * @ledger: the ledger
+ * @acct: the account
+ * @dt: date
+ * @id: row id
+ *
+ * Finds where a row is, or would be, in the account's (date, id) order.
+ * With @id INT32_MIN this is the number of rows dated before @dt, so
+ * mdb_ledger_balance() of it is the balance at the start of that date.
+ *
+ * Return value: number of rows of the account ordered before (@dt, @id)
+ */
+unsigned int
+mdb_ledger_rank(MdbLedger *ledger, gint32 acct, gint64 dt, gint32 id)
+{
+	MdbLedgerAccount *a;
+	unsigned int rank = 0, b;
+	gint64 sum;
+
+	pthread_mutex_lock(&ledger->lock);
+	a = mdb_ledger_account(ledger, acct);
+	if (a && a->num_blocks) {
+		b = mdb_ledger_find_block(a, dt, id);
+		rank = mdb_ledger_fen_prefix(a, b, &sum) + mdb_ledger_find_row(a->blocks[b], dt, id);
+	}
+	pthread_mutex_unlock(&ledger->lock);
+	return rank;
+}
+/**
+ * mdb_ledger_balance:
+ * @ledger: the ledger
+ * @acct: the account
+ * @n: position in (date, id) order
+ *
+ * Return value: sum of the amounts of the account's first @n rows, i.e.
+ * the balance before row @n; the whole account's once @n reaches its count
+ */
+gint64
+mdb_ledger_balance(MdbLedger *ledger, gint32 acct, unsigned int n)
+{
+	MdbLedgerAccount *a;
+	MdbLedgerBlock *block;
+	unsigned int b, offset, i;
+	gint64 sum = 0;
+
+	pthread_mutex_lock(&ledger->lock);
+	a = mdb_ledger_account(ledger, acct);
+	if (a && n >= a->num_rows) {
+		mdb_ledger_fen_prefix(a, a->num_blocks, &sum);
+	} else if (a) {
+		b = mdb_ledger_fen_find(a, n, &offset, &sum);
+		block = a->blocks[b];
+		for (i = 0; i < offset; i++)
+			sum += block->rows[i].amount;
+	}
+	pthread_mutex_unlock(&ledger->lock);
+	return sum;
+}
+/**
+ * mdb_ledger_entries:
+ * @ledger: the ledger
+ * @acct: the account
+ * @start: position of the first row, in (date, id) order
+ * @entries: filled with the rows and the balance after each
+ * @max: most rows to return
+ *
+ * Reads one page of a register.  A register shown newest first reads
+ * from count - start - max and reverses the page.
+ *
+ * Return value: number of entries filled
+ */
+unsigned int
+mdb_ledger_entries(MdbLedger *ledger, gint32 acct, unsigned int start,
+	MdbLedgerEntry *entries, unsigned int max)
+{
+	MdbLedgerAccount *a;
+	MdbLedgerBlock *block;
+	MdbLedgerRow *row;
+	unsigned int b, offset, i, n = 0;
+	gint64 sum;
+
+	pthread_mutex_lock(&ledger->lock);
+	a = mdb_ledger_account(ledger, acct);
+	if (!a || start >= a->num_rows) {
+		pthread_mutex_unlock(&ledger->lock);
+		return 0;
+	}
+	b = mdb_ledger_fen_find(a, start, &offset, &sum);
+	block = a->blocks[b];
+	for (i = 0; i < offset; i++)
+		sum += block->rows[i].amount;
+
+	while (n < max && b < a->num_blocks) {
+		block = a->blocks[b];
+		for (; offset < block->num_rows && n < max; offset++, n++) {
+			row = &block->rows[offset];
+			sum += row->amount;
+			entries[n].dt = row->dt;
+			entries[n].id = row->id;
+			entries[n].amount = row->amount;
+			entries[n].balance = sum;
+		}
+		b++;
+		offset = 0;
+	}
+	pthread_mutex_unlock(&ledger->lock);
+	return n;
+}
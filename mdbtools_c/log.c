@@ -0,0 +1,183 @@
+/* MDB Tools - A library for reading MS Access database files
+ * Copyright (C) 2000 Brian Bruns
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Engine log.  mdb_log() statements carry a category and a level.  Those
+ * above MDB_LOG_MAX_LEVEL are removed by the compiler, arguments and all;
+ * the rest cost one comparison against the category's runtime level
+ * (mdb_log_set_level(), MDB_LOG_WARN to start with) until enabled.
+ *
+ * Enabled lines are formatted into a ring of MDB_LOG_RING records that
+ * keeps the latest ones, for mdb_log_read() to collect, e.g. into a
+ * diagnostics screen or a bug report.  Writers claim a record with one
+ * atomic add and never wait: each record has a sequence number that is
+ * odd while it is being written, so a reader copies a record and keeps it
+ * only if the number was even and unchanged across the copy.  Lines at or
+ * below the echo level (mdb_log_set_echo(), MDB_LOG_WARN to start with, so
+ * warnings such as corrupt rows still show up on the console) also go to
+ * stderr.
+ */
+
+#include <sys/time.h>
+#include "mdbtools.h"
+
+#define MDB_LOG_RING 512	/* a power of two */
+
+typedef struct {
+	guint64 seq;		/* 2 * (number + 1), plus 1 while written */
+	MdbLogRecord rec;
+} MdbLogSlot;
+
+unsigned char mdb_log_levels[MDB_LOG_NCATS] = {
+	[0 ... MDB_LOG_NCATS - 1] = MDB_LOG_WARN
+};
+static int mdb_log_echo = MDB_LOG_WARN;
+static MdbLogSlot mdb_log_ring[MDB_LOG_RING];
+static guint64 mdb_log_next;
+
+static const char *mdb_log_category_names[MDB_LOG_NCATS] = {
+	"file", "data", "index", "write", "sql", "sync"
+};
+static const char *mdb_log_level_names[] = {
+	"error", "warning", "info", "debug", "trace"
+};
+
+/**
+ * mdb_log_set_level:
+ * @cat: category, or MDB_LOG_NCATS for all of them
+ * @level: most detailed level to keep from now on
+ *
+ * Levels above MDB_LOG_MAX_LEVEL stay off: their statements are not in
+ * the build.
+ */
+void mdb_log_set_level(MdbLogCategory cat, MdbLogLevel level)
+{
+	unsigned int i;
+
+	for (i = 0; i < MDB_LOG_NCATS; i++)
+		if (cat == MDB_LOG_NCATS || i == (unsigned int)cat)
+			__atomic_store_n(&mdb_log_levels[i], level, __ATOMIC_RELAXED);
+}
+/**
+ * mdb_log_set_echo:
+ * @level: most detailed level also written to stderr, or -1 for none
+ */
+void mdb_log_set_echo(int level)
+{
+	__atomic_store_n(&mdb_log_echo, level, __ATOMIC_RELAXED);
+}
+/**
+ * mdb_log_enabled:
+ *
+ * For callers that cannot use the mdb_log() macro, e.g. Swift, to skip
+ * building a message nobody keeps.
+ *
+ * Return value: 1 if a line of @level in @cat would be kept
+ */
+int mdb_log_enabled(MdbLogCategory cat, MdbLogLevel level)
+{
+	return level <= MDB_LOG_MAX_LEVEL
+		&& level <= __atomic_load_n(&mdb_log_levels[cat], __ATOMIC_RELAXED);
+}
+/**
+ * mdb_log_message:
+ * @cat: category
+ * @level: level
+ * @msg: the line, without a newline; cut to fit a record
+ *
+ * Adds a line to the ring whatever the runtime level; mdb_log() and
+ * mdb_log_enabled() check that first.
+ */
+void mdb_log_message(MdbLogCategory cat, MdbLogLevel level, const char *msg)
+{
+	MdbLogSlot *slot;
+	struct timeval tv;
+	guint64 n;
+
+	n = __atomic_fetch_add(&mdb_log_next, 1, __ATOMIC_RELAXED);
+	slot = &mdb_log_ring[n & (MDB_LOG_RING - 1)];
+	__atomic_store_n(&slot->seq, 2 * (n + 1) + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	gettimeofday(&tv, NULL);
+	slot->rec.seq = n;
+	slot->rec.usec = (gint64)tv.tv_sec * 1000000 + tv.tv_usec;
+	slot->rec.cat = cat;
+	slot->rec.level = level;
+	snprintf(slot->rec.msg, sizeof(slot->rec.msg), "%s", msg);
+
+	__atomic_store_n(&slot->seq, 2 * (n + 1), __ATOMIC_RELEASE);
+
+	if ((int)level <= __atomic_load_n(&mdb_log_echo, __ATOMIC_RELAXED))
+		fprintf(stderr, "[%s] %s: %s\n", mdb_log_category_names[cat],
+			mdb_log_level_names[level], msg);
+}
+/* formats a line for mdb_log() */
+void mdb_log_write(MdbLogCategory cat, MdbLogLevel level, const char *fmt, ...)
+{
+	char msg[MDB_LOG_MSG_SIZE];
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(msg, sizeof(msg), fmt, ap);
+	va_end(ap);
+	mdb_log_message(cat, level, msg);
+}
+/**
+ * mdb_log_read:
+ * @since: number of the first line wanted, 0 at first; set to the one
+ * after the last line returned
+ * @records: filled with the lines, oldest first
+ * @max: most lines to return
+ *
+ * Lines the ring has dropped, or that are being written, are skipped.
+ *
+ * Return value: number of records filled
+ */
+unsigned int mdb_log_read(guint64 *since, MdbLogRecord *records, unsigned int max)
+{
+	guint64 next = __atomic_load_n(&mdb_log_next, __ATOMIC_ACQUIRE), n, seq;
+	MdbLogSlot *slot;
+	unsigned int count = 0;
+
+	n = *since;
+	if (next > MDB_LOG_RING && n < next - MDB_LOG_RING)
+		n = next - MDB_LOG_RING;
+	for (; n < next && count < max; n++) {
+		slot = &mdb_log_ring[n & (MDB_LOG_RING - 1)];
+		seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		if (seq != 2 * (n + 1))
+			continue;
+		records[count] = slot->rec;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq)
+			continue;
+		count++;
+	}
+	*since = n;
+	return count;
+}
+/**
+ * mdb_log_category_name:
+ *
+ * Return value: the name of a category, e.g. "index"
+ */
+const char *mdb_log_category_name(MdbLogCategory cat)
+{
+	return cat < MDB_LOG_NCATS ? mdb_log_category_names[cat] : "";
+}
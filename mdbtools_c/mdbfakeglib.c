@@ -15,33 +15,111 @@
 #include <stdarg.h>
 #include <ctype.h>
 
-/* Memory allocation */
-void *g_memdup(const void *src, size_t len) {
-    void *dest = malloc(len);
-    if (dest) {
-        memcpy(dest, src, len);
+/* Memory allocation
+ *
+ * Each block carries a small header recording its size and subsystem tag,
+ * so g_free() can credit the right counter without the caller having to
+ * remember either.  Counters are updated atomically; the peak is a
+ * high-water mark since start-up (or the last mdb_mem_reset_peaks()).
+ */
+typedef union {
+    struct {
+        size_t size;
+        int tag;
+    } h;
+    max_align_t align;
+} MdbMemHeader;
+
+static size_t mdb_mem_cur[MDB_MEM_NTAGS];
+static size_t mdb_mem_hwm[MDB_MEM_NTAGS];
+
+static const char *mdb_mem_names[MDB_MEM_NTAGS] = {
+    "other",
+    "catalog",
+    "table def",
+    "page cache",
+    "bind buffers",
+    "sargs",
+    "temp tables",
+    "memo",
+    "properties",
+    "result cache",
+    "prefix index",
+    "trees",
+    "ledgers"
+};
+
+static void mdb_mem_charge(int tag, size_t len) {
+    size_t cur = __atomic_add_fetch(&mdb_mem_cur[tag], len, __ATOMIC_RELAXED);
+    size_t peak = __atomic_load_n(&mdb_mem_hwm[tag], __ATOMIC_RELAXED);
+    while (cur > peak &&
+            !__atomic_compare_exchange_n(&mdb_mem_hwm[tag], &peak, cur,
+                1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+static void mdb_mem_credit(int tag, size_t len) {
+    __atomic_sub_fetch(&mdb_mem_cur[tag], len, __ATOMIC_RELAXED);
+}
+
+static void *mdb_mem_attach(MdbMemHeader *hdr, MdbMemTag tag, size_t len) {
+    if (!hdr) return NULL;
+    if ((unsigned)tag >= MDB_MEM_NTAGS) tag = MDB_MEM_OTHER;
+    hdr->h.size = len;
+    hdr->h.tag = tag;
+    mdb_mem_charge(tag, len);
+    return hdr + 1;
+}
+
+void *mdb_mem_malloc(MdbMemTag tag, size_t len) {
+    return mdb_mem_attach(malloc(sizeof(MdbMemHeader) + len), tag, len);
+}
+
+void *mdb_mem_malloc0(MdbMemTag tag, size_t len) {
+    return mdb_mem_attach(calloc(1, sizeof(MdbMemHeader) + len), tag, len);
+}
+
+void *mdb_mem_realloc(MdbMemTag tag, void *ptr, size_t len) {
+    if (!ptr) return mdb_mem_malloc(tag, len);
+    if (!len) {
+        mdb_mem_free(ptr);
+        return NULL;
     }
-    return dest;
+
+    MdbMemHeader *hdr = (MdbMemHeader *)ptr - 1;
+    size_t old_len = hdr->h.size;
+    int old_tag = hdr->h.tag;
+    MdbMemHeader *new_hdr = realloc(hdr, sizeof(MdbMemHeader) + len);
+    if (!new_hdr) return NULL;
+
+    /* A block keeps the subsystem it was first charged to */
+    mdb_mem_credit(old_tag, old_len);
+    return mdb_mem_attach(new_hdr, old_tag, len);
 }
 
-/* String functions */
-int g_str_equal(const void *str1, const void *str2) {
-    return strcmp((const char *)str1, (const char *)str2) == 0;
+void mdb_mem_free(void *ptr) {
+    if (!ptr) return;
+    MdbMemHeader *hdr = (MdbMemHeader *)ptr - 1;
+    mdb_mem_credit(hdr->h.tag, hdr->h.size);
+    free(hdr);
 }
 
-char *g_strdup(const char *src) {
-    if (!src) return NULL;
-    size_t len = strlen(src) + 1;
-    char *dest = malloc(len);
+void *mdb_mem_memdup(MdbMemTag tag, const void *src, size_t len) {
+    void *dest = mdb_mem_malloc(tag, len);
     if (dest) {
         memcpy(dest, src, len);
     }
     return dest;
 }
 
-char *g_strndup(const char *src, size_t len) {
+char *mdb_mem_strdup(MdbMemTag tag, const char *src) {
     if (!src) return NULL;
-    char *dest = malloc(len + 1);
+    return mdb_mem_memdup(tag, src, strlen(src) + 1);
+}
+
+char *mdb_mem_strndup(MdbMemTag tag, const char *src, size_t len) {
+    if (!src) return NULL;
+    char *dest = mdb_mem_malloc(tag, len + 1);
     if (dest) {
         memcpy(dest, src, len);
         dest[len] = '\0';
@@ -49,6 +127,46 @@ char *g_strndup(const char *src, size_t len) {
     return dest;
 }
 
+size_t mdb_mem_current(MdbMemTag tag) {
+    if ((unsigned)tag >= MDB_MEM_NTAGS) return 0;
+    return __atomic_load_n(&mdb_mem_cur[tag], __ATOMIC_RELAXED);
+}
+
+size_t mdb_mem_peak(MdbMemTag tag) {
+    if ((unsigned)tag >= MDB_MEM_NTAGS) return 0;
+    return __atomic_load_n(&mdb_mem_hwm[tag], __ATOMIC_RELAXED);
+}
+
+void mdb_mem_reset_peaks(void) {
+    for (int i = 0; i < MDB_MEM_NTAGS; i++) {
+        __atomic_store_n(&mdb_mem_hwm[i], mdb_mem_current(i), __ATOMIC_RELAXED);
+    }
+}
+
+const char *mdb_mem_tag_name(MdbMemTag tag) {
+    if ((unsigned)tag >= MDB_MEM_NTAGS) return "unknown";
+    return mdb_mem_names[tag];
+}
+
+/* The g_memdup/g_strdup/g_strndup macros charge the caller's subsystem;
+ * these out-of-line versions remain for code that takes their address. */
+void *(g_memdup)(const void *src, size_t len) {
+    return mdb_mem_memdup(MDB_MEM_OTHER, src, len);
+}
+
+/* String functions */
+int g_str_equal(const void *str1, const void *str2) {
+    return strcmp((const char *)str1, (const char *)str2) == 0;
+}
+
+char *(g_strdup)(const char *src) {
+    return mdb_mem_strdup(MDB_MEM_OTHER, src);
+}
+
+char *(g_strndup)(const char *src, size_t len) {
+    return mdb_mem_strndup(MDB_MEM_OTHER, src, len);
+}
+
 char *g_strdup_printf(const char *format, ...) {
     va_list args;
     va_start(args, format);
@@ -65,7 +183,7 @@ char *g_strdup_printf(const char *format, ...) {
     }
     
     // Allocate and format
-    char *result = malloc(len + 1);
+    char *result = g_malloc(len + 1);
     if (result) {
         vsnprintf(result, len + 1, format, args);
     }
@@ -88,7 +206,7 @@ char *g_strconcat(const char *first, ...) {
     va_end(args);
     
     // Allocate
-    char *result = malloc(total_len + 1);
+    char *result = g_malloc(total_len + 1);
     if (!result) return NULL;
     
     // Concatenate
@@ -117,7 +235,7 @@ char **g_strsplit(const char *haystack, const char *needle, int max_tokens) {
     }
     
     // Allocate array
-    char **result = calloc(count + 1, sizeof(char *));
+    char **result = g_malloc0((count + 1) * sizeof(char *));
     if (!result) return NULL;
     
     // Split
@@ -138,9 +256,9 @@ char **g_strsplit(const char *haystack, const char *needle, int max_tokens) {
 void g_strfreev(char **str_array) {
     if (!str_array) return;
     for (int i = 0; str_array[i]; i++) {
-        free(str_array[i]);
+        g_free(str_array[i]);
     }
-    free(str_array);
+    g_free(str_array);
 }
 
 gchar *g_strdelimit(gchar *string, const gchar *delimiters, gchar new_delimiter) {
@@ -181,7 +299,7 @@ gchar *g_utf8_casefold(const gchar *str, gssize len) {
     if (!str) return NULL;
     if (len < 0) len = strlen(str);
     
-    gchar *result = malloc(len + 1);
+    gchar *result = g_malloc(len + 1);
     if (!result) return NULL;
     
     for (gssize i = 0; i < len; i++) {
@@ -208,24 +326,24 @@ gint g_unichar_to_utf8(gunichar c, gchar *dst) {
 
 /* GString */
 GString *g_string_new(const gchar *init) {
-    GString *string = malloc(sizeof(GString));
+    GString *string = g_malloc(sizeof(GString));
     if (!string) return NULL;
     
     if (init) {
         string->len = strlen(init);
         string->allocated_len = string->len + 1;
-        string->str = malloc(string->allocated_len);
+        string->str = g_malloc(string->allocated_len);
         if (!string->str) {
-            free(string);
+            g_free(string);
             return NULL;
         }
         memcpy(string->str, init, string->len + 1);
     } else {
         string->len = 0;
         string->allocated_len = 16;
-        string->str = malloc(string->allocated_len);
+        string->str = g_malloc(string->allocated_len);
         if (!string->str) {
-            free(string);
+            g_free(string);
             return NULL;
         }
         string->str[0] = '\0';
@@ -239,7 +357,7 @@ GString *g_string_assign(GString *string, const gchar *rval) {
     
     size_t len = rval ? strlen(rval) : 0;
     if (len + 1 > string->allocated_len) {
-        char *new_str = realloc(string->str, len + 1);
+        char *new_str = g_realloc(string->str, len + 1);
         if (!new_str) return NULL;
         string->str = new_str;
         string->allocated_len = len + 1;
@@ -263,7 +381,7 @@ GString *g_string_append(GString *string, const gchar *val) {
     
     if (new_len + 1 > string->allocated_len) {
         size_t new_allocated = (new_len + 1) * 2;
-        char *new_str = realloc(string->str, new_allocated);
+        char *new_str = g_realloc(string->str, new_allocated);
         if (!new_str) return NULL;
         string->str = new_str;
         string->allocated_len = new_allocated;
@@ -282,16 +400,16 @@ gchar *g_string_free(GString *string, gboolean free_segment) {
     if (!free_segment) {
         result = string->str;
     } else {
-        free(string->str);
+        g_free(string->str);
     }
-    free(string);
+    g_free(string);
     
     return result;
 }
 
 /* GPtrArray */
 GPtrArray *g_ptr_array_new(void) {
-    GPtrArray *array = malloc(sizeof(GPtrArray));
+    GPtrArray *array = g_malloc(sizeof(GPtrArray));
     if (!array) return NULL;
     
     array->len = 0;
@@ -303,7 +421,7 @@ GPtrArray *g_ptr_array_new(void) {
 void g_ptr_array_add(GPtrArray *array, void *entry) {
     if (!array) return;
     
-    void **new_pdata = realloc(array->pdata, (array->len + 1) * sizeof(void *));
+    void **new_pdata = g_realloc(array->pdata, (array->len + 1) * sizeof(void *));
     if (!new_pdata) return;
     
     array->pdata = new_pdata;
@@ -360,8 +478,8 @@ void g_ptr_array_free(GPtrArray *array, gboolean free_elements) {
     // So we should NEVER free the individual elements here
     
     // Just free the pointer array structure itself
-    free(array->pdata);
-    free(array);
+    g_free(array->pdata);
+    g_free(array);
     
     // Ignore the free_elements parameter - it's a GLib quirk that doesn't apply here
     (void)free_elements;
@@ -369,7 +487,7 @@ void g_ptr_array_free(GPtrArray *array, gboolean free_elements) {
 
 /* GList */
 GList *g_list_append(GList *list, void *data) {
-    GList *new_node = malloc(sizeof(GList));
+    GList *new_node = g_malloc(sizeof(GList));
     if (!new_node) return list;
     
     new_node->data = data;
@@ -410,7 +528,7 @@ GList *g_list_remove(GList *list, void *data) {
             }
             
             GList *result = (node == list) ? node->next : list;
-            free(node);
+            g_free(node);
             return result;
         }
         node = node->next;
@@ -422,14 +540,14 @@ GList *g_list_remove(GList *list, void *data) {
 void g_list_free(GList *list) {
     while (list) {
         GList *next = list->next;
-        free(list);
+        g_free(list);
         list = next;
     }
 }
 
 /* GHashTable - simplified implementation */
 GHashTable *g_hash_table_new(GHashFunc hash_func, GEqualFunc equal_func) {
-    GHashTable *table = malloc(sizeof(GHashTable));
+    GHashTable *table = g_malloc(sizeof(GHashTable));
     if (!table) return NULL;
     
     table->compare = equal_func;
@@ -485,7 +603,7 @@ void g_hash_table_insert(GHashTable *table, void *key, void *value) {
     }
     
     // Add new entry
-    HashEntry *entry = malloc(sizeof(HashEntry));
+    HashEntry *entry = g_malloc(sizeof(HashEntry));
     if (entry) {
         entry->key = key;
         entry->value = value;
@@ -499,7 +617,7 @@ gboolean g_hash_table_remove(GHashTable *table, const void *key) {
     for (guint i = 0; i < table->array->len; i++) {
         HashEntry *entry = table->array->pdata[i];
         if (entry && table->compare(entry->key, key)) {
-            free(entry);
+            g_free(entry);
             // Shift remaining elements
             for (guint j = i; j < table->array->len - 1; j++) {
                 table->array->pdata[j] = table->array->pdata[j + 1];
@@ -529,7 +647,7 @@ void g_hash_table_foreach_remove(GHashTable *table, GHRFunc function, void *user
     for (guint i = 0; i < table->array->len; ) {
         HashEntry *entry = table->array->pdata[i];
         if (entry && function(entry->key, entry->value, user_data)) {
-            free(entry);
+            g_free(entry);
             // Shift remaining elements
             for (guint j = i; j < table->array->len - 1; j++) {
                 table->array->pdata[j] = table->array->pdata[j + 1];
@@ -546,17 +664,17 @@ void g_hash_table_destroy(GHashTable *table) {
     
     if (table->array) {
         for (guint i = 0; i < table->array->len; i++) {
-            free(table->array->pdata[i]);
+            g_free(table->array->pdata[i]);
         }
         g_ptr_array_free(table->array, FALSE);
     }
     
-    free(table);
+    g_free(table);
 }
 
 /* GOption - minimal implementation */
 GOptionContext *g_option_context_new(const char *description) {
-    GOptionContext *context = malloc(sizeof(GOptionContext));
+    GOptionContext *context = g_malloc(sizeof(GOptionContext));
     if (context) {
         context->desc = description;
         context->entries = NULL;
@@ -584,5 +702,5 @@ gboolean g_option_context_parse(GOptionContext *context,
 }
 
 void g_option_context_free(GOptionContext *context) {
-    free(context);
+    g_free(context);
 }
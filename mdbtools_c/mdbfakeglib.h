@@ -21,6 +21,7 @@
 #ifndef _mdbfakeglib_h_
 #define _mdbfakeglib_h_
 
+#include <stddef.h>
 #include <time.h>
 #include <locale.h>
 #include <inttypes.h>
@@ -30,6 +31,7 @@ typedef uint16_t guint16;
 typedef uint32_t guint32;
 typedef uint64_t guint64;
 typedef int32_t gint32;
+typedef int64_t gint64;
 typedef char gchar;
 typedef int gboolean;
 typedef int gint;
@@ -112,11 +114,53 @@ typedef struct GOptionContext {
 
 #define g_return_val_if_fail(a, b) if (!a) { return b; }
 
+/* Memory accounting.
+ *
+ * Every g_malloc-family allocation is charged to a subsystem so that
+ * current and peak usage can be queried at runtime (see mdb_dump_stats).
+ * A source file picks its subsystem by defining MDB_MEM_TAG before
+ * including this header; individual call sites can override it with the
+ * mdb_mem_* functions.  Memory obtained here must be released with
+ * g_free(), never with free().
+ */
+typedef enum {
+	MDB_MEM_OTHER = 0,
+	MDB_MEM_CATALOG,
+	MDB_MEM_TABLEDEF,
+	MDB_MEM_PAGE_CACHE,
+	MDB_MEM_BIND,
+	MDB_MEM_SARG,
+	MDB_MEM_TEMPTABLE,
+	MDB_MEM_MEMO,
+	MDB_MEM_PROPS,
+	MDB_MEM_RESULT_CACHE,
+	MDB_MEM_PREFIX_INDEX,
+	MDB_MEM_TREE,
+	MDB_MEM_LEDGER,
+	MDB_MEM_NTAGS
+} MdbMemTag;
+
+#ifndef MDB_MEM_TAG
+#define MDB_MEM_TAG MDB_MEM_OTHER
+#endif
+
+void *mdb_mem_malloc(MdbMemTag tag, size_t len);
+void *mdb_mem_malloc0(MdbMemTag tag, size_t len);
+void *mdb_mem_realloc(MdbMemTag tag, void *ptr, size_t len);
+void *mdb_mem_memdup(MdbMemTag tag, const void *src, size_t len);
+char *mdb_mem_strdup(MdbMemTag tag, const char *src);
+char *mdb_mem_strndup(MdbMemTag tag, const char *src, size_t len);
+void mdb_mem_free(void *ptr);
+size_t mdb_mem_current(MdbMemTag tag);
+size_t mdb_mem_peak(MdbMemTag tag);
+void mdb_mem_reset_peaks(void);
+const char *mdb_mem_tag_name(MdbMemTag tag);
+
 #define g_ascii_strcasecmp strcasecmp
-#define g_malloc0(len) calloc(1, len)
-#define g_malloc malloc
-#define g_free free
-#define g_realloc realloc
+#define g_malloc0(len) mdb_mem_malloc0(MDB_MEM_TAG, len)
+#define g_malloc(len) mdb_mem_malloc(MDB_MEM_TAG, len)
+#define g_free mdb_mem_free
+#define g_realloc(ptr, len) mdb_mem_realloc(MDB_MEM_TAG, ptr, len)
 #define g_memdup2 g_memdup
 
 #define	G_STR_DELIMITERS "_-|> <."
@@ -127,6 +171,13 @@ typedef struct GOptionContext {
 #define TRUE 1
 #define FALSE 0
 
+#ifndef MIN
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+
 #define GUINT32_SWAP_LE_BE(l) __builtin_bswap32((uint32_t)(l))
 
 /* string functions */
@@ -137,6 +188,9 @@ void g_strfreev(char **dir);
 char *g_strconcat(const char *first, ...);
 char *g_strdup(const char *src);
 char *g_strndup(const char *src, size_t len);
+#define g_memdup(src, len) mdb_mem_memdup(MDB_MEM_TAG, src, len)
+#define g_strdup(src) mdb_mem_strdup(MDB_MEM_TAG, src)
+#define g_strndup(src, len) mdb_mem_strndup(MDB_MEM_TAG, src, len)
 char *g_strdup_printf(const char *format, ...);
 gchar *g_strdelimit(gchar *string, const gchar *delimiters, gchar new_delimiter);
 void g_printerr(const gchar *format, ...);
@@ -31,6 +31,14 @@
 #endif
 
 void mdbi_rc4(unsigned char *key, guint32 key_len, unsigned char *buf, guint32 buf_len);
+off_t mdbi_file_size(MdbFile *f);
+ssize_t mdbi_read_at(MdbFile *f, void *buf, size_t len, off_t offset);
+ssize_t mdbi_write_at(MdbFile *f, const void *buf, size_t len, off_t offset);
+void mdbi_snapshot_init(MdbFile *f);
+void mdbi_snapshot_free(MdbFile *f);
+void mdbi_snapshot_share(MdbHandle *mdb);
+ssize_t mdbi_read_page(MdbHandle *mdb, void *buf, unsigned long pg, off_t offset);
+ssize_t mdbi_write_page(MdbHandle *mdb, const void *buf, unsigned long pg, off_t offset);
 MdbBackend *mdbi_register_backend2(MdbHandle *mdb, char *backend_name, guint32 capabilities,
         const MdbBackendType *backend_type,
         const MdbBackendType *type_shortdate,
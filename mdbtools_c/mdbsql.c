@@ -0,0 +1,1998 @@
+/* MDB Tools - A library for reading MS Access database file
+ * Copyright (C) 2000 Brian Bruns
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Embedded SQL engine: a recursive descent parser for the SELECT subset
+ * the app needs, executed directly against the table scan.  The WHERE
+ * clause is compiled into the table's sarg tree, so rows are filtered as
+ * they are cracked and indexable terms can drive an index scan.
+ *
+ * Statements may contain '?' placeholders.  mdb_sql_prepare() parses and
+ * binds a statement once; mdb_sql_bind_param() and mdb_sql_execute() can
+ * then rerun it with new values without parsing or rebinding anything.
+ */
+
+#define MDB_MEM_TAG MDB_MEM_TEMPTABLE
+#define _GNU_SOURCE	/* strptime */
+
+#include <stdarg.h>
+#include <ctype.h>
+#include <time.h>
+#include "mdbsql.h"
+
+enum {
+	MDB_SQL_TOK_END,
+	MDB_SQL_TOK_IDENT,	/* bare word, may be a keyword */
+	MDB_SQL_TOK_NAME,	/* [bracketed] or "quoted" identifier */
+	MDB_SQL_TOK_STRING,
+	MDB_SQL_TOK_NUMBER,
+	MDB_SQL_TOK_PARAM,
+	MDB_SQL_TOK_OP,		/* relational operator in op */
+	MDB_SQL_TOK_PUNCT	/* single character in op */
+};
+
+typedef struct {
+	MdbSQL *sql;
+	const char *p;
+	int tok;
+	int op;
+	char *text;
+} MdbSQLParser;
+
+/* row materialized for ORDER BY or COUNT(*) */
+typedef struct {
+	char **values;
+	double *num_keys;
+	char **str_keys;
+	unsigned char *null_keys;
+} MdbSQLRow;
+
+static int mdb_sql_parse_expr(MdbSQLParser *ps);
+
+void
+mdb_sql_error(MdbSQL* sql, const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(sql->error_msg, sizeof(sql->error_msg), fmt, ap);
+	va_end(ap);
+}
+MdbSQL *
+mdb_sql_init(void)
+{
+	MdbSQL *sql;
+
+	sql = g_malloc0(sizeof(MdbSQL));
+	sql->columns = g_ptr_array_new();
+	sql->tables = g_ptr_array_new();
+	sql->bound_values = g_ptr_array_new();
+	sql->order_by = g_ptr_array_new();
+	sql->params = g_ptr_array_new();
+	sql->max_rows = -1;
+	sql->limit = -1;
+
+	return sql;
+}
+MdbSQLSarg *
+mdb_sql_alloc_sarg(void)
+{
+	MdbSQLSarg *sql_sarg;
+
+	sql_sarg = g_malloc0(sizeof(MdbSQLSarg));
+	sql_sarg->sarg = g_malloc0(sizeof(MdbSarg));
+	return sql_sarg;
+}
+static MdbSargNode *
+mdb_sql_alloc_node(void)
+{
+	return g_malloc0(sizeof(MdbSargNode));
+}
+void
+mdb_sql_free_tree(MdbSargNode *tree)
+{
+	if (!tree)
+		return;
+	mdb_sql_free_tree(tree->left);
+	mdb_sql_free_tree(tree->right);
+	/* parent holds the column name until the tree is bound */
+	if (!tree->col)
+		g_free(tree->parent);
+	mdb_any_clear(&tree->value);
+	g_free(tree);
+}
+MdbHandle *
+mdb_sql_open(MdbSQL *sql, char *db_name)
+{
+	char *db_namep = db_name;
+
+	sql->mdb = mdb_open(db_namep, MDB_NOFLAGS);
+	if (!sql->mdb && !strstr(db_name, ".mdb")) {
+		db_namep = g_strdup_printf("%s.mdb", db_name);
+		sql->mdb = mdb_open(db_namep, MDB_NOFLAGS);
+		g_free(db_namep);
+	}
+	if (!sql->mdb) {
+		mdb_sql_error(sql, "Unable to locate database %s", db_name);
+		return NULL;
+	}
+	if (!mdb_read_catalog(sql->mdb, MDB_TABLE)) {
+		mdb_sql_error(sql, "Unable to read catalog of %s", db_name);
+		mdb_close(sql->mdb);
+		sql->mdb = NULL;
+	}
+	return sql->mdb;
+}
+
+/* WHERE clause construction.  Terms are pushed on sarg_stack and the
+ * logical operators combine the topmost entries, as the grammar reduces. */
+
+static void
+mdb_sql_push_node(MdbSQL *sql, MdbSargNode *node)
+{
+	sql->sarg_stack = g_list_append(sql->sarg_stack, node);
+	sql->sarg_tree = node;
+}
+static MdbSargNode *
+mdb_sql_pop_node(MdbSQL *sql)
+{
+	GList *glist;
+	MdbSargNode *node;
+
+	glist = g_list_last(sql->sarg_stack);
+	if (!glist)
+		return NULL;
+	node = glist->data;
+	sql->sarg_stack = g_list_remove(sql->sarg_stack, node);
+	return node;
+}
+void
+mdb_sql_add_or(MdbSQL *sql)
+{
+	MdbSargNode *node;
+
+	node = mdb_sql_alloc_node();
+	node->op = MDB_OR;
+	node->right = mdb_sql_pop_node(sql);
+	node->left = mdb_sql_pop_node(sql);
+	mdb_sql_push_node(sql, node);
+}
+void
+mdb_sql_add_and(MdbSQL *sql)
+{
+	MdbSargNode *node;
+
+	node = mdb_sql_alloc_node();
+	node->op = MDB_AND;
+	node->right = mdb_sql_pop_node(sql);
+	node->left = mdb_sql_pop_node(sql);
+	mdb_sql_push_node(sql, node);
+}
+void
+mdb_sql_add_not(MdbSQL *sql)
+{
+	MdbSargNode *node;
+
+	node = mdb_sql_alloc_node();
+	node->op = MDB_NOT;
+	node->left = mdb_sql_pop_node(sql);
+	mdb_sql_push_node(sql, node);
+}
+/*
+ * Store a constant in node.  Until the column is known it is kept as
+ * text; mdb_sql_coerce_node() converts it to the column's type.
+ */
+static void
+mdb_sql_set_node_text(MdbSargNode *node, const char *constant)
+{
+	mdb_any_set_text(&node->value, constant, strlen(constant));
+	node->val_type = MDB_TEXT;
+}
+/**
+ * mdb_sql_add_sarg:
+ * @sql: statement being built
+ * @col_name: column the term tests
+ * @op: relational operator, e.g. MDB_EQUAL
+ * @constant: value to compare with, or NULL for a '?' placeholder
+ *
+ * Pushes a term onto the WHERE clause being built.
+ *
+ * Return value: 1 on success
+ */
+int
+mdb_sql_add_sarg(MdbSQL *sql, char *col_name, int op, char *constant)
+{
+	MdbSargNode *node;
+
+	node = mdb_sql_alloc_node();
+	node->op = op;
+	/* stash the column name until the table is bound */
+	node->parent = g_strdup(col_name);
+	if (constant)
+		mdb_sql_set_node_text(node, constant);
+	else if (op != MDB_ISNULL && op != MDB_NOTNULL)
+		g_ptr_array_add(sql->params, node);
+	mdb_sql_push_node(sql, node);
+	return 1;
+}
+void
+mdb_sql_all_columns(MdbSQL *sql)
+{
+	sql->all_columns = 1;
+}
+void
+mdb_sql_sel_count(MdbSQL *sql)
+{
+	sql->sel_count = 1;
+}
+int
+mdb_sql_add_column(MdbSQL *sql, char *column_name)
+{
+	MdbSQLColumn *c;
+
+	c = g_malloc0(sizeof(MdbSQLColumn));
+	c->name = g_strdup(column_name);
+	g_ptr_array_add(sql->columns, c);
+	sql->num_columns++;
+	return 0;
+}
+int
+mdb_sql_add_table(MdbSQL *sql, char *table_name)
+{
+	MdbSQLTable *t;
+
+	t = g_malloc0(sizeof(MdbSQLTable));
+	t->name = g_strdup(table_name);
+	g_ptr_array_add(sql->tables, t);
+	sql->num_tables++;
+	return 0;
+}
+int
+mdb_sql_add_order(MdbSQL *sql, char *col_name, int desc)
+{
+	MdbSQLOrder *o;
+
+	o = g_malloc0(sizeof(MdbSQLOrder));
+	o->col_name = g_strdup(col_name);
+	o->desc = desc;
+	g_ptr_array_add(sql->order_by, o);
+	return 0;
+}
+int
+mdb_sql_add_limit(MdbSQL *sql, char *limit, int percent)
+{
+	char *end;
+	long n = strtol(limit, &end, 10);
+
+	if (*end || n < 0 || (percent && n > 100)) {
+		mdb_sql_error(sql, "Invalid limit %s", limit);
+		return 1;
+	}
+	sql->limit = n;
+	sql->limit_percent = percent;
+	return 0;
+}
+int
+mdb_sql_get_limit(MdbSQL *sql)
+{
+	return sql->limit;
+}
+void
+mdb_sql_set_maxrow(MdbSQL *sql, int maxrow)
+{
+	sql->max_rows = maxrow;
+}
+/* parse 'YYYY-MM-DD[ HH:MM[:SS]]' or 'MM/DD/YYYY[ HH:MM[:SS]]' */
+static int
+mdb_sql_parse_date(const char *s, double *td)
+{
+	struct tm t;
+	int n, consumed = 0;
+
+	memset(&t, 0, sizeof(t));
+	if (sscanf(s, "%4d-%2d-%2d%n", &t.tm_year, &t.tm_mon, &t.tm_mday, &consumed) == 3) {
+		;
+	} else if (sscanf(s, "%2d/%2d/%4d%n", &t.tm_mon, &t.tm_mday, &t.tm_year, &consumed) == 3) {
+		;
+	} else {
+		return 0;
+	}
+	s += consumed;
+	if (*s == ' ' || *s == 'T') {
+		n = sscanf(s + 1, "%2d:%2d:%2d", &t.tm_hour, &t.tm_min, &t.tm_sec);
+		if (n < 2)
+			return 0;
+	} else if (*s) {
+		return 0;
+	}
+	if (t.tm_mon < 1 || t.tm_mon > 12 || t.tm_mday < 1 || t.tm_mday > 31)
+		return 0;
+	t.tm_year -= 1900;
+	t.tm_mon--;
+	mdb_tm_to_date(&t, td);
+	return 1;
+}
+char *
+mdb_sql_strptime(MdbSQL *sql, char *data, char *format)
+{
+	struct tm tm;
+	double date;
+	char *p;
+
+	memset(&tm, 0, sizeof(tm));
+	p = strptime(data, format, &tm);
+	if (!p || *p) {
+		mdb_sql_error(sql, "Date %s does not match format %s", data, format);
+		return NULL;
+	}
+	mdb_tm_to_date(&tm, &date);
+	return g_strdup_printf("%f", date);
+}
+/*
+ * Convert the text constant in node to the type of node->col, the form
+ * mdb_test_sarg() compares against.
+ */
+static int
+mdb_sql_coerce_node(MdbSQL *sql, MdbSargNode *node)
+{
+	MdbColumn *col = node->col;
+	char *text;
+	char *end;
+	double d;
+
+	if (node->val_type != MDB_TEXT || node->op == MDB_ISNULL || node->op == MDB_NOTNULL)
+		return 0;
+	text = node->value.s;
+
+	switch (col->col_type) {
+		case MDB_BOOL:
+			if (!g_ascii_strcasecmp(text, "true") || !g_ascii_strcasecmp(text, "yes"))
+				node->value.i = 1;
+			else if (!g_ascii_strcasecmp(text, "false") || !g_ascii_strcasecmp(text, "no"))
+				node->value.i = 0;
+			else
+				node->value.i = strtol(text, &end, 10) != 0;
+			node->val_type = MDB_INT;
+			mdb_any_clear(&node->value);
+			return 0;
+		case MDB_BYTE:
+		case MDB_INT:
+		case MDB_LONGINT:
+		case MDB_FLOAT:
+		case MDB_DOUBLE:
+		case MDB_MONEY:
+			d = strtod(text, &end);
+			if (end == text || *end)
+				break;
+			/* out of range values can't be cast */
+			if (d >= INT32_MIN && d <= INT32_MAX && d == (gint32)d
+					&& col->col_type != MDB_FLOAT
+					&& col->col_type != MDB_DOUBLE && col->col_type != MDB_MONEY) {
+				node->value.i = (gint32)d;
+				node->val_type = MDB_INT;
+			} else {
+				node->value.d = d;
+				node->val_type = MDB_DOUBLE;
+			}
+			mdb_any_clear(&node->value);
+			return 0;
+		case MDB_DATETIME:
+			d = strtod(text, &end);
+			if (end == text || *end) {
+				if (!mdb_sql_parse_date(text, &d))
+					break;
+			}
+			node->value.d = d;
+			node->val_type = MDB_DOUBLE;
+			mdb_any_clear(&node->value);
+			return 0;
+		default:
+			/* text comparisons use the constant as is */
+			return 0;
+	}
+	mdb_sql_error(sql, "Invalid value '%s' for column %s", text, col->name);
+	return 1;
+}
+int
+mdb_sql_eval_expr(MdbSQL *sql, char *const1, int op, char *const2)
+{
+	MdbSargNode node, *result;
+	char *end1, *end2;
+	double d1, d2;
+	int compar, value;
+
+	d1 = strtod(const1, &end1);
+	d2 = strtod(const2, &end2);
+	if (end1 != const1 && !*end1 && end2 != const2 && !*end2) {
+		compar = d1 < d2 ? -1 : d1 > d2;
+	} else if (op == MDB_LIKE || op == MDB_ILIKE) {
+		memset(&node, 0, sizeof(node));
+		node.op = op;
+		mdb_sql_set_node_text(&node, const2);
+		compar = mdb_test_string(&node, const1) ? 0 : 1;
+		mdb_any_clear(&node.value);
+		op = MDB_EQUAL;
+	} else {
+		compar = strcoll(const1, const2);
+	}
+	switch (op) {
+		case MDB_EQUAL: value = (compar == 0); break;
+		case MDB_NEQ: value = (compar != 0); break;
+		case MDB_GT: value = (compar > 0); break;
+		case MDB_LT: value = (compar < 0); break;
+		case MDB_GTEQ: value = (compar >= 0); break;
+		case MDB_LTEQ: value = (compar <= 0); break;
+		default:
+			mdb_sql_error(sql, "Unsupported operator in constant expression");
+			return 1;
+	}
+	/* a relational node with no column evaluates to value.i */
+	result = mdb_sql_alloc_node();
+	result->op = MDB_EQUAL;
+	result->value.i = value;
+	result->val_type = MDB_INT;
+	mdb_sql_push_node(sql, result);
+	return 0;
+}
+
+/* Tokenizer */
+
+static int
+mdb_sql_next(MdbSQLParser *ps)
+{
+	const char *p = ps->p, *start;
+	char *out;
+
+	g_free(ps->text);
+	ps->text = NULL;
+	ps->op = 0;
+
+	while (isspace((unsigned char)*p))
+		p++;
+	start = p;
+
+	if (!*p) {
+		ps->tok = MDB_SQL_TOK_END;
+	} else if (isalpha((unsigned char)*p) || *p == '_' || *p == '#') {
+		while (isalnum((unsigned char)*p) || *p == '_' || *p == '#' || *p == '$')
+			p++;
+		ps->tok = MDB_SQL_TOK_IDENT;
+		ps->text = g_strndup(start, p - start);
+	} else if (*p == '[' || *p == '"' || *p == '`') {
+		char close = *p == '[' ? ']' : *p;
+		start = ++p;
+		while (*p && *p != close)
+			p++;
+		if (!*p) {
+			mdb_sql_error(ps->sql, "Unterminated identifier");
+			return 0;
+		}
+		ps->tok = MDB_SQL_TOK_NAME;
+		ps->text = g_strndup(start, p - start);
+		p++;
+	} else if (*p == '\'') {
+		/* '' inside a string is a literal quote */
+		ps->text = out = g_malloc(strlen(p) + 1);
+		for (p++; *p; p++) {
+			if (*p == '\'') {
+				if (p[1] != '\'')
+					break;
+				p++;
+			}
+			*out++ = *p;
+		}
+		*out = '\0';
+		if (!*p) {
+			mdb_sql_error(ps->sql, "Unterminated string");
+			return 0;
+		}
+		p++;
+		ps->tok = MDB_SQL_TOK_STRING;
+	} else if (isdigit((unsigned char)*p) || ((*p == '-' || *p == '.')
+			&& (isdigit((unsigned char)p[1]) || (p[1] == '.' && isdigit((unsigned char)p[2]))))) {
+		strtod(p, (char **)&p);
+		ps->tok = MDB_SQL_TOK_NUMBER;
+		ps->text = g_strndup(start, p - start);
+	} else if (*p == '?') {
+		p++;
+		ps->tok = MDB_SQL_TOK_PARAM;
+	} else if (*p == '=') {
+		p++;
+		ps->tok = MDB_SQL_TOK_OP;
+		ps->op = MDB_EQUAL;
+	} else if (*p == '<' || *p == '>' || *p == '!') {
+		ps->tok = MDB_SQL_TOK_OP;
+		if (p[0] == '<' && p[1] == '>') {
+			ps->op = MDB_NEQ; p += 2;
+		} else if (p[0] == '!' && p[1] == '=') {
+			ps->op = MDB_NEQ; p += 2;
+		} else if (p[1] == '=') {
+			ps->op = *p == '<' ? MDB_LTEQ : MDB_GTEQ; p += 2;
+		} else if (*p != '!') {
+			ps->op = *p == '<' ? MDB_LT : MDB_GT; p++;
+		} else {
+			mdb_sql_error(ps->sql, "Unexpected character '!'");
+			return 0;
+		}
+	} else if (strchr("(),*;", *p)) {
+		ps->tok = MDB_SQL_TOK_PUNCT;
+		ps->op = *p++;
+	} else {
+		mdb_sql_error(ps->sql, "Unexpected character '%c'", *p);
+		return 0;
+	}
+	ps->p = p;
+	return 1;
+}
+static int
+mdb_sql_is_keyword(MdbSQLParser *ps, const char *kw)
+{
+	return ps->tok == MDB_SQL_TOK_IDENT && !g_ascii_strcasecmp(ps->text, kw);
+}
+static int
+mdb_sql_accept_keyword(MdbSQLParser *ps, const char *kw)
+{
+	if (!mdb_sql_is_keyword(ps, kw))
+		return 0;
+	return mdb_sql_next(ps) ? 1 : -1;
+}
+static int
+mdb_sql_expect_keyword(MdbSQLParser *ps, const char *kw)
+{
+	int rc = mdb_sql_accept_keyword(ps, kw);
+
+	if (!rc)
+		mdb_sql_error(ps->sql, "Expected %s", kw);
+	return rc == 1;
+}
+static int
+mdb_sql_accept_punct(MdbSQLParser *ps, char c)
+{
+	if (ps->tok != MDB_SQL_TOK_PUNCT || ps->op != c)
+		return 0;
+	return mdb_sql_next(ps) ? 1 : -1;
+}
+static int
+mdb_sql_is_name(MdbSQLParser *ps)
+{
+	static const char *reserved[] = { "select", "from", "where", "order",
+		"by", "limit", "and", "or", "not", "is", "null", "like", "ilike", NULL };
+	int i;
+
+	if (ps->tok == MDB_SQL_TOK_NAME)
+		return 1;
+	if (ps->tok != MDB_SQL_TOK_IDENT)
+		return 0;
+	for (i = 0; reserved[i]; i++)
+		if (!g_ascii_strcasecmp(ps->text, reserved[i]))
+			return 0;
+	return 1;
+}
+/* take ownership of the current token's text and advance */
+static char *
+mdb_sql_take(MdbSQLParser *ps)
+{
+	char *text = ps->text;
+
+	ps->text = NULL;
+	if (!mdb_sql_next(ps)) {
+		g_free(text);
+		return NULL;
+	}
+	return text;
+}
+
+/* Parser */
+
+static int
+mdb_sql_flip_op(int op)
+{
+	switch (op) {
+		case MDB_GT: return MDB_LT;
+		case MDB_LT: return MDB_GT;
+		case MDB_GTEQ: return MDB_LTEQ;
+		case MDB_LTEQ: return MDB_GTEQ;
+	}
+	return op;
+}
+/* operand: column name (kind 1), constant (kind 2) or placeholder (kind 3) */
+static char *
+mdb_sql_parse_operand(MdbSQLParser *ps, int *kind)
+{
+	if (mdb_sql_is_keyword(ps, "true") || mdb_sql_is_keyword(ps, "false")) {
+		*kind = 2;
+		return mdb_sql_take(ps);
+	}
+	if (mdb_sql_is_name(ps)) {
+		*kind = 1;
+		return mdb_sql_take(ps);
+	}
+	if (ps->tok == MDB_SQL_TOK_STRING || ps->tok == MDB_SQL_TOK_NUMBER) {
+		*kind = 2;
+		return mdb_sql_take(ps);
+	}
+	if (ps->tok == MDB_SQL_TOK_PARAM) {
+		*kind = 3;
+		return mdb_sql_next(ps) ? g_strdup("?") : NULL;
+	}
+	mdb_sql_error(ps->sql, "Expected a column, constant or ? near '%s'", ps->text ? ps->text : "end of query");
+	return NULL;
+}
+static int
+mdb_sql_parse_predicate(MdbSQLParser *ps)
+{
+	char *lhs, *rhs = NULL;
+	int lkind, rkind, op, negate = 0, rc = 1;
+
+	if (!(lhs = mdb_sql_parse_operand(ps, &lkind)))
+		return 1;
+
+	if (mdb_sql_accept_keyword(ps, "is") == 1) {
+		negate = mdb_sql_accept_keyword(ps, "not") == 1;
+		if (lkind != 1 || !mdb_sql_expect_keyword(ps, "null")) {
+			if (lkind != 1)
+				mdb_sql_error(ps->sql, "IS NULL needs a column");
+			goto done;
+		}
+		rc = !mdb_sql_add_sarg(ps->sql, lhs, negate ? MDB_NOTNULL : MDB_ISNULL, NULL);
+		goto done;
+	}
+
+	negate = mdb_sql_accept_keyword(ps, "not") == 1;
+	if (mdb_sql_is_keyword(ps, "like") || mdb_sql_is_keyword(ps, "ilike")) {
+		op = mdb_sql_is_keyword(ps, "like") ? MDB_LIKE : MDB_ILIKE;
+		if (!mdb_sql_next(ps))
+			goto done;
+	} else if (!negate && ps->tok == MDB_SQL_TOK_OP) {
+		op = ps->op;
+		if (!mdb_sql_next(ps))
+			goto done;
+	} else {
+		mdb_sql_error(ps->sql, "Expected an operator after %s", lhs);
+		goto done;
+	}
+
+	if (!(rhs = mdb_sql_parse_operand(ps, &rkind)))
+		goto done;
+
+	if (lkind == 1 && rkind == 1) {
+		mdb_sql_error(ps->sql, "Comparing two columns (%s, %s) is not supported", lhs, rhs);
+	} else if (lkind == 1) {
+		rc = !mdb_sql_add_sarg(ps->sql, lhs, op, rkind == 3 ? NULL : rhs);
+	} else if (rkind == 1 && op != MDB_LIKE && op != MDB_ILIKE) {
+		rc = !mdb_sql_add_sarg(ps->sql, rhs, mdb_sql_flip_op(op), lkind == 3 ? NULL : lhs);
+	} else if (lkind == 2 && rkind == 2) {
+		rc = mdb_sql_eval_expr(ps->sql, lhs, op, rhs);
+	} else {
+		mdb_sql_error(ps->sql, "Unsupported comparison");
+	}
+	if (!rc && negate)
+		mdb_sql_add_not(ps->sql);
+done:
+	g_free(lhs);
+	g_free(rhs);
+	return rc || mdb_sql_has_error(ps->sql);
+}
+static int
+mdb_sql_parse_factor(MdbSQLParser *ps)
+{
+	int rc;
+
+	if ((rc = mdb_sql_accept_keyword(ps, "not"))) {
+		if (rc < 0 || mdb_sql_parse_factor(ps))
+			return 1;
+		mdb_sql_add_not(ps->sql);
+		return 0;
+	}
+	if ((rc = mdb_sql_accept_punct(ps, '('))) {
+		if (rc < 0 || mdb_sql_parse_expr(ps))
+			return 1;
+		if (mdb_sql_accept_punct(ps, ')') != 1) {
+			if (!mdb_sql_has_error(ps->sql))
+				mdb_sql_error(ps->sql, "Expected )");
+			return 1;
+		}
+		return 0;
+	}
+	return mdb_sql_parse_predicate(ps);
+}
+static int
+mdb_sql_parse_term(MdbSQLParser *ps)
+{
+	int rc;
+
+	if (mdb_sql_parse_factor(ps))
+		return 1;
+	while ((rc = mdb_sql_accept_keyword(ps, "and"))) {
+		if (rc < 0 || mdb_sql_parse_factor(ps))
+			return 1;
+		mdb_sql_add_and(ps->sql);
+	}
+	return 0;
+}
+static int
+mdb_sql_parse_expr(MdbSQLParser *ps)
+{
+	int rc;
+
+	if (mdb_sql_parse_term(ps))
+		return 1;
+	while ((rc = mdb_sql_accept_keyword(ps, "or"))) {
+		if (rc < 0 || mdb_sql_parse_term(ps))
+			return 1;
+		mdb_sql_add_or(ps->sql);
+	}
+	return 0;
+}
+static int
+mdb_sql_parse_number(MdbSQLParser *ps, int percent_ok)
+{
+	char *n;
+	int percent = 0, rc;
+
+	if (ps->tok != MDB_SQL_TOK_NUMBER) {
+		mdb_sql_error(ps->sql, "Expected a row count");
+		return 1;
+	}
+	if (!(n = mdb_sql_take(ps)))
+		return 1;
+	if (percent_ok && mdb_sql_accept_keyword(ps, "percent") == 1)
+		percent = 1;
+	rc = mdb_sql_add_limit(ps->sql, n, percent);
+	g_free(n);
+	return rc;
+}
+static int
+mdb_sql_parse_select(MdbSQLParser *ps)
+{
+	MdbSQL *sql = ps->sql;
+	char *name;
+	int rc;
+
+	if (mdb_sql_accept_keyword(ps, "top") == 1 && mdb_sql_parse_number(ps, 1))
+		return 1;
+
+	if (mdb_sql_accept_punct(ps, '*') == 1) {
+		mdb_sql_all_columns(sql);
+	} else if (mdb_sql_is_keyword(ps, "count")) {
+		if (!mdb_sql_next(ps) || mdb_sql_accept_punct(ps, '(') != 1
+				|| mdb_sql_accept_punct(ps, '*') != 1 || mdb_sql_accept_punct(ps, ')') != 1) {
+			if (!mdb_sql_has_error(sql))
+				mdb_sql_error(sql, "Expected COUNT(*)");
+			return 1;
+		}
+		mdb_sql_sel_count(sql);
+	} else {
+		do {
+			if (!mdb_sql_is_name(ps)) {
+				mdb_sql_error(sql, "Expected a column name");
+				return 1;
+			}
+			if (!(name = mdb_sql_take(ps)))
+				return 1;
+			mdb_sql_add_column(sql, name);
+			g_free(name);
+		} while ((rc = mdb_sql_accept_punct(ps, ',')) == 1);
+		if (rc < 0)
+			return 1;
+	}
+
+	if (!mdb_sql_expect_keyword(ps, "from"))
+		return 1;
+	if (!mdb_sql_is_name(ps)) {
+		mdb_sql_error(sql, "Expected a table name");
+		return 1;
+	}
+	if (!(name = mdb_sql_take(ps)))
+		return 1;
+	mdb_sql_add_table(sql, name);
+	g_free(name);
+
+	if ((rc = mdb_sql_accept_keyword(ps, "where"))) {
+		if (rc < 0 || mdb_sql_parse_expr(ps))
+			return 1;
+	}
+	if ((rc = mdb_sql_accept_keyword(ps, "order"))) {
+		if (rc < 0 || !mdb_sql_expect_keyword(ps, "by"))
+			return 1;
+		do {
+			int desc = 0;
+			if (!mdb_sql_is_name(ps)) {
+				mdb_sql_error(sql, "Expected a column name after ORDER BY");
+				return 1;
+			}
+			if (!(name = mdb_sql_take(ps)))
+				return 1;
+			if (mdb_sql_accept_keyword(ps, "desc") == 1)
+				desc = 1;
+			else
+				mdb_sql_accept_keyword(ps, "asc");
+			mdb_sql_add_order(sql, name, desc);
+			g_free(name);
+		} while ((rc = mdb_sql_accept_punct(ps, ',')) == 1);
+		if (rc < 0)
+			return 1;
+	}
+	if ((rc = mdb_sql_accept_keyword(ps, "limit"))) {
+		if (rc < 0 || mdb_sql_parse_number(ps, 0))
+			return 1;
+	}
+	return 0;
+}
+/**
+ * parse_sql:
+ * @sql: statement, reset
+ * @str: query text
+ *
+ * Parses one of
+ *   [EXPLAIN [ANALYZE]] SELECT [TOP n [PERCENT]] {* | COUNT(*) | col, ...}
+ *     FROM table [WHERE expr] [ORDER BY col [ASC|DESC], ...] [LIMIT n]
+ *   LIST TABLES
+ *   DESCRIBE TABLE name
+ * into @sql.  WHERE supports AND, OR, NOT, parentheses, the relational
+ * operators, [NOT] LIKE/ILIKE and IS [NOT] NULL.  Constants are 'strings'
+ * or numbers; '?' is a parameter for mdb_sql_bind_param().
+ *
+ * Return value: 0 on success, 1 with the error in sql->error_msg.
+ */
+int
+parse_sql(MdbSQL *sql, const gchar *str)
+{
+	MdbSQLParser ps;
+	int rc = 1;
+
+	memset(&ps, 0, sizeof(ps));
+	ps.sql = sql;
+	ps.p = str;
+	if (!mdb_sql_next(&ps))
+		goto done;
+
+	if (mdb_sql_accept_keyword(&ps, "explain") == 1) {
+		sql->explain = MDB_SQL_EXPLAIN;
+		if (mdb_sql_accept_keyword(&ps, "analyze") == 1)
+			sql->explain = MDB_SQL_ANALYZE;
+		if (!mdb_sql_is_keyword(&ps, "select")) {
+			mdb_sql_error(sql, "EXPLAIN only applies to SELECT");
+			goto done;
+		}
+	}
+	if (mdb_sql_accept_keyword(&ps, "select") == 1) {
+		sql->stmt_type = MDB_SQL_SELECT;
+		if (mdb_sql_parse_select(&ps))
+			goto done;
+	} else if (mdb_sql_accept_keyword(&ps, "list") == 1) {
+		if (!mdb_sql_expect_keyword(&ps, "tables"))
+			goto done;
+		sql->stmt_type = MDB_SQL_LIST_TABLES;
+	} else if (mdb_sql_accept_keyword(&ps, "describe") == 1) {
+		if (!mdb_sql_expect_keyword(&ps, "table"))
+			goto done;
+		if (!mdb_sql_is_name(&ps)) {
+			mdb_sql_error(sql, "Expected a table name");
+			goto done;
+		}
+		mdb_sql_add_table(sql, ps.text);
+		if (!mdb_sql_next(&ps))
+			goto done;
+		sql->stmt_type = MDB_SQL_DESCRIBE;
+	} else {
+		if (!mdb_sql_has_error(sql))
+			mdb_sql_error(sql, "Unsupported statement");
+		goto done;
+	}
+
+	mdb_sql_accept_punct(&ps, ';');
+	if (ps.tok != MDB_SQL_TOK_END) {
+		if (!mdb_sql_has_error(sql))
+			mdb_sql_error(sql, "Unexpected '%s' at end of query", ps.text ? ps.text : ps.p - 1);
+		goto done;
+	}
+	rc = 0;
+done:
+	g_free(ps.text);
+	if (rc && !mdb_sql_has_error(sql))
+		mdb_sql_error(sql, "Syntax error");
+	return rc;
+}
+
+/* Binding */
+
+static MdbColumn *
+mdb_sql_find_column(MdbTableDef *table, const char *name)
+{
+	MdbColumn *col;
+	unsigned int i;
+
+	for (i = 0; i < table->num_cols; i++) {
+		col = g_ptr_array_index(table->columns, i);
+		if (!g_ascii_strcasecmp(col->name, name))
+			return col;
+	}
+	return NULL;
+}
+static int
+mdb_sql_find_sargcol(MdbSargNode *node, gpointer data)
+{
+	MdbSQL *sql = data;
+
+	if (!mdb_is_relational_op(node->op) || node->col || !node->parent)
+		return 0;
+	node->col = mdb_sql_find_column(sql->cur_table, node->parent);
+	if (!node->col) {
+		mdb_sql_error(sql, "Column %s not found", (char *)node->parent);
+		return 1;
+	}
+	g_free(node->parent);
+	node->parent = NULL;
+	mdb_sql_coerce_node(sql, node);
+	return mdb_sql_has_error(sql);
+}
+int
+mdb_sql_bind_column(MdbSQL *sql, int colnum, void *varaddr, int *len_ptr)
+{
+	MdbSQLColumn *sqlcol;
+
+	if (colnum <= 0 || colnum > (int)sql->num_columns)
+		return -1;
+	sqlcol = g_ptr_array_index(sql->columns, colnum - 1);
+	sqlcol->bind_addr = varaddr;
+	sqlcol->bind_len = len_ptr;
+	if (sql->sel_count || sql->explain)
+		return 0;
+	/* sorted, counted and explained results are copied out in mdb_sql_fetch_row() */
+	mdb_bind_column_by_name(sql->cur_table, sqlcol->name, varaddr, len_ptr);
+	return 0;
+}
+int
+mdb_sql_bind_all(MdbSQL *sql)
+{
+	unsigned int i;
+	void *bound_value;
+
+	for (i = 0; i < sql->num_columns; i++) {
+		bound_value = g_malloc0(sql->mdb->bind_size);
+		g_ptr_array_add(sql->bound_values, bound_value);
+		mdb_sql_bind_column(sql, i + 1, bound_value, NULL);
+	}
+	return sql->num_columns;
+}
+void
+mdb_sql_unbind_all(MdbSQL *sql)
+{
+	unsigned int i;
+
+	for (i = 0; i < sql->bound_values->len; i++)
+		g_free(g_ptr_array_index(sql->bound_values, i));
+	sql->bound_values->len = 0;
+}
+int
+mdb_sql_add_temp_col(MdbSQL *sql, MdbTableDef *ttable, int col_num, char *name, int col_type, int col_size, int is_fixed)
+{
+	MdbColumn tcol;
+	MdbSQLColumn *sqlcol;
+
+	mdb_fill_temp_col(&tcol, name, col_size, col_type, is_fixed);
+	mdb_temp_table_add_col(ttable, &tcol);
+	mdb_sql_add_column(sql, name);
+	sqlcol = g_ptr_array_index(sql->columns, col_num);
+	sqlcol->disp_size = mdb_col_disp_size(&tcol);
+	return 0;
+}
+static void
+mdb_sql_add_temp_row(MdbTableDef *ttable, char **values, int num_values)
+{
+	MdbHandle *mdb = ttable->entry->mdb;
+	MdbField fields[4];
+	char text[4][256];
+	unsigned char row_buffer[MDB_PGSIZE];
+	int i, len, row_size;
+
+	for (i = 0; i < num_values; i++) {
+		len = mdb_ascii2unicode(mdb, values[i], strlen(values[i]), text[i], sizeof(text[i]));
+		mdb_fill_temp_field(&fields[i], text[i], len, 0, 0, 0, i);
+	}
+	row_size = mdb_pack_row(ttable, row_buffer, num_values, fields);
+	mdb_add_row_to_pg(ttable, row_buffer, row_size);
+	ttable->num_rows++;
+}
+void
+mdb_sql_listtables(MdbSQL *sql)
+{
+	MdbHandle *mdb = sql->mdb;
+	MdbCatalogEntry *entry;
+	MdbTableDef *ttable;
+	unsigned int i;
+
+	ttable = mdb_create_temp_table(mdb, "#listtables");
+	mdb_sql_add_temp_col(sql, ttable, 0, "Tables", MDB_TEXT, 30, 0);
+	mdb_temp_columns_end(ttable);
+
+	for (i = 0; i < mdb->num_catalog; i++) {
+		entry = g_ptr_array_index(mdb->catalog, i);
+		if (mdb_is_user_table(entry)) {
+			char *name = entry->object_name;
+			mdb_sql_add_temp_row(ttable, &name, 1);
+		}
+	}
+	sql->cur_table = ttable;
+}
+void
+mdb_sql_describe_table(MdbSQL *sql)
+{
+	MdbTableDef *ttable, *table;
+	MdbSQLTable *sql_tab;
+	MdbColumn *col;
+	char colsize[11];
+	char *values[3];
+	unsigned int i;
+
+	sql_tab = g_ptr_array_index(sql->tables, 0);
+	table = mdb_read_table_by_name(sql->mdb, sql_tab->name, MDB_TABLE);
+	if (!table) {
+		mdb_sql_error(sql, "%s is not a table in this database", sql_tab->name);
+		return;
+	}
+	mdb_read_columns(table);
+
+	ttable = mdb_create_temp_table(sql->mdb, "#describe");
+	mdb_sql_add_temp_col(sql, ttable, 0, "Column Name", MDB_TEXT, 30, 0);
+	mdb_sql_add_temp_col(sql, ttable, 1, "Type", MDB_TEXT, 20, 0);
+	mdb_sql_add_temp_col(sql, ttable, 2, "Size", MDB_TEXT, 10, 0);
+	mdb_temp_columns_end(ttable);
+
+	for (i = 0; i < table->num_cols; i++) {
+		col = g_ptr_array_index(table->columns, i);
+		snprintf(colsize, sizeof(colsize), "%d", col->col_size);
+		values[0] = col->name;
+		values[1] = (char *)mdb_get_colbacktype_string(col);
+		values[2] = colsize;
+		mdb_sql_add_temp_row(ttable, values, 3);
+	}
+	mdb_free_tabledef(table);
+	sql->cur_table = ttable;
+}
+/*
+ * Bind the parsed SELECT to its table: resolve every column, compile the
+ * WHERE clause into the table's sarg tree and bind the output buffers.
+ */
+void
+mdb_sql_select(MdbSQL *sql)
+{
+	MdbTableDef *table;
+	MdbSQLTable *sql_tab;
+	MdbSQLColumn *sqlcol;
+	MdbSQLOrder *order;
+	MdbColumn *col;
+	unsigned int i;
+
+	sql_tab = g_ptr_array_index(sql->tables, 0);
+	table = mdb_read_table_by_name(sql->mdb, sql_tab->name, MDB_TABLE);
+	if (!table) {
+		mdb_sql_error(sql, "%s is not a table in this database", sql_tab->name);
+		return;
+	}
+	mdb_read_columns(table);
+	mdb_read_indices(table);
+	sql->cur_table = table;
+
+	if (sql->all_columns) {
+		for (i = 0; i < table->num_cols; i++) {
+			col = g_ptr_array_index(table->columns, i);
+			mdb_sql_add_column(sql, col->name);
+		}
+	} else if (sql->sel_count) {
+		mdb_sql_add_column(sql, "count");
+	}
+	for (i = 0; !sql->sel_count && i < sql->num_columns; i++) {
+		sqlcol = g_ptr_array_index(sql->columns, i);
+		if (!(col = mdb_sql_find_column(table, sqlcol->name))) {
+			mdb_sql_error(sql, "Column %s not found", sqlcol->name);
+			return;
+		}
+		sqlcol->disp_size = mdb_col_disp_size(col);
+	}
+	for (i = 0; i < sql->order_by->len; i++) {
+		order = g_ptr_array_index(sql->order_by, i);
+		if (!(order->col = mdb_sql_find_column(table, order->col_name))) {
+			mdb_sql_error(sql, "Column %s not found", order->col_name);
+			return;
+		}
+	}
+
+	if (sql->sarg_tree) {
+		mdb_sql_walk_tree(sql->sarg_tree, mdb_sql_find_sargcol, sql);
+		if (mdb_sql_has_error(sql))
+			return;
+		table->sarg_tree = sql->sarg_tree;
+	}
+
+	mdb_sql_bind_all(sql);
+
+	/* sort keys not in the select list still need a buffer */
+	for (i = 0; i < sql->order_by->len; i++) {
+		order = g_ptr_array_index(sql->order_by, i);
+		if (!order->col->bind_ptr) {
+			void *bound_value = g_malloc0(sql->mdb->bind_size);
+			g_ptr_array_add(sql->bound_values, bound_value);
+			order->col->bind_ptr = bound_value;
+		}
+	}
+}
+
+/* Execution */
+
+static double
+mdb_sql_now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/* rows the statement may return under LIMIT and max_rows, or -1 */
+static long
+mdb_sql_row_limit(MdbSQL *sql, MdbTableDef *table)
+{
+	long limit = sql->limit;
+
+	if (sql->limit_percent)
+		limit = table->num_rows * sql->limit / 100;
+	if (sql->max_rows >= 0 && (limit < 0 || sql->max_rows < limit))
+		limit = sql->max_rows;
+	return limit;
+}
+static void
+mdb_sql_free_row(MdbSQL *sql, MdbSQLRow *row)
+{
+	unsigned int j;
+
+	for (j = 0; j < sql->num_columns; j++)
+		g_free(row->values[j]);
+	for (j = 0; j < sql->order_by->len; j++)
+		g_free(row->str_keys[j]);
+	g_free(row->values);
+	g_free(row->num_keys);
+	g_free(row->str_keys);
+	g_free(row->null_keys);
+	g_free(row);
+}
+static void
+mdb_sql_free_result(MdbSQL *sql)
+{
+	unsigned int i;
+
+	if (!sql->result_rows)
+		return;
+	for (i = 0; i < sql->result_rows->len; i++)
+		mdb_sql_free_row(sql, g_ptr_array_index(sql->result_rows, i));
+	g_ptr_array_free(sql->result_rows, TRUE);
+	sql->result_rows = NULL;
+	sql->result_pos = 0;
+}
+static void
+mdb_sql_clear_col_sargs(MdbTableDef *table)
+{
+	MdbColumn *col;
+	unsigned int i, j;
+
+	for (i = 0; i < table->num_cols; i++) {
+		col = g_ptr_array_index(table->columns, i);
+		if (col->sargs) {
+			for (j = 0; j < col->sargs->len; j++)
+				mdb_free_sarg(g_ptr_array_index(col->sargs, j));
+			col->sargs->len = 0;
+		}
+		if (col->idx_sarg_cache) {
+			for (j = 0; j < col->idx_sarg_cache->len; j++)
+				mdb_free_sarg(g_ptr_array_index(col->idx_sarg_cache, j));
+			g_ptr_array_free(col->idx_sarg_cache, TRUE);
+			col->idx_sarg_cache = NULL;
+		}
+		col->num_sargs = 0;
+	}
+}
+/* fixed width types sort on their stored value, the rest on the text */
+static int
+mdb_sql_sort_key(MdbHandle *mdb, MdbColumn *col, double *num_key, char **str_key)
+{
+	int start = col->cur_value_start;
+
+	if (col->col_type == MDB_BOOL) {
+		*num_key = !col->cur_value_len;
+		return 1;
+	}
+	if (!col->cur_value_len)
+		return 0;
+	switch (col->col_type) {
+		case MDB_BYTE:
+			*num_key = mdb_get_byte(mdb->pg_buf, start);
+			break;
+		case MDB_INT:
+			*num_key = (short)mdb_get_int16(mdb->pg_buf, start);
+			break;
+		case MDB_LONGINT:
+			*num_key = (gint32)mdb_get_int32(mdb->pg_buf, start);
+			break;
+		case MDB_MONEY:
+			*num_key = ((guint32)mdb_get_int32(mdb->pg_buf, start)
+				+ (gint32)mdb_get_int32(mdb->pg_buf, start + 4) * 4294967296.0) / 10000.0;
+			break;
+		case MDB_FLOAT:
+			*num_key = mdb_get_single(mdb->pg_buf, start);
+			break;
+		case MDB_DOUBLE:
+		case MDB_DATETIME:
+			*num_key = mdb_get_double(mdb->pg_buf, start);
+			break;
+		case MDB_NUMERIC:
+			*num_key = strtod(col->bind_ptr, NULL);
+			break;
+		default:
+			*str_key = g_strdup(col->bind_ptr);
+			break;
+	}
+	return 1;
+}
+static int
+mdb_sql_compare_rows(MdbSQL *sql, MdbSQLRow *a, MdbSQLRow *b)
+{
+	MdbSQLOrder *order;
+	unsigned int i;
+	int rc;
+
+	for (i = 0; i < sql->order_by->len; i++) {
+		order = g_ptr_array_index(sql->order_by, i);
+		/* nulls sort first, as in Access */
+		if (a->null_keys[i] || b->null_keys[i])
+			rc = b->null_keys[i] - a->null_keys[i];
+		else if (a->str_keys[i])
+			rc = strcoll(a->str_keys[i], b->str_keys[i]);
+		else
+			rc = a->num_keys[i] < b->num_keys[i] ? -1 : a->num_keys[i] > b->num_keys[i];
+		if (rc)
+			return order->desc ? -rc : rc;
+	}
+	return 0;
+}
+/* stable merge sort, so equal keys keep the table's order */
+static void
+mdb_sql_sort_rows(MdbSQL *sql, gpointer *rows, gpointer *tmp, unsigned int n)
+{
+	unsigned int mid = n / 2, i = 0, j = mid, k = 0;
+
+	if (n < 2)
+		return;
+	mdb_sql_sort_rows(sql, rows, tmp, mid);
+	mdb_sql_sort_rows(sql, rows + mid, tmp, n - mid);
+	while (i < mid && j < n) {
+		if (mdb_sql_compare_rows(sql, rows[j], rows[i]) < 0)
+			tmp[k++] = rows[j++];
+		else
+			tmp[k++] = rows[i++];
+	}
+	while (i < mid)
+		tmp[k++] = rows[i++];
+	while (j < n)
+		tmp[k++] = rows[j++];
+	memcpy(rows, tmp, n * sizeof(gpointer));
+}
+/* sort the rows collected so far and drop all but the first keep */
+static void
+mdb_sql_sort_truncate(MdbSQL *sql, unsigned int keep)
+{
+	GPtrArray *rows = sql->result_rows;
+	gpointer *tmp;
+	unsigned int i;
+	double start = sql->explain ? mdb_sql_now_ms() : 0;
+
+	tmp = g_malloc(rows->len * sizeof(gpointer) + 1);
+	mdb_sql_sort_rows(sql, rows->pdata, tmp, rows->len);
+	g_free(tmp);
+	if (sql->explain)
+		sql->profile.sort_ms += mdb_sql_now_ms() - start;
+	for (i = keep; i < rows->len; i++)
+		mdb_sql_free_row(sql, g_ptr_array_index(rows, i));
+	if (keep < rows->len)
+		rows->len = keep;
+}
+/* whether a sort under this limit keeps only the first rows */
+static int
+mdb_sql_top_n(long limit)
+{
+	return limit >= 0 && limit < (1 << 24);
+}
+/* copy out the bound values and sort keys of the row just fetched */
+static MdbSQLRow *
+mdb_sql_capture_row(MdbSQL *sql)
+{
+	MdbSQLColumn *sqlcol;
+	MdbSQLOrder *order;
+	MdbSQLRow *row;
+	unsigned int i, n = sql->order_by->len;
+
+	row = g_malloc0(sizeof(MdbSQLRow));
+	row->values = g_malloc(sql->num_columns * sizeof(char *));
+	for (i = 0; i < sql->num_columns; i++) {
+		sqlcol = g_ptr_array_index(sql->columns, i);
+		row->values[i] = g_strdup(sqlcol->bind_addr);
+	}
+	row->num_keys = g_malloc0(n * sizeof(double));
+	row->str_keys = g_malloc0(n * sizeof(char *));
+	row->null_keys = g_malloc0(n);
+	for (i = 0; i < n; i++) {
+		order = g_ptr_array_index(sql->order_by, i);
+		row->null_keys[i] = !mdb_sql_sort_key(sql->mdb, order->col,
+			&row->num_keys[i], &row->str_keys[i]);
+	}
+	return row;
+}
+/*
+ * Read every row and sort them.  With a limit only the first limit rows
+ * are wanted, so the rows are cut back to that many whenever twice as
+ * many pile up; the sort is stable, so rows with equal keys still come
+ * out in table order.
+ */
+static void
+mdb_sql_materialize(MdbSQL *sql, long limit)
+{
+	MdbTableDef *table = sql->cur_table;
+	int bounded = mdb_sql_top_n(limit);
+
+	sql->result_rows = g_ptr_array_new();
+	while (mdb_fetch_row(table)) {
+		g_ptr_array_add(sql->result_rows, mdb_sql_capture_row(sql));
+		if (bounded && sql->result_rows->len >= 2 * limit + 64)
+			mdb_sql_sort_truncate(sql, limit);
+	}
+	mdb_sql_sort_truncate(sql, bounded ? limit : sql->result_rows->len);
+}
+/*
+ * A leaf scan walking its index backwards returns rows with equal keys in
+ * reverse table order.  Read the first limit rows, and the rest of the
+ * last key's rows, then turn each run of equal keys back round.
+ */
+static void
+mdb_sql_collect_reversed(MdbSQL *sql, long limit)
+{
+	MdbTableDef *table = sql->cur_table;
+	GPtrArray *rows;
+	MdbSQLRow *row;
+	gpointer swap;
+	unsigned int i, j, k;
+
+	sql->result_rows = rows = g_ptr_array_new();
+	while (mdb_fetch_row(table)) {
+		row = mdb_sql_capture_row(sql);
+		if (rows->len >= (unsigned long)limit &&
+		    mdb_sql_compare_rows(sql, g_ptr_array_index(rows, rows->len - 1), row)) {
+			mdb_sql_free_row(sql, row);
+			break;
+		}
+		g_ptr_array_add(rows, row);
+	}
+	for (i = 0; i < rows->len; i = j) {
+		for (j = i + 1; j < rows->len &&
+		     !mdb_sql_compare_rows(sql, rows->pdata[i], rows->pdata[j]); j++)
+			;
+		for (k = 0; k < (j - i) / 2; k++) {
+			swap = rows->pdata[i + k];
+			rows->pdata[i + k] = rows->pdata[j - 1 - k];
+			rows->pdata[j - 1 - k] = swap;
+		}
+	}
+	for (i = limit; i < rows->len; i++)
+		mdb_sql_free_row(sql, g_ptr_array_index(rows, i));
+	if ((unsigned long)limit < rows->len)
+		rows->len = limit;
+}
+/* count or sort the rows up front when the statement needs it */
+static void
+mdb_sql_start_scan(MdbSQL *sql, int ordered, long limit)
+{
+	MdbTableDef *table = sql->cur_table;
+	MdbSQLColumn *sqlcol;
+	MdbSQLRow *row;
+	unsigned int i;
+	long count = 0;
+
+	if (sql->sel_count) {
+		while (mdb_fetch_row(table))
+			count++;
+		sql->result_rows = g_ptr_array_new();
+		row = g_malloc0(sizeof(MdbSQLRow));
+		row->values = g_malloc(sizeof(char *));
+		row->values[0] = g_strdup_printf("%ld", count);
+		g_ptr_array_add(sql->result_rows, row);
+	} else if (sql->order_by->len && !ordered && limit != 0) {
+		mdb_sql_materialize(sql, limit);
+	} else if (ordered && table->chain && table->chain->reverse && limit != 0) {
+		mdb_sql_collect_reversed(sql, limit);
+	}
+
+	/* COUNT(*) has no table column to write through */
+	if (sql->result_rows) {
+		for (i = 0; i < sql->num_columns; i++) {
+			sqlcol = g_ptr_array_index(sql->columns, i);
+			if (sqlcol->bind_addr)
+				((char *)sqlcol->bind_addr)[0] = '\0';
+		}
+	}
+}
+
+/* EXPLAIN */
+
+static const char *mdb_sql_ops[] = { "", "OR", "AND", "NOT", "=", ">", "<", ">=",
+	"<=", "LIKE", "IS NULL", "IS NOT NULL", "ILIKE", "<>" };
+
+/*
+ * An EXPLAIN statement returns its plan, one line per row, in place of the
+ * selected columns.  The table's columns stay bound, so ANALYZE formats
+ * every value just as the query itself would.
+ */
+static void
+mdb_sql_explain_columns(MdbSQL *sql)
+{
+	MdbSQLColumn *c;
+	void *bound_value;
+	unsigned int i;
+
+	for (i = 0; i < sql->columns->len; i++) {
+		c = g_ptr_array_index(sql->columns, i);
+		g_free(c->name);
+		g_free(c);
+	}
+	sql->columns->len = 0;
+	sql->num_columns = 0;
+	mdb_sql_add_column(sql, "Plan");
+	bound_value = g_malloc0(sql->mdb->bind_size);
+	g_ptr_array_add(sql->bound_values, bound_value);
+	mdb_sql_bind_column(sql, 1, bound_value, NULL);
+}
+/* join two strings with sep, freeing the first */
+static char *
+mdb_sql_join(char *text, const char *sep, const char *more)
+{
+	char *joined;
+
+	if (!text)
+		return g_strdup(more);
+	joined = g_strconcat(text, sep, more, NULL);
+	g_free(text);
+	return joined;
+}
+/* a WHERE term as text, parenthesized where the grouping is not implied */
+static char *
+mdb_sql_node_text(MdbSargNode *node, int parent_op)
+{
+	const char *fmt, *name;
+	char *left, *right, *text;
+
+	if (node->op == MDB_AND || node->op == MDB_OR) {
+		left = mdb_sql_node_text(node->left, node->op);
+		right = mdb_sql_node_text(node->right, node->op);
+		fmt = parent_op && parent_op != node->op ? "(%s %s %s)" : "%s %s %s";
+		text = g_strdup_printf(fmt, left, mdb_sql_ops[node->op], right);
+		g_free(left);
+		g_free(right);
+		return text;
+	}
+	if (node->op == MDB_NOT) {
+		left = mdb_sql_node_text(node->left, node->op);
+		text = g_strdup_printf("NOT %s", left);
+		g_free(left);
+		return text;
+	}
+	if (!mdb_is_relational_op(node->op))
+		return g_strdup("?");
+	name = node->col ? node->col->name : "(const)";
+	if (node->op == MDB_ISNULL || node->op == MDB_NOTNULL)
+		return g_strdup_printf("%s %s", name, mdb_sql_ops[node->op]);
+	if (!node->val_type)
+		return g_strdup_printf("%s %s ?", name, mdb_sql_ops[node->op]);
+	if (node->val_type == MDB_INT)
+		return g_strdup_printf("%s %s %d", name, mdb_sql_ops[node->op], node->value.i);
+	if (node->val_type == MDB_DOUBLE)
+		return g_strdup_printf("%s %s %g", name, mdb_sql_ops[node->op], node->value.d);
+	return g_strdup_printf("%s %s '%s'", name, mdb_sql_ops[node->op], node->value.s);
+}
+/* the terms ANDed from the root on the index's key columns, which bound
+ * the index scan the way mdb_find_indexable_sargs() reads them */
+static char *
+mdb_sql_key_range(MdbSargNode *node, MdbTableDef *table, MdbIndex *idx, char *text)
+{
+	char *term;
+	unsigned int i;
+
+	if (node->op == MDB_AND) {
+		text = mdb_sql_key_range(node->left, table, idx, text);
+		return mdb_sql_key_range(node->right, table, idx, text);
+	}
+	if (!mdb_is_relational_op(node->op) || !node->col)
+		return text;
+	for (i = 0; i < idx->num_keys; i++) {
+		if (g_ptr_array_index(table->columns, idx->key_col_num[i]-1) == node->col) {
+			term = mdb_sql_node_text(node, MDB_AND);
+			text = mdb_sql_join(text, " AND ", term);
+			g_free(term);
+			break;
+		}
+	}
+	return text;
+}
+static char *
+mdb_sql_index_text(MdbTableDef *table, MdbIndex *idx)
+{
+	MdbColumn *col;
+	char *keys = NULL;
+	unsigned int i;
+
+	for (i = 0; i < idx->num_keys; i++) {
+		col = g_ptr_array_index(table->columns, idx->key_col_num[i]-1);
+		keys = mdb_sql_join(keys, ", ", col->name);
+	}
+	return g_strdup_printf("%s (%s)", idx->name, keys ? keys : "");
+}
+/* the plan mdb_sql_execute() settled on, one line per entry */
+static GPtrArray *
+mdb_sql_plan(MdbSQL *sql, int ordered, long limit)
+{
+	MdbTableDef *table = sql->cur_table;
+	MdbSQLOrder *order;
+	GPtrArray *lines = g_ptr_array_new();
+	char *text = NULL, *range;
+	unsigned int i;
+
+	g_ptr_array_add(lines, g_strdup_printf("Table: %s, %u rows", table->name, table->num_rows));
+	if (table->strategy == MDB_INDEX_SCAN) {
+		text = mdb_sql_index_text(table, table->scan_idx);
+		range = mdb_sql_key_range(sql->sarg_tree, table, table->scan_idx, NULL);
+		g_ptr_array_add(lines, g_strdup_printf("Index scan: %s", text));
+		g_ptr_array_add(lines, g_strdup_printf("Key range: %s", range ? range : "all"));
+		g_free(range);
+	} else if (table->strategy == MDB_LEAF_SCAN) {
+		text = mdb_sql_index_text(table, table->scan_idx);
+		g_ptr_array_add(lines, g_strdup_printf("Index order scan: %s%s", text,
+			table->chain->reverse ? ", last to first" : ""));
+	} else if (table->num_idxs && !mdb_get_option(MDB_USE_INDEX)) {
+		g_ptr_array_add(lines, g_strdup("Table scan (indexes are off, see MDB_USE_INDEX)"));
+	} else {
+		g_ptr_array_add(lines, g_strdup("Table scan"));
+	}
+	g_free(text);
+
+	/* index scans still test the whole WHERE clause on every row */
+	text = sql->sarg_tree ? mdb_sql_node_text(sql->sarg_tree, 0) : NULL;
+	g_ptr_array_add(lines, g_strdup_printf("Filter: %s", text ? text : "none"));
+	g_free(text);
+	text = NULL;
+
+	if (sql->sel_count)
+		g_ptr_array_add(lines, g_strdup("Aggregate: COUNT(*)"));
+	for (i = 0; i < sql->order_by->len; i++) {
+		order = g_ptr_array_index(sql->order_by, i);
+		text = mdb_sql_join(text, ", ", order->col->name);
+		if (order->desc)
+			text = mdb_sql_join(text, " ", "DESC");
+	}
+	if (text && ordered)
+		g_ptr_array_add(lines, g_strdup_printf("Order: %s, from the index", text));
+	else if (text && mdb_sql_top_n(limit))
+		g_ptr_array_add(lines, g_strdup_printf("Order: %s, sorted keeping the first %ld rows", text, limit));
+	else if (text)
+		g_ptr_array_add(lines, g_strdup_printf("Order: %s, sorted in memory", text));
+	g_free(text);
+	if (limit >= 0)
+		g_ptr_array_add(lines, g_strdup_printf("Limit: %ld", limit));
+	return lines;
+}
+/*
+ * Replace the statement's result with its plan.  For ANALYZE the query is
+ * run to the end first, with statistics collected on the handle, and what
+ * it did is added to the plan.
+ */
+static void
+mdb_sql_explain(MdbSQL *sql, int ordered, long limit)
+{
+	MdbHandle *mdb = sql->mdb;
+	MdbStatistics before;
+	MdbSQLRow *row;
+	GPtrArray *lines;
+	gboolean collecting;
+	long returned = 0;
+	unsigned int i;
+	double start;
+
+	lines = mdb_sql_plan(sql, ordered, limit);
+	if (sql->explain == MDB_SQL_ANALYZE) {
+		collecting = mdb->stats && mdb->stats->collect;
+		mdb_stats_on(mdb);
+		before = *mdb->stats;
+
+		start = mdb_sql_now_ms();
+		mdb_sql_start_scan(sql, ordered, limit);
+		sql->profile.scan_ms = mdb_sql_now_ms() - start - sql->profile.sort_ms;
+		start = mdb_sql_now_ms();
+		while ((limit < 0 || returned < limit) && mdb_sql_fetch_row(sql, sql->cur_table))
+			returned++;
+		sql->profile.fetch_ms = mdb_sql_now_ms() - start;
+		if (!collecting)
+			mdb_stats_off(mdb);
+		mdb_sql_free_result(sql);
+
+		g_ptr_array_add(lines, g_strdup_printf("Rows: %lu visited, %lu filtered, %ld returned",
+			mdb->stats->rows_visited - before.rows_visited,
+			mdb->stats->rows_filtered - before.rows_filtered, returned));
+		g_ptr_array_add(lines, g_strdup_printf("Data pages: %lu read, %lu already loaded",
+			mdb->stats->pg_reads - before.pg_reads, mdb->stats->pg_hits - before.pg_hits));
+		g_ptr_array_add(lines, g_strdup_printf("Time: plan %.3f ms, scan %.3f ms, sort %.3f ms, fetch %.3f ms",
+			sql->profile.plan_ms, sql->profile.scan_ms, sql->profile.sort_ms, sql->profile.fetch_ms));
+	}
+
+	sql->result_rows = g_ptr_array_new();
+	for (i = 0; i < lines->len; i++) {
+		row = g_malloc0(sizeof(MdbSQLRow));
+		row->values = g_malloc(sizeof(char *));
+		row->values[0] = g_ptr_array_index(lines, i);
+		row->str_keys = g_malloc0(sql->order_by->len * sizeof(char *) + 1);
+		g_ptr_array_add(sql->result_rows, row);
+	}
+	g_ptr_array_free(lines, TRUE);
+	sql->row_count = 0;
+}
+/**
+ * mdb_sql_prepare:
+ * @sql: statement handle with an open database
+ * @querystr: query text, optionally with '?' placeholders
+ *
+ * Parses and binds @querystr without running it.  Bind any parameters
+ * with mdb_sql_bind_param(), then call mdb_sql_execute(); both may be
+ * repeated to rerun the statement.
+ *
+ * Return value: 0 on success, 1 with the error in sql->error_msg.
+ */
+int
+mdb_sql_prepare(MdbSQL *sql, const gchar *querystr)
+{
+	mdb_sql_reset(sql);
+
+	if (!sql->mdb) {
+		mdb_sql_error(sql, "You must connect to a database first");
+		return 1;
+	}
+	if (parse_sql(sql, querystr))
+		return 1;
+	if (sql->sarg_stack && sql->sarg_stack->next) {
+		mdb_sql_error(sql, "Syntax error in WHERE clause");
+		return 1;
+	}
+
+	switch (sql->stmt_type) {
+		case MDB_SQL_SELECT:
+			mdb_sql_select(sql);
+			if (sql->explain && !mdb_sql_has_error(sql))
+				mdb_sql_explain_columns(sql);
+			break;
+		case MDB_SQL_LIST_TABLES:
+			mdb_sql_listtables(sql);
+			mdb_sql_bind_all(sql);
+			break;
+		case MDB_SQL_DESCRIBE:
+			mdb_sql_describe_table(sql);
+			if (!mdb_sql_has_error(sql))
+				mdb_sql_bind_all(sql);
+			break;
+	}
+	if (mdb_sql_has_error(sql))
+		return 1;
+	sql->prepared = 1;
+	return 0;
+}
+int
+mdb_sql_num_params(MdbSQL *sql)
+{
+	return sql->params->len;
+}
+/**
+ * mdb_sql_bind_param:
+ * @sql: prepared statement
+ * @param: 1-based position of the '?' in the query
+ * @value: value as text; converted to the type of the column it is
+ *   compared with
+ *
+ * Return value: 0 on success, 1 with the error in sql->error_msg.
+ */
+int
+mdb_sql_bind_param(MdbSQL *sql, int param, const char *value)
+{
+	MdbSargNode *node;
+
+	if (param <= 0 || param > (int)sql->params->len) {
+		mdb_sql_error(sql, "Parameter %d out of range", param);
+		return 1;
+	}
+	if (!value) {
+		mdb_sql_error(sql, "Parameter %d: use IS NULL to test for nulls", param);
+		return 1;
+	}
+	node = g_ptr_array_index(sql->params, param - 1);
+	mdb_sql_set_node_text(node, value);
+	if (node->col && mdb_sql_coerce_node(sql, node)) {
+		node->val_type = 0;
+		return 1;
+	}
+	return 0;
+}
+/**
+ * mdb_sql_execute:
+ * @sql: prepared statement with every parameter bound
+ *
+ * Starts (or restarts) the statement; read the rows with
+ * mdb_sql_fetch_row().
+ *
+ * Return value: 0 on success, 1 with the error in sql->error_msg.
+ */
+int
+mdb_sql_execute(MdbSQL *sql)
+{
+	MdbTableDef *table = sql->cur_table;
+	MdbSargNode *node;
+	MdbSQLOrder *order;
+	unsigned int i;
+	long limit;
+	int ordered = 0;
+	double start;
+
+	if (!sql->prepared) {
+		mdb_sql_error(sql, "Statement is not prepared");
+		return 1;
+	}
+	for (i = 0; i < sql->params->len; i++) {
+		node = g_ptr_array_index(sql->params, i);
+		if (!node->val_type) {
+			mdb_sql_error(sql, "Parameter %d is not bound", i + 1);
+			return 1;
+		}
+	}
+	sql->error_msg[0] = '\0';
+	sql->row_count = 0;
+	mdb_sql_free_result(sql);
+	memset(&sql->profile, 0, sizeof(sql->profile));
+	start = sql->explain ? mdb_sql_now_ms() : 0;
+
+	/* rebuild the per-column sargs the index chooser reads */
+	if (!table->is_temp_table) {
+		mdb_index_scan_free(table);
+		table->strategy = MDB_TABLE_SCAN;
+		mdb_sql_clear_col_sargs(table);
+		if (sql->sarg_tree) {
+			mdb_sql_walk_tree(sql->sarg_tree, mdb_find_indexable_sargs, NULL);
+			mdb_index_scan_init(sql->mdb, table);
+		}
+	}
+	/* with a limit, an index that already gives the order lets the scan
+	 * stop after the first rows instead of reading and sorting them all */
+	limit = mdb_sql_row_limit(sql, table);
+	if (limit >= 0 && !sql->sel_count && sql->order_by->len == 1) {
+		order = g_ptr_array_index(sql->order_by, 0);
+		ordered = mdb_index_leaf_scan_init(sql->mdb, table, order->col, order->desc);
+	}
+	mdb_rewind_table(table);
+
+	if (sql->explain) {
+		sql->profile.plan_ms = mdb_sql_now_ms() - start;
+		mdb_sql_explain(sql, ordered, limit);
+	} else {
+		mdb_sql_start_scan(sql, ordered, limit);
+	}
+	return 0;
+}
+MdbSQL *
+mdb_sql_run_query(MdbSQL *sql, const gchar *querystr)
+{
+	if (!mdb_sql_prepare(sql, querystr) && sql->params->len)
+		mdb_sql_error(sql, "Query has parameters; use mdb_sql_prepare()");
+	if (!mdb_sql_has_error(sql))
+		mdb_sql_execute(sql);
+	return sql;
+}
+/**
+ * mdb_sql_fetch_row:
+ * @sql: executed statement
+ * @table: sql->cur_table
+ *
+ * Advances to the next result row and stores its values in the bound
+ * buffers (sql->bound_values, or those given to mdb_sql_bind_column()).
+ *
+ * Return value: 1 if a row was fetched, 0 at the end of the result.
+ */
+int
+mdb_sql_fetch_row(MdbSQL *sql, MdbTableDef *table)
+{
+	MdbSQLColumn *sqlcol;
+	MdbSQLRow *row;
+	long limit = sql->explain ? -1 : mdb_sql_row_limit(sql, table);
+	unsigned int i;
+
+	if (limit >= 0 && sql->row_count >= limit)
+		return 0;
+
+	if (sql->result_rows) {
+		if (sql->result_pos >= sql->result_rows->len)
+			return 0;
+		row = g_ptr_array_index(sql->result_rows, sql->result_pos++);
+		for (i = 0; i < sql->num_columns; i++) {
+			sqlcol = g_ptr_array_index(sql->columns, i);
+			if (!sqlcol->bind_addr)
+				continue;
+			snprintf(sqlcol->bind_addr, sql->mdb->bind_size, "%s", row->values[i]);
+			if (sqlcol->bind_len)
+				*sqlcol->bind_len = strlen(sqlcol->bind_addr);
+		}
+	} else if (!mdb_fetch_row(table)) {
+		return 0;
+	}
+	sql->row_count++;
+	return 1;
+}
+
+/* Teardown */
+
+void
+mdb_sql_reset(MdbSQL *sql)
+{
+	unsigned int i;
+	MdbSQLColumn *c;
+	MdbSQLTable *t;
+	MdbSQLOrder *o;
+
+	mdb_sql_free_result(sql);
+	if (sql->cur_table) {
+		/* the bound buffers are freed below */
+		for (i = 0; i < sql->cur_table->num_cols; i++) {
+			MdbColumn *col = g_ptr_array_index(sql->cur_table->columns, i);
+			col->bind_ptr = NULL;
+			col->len_ptr = NULL;
+		}
+		sql->cur_table->sarg_tree = NULL;
+		if (!sql->cur_table->is_temp_table) {
+			mdb_index_scan_free(sql->cur_table);
+			mdb_sql_clear_col_sargs(sql->cur_table);
+		}
+		mdb_free_tabledef(sql->cur_table);
+		sql->cur_table = NULL;
+	}
+	mdb_sql_unbind_all(sql);
+
+	for (i = 0; i < sql->columns->len; i++) {
+		c = g_ptr_array_index(sql->columns, i);
+		g_free(c->name);
+		g_free(c);
+	}
+	sql->columns->len = 0;
+	sql->num_columns = 0;
+	for (i = 0; i < sql->tables->len; i++) {
+		t = g_ptr_array_index(sql->tables, i);
+		g_free(t->name);
+		g_free(t->alias);
+		g_free(t);
+	}
+	sql->tables->len = 0;
+	sql->num_tables = 0;
+	for (i = 0; i < sql->order_by->len; i++) {
+		o = g_ptr_array_index(sql->order_by, i);
+		g_free(o->col_name);
+		g_free(o);
+	}
+	sql->order_by->len = 0;
+
+	/* the params point into the tree */
+	sql->params->len = 0;
+	if (sql->sarg_tree) {
+		mdb_sql_free_tree(sql->sarg_tree);
+		sql->sarg_tree = NULL;
+	}
+	g_list_free(sql->sarg_stack);
+	sql->sarg_stack = NULL;
+
+	sql->all_columns = 0;
+	sql->sel_count = 0;
+	sql->stmt_type = 0;
+	sql->prepared = 0;
+	sql->limit = -1;
+	sql->limit_percent = 0;
+	sql->row_count = 0;
+	sql->explain = 0;
+	memset(&sql->profile, 0, sizeof(sql->profile));
+	sql->error_msg[0] = '\0';
+}
+void
+mdb_sql_close(MdbSQL *sql)
+{
+	if (sql->mdb) {
+		mdb_close(sql->mdb);
+		sql->mdb = NULL;
+	}
+}
+void
+mdb_sql_exit(MdbSQL *sql)
+{
+	mdb_sql_reset(sql);
+	mdb_sql_close(sql);
+	g_ptr_array_free(sql->columns, TRUE);
+	g_ptr_array_free(sql->tables, TRUE);
+	g_ptr_array_free(sql->bound_values, TRUE);
+	g_ptr_array_free(sql->order_by, TRUE);
+	g_ptr_array_free(sql->params, TRUE);
+	g_free(sql);
+}
+
+/* Debugging */
+
+void
+mdb_sql_dump_node(MdbSargNode *node, int level)
+{
+	int i;
+
+	for (i = 0; i < level; i++)
+		printf("--");
+	printf(">%s", node->op >= 1 && node->op <= MDB_NEQ ? mdb_sql_ops[node->op] : "?");
+	if (mdb_is_relational_op(node->op)) {
+		printf(" %s", node->col ? node->col->name : node->parent ? (char *)node->parent : "(const)");
+		if (!node->val_type)
+			printf(" ?");
+		else if (node->val_type == MDB_INT)
+			printf(" %d", node->value.i);
+		else if (node->val_type == MDB_DOUBLE)
+			printf(" %f", node->value.d);
+		else
+			printf(" '%s'", node->value.s);
+	}
+	printf("\n");
+	if (node->left)
+		mdb_sql_dump_node(node->left, level + 1);
+	if (node->right)
+		mdb_sql_dump_node(node->right, level + 1);
+}
+void
+mdb_sql_dump(MdbSQL *sql)
+{
+	unsigned int i;
+	MdbSQLColumn *c;
+	MdbSQLTable *t;
+	MdbSQLOrder *o;
+
+	for (i = 0; i < sql->num_columns; i++) {
+		c = g_ptr_array_index(sql->columns, i);
+		printf("column = %s\n", c->name);
+	}
+	for (i = 0; i < sql->num_tables; i++) {
+		t = g_ptr_array_index(sql->tables, i);
+		printf("table = %s\n", t->name);
+	}
+	if (sql->sarg_tree) {
+		printf("sargs:\n");
+		mdb_sql_dump_node(sql->sarg_tree, 0);
+	}
+	for (i = 0; i < sql->order_by->len; i++) {
+		o = g_ptr_array_index(sql->order_by, i);
+		printf("order by = %s%s\n", o->col_name, o->desc ? " desc" : "");
+	}
+	if (sql->limit >= 0)
+		printf("limit = %d%s\n", sql->limit, sql->limit_percent ? "%" : "");
+}
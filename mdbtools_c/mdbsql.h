@@ -27,6 +27,26 @@
 #include <string.h>
 #include <mdbtools.h>
 
+enum {
+	MDB_SQL_SELECT = 1,
+	MDB_SQL_LIST_TABLES,
+	MDB_SQL_DESCRIBE
+};
+
+/* MdbSQL.explain */
+enum {
+	MDB_SQL_EXPLAIN = 1,	/* describe the plan */
+	MDB_SQL_ANALYZE		/* run the query and measure it too */
+};
+
+/* time EXPLAIN ANALYZE spent in each stage, in milliseconds */
+typedef struct {
+	double plan_ms;
+	double scan_ms;
+	double sort_ms;
+	double fetch_ms;
+} MdbSQLProfile;
+
 typedef struct MdbSQL
 {
 	MdbHandle *mdb;
@@ -46,6 +66,14 @@ typedef struct MdbSQL
 	int limit;
 	int limit_percent;
 	long row_count;
+	int stmt_type;
+	int prepared;
+	GPtrArray *order_by;
+	GPtrArray *params;	/* MdbSargNode for each '?', in query order */
+	GPtrArray *result_rows;	/* materialized for ORDER BY and COUNT(*) */
+	unsigned int result_pos;
+	int explain;		/* MDB_SQL_EXPLAIN or MDB_SQL_ANALYZE, else 0 */
+	MdbSQLProfile profile;
 } MdbSQL;
 
 typedef struct {
@@ -67,6 +95,12 @@ typedef struct {
 	MdbSarg *sarg;
 } MdbSQLSarg;
 
+typedef struct {
+	char *col_name;
+	MdbColumn *col;
+	int desc;
+} MdbSQLOrder;
+
 #define mdb_sql_has_error(sql) ((sql)->error_msg[0] ? 1 : 0)
 #define mdb_sql_last_error(sql) ((sql)->error_msg)
 
@@ -102,6 +136,11 @@ int mdb_sql_add_temp_col(MdbSQL *sql, MdbTableDef *ttable, int col_num, char *na
 int mdb_sql_bind_column(MdbSQL *sql, int colnum, void *varaddr, int *len_ptr);
 int mdb_sql_add_limit(MdbSQL *sql, char *limit, int percent);
 int mdb_sql_get_limit(MdbSQL *sql);
+int mdb_sql_add_order(MdbSQL *sql, char *col_name, int desc);
+int mdb_sql_prepare(MdbSQL *sql, const gchar *querystr);
+int mdb_sql_num_params(MdbSQL *sql);
+int mdb_sql_bind_param(MdbSQL *sql, int param, const char *value);
+int mdb_sql_execute(MdbSQL *sql);
 
 int parse_sql(MdbSQL * mdb, const gchar* str);
 
@@ -36,6 +36,15 @@ int mdb_get_option(unsigned long optnum)
     return (mdb_options & optnum) ? 1 : 0;
 }
 
+/* Turn options on or off; set them before opening handles that use them */
+void mdb_set_option(unsigned long optnum, int on)
+{
+    if (on)
+        mdb_options |= optnum;
+    else
+        mdb_options &= ~optnum;
+}
+
 /* Buffer dump for debugging - minimal implementation */
 void mdb_buffer_dump(const void *buf, off_t start, size_t len)
 {
@@ -31,6 +31,7 @@
 #include <ctype.h>
 #include <string.h>
 #include <locale.h>
+#include <pthread.h>
 #include "mdbfakeglib.h"  /* Use mdbfakeglib instead of glib for iOS */
 
 #if MDBTOOLS_H_HAVE_ICONV_H
@@ -63,6 +64,10 @@
 #define MDB_CATALOG_PG 18
 #define MDB_MEMO_OVERHEAD 12
 #define MDB_BIND_SIZE 16384 // override with mdb_set_bind_size(MdbHandle*, size_t)
+#define MDB_EXPORT_BUF_SIZE (256*1024)
+#define MDB_BATCH_ROWS 1024
+#define MDB_TEMP_MEM_BUDGET (4*1024*1024) // override with mdb_temp_table_set_budget()
+#define MDB_RESULT_CACHE_BUDGET (8*1024*1024) // override with mdb_result_cache_set_budget()
 
 // This attribute is not supported by all compilers:
 // M$VC see http://stackoverflow.com/questions/1113409/attribute-constructor-equivalent-in-vc
@@ -166,6 +171,52 @@ enum {
 	MDB_NO_MEMO = 0x0080, /* don't follow memo fields */
 };
 
+/* engine log (log.c); levels from most to least severe */
+typedef enum {
+	MDB_LOG_ERROR = 0,
+	MDB_LOG_WARN,
+	MDB_LOG_INFO,
+	MDB_LOG_DEBUG,
+	MDB_LOG_TRACE
+} MdbLogLevel;
+
+typedef enum {
+	MDB_LOG_FILE = 0,	/* page I/O */
+	MDB_LOG_DATA,		/* row decoding */
+	MDB_LOG_INDEX,
+	MDB_LOG_WRITE,		/* row and page writes */
+	MDB_LOG_SQL,
+	MDB_LOG_SYNC,		/* the app's sync and Money file writer */
+	MDB_LOG_NCATS
+} MdbLogCategory;
+
+/* most detailed level built in; statements above it compile to nothing */
+#ifndef MDB_LOG_MAX_LEVEL
+#ifdef DEBUG
+#define MDB_LOG_MAX_LEVEL MDB_LOG_TRACE
+#else
+#define MDB_LOG_MAX_LEVEL MDB_LOG_INFO
+#endif
+#endif
+
+#define MDB_LOG_MSG_SIZE 160
+
+typedef struct {
+	guint64 seq;		/* line number since start */
+	gint64 usec;		/* time, since 1970 */
+	MdbLogCategory cat;
+	MdbLogLevel level;
+	char msg[MDB_LOG_MSG_SIZE];
+} MdbLogRecord;
+
+extern unsigned char mdb_log_levels[MDB_LOG_NCATS];
+
+#define mdb_log(cat, level, ...) do { \
+	if ((level) <= MDB_LOG_MAX_LEVEL \
+	 && (level) <= __atomic_load_n(&mdb_log_levels[cat], __ATOMIC_RELAXED)) \
+		mdb_log_write(cat, level, __VA_ARGS__); \
+} while (0)
+
 typedef enum {
     MDB_BRACES_4_2_2_8, /* "{XXXX-XX-XX-XXXXXXXX}" format */
     MDB_NOBRACES_4_2_2_2_6, /* "XXXX-XX-XX-XX-XXXXXX" format (matches MS Access ODBC driver) */
@@ -260,10 +311,24 @@ typedef struct {
 typedef struct {
 	gboolean collect;
 	unsigned long pg_reads;
+	unsigned long pg_hits;		/* mdb_read_pg() found the page already loaded */
+	unsigned long rows_visited;	/* live rows cracked by mdb_fetch_row() */
+	unsigned long rows_filtered;	/* of those, rows the sargs rejected */
 } MdbStatistics;
 
+/*
+ * Threading model.  An MdbFile is the open database shared by every
+ * handle cloned from it: after mdb_open() returns it is read-only apart
+ * from the reference count, which is atomic, and page I/O, which is
+ * positional (or serialized on lock for memory streams).  An MdbHandle is
+ * a cursor holding the page buffers, position and catalog copy, and must
+ * only be used by one thread at a time.  To read from several threads,
+ * give each one its own mdb_clone_handle() of the same database.
+ */
 typedef struct {
 	FILE        *stream;
+	int          fd;	/* -1 for memory streams */
+	pthread_mutex_t lock;	/* guards stream when fd is -1 */
 	gboolean      writable;
 	guint32		jet_version;
 	guint32		db_key;
@@ -272,10 +337,19 @@ typedef struct {
 	/* free map */
 	int  map_sz;
 	unsigned char *free_map;
-	/* reference count */
+	/* reference count, updated with __atomic builtins */
 	int refs;
 	guint16 code_page;
 	guint16 lang_id;
+	/* snapshots (snapshot.c) */
+	pthread_rwlock_t snap_lock;	/* guards the fields below */
+	guint64 version;	/* of the last commit */
+	guint64 write_version;	/* of the open write, 0 if none */
+	guint64 *pins;		/* versions pinned by handles */
+	unsigned int num_pins;
+	struct MdbPageImage *images;	/* old page bytes, by page then version */
+	unsigned int num_images;
+	unsigned int images_size;
 } MdbFile; 
 
 /* offset to row count on data pages...version dependant */
@@ -307,6 +381,7 @@ typedef struct {
 	guint32       cur_pg;
 	guint16       row_num;
 	unsigned int  cur_pos;
+	guint64       snapshot;	/* version pinned by mdb_snapshot_pin(), 0 if none */
 	unsigned char pg_buf[MDB_PGSIZE];
 	unsigned char alt_pg_buf[MDB_PGSIZE];
 	MdbFormatConstants *fmt;
@@ -349,10 +424,17 @@ typedef struct {
 	GHashTable	*hash;
 } MdbProperties;
 
-typedef union {
-	int	i;
-	double	d;
-	char	s[256];
+/* A sarg constant, typed by the node's val_type: integers and doubles
+ * (money and dates included) are held inline, text in its own copy with
+ * the length kept alongside.  Use mdb_any_set_text() and mdb_any_clear()
+ * so s is always owned by the node or sarg holding it. */
+typedef struct {
+	union {
+		int	i;
+		double	d;
+	};
+	char	*s;		/* NUL terminated, or NULL */
+	unsigned int	len;	/* strlen(s) */
 } MdbAny;
 
 struct S_MdbTableDef; /* forward definition */
@@ -374,6 +456,8 @@ typedef struct {
 	int		col_num;	
 	int		cur_value_start;
 	int 		cur_value_len;
+	/* set by mdb_read_row(); bools are never null */
+	unsigned char	cur_value_null;
 	/* MEMO/OLE readers */
 	guint32		cur_blob_pg_row;
 	int		chunk_size;
@@ -407,19 +491,68 @@ typedef struct {
 	int offset;
 	int len;
 	int rc;
-	guint16 idx_starts[2000];	
-	unsigned char cache_value[256];
+	/* entry start offsets, unpacked from the page bitmap on first use and
+	 * zero terminated; num_starts is 0 until then.  Both buffers are kept
+	 * across resets and only grow. */
+	guint16 *idx_starts;
+	unsigned int num_starts;
+	unsigned int starts_size;
+	unsigned char *cache_value;	/* key of the current entry */
+	unsigned int cache_size;
 } MdbIndexPage;
 
 typedef int (*MdbSargTreeFunc)(MdbSargNode *, gpointer data);
 
+/* Per-column step of a row decode plan, resolved from the MdbColumn when
+ * the columns are read so mdb_crack_row() doesn't look them up per row */
+typedef struct {
+	guint8	is_fixed;
+	guint8	null_bit;	/* 1 << (col_num % 8) */
+	guint16	null_byte;	/* col_num / 8 */
+	guint16	offset;		/* fixed: offset past the column count; else var_col_num */
+	guint16	size;		/* fixed columns only */
+	guint16	null_pos;	/* col_num, the row in MdbPageRows.validity */
+} MdbRowPlanCol;
+
+typedef struct {
+	int	jet3;
+	unsigned int	col_count_size;	/* bytes of column count at row start */
+	unsigned int	num_cols;
+	unsigned int	num_var_cols;
+	unsigned int	var_slots;	/* highest var_col_num + 1 */
+	unsigned int	mask_bytes;	/* null mask bytes covering every col_num */
+	MdbRowPlanCol	*cols;
+} MdbRowPlan;
+
+/* Every row slot of a data page decoded at once by mdb_crack_page(), so
+ * the row headers, null masks and offset tables are read in bulk rather
+ * than row by row.  A row_start of -1 marks a slot to skip. */
+typedef struct {
+	guint32	pg;		/* page decoded, for the caller's bookkeeping */
+	unsigned int	num_rows;
+	unsigned int	capacity;	/* row slots allocated */
+	unsigned int	mask_stride;	/* bytes per validity row: (capacity + 7) / 8 */
+	unsigned int	var_stride;	/* var_offsets entries per row slot */
+	int	*row_start;	/* without flags */
+	guint16	*row_size;
+	guint16	*row_cols;	/* column count in the row header */
+	guint16	*row_var_cols;	/* from the row header; offsets past var_slots aren't kept */
+	unsigned char	*validity;	/* per col_num, one bit per row slot; set = not null */
+	size_t	validity_size;
+	guint16	*var_offsets;	/* per row slot, offsets from the row start */
+	guint64	*selection;	/* bit per row slot passing the sargs, see mdb_filter_page() */
+	double	*scratch;	/* one value per row slot, for the filter kernels */
+} MdbPageRows;
+
 #define MDB_MAX_INDEX_DEPTH 10
 
 typedef struct {
 	int cur_depth;
 	guint32 last_leaf_found;
 	int clean_up_mode;
-	MdbIndexPage pages[MDB_MAX_INDEX_DEPTH];
+	int reverse;	/* MDB_LEAF_SCAN: walk the leaves last to first */
+	/* allocated as the traversal first reaches each depth */
+	MdbIndexPage *pages[MDB_MAX_INDEX_DEPTH];
 } MdbIndexChain;
 
 typedef struct S_MdbTableDef {
@@ -437,6 +570,7 @@ typedef struct S_MdbTableDef {
 	guint32	cur_phys_pg;
 	unsigned int    cur_row;
 	int  noskip_del;  /* don't skip deleted rows */
+	int  scan_done;  /* sequential scan ran past the last data page */
 	/* object allocation map */
 	guint32  map_base_pg;
 	size_t map_sz;
@@ -453,9 +587,15 @@ typedef struct S_MdbTableDef {
 	MdbIndexChain *chain;
 	MdbProperties	*props;
 	unsigned int num_var_cols;  /* to know if row has variable columns */
+	MdbRowPlan *row_plan;  /* built by mdb_build_row_plan() */
 	/* temp table */
 	unsigned int  is_temp_table;
-	GPtrArray     *temp_table_pages;
+	GPtrArray     *temp_table_pages;  /* NULL where a page was spilled */
+	size_t        temp_mem_budget;  /* bytes of pages kept in memory */
+	unsigned int  temp_mem_pages;
+	int           temp_spill_fd;  /* unlinked file of spilled pages, or -1 */
+	guint32       temp_cur_pg;  /* page last put in mdb->pg_buf ... */
+	guint32       temp_pg_token;  /* ... and the mdb->cur_pg it was given */
 } MdbTableDef;
 
 struct mdbindex {
@@ -490,6 +630,128 @@ typedef struct {
 	MdbAny	value;
 } MdbSarg;
 
+/* Columnar batch scan: values are decoded straight from the page into
+ * one typed vector per column instead of being formatted into bind
+ * buffers.  Validity and boolean bitmaps use one bit per row, LSB first,
+ * set meaning not null / true. */
+typedef enum {
+	MDB_BATCH_INT32,	/* BYTE, INT, LONGINT, COMPLEX */
+	MDB_BATCH_INT64,	/* MONEY, as an integer scaled by 10^scale */
+	MDB_BATCH_DOUBLE,	/* FLOAT, DOUBLE */
+	MDB_BATCH_BOOL,
+	MDB_BATCH_TIMESTAMP,	/* DATETIME, as int64 milliseconds since 1970 */
+	MDB_BATCH_STRING,	/* everything else, UTF-8 */
+	MDB_BATCH_BINARY	/* BINARY, OLE */
+} MdbBatchKind;
+
+typedef struct {
+	MdbColumn *col;
+	MdbBatchKind kind;
+	int scale;
+	unsigned char *validity;
+	void *values;		/* gint32, gint64, double or bitmap, by kind */
+	guint32 *offsets;	/* STRING/BINARY: num_rows+1 offsets into data */
+	char *data;
+	size_t data_len;
+	size_t data_size;
+	unsigned int null_count;
+} MdbBatchColumn;
+
+typedef struct {
+	MdbTableDef *table;
+	unsigned int capacity;
+	unsigned int num_rows;
+	unsigned int num_cols;
+	MdbBatchColumn *columns;
+	MdbField *fields;
+	char *scratch;
+	guint32 *pages;		/* data page each row was read from */
+	const guint32 *page_filter;	/* sorted; when set, only rows on these pages */
+	unsigned int num_page_filter;
+	MdbPageRows *page_rows;	/* sequential scans decode a page at a time */
+	int at_end;		/* the last fetch reached the end of the table */
+} MdbBatch;
+
+/* work-stealing task scheduler shared by all parallel operations (sched.c) */
+typedef struct MdbTaskGroup MdbTaskGroup;
+typedef void (*MdbTaskFunc)(void *arg);
+typedef void (*MdbRangeFunc)(unsigned int begin, unsigned int end, void *arg);
+
+/* asynchronous jobs run as scheduler tasks (async.c) */
+typedef struct MdbJob MdbJob;
+enum {
+	MDB_JOB_OK = 0,
+	MDB_JOB_FAILED = -1,
+	MDB_JOB_CANCELLED = -2
+};
+typedef int (*MdbJobFunc)(MdbJob *job, void *arg);
+typedef void (*MdbJobDoneFunc)(MdbJob *job, int status, void *user);
+typedef int (*MdbJobBatchFunc)(MdbJob *job, MdbBatch *batch, void *user);
+typedef int (*MdbJobRowFunc)(MdbJob *job, char **values, unsigned int num_values, void *user);
+
+/* query results kept column by column in the result cache (cache.c) */
+typedef struct MdbResult MdbResult;
+
+/* what a cached result's table is checked against */
+typedef struct {
+	guint64 stat;		/* file size, mtime and table definition; 0 if unknown */
+	guint64 contents;	/* mdb_table_fingerprint() */
+} MdbCacheStamp;
+
+/* prefix index over a name column (prefix.c) */
+typedef struct MdbPrefixIndex MdbPrefixIndex;
+
+typedef struct {
+	gint32 id;
+	unsigned int uses;
+	char *name;		/* a copy, see mdb_prefix_index_free_matches() */
+} MdbPrefixMatch;
+
+/* hierarchy of a table whose rows point at a parent row (tree.c) */
+typedef struct MdbTree MdbTree;
+
+typedef struct {
+	gint32 id;
+	gint32 parent_id;	/* as read; -1 when null */
+	int parent;		/* node number of the parent, -1 for a root */
+	int root;		/* node number of the top ancestor, itself for a root */
+	unsigned int depth;	/* 0 for a root */
+	const char *name;
+	const char *path;	/* names from the root down, joined by the separator */
+	const char *subpath;	/* the part of path below the root; "" for a root */
+	unsigned int first_child;	/* see mdb_tree_children() */
+	unsigned int num_children;
+	guint32 pg;		/* data page the row was read from */
+} MdbTreeNode;
+
+/* running balances of rows kept in (date, id) order per account (ledger.c) */
+typedef struct MdbLedger MdbLedger;
+
+typedef struct {
+	gint64 dt;
+	gint32 id;
+	gint64 amount;
+	gint64 balance;		/* sum of the amounts up to and including this row */
+} MdbLedgerEntry;
+
+/* Per-page checksum, to find the pages that changed between two scans */
+typedef struct {
+	guint32 pg;
+	guint32 sum;
+} MdbPageSum;
+
+/* Buffered output for the exporters; drained to fd with write(), or to
+ * stream with fwrite() when stream is set. */
+typedef struct {
+	int fd;
+	FILE *stream;
+	char *buf;
+	size_t len;
+	size_t size;
+	int owns_buf;
+	int error;
+} MdbExportWriter;
+
 /* version.c */
 const char *mdb_get_version(void);
 
@@ -511,8 +773,17 @@ MdbHandle *mdb_open(const char *filename, MdbFileFlags flags);
 MdbHandle *mdb_open_buffer(void *buffer, size_t len, MdbFileFlags flags);
 void mdb_close(MdbHandle *mdb);
 MdbHandle *mdb_clone_handle(MdbHandle *mdb);
+MdbHandle *mdb_open_cursor(MdbHandle *mdb);
+void mdb_close_cursor(MdbHandle *cursor);
 void mdb_swap_pgbuf(MdbHandle *mdb);
 
+/* snapshot.c */
+guint64 mdb_snapshot_pin(MdbHandle *mdb);
+void mdb_snapshot_release(MdbHandle *mdb);
+guint64 mdb_snapshot_latest(MdbHandle *mdb);
+int mdb_write_begin(MdbHandle *mdb);
+void mdb_write_commit(MdbHandle *mdb);
+
 /* catalog.c */
 void mdb_free_catalog(MdbHandle *mdb);
 GPtrArray *mdb_read_catalog(MdbHandle *mdb, int obj_type);
@@ -528,6 +799,8 @@ MdbTableDef *mdb_read_table_by_name(MdbHandle *mdb, gchar *table_name, int obj_t
 void mdb_append_column(GPtrArray *columns, MdbColumn *in_col);
 void mdb_free_columns(GPtrArray *columns);
 GPtrArray *mdb_read_columns(MdbTableDef *table);
+MdbRowPlan *mdb_build_row_plan(MdbTableDef *table);
+void mdb_free_row_plan(MdbTableDef *table);
 void mdb_table_dump(MdbCatalogEntry *entry);
 guint8 read_pg_if_8(MdbHandle *mdb, int *cur_pos);
 guint16 read_pg_if_16(MdbHandle *mdb, int *cur_pos);
@@ -567,6 +840,11 @@ void mdb_set_boolean_fmt_words(MdbHandle *mdb);
 void mdb_set_boolean_fmt_numbers(MdbHandle *mdb);
 int mdb_read_row(MdbTableDef *table, unsigned int row);
 int mdb_read_next_dpg(MdbTableDef *table);
+MdbBatch *mdb_alloc_batch(MdbTableDef *table, unsigned int capacity);
+void mdb_free_batch(MdbBatch *batch);
+int mdb_fetch_batch(MdbTableDef *table, MdbBatch *batch);
+unsigned int mdb_table_page_sums(MdbTableDef *table, MdbPageSum **sums);
+void mdb_free_page_sums(MdbPageSum *sums);
 
 /* money.c */
 char *mdb_money_to_string(MdbHandle *mdb, int start);
@@ -596,6 +874,100 @@ int  mdb_print_schema(MdbHandle *mdb, FILE *outfile, char *tabname, char *dbname
 void mdb_print_col(FILE *outfile, gchar *col_val, int quote_text, int col_type, int bin_len, char *quote_char, char *escape_char, int flags);
 gchar *mdb_normalise_and_replace(MdbHandle *mdb, gchar **str);
 
+/* export.c */
+MdbExportWriter *mdb_export_writer_new(int fd, size_t buf_size);
+void mdb_export_writer_init_stream(MdbExportWriter *w, FILE *stream, char *buf, size_t size);
+int mdb_export_writer_flush(MdbExportWriter *w);
+int mdb_export_writer_free(MdbExportWriter *w);
+void mdb_export_write(MdbExportWriter *w, const char *data, size_t len);
+void mdb_export_puts(MdbExportWriter *w, const char *str);
+void mdb_export_col(MdbExportWriter *w, const char *col_val, int quote_text, int col_type, int bin_len, const char *quote_char, const char *escape_char, int flags);
+long mdb_export_table(MdbTableDef *table, MdbExportWriter *w, const char *delimiter, const char *row_delimiter, const char *quote_char, const char *escape_char, int header_row, int flags);
+long mdb_export_table_sql(MdbTableDef *table, MdbExportWriter *w, const char *dbnamespace, int batch_size);
+
+/* arrow.c */
+long mdb_export_table_arrow(MdbTableDef *table, MdbExportWriter *w, unsigned int batch_rows);
+
+/* sched.c */
+int mdb_sched_start(unsigned int num_workers);
+void mdb_sched_stop(void);
+unsigned int mdb_sched_num_workers(void);
+MdbTaskGroup *mdb_task_group_new(void);
+void mdb_task_group_free(MdbTaskGroup *group);
+int mdb_task_spawn(MdbTaskGroup *group, MdbTaskFunc func, void *arg);
+void mdb_task_group_wait(MdbTaskGroup *group);
+void mdb_parallel_for(unsigned int begin, unsigned int end, unsigned int grain,
+	MdbRangeFunc func, void *arg);
+
+/* async.c */
+MdbJob *mdb_job_submit(MdbJobFunc func, void *arg, MdbJobDoneFunc done, void *user);
+MdbJob *mdb_job_scan_table(MdbHandle *mdb, const char *table_name, unsigned int batch_rows,
+	MdbJobBatchFunc on_batch, MdbJobDoneFunc done, void *user);
+MdbJob *mdb_job_query(MdbHandle *mdb, const char *query, MdbJobRowFunc on_row,
+	MdbJobDoneFunc done, void *user);
+void mdb_job_cancel(MdbJob *job);
+int mdb_job_cancelled(MdbJob *job);
+int mdb_job_wait(MdbJob *job);
+void mdb_job_release(MdbJob *job);
+
+/* cache.c */
+MdbResult *mdb_result_new(unsigned int num_cols);
+void mdb_result_unref(MdbResult *res);
+void mdb_result_append_row(MdbResult *res, char **values);
+unsigned int mdb_result_num_rows(MdbResult *res);
+unsigned int mdb_result_num_cols(MdbResult *res);
+const char *mdb_result_value(MdbResult *res, unsigned int row, unsigned int col);
+char *mdb_result_cache_key(MdbHandle *mdb, const char *query);
+MdbResult *mdb_result_cache_lookup(const char *key, MdbTableDef *table, MdbCacheStamp *stamp);
+void mdb_result_cache_insert(const char *key, MdbTableDef *table, const MdbCacheStamp *stamp, MdbResult *res);
+void mdb_result_cache_invalidate(MdbTableDef *table);
+void mdb_result_cache_set_budget(size_t bytes);
+void mdb_result_cache_clear(void);
+guint64 mdb_table_fingerprint(MdbTableDef *table);
+
+/* persist.c */
+FILE *mdb_persist_create(const char *path, const char *magic, const char *spec, char **tmp_path);
+int mdb_persist_commit(FILE *f, char *tmp_path, const char *path, int ok);
+FILE *mdb_persist_open(const char *path, const char *magic, const char *spec);
+int mdb_persist_write(FILE *f, const void *p, size_t len);
+int mdb_persist_write_str(FILE *f, const char *s);
+int mdb_persist_read(FILE *f, void *p, size_t len);
+char *mdb_persist_read_str(FILE *f);
+
+/* prefix.c */
+MdbPrefixIndex *mdb_prefix_index_new(MdbHandle *mdb, const char *table_name, const char *id_col,
+	const char *name_col, const char *ref_table, const char *ref_col);
+MdbPrefixIndex *mdb_prefix_index_open(MdbHandle *mdb, const char *table_name, const char *id_col,
+	const char *name_col, const char *ref_table, const char *ref_col, const char *path);
+void mdb_prefix_index_free(MdbPrefixIndex *idx);
+int mdb_prefix_index_save(MdbPrefixIndex *idx, const char *path);
+void mdb_prefix_index_add(MdbPrefixIndex *idx, gint32 id, const char *name);
+void mdb_prefix_index_use(MdbPrefixIndex *idx, gint32 id);
+unsigned int mdb_prefix_index_lookup(MdbPrefixIndex *idx, const char *prefix, MdbPrefixMatch *matches, unsigned int max);
+void mdb_prefix_index_free_matches(MdbPrefixMatch *matches, unsigned int count);
+unsigned int mdb_prefix_index_count(MdbPrefixIndex *idx);
+
+/* tree.c */
+MdbTree *mdb_tree_open(MdbHandle *mdb, const char *table_name, const char *id_col,
+	const char *parent_col, const char *name_col, const char *sep, const char *path);
+void mdb_tree_free(MdbTree *tree);
+int mdb_tree_save(MdbTree *tree, const char *path);
+unsigned int mdb_tree_num_nodes(MdbTree *tree);
+const MdbTreeNode *mdb_tree_node(MdbTree *tree, int n);
+int mdb_tree_find(MdbTree *tree, gint32 id);
+const guint32 *mdb_tree_children(MdbTree *tree, int n, unsigned int *count);
+
+/* ledger.c */
+MdbLedger *mdb_ledger_new(void);
+void mdb_ledger_free(MdbLedger *ledger);
+int mdb_ledger_insert(MdbLedger *ledger, gint32 acct, gint64 dt, gint32 id, gint64 amount);
+int mdb_ledger_remove(MdbLedger *ledger, gint32 acct, gint64 dt, gint32 id);
+unsigned int mdb_ledger_count(MdbLedger *ledger, gint32 acct);
+unsigned int mdb_ledger_rank(MdbLedger *ledger, gint32 acct, gint64 dt, gint32 id);
+gint64 mdb_ledger_balance(MdbLedger *ledger, gint32 acct, unsigned int n);
+unsigned int mdb_ledger_entries(MdbLedger *ledger, gint32 acct, unsigned int start,
+	MdbLedgerEntry *entries, unsigned int max);
+
 /* sargs.c */
 int mdb_test_sargs(MdbTableDef *table, MdbField *fields, int num_fields);
 int mdb_test_sarg(MdbHandle *mdb, MdbColumn *col, MdbSargNode *node, MdbField *field);
@@ -604,7 +976,12 @@ int mdb_find_indexable_sargs(MdbSargNode *node, gpointer data);
 int mdb_add_sarg_by_name(MdbTableDef *table, char *colname, MdbSarg *in_sarg);
 int mdb_test_string(MdbSargNode *node, char *s);
 int mdb_test_int(MdbSargNode *node, gint32 i);
+int mdb_test_double(int op, double vd, double d);
 int mdb_add_sarg(MdbColumn *col, MdbSarg *in_sarg);
+void mdb_any_set_text(MdbAny *value, const char *text, size_t len);
+void mdb_any_clear(MdbAny *value);
+void mdb_free_sarg(MdbSarg *sarg);
+int mdb_filter_page(MdbTableDef *table, MdbPageRows *pr);
 
 
 
@@ -617,16 +994,30 @@ int mdb_index_find_next(MdbHandle *mdb, MdbIndex *idx, MdbIndexChain *chain, gui
 void mdb_index_hash_text(MdbHandle *mdb, char *text, char *hash);
 void mdb_index_scan_init(MdbHandle *mdb, MdbTableDef *table);
 int mdb_index_find_row(MdbHandle *mdb, MdbIndex *idx, MdbIndexChain *chain, guint32 pg, guint16 row);
+int mdb_index_leaf_next(MdbHandle *mdb, MdbIndex *idx, MdbIndexChain *chain, guint32 *pg, guint16 *row);
+int mdb_index_leaf_scan_init(MdbHandle *mdb, MdbTableDef *table, MdbColumn *col, int desc);
 void mdb_index_swap_n(unsigned char *src, int sz, unsigned char *dest);
 void mdb_free_indices(GPtrArray *indices);
 void mdb_index_page_reset(MdbHandle *mdb, MdbIndexPage *ipg);
 int mdb_index_pack_bitmap(MdbHandle *mdb, MdbIndexPage *ipg);
+guint16 *mdb_index_page_reserve(MdbIndexPage *ipg, unsigned int num_starts);
+void mdb_free_index_chain(MdbIndexChain *chain);
 
 /* stats.c */
 void mdb_stats_on(MdbHandle *mdb);
 void mdb_stats_off(MdbHandle *mdb);
 void mdb_dump_stats(MdbHandle *mdb);
 
+/* log.c */
+void mdb_log_set_level(MdbLogCategory cat, MdbLogLevel level);
+void mdb_log_set_echo(int level);
+int mdb_log_enabled(MdbLogCategory cat, MdbLogLevel level);
+void mdb_log_message(MdbLogCategory cat, MdbLogLevel level, const char *msg);
+void mdb_log_write(MdbLogCategory cat, MdbLogLevel level, const char *fmt, ...)
+	__attribute__((format(printf, 3, 4)));
+unsigned int mdb_log_read(guint64 *since, MdbLogRecord *records, unsigned int max);
+const char *mdb_log_category_name(MdbLogCategory cat);
+
 /* like.c */
 int mdb_like_cmp(char *s, char *r);
 int mdb_ilike_cmp(char *s, char *r);
@@ -636,6 +1027,10 @@ void mdb_put_int16(void *buf, guint32 offset, guint32 value);
 void mdb_put_int32(void *buf, guint32 offset, guint32 value);
 void mdb_put_int32_msb(void *buf, guint32 offset, guint32 value);
 int mdb_crack_row(MdbTableDef *table, int row_start, size_t row_size, MdbField *fields);
+MdbPageRows *mdb_alloc_page_rows(void);
+void mdb_free_page_rows(MdbPageRows *pr);
+unsigned int mdb_crack_page(MdbTableDef *table, MdbPageRows *pr);
+int mdb_page_row_fields(MdbTableDef *table, MdbPageRows *pr, unsigned int row, MdbField *fields);
 guint16 mdb_add_row_to_pg(MdbTableDef *table, unsigned char *row_buffer, int new_row_size);
 int mdb_update_index(MdbTableDef *table, MdbIndex *idx, unsigned int num_fields, MdbField *fields, guint32 pgnum, guint16 rownum);
 int mdb_update_indexes(MdbTableDef *table, int num_fields, MdbField *fields, guint32 pgnum, guint16 rownum);
@@ -662,9 +1057,14 @@ void mdb_temp_table_add_col(MdbTableDef *table, MdbColumn *col);
 void mdb_fill_temp_col(MdbColumn *tcol, char *col_name, int col_size, int col_type, int is_fixed);
 void mdb_fill_temp_field(MdbField *field, void *value, int siz, int is_fixed, int is_null, int start, int column);
 void mdb_temp_columns_end(MdbTableDef *table);
+void mdb_temp_table_set_budget(MdbTableDef *table, size_t bytes);
+void *mdb_temp_table_new_pg(MdbTableDef *table);
+int mdb_temp_table_read_pg(MdbTableDef *table, guint32 pg);
+void mdb_temp_table_free_pages(MdbTableDef *table);
 
 /* options.c */
 int mdb_get_option(unsigned long optnum);
+void mdb_set_option(unsigned long optnum, int on);
 void mdb_debug(int klass, char *fmt, ...);
 
 /* iconv.c */
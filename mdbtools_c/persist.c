@@ -0,0 +1,155 @@
+/* MDB Tools - A library for reading MS Access database files
+ * Copyright (C) 2000 Brian Bruns
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Files the derived structures (prefix.c, tree.c) are saved to between
+ * runs.  Each starts with an 8 byte magic and the spec the structure was
+ * built from, so a file made for another table or other columns is not
+ * loaded.  Numbers are in host byte order and strings are a guint32
+ * length followed by the bytes.
+ *
+ * A file is written under a unique name next to its path and renamed over
+ * it once complete, so a reader never sees half of it and concurrent
+ * saves don't mix.
+ */
+
+#include "mdbtools.h"
+
+#define MDB_PERSIST_MAX_STR 0xffff
+
+/**
+ * mdb_persist_create:
+ * @path: file to replace
+ * @magic: 8 bytes naming the format
+ * @spec: what the saved structure was built from
+ * @tmp_path: receives the name written to, for mdb_persist_commit()
+ *
+ * Opens a new file next to @path and writes its header.
+ *
+ * Return value: the open file, or NULL on error.
+ */
+FILE *
+mdb_persist_create(const char *path, const char *magic, const char *spec, char **tmp_path)
+{
+	FILE *f;
+	int fd;
+
+	*tmp_path = g_strdup_printf("%s.XXXXXX", path);
+	if ((fd = mkstemp(*tmp_path)) == -1 || !(f = fdopen(fd, "wb"))) {
+		fprintf(stderr, "Couldn't open %s\n", *tmp_path);
+		if (fd != -1) {
+			close(fd);
+			remove(*tmp_path);
+		}
+		g_free(*tmp_path);
+		*tmp_path = NULL;
+		return NULL;
+	}
+	if (!mdb_persist_write(f, magic, 8) || !mdb_persist_write_str(f, spec)) {
+		mdb_persist_commit(f, *tmp_path, path, 0);
+		*tmp_path = NULL;
+		return NULL;
+	}
+	return f;
+}
+/**
+ * mdb_persist_commit:
+ * @f: file from mdb_persist_create()
+ * @tmp_path: its name; freed
+ * @path: file to replace
+ * @ok: whether everything was written
+ *
+ * Closes @f and renames it over @path, or removes it when @ok is 0 or
+ * it can't be completed.
+ *
+ * Return value: 1 on success, 0 on failure.
+ */
+int
+mdb_persist_commit(FILE *f, char *tmp_path, const char *path, int ok)
+{
+	if (fclose(f) != 0)
+		ok = 0;
+	if (ok && rename(tmp_path, path) != 0)
+		ok = 0;
+	if (!ok) {
+		fprintf(stderr, "Couldn't write %s\n", path);
+		remove(tmp_path);
+	}
+	g_free(tmp_path);
+	return ok;
+}
+/**
+ * mdb_persist_open:
+ * @path: file to read
+ * @magic: 8 bytes naming the format
+ * @spec: what the structure to load must have been built from
+ *
+ * Return value: the file, positioned after its header, or NULL when it
+ * is missing or was saved from something else.
+ */
+FILE *
+mdb_persist_open(const char *path, const char *magic, const char *spec)
+{
+	char saved_magic[8], *saved_spec = NULL;
+	FILE *f;
+
+	if (!(f = fopen(path, "rb")))
+		return NULL;
+	if (!mdb_persist_read(f, saved_magic, 8) || memcmp(saved_magic, magic, 8) ||
+	    !(saved_spec = mdb_persist_read_str(f)) || strcmp(saved_spec, spec)) {
+		g_free(saved_spec);
+		fclose(f);
+		return NULL;
+	}
+	g_free(saved_spec);
+	return f;
+}
+int
+mdb_persist_write(FILE *f, const void *p, size_t len)
+{
+	return fwrite(p, 1, len, f) == len;
+}
+int
+mdb_persist_write_str(FILE *f, const char *s)
+{
+	guint32 len = strlen(s);
+
+	return mdb_persist_write(f, &len, sizeof(len)) && mdb_persist_write(f, s, len);
+}
+int
+mdb_persist_read(FILE *f, void *p, size_t len)
+{
+	return fread(p, 1, len, f) == len;
+}
+/* reads a string written by mdb_persist_write_str() into a new buffer */
+char *
+mdb_persist_read_str(FILE *f)
+{
+	guint32 len;
+	char *s;
+
+	if (!mdb_persist_read(f, &len, sizeof(len)) || len > MDB_PERSIST_MAX_STR)
+		return NULL;
+	s = g_malloc(len + 1);
+	if (!mdb_persist_read(f, s, len)) {
+		g_free(s);
+		return NULL;
+	}
+	s[len] = '\0';
+	return s;
+}
@@ -0,0 +1,724 @@
+/* MDB Tools - A library for reading MS Access database files
+ * Copyright (C) 2000 Brian Bruns
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Prefix index for autocomplete over a name column, e.g. payee names in
+ * PAY.  Each name is case folded and every word in it becomes a key, so
+ * "cof" finds both "Coffee Shop" and "Joe's Coffee".  The keys are kept in
+ * one sorted array; a lookup is a binary search for the first key at or
+ * after the prefix followed by a walk over the keys that start with it.
+ * Matches are ranked by how often the referencing table (TRN.lHpay) uses
+ * each id, then by name.
+ *
+ * The index is built by scanning both tables once and can be saved to a
+ * file together with a fingerprint of each table (see cache.c).
+ * mdb_prefix_index_open() reuses the saved index while both fingerprints
+ * still match, so a lookup never needs the name table decoded again.  New
+ * names and uses made by the app are added in place with
+ * mdb_prefix_index_add() and mdb_prefix_index_use().
+ *
+ * An index has its own lock, so lookups and updates may come from
+ * different threads.
+ */
+
+#define MDB_MEM_TAG MDB_MEM_PREFIX_INDEX
+
+#include "mdbtools.h"
+
+#define MDB_PREFIX_MAGIC "MDBPFX01"
+
+typedef struct {
+	gint32 id;
+	guint32 uses;
+	char *name;
+	char *folded;
+	guint32 stamp;		/* last lookup that matched this entry */
+} MdbPrefixEntry;
+
+typedef struct {
+	const char *str;	/* a word start inside an entry's folded name */
+	guint32 entry;
+} MdbPrefixKey;
+
+struct MdbPrefixIndex {
+	pthread_mutex_t lock;
+	char *spec;		/* tables and columns the index was built from */
+	guint64 fingerprint;	/* of the name table when built */
+	guint64 ref_fingerprint;	/* of the referencing table when built */
+	MdbPrefixEntry *entries;
+	unsigned int num_entries;
+	unsigned int entries_size;
+	guint32 *by_id;		/* entry numbers, sorted by id */
+	MdbPrefixKey *keys;
+	unsigned int num_keys;
+	unsigned int keys_size;
+	guint32 stamp;
+};
+
+/*
+ * Folds ASCII and the Latin-1 letters of UTF-8 (U+00C0 to U+00DE) to lower
+ * case.  Both keep the length, so offsets into the folded name are offsets
+ * into the name too.
+ */
+static void
+mdb_prefix_fold(char *s)
+{
+	unsigned char *p = (unsigned char *)s;
+
+	for (; *p; p++) {
+		if (*p >= 'A' && *p <= 'Z')
+			*p += 'a' - 'A';
+		else if (*p == 0xc3 && p[1] >= 0x80 && p[1] <= 0x9e && p[1] != 0x97)
+			*++p += 0x20;
+	}
+}
+static int
+mdb_prefix_is_word_start(const char *folded, const char *p)
+{
+	unsigned char c = *p, prev;
+
+	if (c == ' ' || c == '\t' || (c & 0xc0) == 0x80)
+		return 0;
+	if (p == folded)
+		return 1;
+	prev = p[-1];
+	/* "Joe's" is one word */
+	return prev < 0x80 && !isalnum(prev) && prev != '\'' && (isalnum(c) || c >= 0x80);
+}
+static int
+mdb_prefix_key_cmp(const void *a, const void *b)
+{
+	const MdbPrefixKey *ka = a, *kb = b;
+	int ret = strcmp(ka->str, kb->str);
+
+	if (ret)
+		return ret;
+	return ka->entry < kb->entry ? -1 : ka->entry > kb->entry;
+}
+/* first key not less than str; callers hold the lock */
+static unsigned int
+mdb_prefix_lower_bound(MdbPrefixIndex *idx, const char *str)
+{
+	unsigned int lo = 0, hi = idx->num_keys, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (strcmp(idx->keys[mid].str, str) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+/* position of id in by_id, or where it would go; callers hold the lock */
+static unsigned int
+mdb_prefix_find_id(MdbPrefixIndex *idx, gint32 id, int *found)
+{
+	unsigned int lo = 0, hi = idx->num_entries, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (idx->entries[idx->by_id[mid]].id < id)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	*found = lo < idx->num_entries && idx->entries[idx->by_id[lo]].id == id;
+	return lo;
+}
+static void
+mdb_prefix_push_key(MdbPrefixIndex *idx, const char *str, guint32 entry)
+{
+	if (idx->num_keys == idx->keys_size) {
+		idx->keys_size = idx->keys_size ? idx->keys_size * 2 : 256;
+		idx->keys = g_realloc(idx->keys, idx->keys_size * sizeof(MdbPrefixKey));
+	}
+	idx->keys[idx->num_keys].str = str;
+	idx->keys[idx->num_keys].entry = entry;
+	idx->num_keys++;
+}
+/*
+ * Adds an entry without keys and returns its number.  The id must not be in
+ * the index yet; pos is where mdb_prefix_find_id() would put it.
+ */
+static guint32
+mdb_prefix_new_entry(MdbPrefixIndex *idx, unsigned int pos, gint32 id, const char *name, guint32 uses)
+{
+	MdbPrefixEntry *e;
+	guint32 n = idx->num_entries;
+
+	if (n == idx->entries_size) {
+		idx->entries_size = idx->entries_size ? idx->entries_size * 2 : 64;
+		idx->entries = g_realloc(idx->entries, idx->entries_size * sizeof(MdbPrefixEntry));
+		idx->by_id = g_realloc(idx->by_id, idx->entries_size * sizeof(guint32));
+	}
+	e = &idx->entries[n];
+	e->id = id;
+	e->uses = uses;
+	e->name = g_strdup(name);
+	e->folded = g_strdup(name);
+	mdb_prefix_fold(e->folded);
+	e->stamp = 0;
+	memmove(&idx->by_id[pos + 1], &idx->by_id[pos], (n - pos) * sizeof(guint32));
+	idx->by_id[pos] = n;
+	idx->num_entries++;
+	return n;
+}
+/* adds an entry's keys in order, for a single change to a built index */
+static void
+mdb_prefix_insert_keys(MdbPrefixIndex *idx, guint32 entry)
+{
+	const char *folded = idx->entries[entry].folded, *p;
+	MdbPrefixKey key;
+	unsigned int pos, lo, hi, mid;
+
+	for (p = folded; *p; p++) {
+		if (!mdb_prefix_is_word_start(folded, p))
+			continue;
+		key.str = p;
+		key.entry = entry;
+		/* make room, then find the place among the keys before it */
+		mdb_prefix_push_key(idx, p, entry);
+		lo = 0;
+		hi = idx->num_keys - 1;
+		while (lo < hi) {
+			mid = lo + (hi - lo) / 2;
+			if (mdb_prefix_key_cmp(&idx->keys[mid], &key) < 0)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		pos = lo;
+		memmove(&idx->keys[pos + 1], &idx->keys[pos],
+			(idx->num_keys - 1 - pos) * sizeof(MdbPrefixKey));
+		idx->keys[pos] = key;
+	}
+}
+static void
+mdb_prefix_remove_keys(MdbPrefixIndex *idx, guint32 entry)
+{
+	unsigned int i, j;
+
+	for (i = j = 0; i < idx->num_keys; i++)
+		if (idx->keys[i].entry != entry)
+			idx->keys[j++] = idx->keys[i];
+	idx->num_keys = j;
+}
+/* adds every entry's keys and sorts them once, after a build or a load */
+static void
+mdb_prefix_sort_keys(MdbPrefixIndex *idx)
+{
+	const char *folded, *p;
+	guint32 i;
+
+	idx->num_keys = 0;
+	for (i = 0; i < idx->num_entries; i++) {
+		folded = idx->entries[i].folded;
+		for (p = folded; *p; p++)
+			if (mdb_prefix_is_word_start(folded, p))
+				mdb_prefix_push_key(idx, p, i);
+	}
+	qsort(idx->keys, idx->num_keys, sizeof(MdbPrefixKey), mdb_prefix_key_cmp);
+}
+static MdbPrefixIndex *
+mdb_prefix_index_alloc(const char *spec)
+{
+	MdbPrefixIndex *idx;
+
+	idx = g_malloc0(sizeof(MdbPrefixIndex));
+	pthread_mutex_init(&idx->lock, NULL);
+	idx->spec = g_strdup(spec);
+	return idx;
+}
+static char *
+mdb_prefix_spec(const char *table_name, const char *id_col, const char *name_col,
+	const char *ref_table, const char *ref_col)
+{
+	return g_strdup_printf("%s.%s.%s %s.%s", table_name, id_col, name_col,
+		ref_table ? ref_table : "", ref_col ? ref_col : "");
+}
+/* opens a table for a scan of its columns; NULL if it is missing */
+static MdbTableDef *
+mdb_prefix_open_table(MdbHandle *mdb, const char *table_name, guint64 *fingerprint)
+{
+	MdbTableDef *table;
+
+	table = mdb_read_table_by_name(mdb, (gchar *)table_name, MDB_TABLE);
+	if (!table) {
+		fprintf(stderr, "Table %s not found\n", table_name);
+		return NULL;
+	}
+	mdb_read_columns(table);
+	*fingerprint = mdb_table_fingerprint(table);
+	mdb_rewind_table(table);
+	return table;
+}
+static int
+mdb_prefix_bind(MdbTableDef *table, const char *col_name, char *buf, int *len)
+{
+	if (mdb_bind_column_by_name(table, (gchar *)col_name, buf, len) == -1) {
+		fprintf(stderr, "Column %s not found in %s\n", col_name, table->name);
+		return 0;
+	}
+	return 1;
+}
+static int
+mdb_prefix_read_names(MdbHandle *mdb, MdbPrefixIndex *idx, const char *table_name,
+	const char *id_col, const char *name_col)
+{
+	MdbTableDef *table;
+	char *id_buf, *name_buf;
+	int id_len, name_len, found, ret = 0;
+	unsigned int pos;
+	gint32 id;
+
+	if (!(table = mdb_prefix_open_table(mdb, table_name, &idx->fingerprint)))
+		return 0;
+	id_buf = g_malloc(mdb->bind_size);
+	name_buf = g_malloc(mdb->bind_size);
+	if (mdb_prefix_bind(table, id_col, id_buf, &id_len) &&
+	    mdb_prefix_bind(table, name_col, name_buf, &name_len)) {
+		while (mdb_fetch_row(table)) {
+			if (!id_len || !name_len)
+				continue;
+			id = atol(id_buf);
+			pos = mdb_prefix_find_id(idx, id, &found);
+			if (!found)
+				mdb_prefix_new_entry(idx, pos, id, name_buf, 0);
+		}
+		ret = 1;
+	}
+	g_free(id_buf);
+	g_free(name_buf);
+	mdb_free_tabledef(table);
+	return ret;
+}
+static int
+mdb_prefix_count_uses(MdbHandle *mdb, MdbPrefixIndex *idx, const char *ref_table, const char *ref_col)
+{
+	MdbTableDef *table;
+	char *buf;
+	int len, found, ret = 0;
+	unsigned int pos;
+
+	if (!(table = mdb_prefix_open_table(mdb, ref_table, &idx->ref_fingerprint)))
+		return 0;
+	buf = g_malloc(mdb->bind_size);
+	if (mdb_prefix_bind(table, ref_col, buf, &len)) {
+		while (mdb_fetch_row(table)) {
+			if (!len)
+				continue;
+			pos = mdb_prefix_find_id(idx, atol(buf), &found);
+			if (found)
+				idx->entries[idx->by_id[pos]].uses++;
+		}
+		ret = 1;
+	}
+	g_free(buf);
+	mdb_free_tabledef(table);
+	return ret;
+}
+
+/**
+ * mdb_prefix_index_new:
+ * @mdb: Handle to open MDB database file
+ * @table_name: table holding the names, e.g. "PAY"
+ * @id_col: its integer id column, e.g. "hpay"
+ * @name_col: its name column, e.g. "szFull"
+ * @ref_table: table whose rows use the ids, e.g. "TRN", or NULL
+ * @ref_col: its column holding the id, e.g. "lHpay"
+ *
+ * Builds a prefix index by scanning @table_name, and @ref_table when given
+ * to rank names by how often they are used.  Rows with an empty id or name
+ * are left out.
+ *
+ * Return value: the index, or NULL if a table or column is missing.
+ */
+MdbPrefixIndex *
+mdb_prefix_index_new(MdbHandle *mdb, const char *table_name, const char *id_col,
+	const char *name_col, const char *ref_table, const char *ref_col)
+{
+	MdbPrefixIndex *idx;
+	char *spec;
+
+	spec = mdb_prefix_spec(table_name, id_col, name_col, ref_table, ref_col);
+	idx = mdb_prefix_index_alloc(spec);
+	g_free(spec);
+	if (!mdb_prefix_read_names(mdb, idx, table_name, id_col, name_col) ||
+	    (ref_table && !mdb_prefix_count_uses(mdb, idx, ref_table, ref_col))) {
+		mdb_prefix_index_free(idx);
+		return NULL;
+	}
+	mdb_prefix_sort_keys(idx);
+	return idx;
+}
+void
+mdb_prefix_index_free(MdbPrefixIndex *idx)
+{
+	unsigned int i;
+
+	if (!idx)
+		return;
+	for (i = 0; i < idx->num_entries; i++) {
+		g_free(idx->entries[i].name);
+		g_free(idx->entries[i].folded);
+	}
+	g_free(idx->entries);
+	g_free(idx->by_id);
+	g_free(idx->keys);
+	g_free(idx->spec);
+	pthread_mutex_destroy(&idx->lock);
+	g_free(idx);
+}
+
+/* Persistence */
+
+/**
+ * mdb_prefix_index_save:
+ * @idx: index to save
+ * @path: file to write
+ *
+ * Saves @idx, including names and uses added since it was built, for
+ * mdb_prefix_index_open(), written as described in persist.c.
+ *
+ * Return value: 1 on success, 0 on failure.
+ */
+int
+mdb_prefix_index_save(MdbPrefixIndex *idx, const char *path)
+{
+	MdbPrefixEntry *e;
+	char *tmp_path;
+	FILE *f;
+	unsigned int i;
+	int ok;
+
+	if (!(f = mdb_persist_create(path, MDB_PREFIX_MAGIC, idx->spec, &tmp_path)))
+		return 0;
+	pthread_mutex_lock(&idx->lock);
+	ok = mdb_persist_write(f, &idx->fingerprint, sizeof(guint64)) &&
+		mdb_persist_write(f, &idx->ref_fingerprint, sizeof(guint64)) &&
+		mdb_persist_write(f, &idx->num_entries, sizeof(guint32));
+	for (i = 0; ok && i < idx->num_entries; i++) {
+		e = &idx->entries[idx->by_id[i]];
+		ok = mdb_persist_write(f, &e->id, sizeof(gint32)) &&
+			mdb_persist_write(f, &e->uses, sizeof(guint32)) &&
+			mdb_persist_write_str(f, e->name);
+	}
+	pthread_mutex_unlock(&idx->lock);
+	return mdb_persist_commit(f, tmp_path, path, ok);
+}
+/* the saved index at path if it was built from spec, else NULL */
+static MdbPrefixIndex *
+mdb_prefix_index_load(const char *path, const char *spec)
+{
+	MdbPrefixIndex *idx;
+	char *name;
+	guint32 count, i, uses;
+	gint32 id;
+	FILE *f;
+
+	if (!(f = mdb_persist_open(path, MDB_PREFIX_MAGIC, spec)))
+		return NULL;
+	idx = mdb_prefix_index_alloc(spec);
+	if (!mdb_persist_read(f, &idx->fingerprint, sizeof(guint64)) ||
+	    !mdb_persist_read(f, &idx->ref_fingerprint, sizeof(guint64)) ||
+	    !mdb_persist_read(f, &count, sizeof(guint32)))
+		goto fail;
+	/* written in id order, so each entry goes at the end of by_id */
+	for (i = 0; i < count; i++) {
+		if (!mdb_persist_read(f, &id, sizeof(gint32)) ||
+		    !mdb_persist_read(f, &uses, sizeof(guint32)) ||
+		    !(name = mdb_persist_read_str(f)))
+			goto fail;
+		if (i && id <= idx->entries[idx->by_id[i - 1]].id) {
+			g_free(name);
+			goto fail;
+		}
+		mdb_prefix_new_entry(idx, i, id, name, uses);
+		g_free(name);
+	}
+	mdb_prefix_sort_keys(idx);
+	fclose(f);
+	return idx;
+fail:
+	mdb_prefix_index_free(idx);
+	fclose(f);
+	return NULL;
+}
+static int
+mdb_prefix_table_unchanged(MdbHandle *mdb, const char *table_name, guint64 fingerprint)
+{
+	MdbTableDef *table;
+	guint64 current;
+
+	if (!(table = mdb_prefix_open_table(mdb, table_name, &current)))
+		return 0;
+	mdb_free_tabledef(table);
+	return current == fingerprint;
+}
+
+/**
+ * mdb_prefix_index_open:
+ * @mdb: Handle to open MDB database file
+ * @table_name, @id_col, @name_col, @ref_table, @ref_col: as for
+ * mdb_prefix_index_new()
+ * @path: file the index is kept in between runs, or NULL
+ *
+ * Loads the index saved at @path if it was built from the same tables and
+ * columns and neither table has changed since, which costs a checksum of
+ * their pages but no row decoding.  Otherwise builds it again and saves it
+ * to @path.
+ *
+ * Return value: the index, or NULL if a table or column is missing.
+ */
+MdbPrefixIndex *
+mdb_prefix_index_open(MdbHandle *mdb, const char *table_name, const char *id_col,
+	const char *name_col, const char *ref_table, const char *ref_col, const char *path)
+{
+	MdbPrefixIndex *idx = NULL;
+	char *spec;
+
+	if (path) {
+		spec = mdb_prefix_spec(table_name, id_col, name_col, ref_table, ref_col);
+		idx = mdb_prefix_index_load(path, spec);
+		g_free(spec);
+	}
+	if (idx && mdb_prefix_table_unchanged(mdb, table_name, idx->fingerprint) &&
+	    (!ref_table || mdb_prefix_table_unchanged(mdb, ref_table, idx->ref_fingerprint)))
+		return idx;
+	mdb_prefix_index_free(idx);
+
+	idx = mdb_prefix_index_new(mdb, table_name, id_col, name_col, ref_table, ref_col);
+	if (idx && path)
+		mdb_prefix_index_save(idx, path);
+	return idx;
+}
+
+/* Updates */
+
+/**
+ * mdb_prefix_index_add:
+ * @idx: index to change
+ * @id: id of the name
+ * @name: the name; an id already in the index is renamed
+ *
+ * Adds a name the app created, e.g. a new payee not yet written to the
+ * file.  Takes time linear in the number of keys.
+ */
+void
+mdb_prefix_index_add(MdbPrefixIndex *idx, gint32 id, const char *name)
+{
+	MdbPrefixEntry *e;
+	unsigned int pos;
+	guint32 entry;
+	int found;
+
+	if (!name || !*name)
+		return;
+	pthread_mutex_lock(&idx->lock);
+	pos = mdb_prefix_find_id(idx, id, &found);
+	if (found) {
+		entry = idx->by_id[pos];
+		e = &idx->entries[entry];
+		if (!strcmp(e->name, name)) {
+			pthread_mutex_unlock(&idx->lock);
+			return;
+		}
+		mdb_prefix_remove_keys(idx, entry);
+		g_free(e->name);
+		g_free(e->folded);
+		e->name = g_strdup(name);
+		e->folded = g_strdup(name);
+		mdb_prefix_fold(e->folded);
+	} else {
+		entry = mdb_prefix_new_entry(idx, pos, id, name, 0);
+	}
+	mdb_prefix_insert_keys(idx, entry);
+	pthread_mutex_unlock(&idx->lock);
+}
+/**
+ * mdb_prefix_index_use:
+ * @idx: index to change
+ * @id: id a new row refers to
+ *
+ * Counts one more use of @id, e.g. when a transaction with that payee is
+ * saved, so it ranks higher in later lookups.  Unknown ids are ignored.
+ */
+void
+mdb_prefix_index_use(MdbPrefixIndex *idx, gint32 id)
+{
+	unsigned int pos;
+	int found;
+
+	pthread_mutex_lock(&idx->lock);
+	pos = mdb_prefix_find_id(idx, id, &found);
+	if (found)
+		idx->entries[idx->by_id[pos]].uses++;
+	pthread_mutex_unlock(&idx->lock);
+}
+
+/* Lookups */
+
+static int
+mdb_prefix_rank_cmp(const void *a, const void *b)
+{
+	const MdbPrefixEntry *ea = *(MdbPrefixEntry * const *)a;
+	const MdbPrefixEntry *eb = *(MdbPrefixEntry * const *)b;
+	int ret;
+
+	if (ea->uses != eb->uses)
+		return ea->uses > eb->uses ? -1 : 1;
+	if ((ret = strcmp(ea->folded, eb->folded)))
+		return ret;
+	return ea->id < eb->id ? -1 : ea->id > eb->id;
+}
+/*
+ * Keeps the best max entries seen so far in a heap whose root is the worst
+ * of them, so a short prefix that matches most names costs a walk over the
+ * keys rather than a sort of every match.
+ */
+static void
+mdb_prefix_heap_sift(MdbPrefixEntry **heap, unsigned int n, unsigned int i)
+{
+	MdbPrefixEntry *tmp;
+	unsigned int child;
+
+	while ((child = 2 * i + 1) < n) {
+		if (child + 1 < n && mdb_prefix_rank_cmp(&heap[child + 1], &heap[child]) > 0)
+			child++;
+		if (mdb_prefix_rank_cmp(&heap[child], &heap[i]) <= 0)
+			break;
+		tmp = heap[i];
+		heap[i] = heap[child];
+		heap[child] = tmp;
+		i = child;
+	}
+}
+static void
+mdb_prefix_heap_offer(MdbPrefixEntry **heap, unsigned int *n, unsigned int max, MdbPrefixEntry *e)
+{
+	unsigned int i, parent;
+
+	if (*n < max) {
+		/* sift up */
+		for (i = (*n)++; i > 0; i = parent) {
+			parent = (i - 1) / 2;
+			if (mdb_prefix_rank_cmp(&heap[parent], &e) >= 0)
+				break;
+			heap[i] = heap[parent];
+		}
+		heap[i] = e;
+	} else if (mdb_prefix_rank_cmp(&e, &heap[0]) < 0) {
+		heap[0] = e;
+		mdb_prefix_heap_sift(heap, *n, 0);
+	}
+}
+
+/**
+ * mdb_prefix_index_lookup:
+ * @idx: index to search
+ * @prefix: what the user has typed; matched case insensitively against the
+ * start of any word of a name.  An empty prefix matches every name.
+ * @matches: receives up to @max matches, most used first, then by name
+ * @max: size of @matches
+ *
+ * The names in @matches are copies, since another thread may rename an
+ * entry as soon as the lookup returns; release them with
+ * mdb_prefix_index_free_matches().
+ *
+ * Return value: number of matches stored.
+ */
+unsigned int
+mdb_prefix_index_lookup(MdbPrefixIndex *idx, const char *prefix, MdbPrefixMatch *matches, unsigned int max)
+{
+	MdbPrefixEntry **found, *e;
+	unsigned int pos, num_found = 0, i;
+	char *folded;
+	size_t len;
+
+	if (!max)
+		return 0;
+	found = g_malloc(max * sizeof(MdbPrefixEntry *));
+	folded = g_strdup(prefix ? prefix : "");
+	mdb_prefix_fold(folded);
+	len = strlen(folded);
+
+	pthread_mutex_lock(&idx->lock);
+	if (++idx->stamp == 0) {
+		for (i = 0; i < idx->num_entries; i++)
+			idx->entries[i].stamp = 0;
+		idx->stamp = 1;
+	}
+	if (!len) {
+		/* every name, without going through its keys */
+		for (i = 0; i < idx->num_entries; i++)
+			mdb_prefix_heap_offer(found, &num_found, max, &idx->entries[i]);
+	}
+	for (pos = len ? mdb_prefix_lower_bound(idx, folded) : idx->num_keys;
+	     pos < idx->num_keys && !strncmp(idx->keys[pos].str, folded, len); pos++) {
+		e = &idx->entries[idx->keys[pos].entry];
+		if (e->stamp == idx->stamp)
+			continue;
+		e->stamp = idx->stamp;
+		mdb_prefix_heap_offer(found, &num_found, max, e);
+	}
+	qsort(found, num_found, sizeof(MdbPrefixEntry *), mdb_prefix_rank_cmp);
+	for (i = 0; i < num_found; i++) {
+		matches[i].id = found[i]->id;
+		matches[i].uses = found[i]->uses;
+		matches[i].name = g_strdup(found[i]->name);
+	}
+	pthread_mutex_unlock(&idx->lock);
+
+	g_free(found);
+	g_free(folded);
+	return num_found;
+}
+/**
+ * mdb_prefix_index_free_matches:
+ * @matches: filled in by mdb_prefix_index_lookup()
+ * @count: number of matches it returned
+ *
+ * Frees the names of the matches; @matches itself belongs to the caller.
+ */
+void
+mdb_prefix_index_free_matches(MdbPrefixMatch *matches, unsigned int count)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		g_free(matches[i].name);
+		matches[i].name = NULL;
+	}
+}
+/**
+ * mdb_prefix_index_count:
+ * @idx: index
+ *
+ * Return value: number of names in @idx, enough room for any lookup.
+ */
+unsigned int
+mdb_prefix_index_count(MdbPrefixIndex *idx)
+{
+	unsigned int count;
+
+	pthread_mutex_lock(&idx->lock);
+	count = idx->num_entries;
+	pthread_mutex_unlock(&idx->lock);
+	return count;
+}
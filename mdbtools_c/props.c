@@ -16,6 +16,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#define MDB_MEM_TAG MDB_MEM_PROPS
+
 #include "mdbtools.h"
 
 static GPtrArray *
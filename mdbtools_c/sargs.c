@@ -27,9 +27,18 @@
  * a mdb_test_[type]() function and invoke it from mdb_test_sarg()
  */
 
+#define MDB_MEM_TAG MDB_MEM_SARG
+
 #include <time.h>
 #include "mdbtools.h"
 #include "mdbprivate.h"
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define MDB_FILTER_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define MDB_FILTER_SSE2 1
+#endif
 
 void
 mdb_sql_walk_tree(MdbSargNode *node, MdbSargTreeFunc func, gpointer data)
@@ -78,7 +87,12 @@ int rc;
 }
 int mdb_test_int(MdbSargNode *node, gint32 i)
 {
-	gint32 val = node->val_type == MDB_INT ? node->value.i : node->value.d;
+	gint32 val;
+
+	/* a fractional literal: 1.5 equals no integer, >= 1.5 starts at 2 */
+	if (node->val_type == MDB_DOUBLE)
+		return mdb_test_double(node->op, node->value.d, i);
+	val = node->value.i;
 	switch (node->op) {
 		case MDB_EQUAL:
 			//fprintf(stderr, "comparing %ld and %ld\n", i, node->value.i);
@@ -214,6 +228,16 @@ mdb_find_indexable_sargs(MdbSargNode *node, gpointer data)
 	 */
 	if (mdb_is_relational_op(node->op) && node->col) {
 		//printf("op = %d value = %s\n", node->op, node->value.s);
+		/* index keys of integer columns are compared as integers; leave
+		 * a fractional literal to the row test */
+		if (node->val_type == MDB_DOUBLE) {
+			switch (node->col->col_type) {
+				case MDB_BYTE:
+				case MDB_INT:
+				case MDB_LONGINT:
+					return 0;
+			}
+		}
 		sarg.op = node->op;
 		sarg.value = node->value;
 		mdb_add_sarg(node->col, &sarg);
@@ -227,10 +251,13 @@ mdb_test_sarg(MdbHandle *mdb, MdbColumn *col, MdbSargNode *node, MdbField *field
 	char* val;
 	int ret = 1;
 
+	/* a bool is stored in the null mask, so it is never null */
 	if (node->op == MDB_ISNULL)
-		ret = field->is_null;
+		return col->col_type != MDB_BOOL && field->is_null;
 	else if (node->op == MDB_NOTNULL)
-		ret = !field->is_null;
+		return col->col_type == MDB_BOOL || !field->is_null;
+	if (field->is_null && col->col_type != MDB_BOOL)
+		return 0;
 	switch (col->col_type) {
 		case MDB_BOOL:
 			ret = mdb_test_int(node, !field->is_null);
@@ -250,6 +277,10 @@ mdb_test_sarg(MdbHandle *mdb, MdbColumn *col, MdbSargNode *node, MdbField *field
 		case MDB_DOUBLE:
 			ret = mdb_test_double(node->op, node->val_type == MDB_INT ? node->value.i : node->value.d, mdb_get_double(field->value, 0));
 			break;
+		case MDB_MONEY:
+			ret = mdb_test_double(node->op, node->val_type == MDB_INT ? node->value.i : node->value.d,
+				((gint32)mdb_get_int32(field->value, 4) * 4294967296.0 + (guint32)mdb_get_int32(field->value, 0)) / 10000.0);
+			break;
 		case MDB_TEXT:
 			mdb_unicode2ascii(mdb, field->value, field->siz, tmpbuf, sizeof(tmpbuf));
 			ret = mdb_test_string(node, tmpbuf);
@@ -347,6 +378,43 @@ int i;
 	return 1;
 }
 #endif
+/**
+ * mdb_any_set_text:
+ * @value: sarg constant
+ * @text: text to store, need not be NUL terminated
+ * @len: bytes of @text
+ *
+ * Replaces whatever text @value held with a copy of @text.
+ */
+void
+mdb_any_set_text(MdbAny *value, const char *text, size_t len)
+{
+	g_free(value->s);
+	value->s = g_malloc(len + 1);
+	memcpy(value->s, text, len);
+	value->s[len] = '\0';
+	value->len = len;
+}
+/**
+ * mdb_any_clear:
+ * @value: sarg constant
+ *
+ * Frees the text held by @value, if any; the numeric value is kept.
+ */
+void
+mdb_any_clear(MdbAny *value)
+{
+	g_free(value->s);
+	value->s = NULL;
+	value->len = 0;
+}
+void
+mdb_free_sarg(MdbSarg *sarg)
+{
+	if (!sarg) return;
+	mdb_any_clear(&sarg->value);
+	g_free(sarg);
+}
 int mdb_add_sarg(MdbColumn *col, MdbSarg *in_sarg)
 {
 MdbSarg *sarg;
@@ -354,6 +422,11 @@ MdbSarg *sarg;
 		col->sargs = g_ptr_array_new();
 	}
 	sarg = g_memdup2(in_sarg,sizeof(MdbSarg));
+	/* the column's copy owns its text */
+	if (in_sarg->value.s) {
+		sarg->value.s = NULL;
+		mdb_any_set_text(&sarg->value, in_sarg->value.s, in_sarg->value.len);
+	}
         g_ptr_array_add(col->sargs, sarg);
 	col->num_sargs++;
 
@@ -373,3 +446,404 @@ int mdb_add_sarg_by_name(MdbTableDef *table, char *colname, MdbSarg *in_sarg)
 	/* else didn't find the column return 0! */
 	return 0;
 }
+
+/*
+ * Page filters.  mdb_filter_page() evaluates the sarg tree column at a time
+ * over every row slot of a page decoded by mdb_crack_page().  Each
+ * comparison gathers its column into pr->scratch and compares the whole
+ * vector in one pass, four or two lanes at a time with NEON or SSE2, giving
+ * a bitmap of the slots that match; AND, OR and NOT then combine bitmaps a
+ * word at a time.  The result is what mdb_test_sargs() would give row by
+ * row, so only the surviving rows need their fields filled in.
+ */
+
+enum {
+	MDB_FILTER_NONE,
+	MDB_FILTER_BOOL,
+	MDB_FILTER_INT,
+	MDB_FILTER_DOUBLE,
+	MDB_FILTER_DATE,
+	MDB_FILTER_TEXT
+};
+
+static int
+mdb_filter_kind(MdbColumn *col)
+{
+	switch (col->col_type) {
+		case MDB_BOOL:
+			return MDB_FILTER_BOOL;
+		case MDB_BYTE:
+		case MDB_INT:
+		case MDB_LONGINT:
+			return MDB_FILTER_INT;
+		case MDB_FLOAT:
+		case MDB_DOUBLE:
+		case MDB_MONEY:
+			return MDB_FILTER_DOUBLE;
+		case MDB_DATETIME:
+			return MDB_FILTER_DATE;
+		case MDB_TEXT:
+			return MDB_FILTER_TEXT;
+	}
+	return MDB_FILTER_NONE;
+}
+/* whether mdb_filter_node() can evaluate the whole tree under @node */
+static int
+mdb_filter_supported(MdbTableDef *table, MdbSargNode *node)
+{
+	int kind;
+
+	if (mdb_is_relational_op(node->op)) {
+		if (!node->col)
+			return 1;
+		if ((unsigned int)node->col->col_num >= table->num_cols)
+			return 0;
+		if (node->op == MDB_ISNULL || node->op == MDB_NOTNULL)
+			return 1;
+		kind = mdb_filter_kind(node->col);
+		if (node->op == MDB_LIKE || node->op == MDB_ILIKE)
+			return kind == MDB_FILTER_TEXT;
+		return kind != MDB_FILTER_NONE;
+	}
+	switch (node->op) {
+		case MDB_NOT:
+			return node->left && mdb_filter_supported(table, node->left);
+		case MDB_AND:
+		case MDB_OR:
+			return node->left && node->right &&
+				mdb_filter_supported(table, node->left) &&
+				mdb_filter_supported(table, node->right);
+	}
+	return 0;
+}
+static inline int
+mdb_filter_test(int op, double x, double k)
+{
+	switch (op) {
+		case MDB_EQUAL: return x == k;
+		case MDB_GT: return x > k;
+		case MDB_LT: return x < k;
+		case MDB_GTEQ: return x >= k;
+		case MDB_LTEQ: return x <= k;
+		case MDB_NEQ: return x != k;
+	}
+	return 0;
+}
+/* out = bitmap of v[i] @op k, for relational ops EQUAL to NEQ */
+static void
+mdb_filter_cmp_i32(const gint32 *v, unsigned int n, int op, gint32 k, guint64 *out)
+{
+	unsigned int i = 0, bits;
+
+	memset(out, 0, (n + 63) / 64 * sizeof(guint64));
+#if defined(MDB_FILTER_NEON)
+	{
+	const int32x4_t kk = vdupq_n_s32(k);
+	const uint32x4_t lanes = { 1, 2, 4, 8 };
+	for (; i + 4 <= n; i += 4) {
+		int32x4_t x = vld1q_s32(v + i);
+		uint32x4_t m;
+		switch (op) {
+			case MDB_EQUAL: m = vceqq_s32(x, kk); break;
+			case MDB_GT: m = vcgtq_s32(x, kk); break;
+			case MDB_LT: m = vcltq_s32(x, kk); break;
+			case MDB_GTEQ: m = vcgeq_s32(x, kk); break;
+			case MDB_LTEQ: m = vcleq_s32(x, kk); break;
+			default: m = vmvnq_u32(vceqq_s32(x, kk)); break;
+		}
+		bits = vaddvq_u32(vandq_u32(m, lanes));
+		out[i >> 6] |= (guint64)bits << (i & 63);
+	}
+	}
+#elif defined(MDB_FILTER_SSE2)
+	{
+	const __m128i kk = _mm_set1_epi32(k);
+	for (; i + 4 <= n; i += 4) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(v + i));
+		__m128i m;
+		unsigned int inv = 0;
+		switch (op) {
+			case MDB_EQUAL: m = _mm_cmpeq_epi32(x, kk); break;
+			case MDB_GT: m = _mm_cmpgt_epi32(x, kk); break;
+			case MDB_LT: m = _mm_cmplt_epi32(x, kk); break;
+			case MDB_GTEQ: m = _mm_cmplt_epi32(x, kk); inv = 0xF; break;
+			case MDB_LTEQ: m = _mm_cmpgt_epi32(x, kk); inv = 0xF; break;
+			default: m = _mm_cmpeq_epi32(x, kk); inv = 0xF; break;
+		}
+		bits = _mm_movemask_ps(_mm_castsi128_ps(m)) ^ inv;
+		out[i >> 6] |= (guint64)bits << (i & 63);
+	}
+	}
+#endif
+	for (; i < n; i++)
+		if (mdb_filter_test(op, v[i], k))
+			out[i >> 6] |= (guint64)1 << (i & 63);
+}
+static void
+mdb_filter_cmp_f64(const double *v, unsigned int n, int op, double k, guint64 *out)
+{
+	unsigned int i = 0, bits;
+
+	memset(out, 0, (n + 63) / 64 * sizeof(guint64));
+#if defined(MDB_FILTER_NEON)
+	{
+	const float64x2_t kk = vdupq_n_f64(k);
+	const uint64x2_t lanes = { 1, 2 };
+	for (; i + 2 <= n; i += 2) {
+		float64x2_t x = vld1q_f64(v + i);
+		uint64x2_t m;
+		switch (op) {
+			case MDB_EQUAL: m = vceqq_f64(x, kk); break;
+			case MDB_GT: m = vcgtq_f64(x, kk); break;
+			case MDB_LT: m = vcltq_f64(x, kk); break;
+			case MDB_GTEQ: m = vcgeq_f64(x, kk); break;
+			case MDB_LTEQ: m = vcleq_f64(x, kk); break;
+			default: m = veorq_u64(vceqq_f64(x, kk), vdupq_n_u64(~0ULL)); break;
+		}
+		bits = vaddvq_u64(vandq_u64(m, lanes));
+		out[i >> 6] |= (guint64)bits << (i & 63);
+	}
+	}
+#elif defined(MDB_FILTER_SSE2)
+	{
+	const __m128d kk = _mm_set1_pd(k);
+	for (; i + 2 <= n; i += 2) {
+		__m128d x = _mm_loadu_pd(v + i);
+		__m128d m;
+		switch (op) {
+			case MDB_EQUAL: m = _mm_cmpeq_pd(x, kk); break;
+			case MDB_GT: m = _mm_cmpgt_pd(x, kk); break;
+			case MDB_LT: m = _mm_cmplt_pd(x, kk); break;
+			case MDB_GTEQ: m = _mm_cmpge_pd(x, kk); break;
+			case MDB_LTEQ: m = _mm_cmple_pd(x, kk); break;
+			default: m = _mm_cmpneq_pd(x, kk); break;
+		}
+		bits = _mm_movemask_pd(m);
+		out[i >> 6] |= (guint64)bits << (i & 63);
+	}
+	}
+#endif
+	for (; i < n; i++)
+		if (mdb_filter_test(op, v[i], k))
+			out[i >> 6] |= (guint64)1 << (i & 63);
+}
+/*
+ * Locate column @elem of row slot @r the way mdb_page_row_fields() does.
+ * @fixed_ord is the column's position among the fixed columns.
+ *
+ * Return value: 0 if the slot is unused or the value lies outside the row.
+ */
+static int
+mdb_filter_field(MdbTableDef *table, MdbPageRows *pr, unsigned int r,
+	unsigned int elem, unsigned int fixed_ord, MdbField *f)
+{
+	const MdbRowPlanCol *pc = &table->row_plan->cols[elem];
+	int row_start = pr->row_start[r];
+
+	if (row_start < 0)
+		return 0;
+	f->is_null = !(pr->validity[pc->null_pos * pr->mask_stride + r / 8] & (1 << (r % 8)));
+	if (pc->is_fixed && fixed_ord < (unsigned int)(pr->row_cols[r] - pr->row_var_cols[r])) {
+		f->start = row_start + pc->offset;
+		f->siz = pc->size;
+	} else if (!pc->is_fixed && pc->offset < pr->row_var_cols[r]) {
+		const guint16 *off = pr->var_offsets + r * pr->var_stride + pc->offset;
+		f->start = row_start + off[0];
+		f->siz = off[1] - off[0];
+	} else {
+		f->start = 0;
+		f->siz = 0;
+		f->is_null = 1;
+		f->value = NULL;
+		return 1;
+	}
+	if ((size_t)(f->start + f->siz) > (size_t)row_start + pr->row_size[r])
+		return 0;
+	f->value = (char *)table->entry->mdb->pg_buf + f->start;
+	return 1;
+}
+/* bitmap of the row slots matching relational @node, as mdb_test_sarg() */
+static void
+mdb_filter_leaf(MdbTableDef *table, MdbPageRows *pr, MdbSargNode *node,
+	const guint64 *cand, guint64 *out)
+{
+	MdbHandle *mdb = table->entry->mdb;
+	MdbColumn *col = node->col;
+	unsigned int n = pr->num_rows, words = (n + 63) / 64;
+	unsigned int elem, fixed_ord, i, r;
+	int kind;
+	guint64 *ok;
+	gint32 v;
+	gint32 *iv = (gint32 *)pr->scratch;
+	double *dv = pr->scratch;
+	double k, kr;
+	char tmpbuf[256];
+	MdbField f;
+
+	/* for const = const expressions */
+	if (!col) {
+		for (i = 0; i < words; i++)
+			out[i] = node->value.i ? cand[i] : 0;
+		return;
+	}
+	elem = col->col_num;
+	for (i = 0, fixed_ord = 0; i < elem; i++)
+		fixed_ord += table->row_plan->cols[i].is_fixed;
+	kind = mdb_filter_kind(col);
+	/* a fractional literal compares integers as doubles, as mdb_test_int() */
+	if (kind == MDB_FILTER_INT && node->val_type == MDB_DOUBLE)
+		kind = MDB_FILTER_DOUBLE;
+
+	/* ok: slots with a usable, non-null value */
+	ok = g_malloc0(words * sizeof(guint64));
+	memset(out, 0, words * sizeof(guint64));
+	for (r = 0; r < n; r++) {
+		if (!(cand[r >> 6] >> (r & 63) & 1) ||
+		    !mdb_filter_field(table, pr, r, elem, fixed_ord, &f)) {
+			if (kind == MDB_FILTER_INT) iv[r] = 0; else dv[r] = 0;
+			continue;
+		}
+		/* a bool is stored in the null mask, so it is never null */
+		if (node->op == MDB_ISNULL || node->op == MDB_NOTNULL) {
+			if ((node->op == MDB_ISNULL) == (kind != MDB_FILTER_BOOL && f.is_null))
+				out[r >> 6] |= (guint64)1 << (r & 63);
+			continue;
+		}
+		if (kind == MDB_FILTER_BOOL) {
+			iv[r] = !f.is_null;
+			ok[r >> 6] |= (guint64)1 << (r & 63);
+			continue;
+		}
+		if (f.is_null) {
+			if (kind == MDB_FILTER_INT) iv[r] = 0; else dv[r] = 0;
+			continue;
+		}
+		switch (col->col_type) {
+			case MDB_BYTE:
+			case MDB_INT:
+			case MDB_LONGINT:
+				v = col->col_type == MDB_BYTE ? ((char *)f.value)[0] :
+					col->col_type == MDB_INT ? mdb_get_int16(f.value, 0) :
+					mdb_get_int32(f.value, 0);
+				if (kind == MDB_FILTER_INT) iv[r] = v; else dv[r] = v;
+				break;
+			case MDB_FLOAT:
+				dv[r] = mdb_get_single(f.value, 0);
+				break;
+			case MDB_DOUBLE:
+			case MDB_DATETIME:
+				dv[r] = mdb_get_double(f.value, 0);
+				break;
+			case MDB_MONEY:
+				dv[r] = ((gint32)mdb_get_int32(f.value, 4) * 4294967296.0 +
+					(guint32)mdb_get_int32(f.value, 0)) / 10000.0;
+				break;
+			case MDB_TEXT:
+				mdb_unicode2ascii(mdb, f.value, f.siz, tmpbuf, sizeof(tmpbuf));
+				if (mdb_test_string(node, tmpbuf))
+					out[r >> 6] |= (guint64)1 << (r & 63);
+				continue;
+		}
+		ok[r >> 6] |= (guint64)1 << (r & 63);
+	}
+	if (node->op == MDB_ISNULL || node->op == MDB_NOTNULL || kind == MDB_FILTER_TEXT) {
+		g_free(ok);
+		return;
+	}
+
+	switch (kind) {
+		case MDB_FILTER_BOOL:
+		case MDB_FILTER_INT:
+			mdb_filter_cmp_i32(iv, n, node->op, node->val_type == MDB_INT ?
+				node->value.i : node->value.d, out);
+			break;
+		case MDB_FILTER_DOUBLE:
+			mdb_filter_cmp_f64(dv, n, node->op, node->val_type == MDB_INT ?
+				node->value.i : node->value.d, out);
+			break;
+		case MDB_FILTER_DATE:
+			/* Dates compare after rounding both sides to 6 decimals.
+			 * Rounding keeps the order of values more than a few
+			 * millionths apart, so only near-ties need the exact test. */
+			k = node->value.d;
+			mdb_filter_cmp_f64(dv, n, node->op, k, out);
+			kr = poor_mans_trunc(k);
+			for (r = 0; r < n; r++) {
+				if (!(ok[r >> 6] >> (r & 63) & 1))
+					continue;
+				if (k > -1e6 && k < 1e6 && (dv[r] - k > 1e-5 || k - dv[r] > 1e-5))
+					continue;
+				if (mdb_test_double(node->op, kr, poor_mans_trunc(dv[r])))
+					out[r >> 6] |= (guint64)1 << (r & 63);
+				else
+					out[r >> 6] &= ~((guint64)1 << (r & 63));
+			}
+			break;
+	}
+	for (i = 0; i < words; i++)
+		out[i] &= ok[i];
+	g_free(ok);
+}
+static void
+mdb_filter_node(MdbTableDef *table, MdbPageRows *pr, MdbSargNode *node,
+	const guint64 *cand, guint64 *out)
+{
+	unsigned int words = (pr->num_rows + 63) / 64, i;
+	guint64 *right, any = 0;
+
+	if (mdb_is_relational_op(node->op)) {
+		mdb_filter_leaf(table, pr, node, cand, out);
+		return;
+	}
+	mdb_filter_node(table, pr, node->left, cand, out);
+	if (node->op == MDB_NOT) {
+		for (i = 0; i < words; i++)
+			out[i] = ~out[i] & cand[i];
+		return;
+	}
+	for (i = 0; i < words; i++)
+		any |= node->op == MDB_AND ? out[i] : ~out[i] & cand[i];
+	/* nothing left for the right side to decide */
+	if (!any)
+		return;
+	right = g_malloc(words * sizeof(guint64));
+	mdb_filter_node(table, pr, node->right, cand, right);
+	for (i = 0; i < words; i++)
+		out[i] = node->op == MDB_AND ? out[i] & right[i] : out[i] | right[i];
+	g_free(right);
+}
+/**
+ * mdb_filter_page:
+ * @table: table being scanned
+ * @pr: its current page, decoded by mdb_crack_page()
+ *
+ * Sets pr->selection to the row slots that are in use and pass the table's
+ * sarg tree.  Trees with a test that can't be run a column at a time (memo
+ * columns, say) are left to mdb_test_sargs(), and then every used slot is
+ * selected.
+ *
+ * Return value: 1 if the sargs were applied, 0 if each selected row must
+ * still go through mdb_test_sargs().
+ */
+int
+mdb_filter_page(MdbTableDef *table, MdbPageRows *pr)
+{
+	unsigned int words = (pr->num_rows + 63) / 64, r, i;
+	guint64 *match;
+
+	memset(pr->selection, 0, words * sizeof(guint64));
+	for (r = 0; r < pr->num_rows; r++)
+		if (pr->row_start[r] >= 0)
+			pr->selection[r >> 6] |= (guint64)1 << (r & 63);
+
+	if (!table->sarg_tree || !words)
+		return 1;
+	if (!mdb_filter_supported(table, table->sarg_tree))
+		return 0;
+	match = g_malloc(words * sizeof(guint64));
+	mdb_filter_node(table, pr, table->sarg_tree, pr->selection, match);
+	for (i = 0; i < words; i++)
+		pr->selection[i] &= match[i];
+	g_free(match);
+	return 1;
+}
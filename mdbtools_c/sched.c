@@ -0,0 +1,551 @@
+/* MDB Tools - A library for reading MS Access database file
+ * Copyright (C) 2000 Brian Bruns
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * The engine's task scheduler.  Every parallel operation (async jobs,
+ * partitioned scans, exports) runs on this one set of worker threads so
+ * that they never oversubscribe the device between them.
+ *
+ * Each worker owns a deque: tasks it spawns are pushed and popped at the
+ * bottom, so a worker keeps working on what it just split off, while idle
+ * workers steal from the top of someone else's deque.  Tasks spawned from
+ * outside the pool go to a shared injection queue.  Deques are short and
+ * their critical sections a few loads and stores, so each has a plain
+ * mutex rather than a lock-free protocol.
+ *
+ * Tasks are joined through task groups.  A thread waiting on a group runs
+ * other grouped tasks while it waits, so a task may spawn and wait on
+ * subtasks without tying up its worker.  Detached tasks, such as async
+ * jobs, may run for long or block, so they go on a queue of their own that
+ * only idle workers take from, never a thread waiting on a group.
+ */
+
+#include "mdbtools.h"
+
+#define MDB_SCHED_MAX_WORKERS 64
+
+typedef struct {
+	MdbTaskFunc func;
+	void *arg;
+	MdbTaskGroup *group;
+} MdbTask;
+
+/* ring buffer; bottom is head + count.  count is only changed under the
+ * lock, but stored atomically for the thieves' unlocked peek. */
+typedef struct {
+	pthread_mutex_t lock;
+	MdbTask *tasks;
+	unsigned int size;
+	unsigned int head;
+	unsigned int count;
+} MdbTaskDeque;
+
+typedef struct {
+	pthread_t thread;
+	MdbTaskDeque deque;
+	unsigned int index;
+	unsigned int seed;	/* victim selection */
+} MdbWorker;
+
+struct MdbTaskGroup {
+	int pending;		/* __atomic, seq_cst against sched.sleepers */
+};
+
+static struct {
+	pthread_mutex_t lock;	/* start/stop, and sleeping workers */
+	pthread_cond_t cond;
+	MdbWorker *workers;
+	unsigned int num_workers;
+	MdbTaskDeque inject;
+	MdbTaskDeque detached;	/* tasks with no group */
+	int queued;		/* tasks in any deque but detached; __atomic */
+	int detached_queued;	/* __atomic */
+	int sleepers;		/* __atomic */
+	int stopping;
+} sched = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER
+};
+
+static __thread MdbWorker *current_worker;
+
+static void
+mdb_deque_init(MdbTaskDeque *d)
+{
+	pthread_mutex_init(&d->lock, NULL);
+	d->tasks = NULL;
+	d->size = d->head = d->count = 0;
+}
+static void
+mdb_deque_free(MdbTaskDeque *d)
+{
+	pthread_mutex_destroy(&d->lock);
+	g_free(d->tasks);
+	d->tasks = NULL;
+}
+static void
+mdb_deque_push(MdbTaskDeque *d, const MdbTask *task)
+{
+	MdbTask *tasks;
+	unsigned int i, size;
+
+	pthread_mutex_lock(&d->lock);
+	if (d->count == d->size) {
+		size = d->size ? d->size * 2 : 64;
+		tasks = g_malloc(size * sizeof(MdbTask));
+		for (i = 0; i < d->count; i++)
+			tasks[i] = d->tasks[(d->head + i) % d->size];
+		g_free(d->tasks);
+		d->tasks = tasks;
+		d->size = size;
+		d->head = 0;
+	}
+	d->tasks[(d->head + d->count) % d->size] = *task;
+	__atomic_store_n(&d->count, d->count + 1, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&d->lock);
+}
+/* owner end: newest first */
+static int
+mdb_deque_pop(MdbTaskDeque *d, MdbTask *task)
+{
+	int found = 0;
+
+	pthread_mutex_lock(&d->lock);
+	if (d->count) {
+		*task = d->tasks[(d->head + d->count - 1) % d->size];
+		__atomic_store_n(&d->count, d->count - 1, __ATOMIC_RELAXED);
+		found = 1;
+	}
+	pthread_mutex_unlock(&d->lock);
+	return found;
+}
+/* thief end: oldest first */
+static int
+mdb_deque_steal(MdbTaskDeque *d, MdbTask *task)
+{
+	int found = 0;
+
+	/* racy peek, so thieves don't all queue up on empty deques */
+	if (!__atomic_load_n(&d->count, __ATOMIC_RELAXED))
+		return 0;
+	pthread_mutex_lock(&d->lock);
+	if (d->count) {
+		*task = d->tasks[d->head];
+		d->head = (d->head + 1) % d->size;
+		__atomic_store_n(&d->count, d->count - 1, __ATOMIC_RELAXED);
+		found = 1;
+	}
+	pthread_mutex_unlock(&d->lock);
+	return found;
+}
+/* Take a task for @self (NULL outside the pool): own deque, injection
+ * queue, then the other workers' deques starting at a random victim, and
+ * last, if @detached, the detached queue. */
+static int
+mdb_sched_find_task(MdbWorker *self, MdbTask *task, int detached)
+{
+	unsigned int i, n, start;
+
+	if (self && mdb_deque_pop(&self->deque, task))
+		goto found;
+	if (mdb_deque_steal(&sched.inject, task))
+		goto found;
+	n = __atomic_load_n(&sched.num_workers, __ATOMIC_ACQUIRE);
+	if (!n)
+		return 0;
+	if (self) {
+		self->seed = self->seed * 1103515245 + 12345;
+		start = (self->seed >> 16) % n;
+	} else {
+		start = 0;
+	}
+	for (i = 0; i < n; i++) {
+		MdbWorker *victim = &sched.workers[(start + i) % n];
+		if (victim != self && mdb_deque_steal(&victim->deque, task))
+			goto found;
+	}
+	if (detached && mdb_deque_steal(&sched.detached, task)) {
+		__atomic_sub_fetch(&sched.detached_queued, 1, __ATOMIC_SEQ_CST);
+		return 1;
+	}
+	return 0;
+found:
+	__atomic_sub_fetch(&sched.queued, 1, __ATOMIC_SEQ_CST);
+	return 1;
+}
+static void
+mdb_sched_wake(int all)
+{
+	if (!__atomic_load_n(&sched.sleepers, __ATOMIC_SEQ_CST))
+		return;
+	pthread_mutex_lock(&sched.lock);
+	if (all)
+		pthread_cond_broadcast(&sched.cond);
+	else
+		pthread_cond_signal(&sched.cond);
+	pthread_mutex_unlock(&sched.lock);
+}
+static void
+mdb_sched_run(MdbTask *task)
+{
+	task->func(task->arg);
+	if (task->group && !__atomic_sub_fetch(&task->group->pending, 1, __ATOMIC_SEQ_CST))
+		mdb_sched_wake(1);	/* whoever waits on the group */
+}
+/* Sleep until a task is queued, a detached one only if @detached, or
+ * @done says to stop waiting.  The sleeper count is raised before
+ * re-checking, and spawners bump the queue count before reading it, so a
+ * wakeup cannot be lost. */
+static void
+mdb_sched_sleep(int detached, int (*done)(void *data), void *data)
+{
+	pthread_mutex_lock(&sched.lock);
+	__atomic_add_fetch(&sched.sleepers, 1, __ATOMIC_SEQ_CST);
+	while (__atomic_load_n(&sched.queued, __ATOMIC_SEQ_CST) <= 0 &&
+	       (!detached || __atomic_load_n(&sched.detached_queued, __ATOMIC_SEQ_CST) <= 0) &&
+	       !done(data))
+		pthread_cond_wait(&sched.cond, &sched.lock);
+	__atomic_sub_fetch(&sched.sleepers, 1, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&sched.lock);
+}
+/* caller holds sched.lock */
+static int
+mdb_sched_stopping(void *data)
+{
+	(void)data;
+	return sched.stopping;
+}
+static void *
+mdb_sched_worker(void *data)
+{
+	MdbWorker *self = data;
+	MdbTask task;
+
+	current_worker = self;
+	for (;;) {
+		if (mdb_sched_find_task(self, &task, 1)) {
+			mdb_sched_run(&task);
+			continue;
+		}
+		pthread_mutex_lock(&sched.lock);
+		if (sched.stopping && __atomic_load_n(&sched.queued, __ATOMIC_SEQ_CST) <= 0 &&
+		    __atomic_load_n(&sched.detached_queued, __ATOMIC_SEQ_CST) <= 0) {
+			pthread_mutex_unlock(&sched.lock);
+			break;
+		}
+		pthread_mutex_unlock(&sched.lock);
+		mdb_sched_sleep(1, mdb_sched_stopping, NULL);
+	}
+	current_worker = NULL;
+	return NULL;
+}
+/* caller holds sched.lock */
+static int
+mdb_sched_start_locked(unsigned int num_workers)
+{
+	unsigned int i;
+	long ncpu;
+
+	if (sched.num_workers)
+		return 1;
+	if (sched.stopping)
+		return 0;
+	if (!num_workers) {
+		ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+		num_workers = ncpu > 1 ? ncpu : 2;
+	}
+	if (num_workers > MDB_SCHED_MAX_WORKERS)
+		num_workers = MDB_SCHED_MAX_WORKERS;
+
+	sched.workers = g_malloc0(num_workers * sizeof(MdbWorker));
+	for (i = 0; i < num_workers; i++) {
+		mdb_deque_init(&sched.workers[i].deque);
+		sched.workers[i].index = i;
+		sched.workers[i].seed = i + 1;
+	}
+	mdb_deque_init(&sched.inject);
+	mdb_deque_init(&sched.detached);
+	/* publish the count before the threads look at each other's deques */
+	sched.num_workers = num_workers;
+	for (i = 0; i < num_workers; i++) {
+		if (pthread_create(&sched.workers[i].thread, NULL, mdb_sched_worker, &sched.workers[i])) {
+			fprintf(stderr, "Unable to start worker thread\n");
+			break;
+		}
+	}
+	if (i < num_workers) {
+		/* the threads that did start only look at the first i deques
+		 * once they see the smaller count */
+		__atomic_store_n(&sched.num_workers, i, __ATOMIC_SEQ_CST);
+	}
+	return sched.num_workers > 0;
+}
+/**
+ * mdb_sched_start:
+ * @num_workers: worker threads, or 0 for one per online CPU (at most 64)
+ *
+ * Starts the scheduler.  Calling this is optional; the first spawned task
+ * starts it with the default size.  Workers are plain pthreads, with no
+ * affinity, so the OS is free to place them on any core.
+ *
+ * Return value: 1 if the scheduler is running, 0 if no worker could be
+ * started or it is shutting down.
+ */
+int
+mdb_sched_start(unsigned int num_workers)
+{
+	int rc;
+
+	pthread_mutex_lock(&sched.lock);
+	rc = mdb_sched_start_locked(num_workers);
+	pthread_mutex_unlock(&sched.lock);
+	return rc;
+}
+/**
+ * mdb_sched_stop:
+ *
+ * Runs every task already queued, then stops the workers.  Long running
+ * async jobs should be cancelled first, and no other thread may be in
+ * mdb_task_group_wait() or mdb_parallel_for().  The scheduler can be
+ * started again afterwards.
+ */
+void
+mdb_sched_stop(void)
+{
+	unsigned int i, num_workers;
+
+	pthread_mutex_lock(&sched.lock);
+	if (!sched.num_workers || sched.stopping) {
+		pthread_mutex_unlock(&sched.lock);
+		return;
+	}
+	sched.stopping = 1;
+	num_workers = sched.num_workers;
+	pthread_cond_broadcast(&sched.cond);
+	pthread_mutex_unlock(&sched.lock);
+
+	for (i = 0; i < num_workers; i++)
+		pthread_join(sched.workers[i].thread, NULL);
+
+	pthread_mutex_lock(&sched.lock);
+	for (i = 0; i < num_workers; i++)
+		mdb_deque_free(&sched.workers[i].deque);
+	mdb_deque_free(&sched.inject);
+	mdb_deque_free(&sched.detached);
+	g_free(sched.workers);
+	sched.workers = NULL;
+	sched.num_workers = 0;
+	sched.stopping = 0;
+	pthread_mutex_unlock(&sched.lock);
+}
+/**
+ * mdb_sched_num_workers:
+ *
+ * Return value: the number of worker threads, starting the scheduler if
+ * needed; 0 if it cannot run.  Parallel operations size their partitions
+ * from this.
+ */
+unsigned int
+mdb_sched_num_workers(void)
+{
+	unsigned int n;
+
+	pthread_mutex_lock(&sched.lock);
+	mdb_sched_start_locked(0);
+	n = sched.num_workers;
+	pthread_mutex_unlock(&sched.lock);
+	return n;
+}
+/**
+ * mdb_task_group_new:
+ *
+ * Return value: an empty task group, to pass to mdb_task_spawn() and
+ * mdb_task_group_wait().
+ */
+MdbTaskGroup *
+mdb_task_group_new(void)
+{
+	return g_malloc0(sizeof(MdbTaskGroup));
+}
+/**
+ * mdb_task_group_free:
+ * @group: task group with no tasks left, i.e. after mdb_task_group_wait()
+ */
+void
+mdb_task_group_free(MdbTaskGroup *group)
+{
+	g_free(group);
+}
+/**
+ * mdb_task_spawn:
+ * @group: group to join the task to, or NULL for a detached task
+ * @func: work to run on a worker thread
+ * @arg: passed to @func
+ *
+ * Queues a task.  From a worker it goes on that worker's own deque, from
+ * any other thread on the injection queue.  A detached task goes on the
+ * detached queue instead, which threads waiting on a group leave alone.
+ *
+ * Return value: 1 if queued; 0 if the scheduler could not be started or is
+ * stopping, in which case the caller should run @func itself.
+ */
+int
+mdb_task_spawn(MdbTaskGroup *group, MdbTaskFunc func, void *arg)
+{
+	MdbWorker *self = current_worker;
+	MdbTask task;
+
+	if (!self) {
+		pthread_mutex_lock(&sched.lock);
+		if (sched.stopping || !mdb_sched_start_locked(0)) {
+			pthread_mutex_unlock(&sched.lock);
+			return 0;
+		}
+		pthread_mutex_unlock(&sched.lock);
+	}
+	task.func = func;
+	task.arg = arg;
+	task.group = group;
+	if (!group) {
+		mdb_deque_push(&sched.detached, &task);
+		__atomic_add_fetch(&sched.detached_queued, 1, __ATOMIC_SEQ_CST);
+		/* a single wakeup could go to a group waiter, which ignores it */
+		mdb_sched_wake(1);
+		return 1;
+	}
+	__atomic_add_fetch(&group->pending, 1, __ATOMIC_ACQ_REL);
+	mdb_deque_push(self ? &self->deque : &sched.inject, &task);
+	__atomic_add_fetch(&sched.queued, 1, __ATOMIC_SEQ_CST);
+	mdb_sched_wake(0);
+	return 1;
+}
+/* caller holds sched.lock */
+static int
+mdb_task_group_done(void *data)
+{
+	MdbTaskGroup *group = data;
+
+	return !__atomic_load_n(&group->pending, __ATOMIC_SEQ_CST);
+}
+/**
+ * mdb_task_group_wait:
+ * @group: task group
+ *
+ * Returns once every task spawned into @group, including ones spawned
+ * while waiting, has finished.  The calling thread runs queued grouped
+ * tasks in the meantime, so it is safe to call from inside a task.
+ */
+void
+mdb_task_group_wait(MdbTaskGroup *group)
+{
+	MdbWorker *self = current_worker;
+	MdbTask task;
+
+	while (__atomic_load_n(&group->pending, __ATOMIC_ACQUIRE)) {
+		if (mdb_sched_find_task(self, &task, 0))
+			mdb_sched_run(&task);
+		else
+			mdb_sched_sleep(0, mdb_task_group_done, group);
+	}
+}
+
+/* Parallel loops */
+
+typedef struct {
+	MdbRangeFunc func;
+	void *arg;
+	unsigned int grain;
+	MdbTaskGroup *group;
+} MdbRangeLoop;
+
+typedef struct {
+	MdbRangeLoop *loop;
+	unsigned int begin, end;
+} MdbRange;
+
+/* Halve the range until it is one grain, leaving the upper halves for
+ * thieves; a busy pool then splits it no more than it has to. */
+static void
+mdb_range_task(void *data)
+{
+	MdbRange *range = data;
+	MdbRangeLoop *loop = range->loop;
+	MdbRange *upper;
+	unsigned int mid;
+
+	while (range->end - range->begin > loop->grain) {
+		mid = range->begin + (range->end - range->begin) / 2;
+		upper = g_malloc(sizeof(MdbRange));
+		upper->loop = loop;
+		upper->begin = mid;
+		upper->end = range->end;
+		if (!mdb_task_spawn(loop->group, mdb_range_task, upper)) {
+			g_free(upper);
+			break;
+		}
+		range->end = mid;
+	}
+	loop->func(range->begin, range->end, loop->arg);
+	g_free(range);
+}
+/**
+ * mdb_parallel_for:
+ * @begin: first index
+ * @end: one past the last index
+ * @grain: smallest range worth a task of its own; 0 picks one that gives
+ *   each worker a few ranges
+ * @func: called with each sub-range [begin, end)
+ * @arg: passed to @func
+ *
+ * Runs @func over [@begin, @end) split into ranges on the scheduler, and
+ * returns when all of them are done.  Sub-ranges may run in any order and
+ * concurrently; each index is covered exactly once.
+ */
+void
+mdb_parallel_for(unsigned int begin, unsigned int end, unsigned int grain,
+	MdbRangeFunc func, void *arg)
+{
+	MdbRangeLoop loop;
+	MdbRange *range;
+	unsigned int n;
+
+	if (end <= begin)
+		return;
+	if (!grain) {
+		n = mdb_sched_num_workers();
+		grain = (end - begin) / (n ? n * 4 : 1);
+	}
+	if (grain < 1)
+		grain = 1;
+	if (end - begin <= grain) {
+		func(begin, end, arg);
+		return;
+	}
+	loop.func = func;
+	loop.arg = arg;
+	loop.grain = grain;
+	loop.group = mdb_task_group_new();
+	range = g_malloc(sizeof(MdbRange));
+	range->loop = &loop;
+	range->begin = begin;
+	range->end = end;
+	/* the caller takes the first range itself */
+	mdb_range_task(range);
+	mdb_task_group_wait(loop.group);
+	mdb_task_group_free(loop.group);
+}
@@ -0,0 +1,308 @@
+/* MDB Tools - A library for reading MS Access database files
+ * Copyright (C) 2000 Brian Bruns
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Snapshot reads.  Every write to a shared MdbFile belongs to a version:
+ * either its own (a lone mdb_write_pg()) or the one opened by
+ * mdb_write_begin() and made visible all at once by mdb_write_commit().
+ * A handle pinned with mdb_snapshot_pin() reads the file as it was at the
+ * last commit before the pin, however many writes follow, until it calls
+ * mdb_snapshot_release().
+ *
+ * Pages are copied on write.  Before a page is overwritten for the first
+ * time in a version, its old bytes are kept as an image of that page
+ * valid until that version, if a snapshot may still need them.  A pinned
+ * reader takes the oldest image of a page made after its version, or the
+ * page on disk when there is none.  Images no pinned snapshot can reach
+ * are dropped on commit and release, so with no pins there are none.
+ *
+ * Handles that are not pinned read the file as it is, as before.  There
+ * is one writer at a time.  The images hold pages as stored, before
+ * decryption.
+ */
+
+#define MDB_MEM_TAG MDB_MEM_PAGE_CACHE
+
+#include <errno.h>
+#include "mdbtools.h"
+#include "mdbprivate.h"
+
+typedef struct MdbPageImage {
+	guint32 pg;
+	guint64 until;		/* version whose write replaced these bytes */
+	unsigned char *buf;
+} MdbPageImage;
+
+void mdbi_snapshot_init(MdbFile *f)
+{
+	pthread_rwlock_init(&f->snap_lock, NULL);
+	f->version = 1;
+}
+void mdbi_snapshot_free(MdbFile *f)
+{
+	unsigned int i;
+
+	for (i = 0; i < f->num_images; i++)
+		g_free(f->images[i].buf);
+	g_free(f->images);
+	g_free(f->pins);
+	pthread_rwlock_destroy(&f->snap_lock);
+}
+/* first image not before (pg, until) */
+static unsigned int
+mdb_snapshot_find(MdbFile *f, guint32 pg, guint64 until)
+{
+	unsigned int lo = 0, hi = f->num_images, mid;
+	MdbPageImage *img;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		img = &f->images[mid];
+		if (img->pg < pg || (img->pg == pg && img->until < until))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+/*
+ * Drops the images no pinned snapshot reads: a pin at version s reads the
+ * image of a page whose until is after s and whose predecessor's is not.
+ * The open write's images stay, for pins taken before it commits.
+ */
+static void
+mdb_snapshot_collect(MdbFile *f)
+{
+	MdbPageImage *img;
+	guint64 from;
+	unsigned int i, j, p;
+	int keep;
+
+	for (i = j = 0; i < f->num_images; i++) {
+		img = &f->images[i];
+		from = (i > 0 && f->images[i - 1].pg == img->pg) ? f->images[i - 1].until : 0;
+		keep = f->write_version && img->until == f->write_version;
+		for (p = 0; p < f->num_pins && !keep; p++)
+			keep = f->pins[p] >= from && f->pins[p] < img->until;
+		if (keep)
+			f->images[j++] = *img;
+		else
+			g_free(img->buf);
+	}
+	f->num_images = j;
+}
+
+/*
+ * Reads page pg into buf as the handle's snapshot sees it, or as the file
+ * is when the handle is not pinned.
+ */
+ssize_t mdbi_read_page(MdbHandle *mdb, void *buf, unsigned long pg, off_t offset)
+{
+	MdbFile *f = mdb->f;
+	ssize_t len;
+	unsigned int i;
+
+	if (!mdb->snapshot)
+		return mdbi_read_at(f, buf, mdb->fmt->pg_size, offset);
+
+	pthread_rwlock_rdlock(&f->snap_lock);
+	i = mdb_snapshot_find(f, pg, mdb->snapshot + 1);
+	if (i < f->num_images && f->images[i].pg == pg) {
+		memcpy(buf, f->images[i].buf, mdb->fmt->pg_size);
+		len = mdb->fmt->pg_size;
+	} else {
+		len = mdbi_read_at(f, buf, mdb->fmt->pg_size, offset);
+	}
+	pthread_rwlock_unlock(&f->snap_lock);
+	return len;
+}
+/*
+ * Writes page pg from buf as part of the open write, or as a version of
+ * its own.  The page's old bytes are kept first when a snapshot may read
+ * them: always during mdb_write_begin(), since a reader may still pin the
+ * version before it, otherwise only while some handle is pinned.
+ */
+ssize_t mdbi_write_page(MdbHandle *mdb, const void *buf, unsigned long pg, off_t offset)
+{
+	MdbFile *f = mdb->f;
+	MdbPageImage *img;
+	guint64 version;
+	ssize_t len;
+	unsigned int i;
+
+	pthread_rwlock_wrlock(&f->snap_lock);
+	version = f->write_version ? f->write_version : f->version + 1;
+	i = mdb_snapshot_find(f, pg, version);
+	if ((f->write_version || f->num_pins)
+	 && (i == f->num_images || f->images[i].pg != pg || f->images[i].until != version)) {
+		if (f->num_images == f->images_size) {
+			f->images_size = f->images_size ? f->images_size * 2 : 64;
+			f->images = g_realloc(f->images, f->images_size * sizeof(MdbPageImage));
+		}
+		memmove(&f->images[i + 1], &f->images[i], (f->num_images - i) * sizeof(MdbPageImage));
+		img = &f->images[i];
+		img->pg = pg;
+		img->until = version;
+		img->buf = g_malloc0(mdb->fmt->pg_size);
+		f->num_images++;
+		if (mdbi_read_at(f, img->buf, mdb->fmt->pg_size, offset) == -1) {
+			fprintf(stderr, "Unable to keep page %lu for snapshots: %s\n", pg, strerror(errno));
+			g_free(img->buf);
+			f->num_images--;
+			memmove(&f->images[i], &f->images[i + 1], (f->num_images - i) * sizeof(MdbPageImage));
+			pthread_rwlock_unlock(&f->snap_lock);
+			return -1;
+		}
+	}
+
+	len = mdbi_write_at(f, buf, mdb->fmt->pg_size, offset);
+	if (!f->write_version) {
+		f->version = version;
+		mdb_snapshot_collect(f);
+	}
+	pthread_rwlock_unlock(&f->snap_lock);
+	return len;
+}
+
+/**
+ * mdb_snapshot_pin:
+ * @mdb: handle to read from
+ *
+ * Pins @mdb, and cursors opened from it, to the file as of the last
+ * commit.  Later writes through other handles are not seen until the
+ * handle is released or pinned again.  Pinning a pinned handle moves it
+ * to the latest version.  Tables and catalogs read before the pin keep
+ * what they read; read them again after pinning.
+ *
+ * Return value: the version pinned
+ */
+guint64 mdb_snapshot_pin(MdbHandle *mdb)
+{
+	MdbFile *f = mdb->f;
+	unsigned int p;
+
+	pthread_rwlock_wrlock(&f->snap_lock);
+	for (p = 0; mdb->snapshot && p < f->num_pins; p++) {
+		if (f->pins[p] == mdb->snapshot) {
+			f->pins[p] = f->pins[--f->num_pins];
+			break;
+		}
+	}
+	f->pins = g_realloc(f->pins, (f->num_pins + 1) * sizeof(guint64));
+	f->pins[f->num_pins++] = f->version;
+	mdb->snapshot = f->version;
+	mdb_snapshot_collect(f);
+	pthread_rwlock_unlock(&f->snap_lock);
+
+	/* the page buffer may hold a page of another version */
+	mdb->cur_pg = 0;
+	return mdb->snapshot;
+}
+/**
+ * mdb_snapshot_release:
+ * @mdb: pinned handle
+ *
+ * Unpins @mdb so it reads the file as it is, and frees the page images
+ * only its snapshot needed.
+ */
+void mdb_snapshot_release(MdbHandle *mdb)
+{
+	MdbFile *f = mdb->f;
+	unsigned int p;
+
+	if (!mdb->snapshot)
+		return;
+	pthread_rwlock_wrlock(&f->snap_lock);
+	for (p = 0; p < f->num_pins; p++) {
+		if (f->pins[p] == mdb->snapshot) {
+			f->pins[p] = f->pins[--f->num_pins];
+			break;
+		}
+	}
+	mdb->snapshot = 0;
+	mdb_snapshot_collect(f);
+	pthread_rwlock_unlock(&f->snap_lock);
+	mdb->cur_pg = 0;
+}
+/**
+ * mdb_snapshot_latest:
+ *
+ * Return value: the version of the last commit, to compare with the one a
+ * handle has pinned
+ */
+guint64 mdb_snapshot_latest(MdbHandle *mdb)
+{
+	guint64 version;
+
+	pthread_rwlock_rdlock(&mdb->f->snap_lock);
+	version = mdb->f->version;
+	pthread_rwlock_unlock(&mdb->f->snap_lock);
+	return version;
+}
+/* adds a pin for a clone of a pinned handle */
+void mdbi_snapshot_share(MdbHandle *mdb)
+{
+	MdbFile *f = mdb->f;
+
+	pthread_rwlock_wrlock(&f->snap_lock);
+	f->pins = g_realloc(f->pins, (f->num_pins + 1) * sizeof(guint64));
+	f->pins[f->num_pins++] = mdb->snapshot;
+	pthread_rwlock_unlock(&f->snap_lock);
+}
+/**
+ * mdb_write_begin:
+ * @mdb: writable handle
+ *
+ * Opens a write: pages written from here on, through any handle, form one
+ * new version that pinned readers see only after mdb_write_commit().
+ *
+ * Return value: 1 on success, 0 if a write is already open
+ */
+int mdb_write_begin(MdbHandle *mdb)
+{
+	MdbFile *f = mdb->f;
+
+	pthread_rwlock_wrlock(&f->snap_lock);
+	if (f->write_version) {
+		pthread_rwlock_unlock(&f->snap_lock);
+		fprintf(stderr, "A write is already open\n");
+		return 0;
+	}
+	f->write_version = f->version + 1;
+	pthread_rwlock_unlock(&f->snap_lock);
+	return 1;
+}
+/**
+ * mdb_write_commit:
+ * @mdb: handle that opened the write
+ *
+ * Makes the open write the latest version, for every pin taken from now
+ * on.  Snapshots pinned before keep reading the old pages.
+ */
+void mdb_write_commit(MdbHandle *mdb)
+{
+	MdbFile *f = mdb->f;
+
+	pthread_rwlock_wrlock(&f->snap_lock);
+	if (f->write_version) {
+		f->version = f->write_version;
+		f->write_version = 0;
+		mdb_snapshot_collect(f);
+	}
+	pthread_rwlock_unlock(&f->snap_lock);
+}
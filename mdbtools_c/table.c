@@ -16,6 +16,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#define MDB_MEM_TAG MDB_MEM_TABLEDEF
+
 #include "mdbtools.h"
 #include "mdbprivate.h"
 
@@ -41,15 +43,13 @@ void mdb_free_tabledef(MdbTableDef *table)
 {
 	if (!table) return;
 	if (table->is_temp_table) {
-		guint i;
-		/* Temp table pages are being stored in memory */
-		for (i=0; i<table->temp_table_pages->len; i++)
-			g_free(g_ptr_array_index(table->temp_table_pages,i));
-		g_ptr_array_free(table->temp_table_pages, TRUE);
+		/* Temp table pages are in memory or the spill file */
+		mdb_temp_table_free_pages(table);
 		/* Temp tables use dummy entries */
 		g_free(table->entry);
 	}
 	mdb_free_columns(table->columns);
+	mdb_free_row_plan(table);
 	mdb_free_indices(table->indices);
 	g_free(table->usage_map);
 	g_free(table->free_usage_map);
@@ -220,7 +220,7 @@ void mdb_free_columns(GPtrArray *columns)
 		col = (MdbColumn *) g_ptr_array_index(columns, i);
 		if (col->sargs) {
 			for (j=0; j<col->sargs->len; j++) {
-				g_free( g_ptr_array_index(col->sargs, j));
+				mdb_free_sarg( g_ptr_array_index(col->sargs, j));
 			}
 			g_ptr_array_free(col->sargs, TRUE);
 		}
@@ -342,8 +342,64 @@ GPtrArray *mdb_read_columns(MdbTableDef *table)
 			}
 		}
 	table->index_start = cur_pos;
+	mdb_build_row_plan(table);
 	return table->columns;
 }
+/**
+ * mdb_build_row_plan:
+ * @table: table whose columns have been read
+ *
+ * Flattens what mdb_crack_row() needs from each column (null mask
+ * position, fixed offset or variable column slot, size) and the
+ * JET3/JET4 row header layout into table->row_plan, replacing any older
+ * plan.  mdb_read_columns() calls this; temp tables get theirs on first
+ * use, after mdb_temp_columns_end().
+ *
+ * Return value: the plan.
+ */
+MdbRowPlan *mdb_build_row_plan(MdbTableDef *table)
+{
+	MdbHandle *mdb = table->entry->mdb;
+	MdbRowPlan *plan;
+	MdbRowPlanCol *pc;
+	MdbColumn *col;
+	unsigned int i;
+
+	mdb_free_row_plan(table);
+	plan = g_malloc0(sizeof(MdbRowPlan));
+	plan->jet3 = IS_JET3(mdb);
+	plan->col_count_size = plan->jet3 ? 1 : 2;
+	plan->num_cols = table->num_cols;
+	plan->num_var_cols = table->num_var_cols;
+	plan->cols = g_malloc0(table->num_cols * sizeof(MdbRowPlanCol) + 1);
+	for (i=0;i<table->num_cols;i++) {
+		col = g_ptr_array_index(table->columns, i);
+		pc = &plan->cols[i];
+		pc->is_fixed = col->is_fixed;
+		pc->null_byte = col->col_num / 8;
+		pc->null_bit = 1 << (col->col_num % 8);
+		pc->null_pos = col->col_num;
+		if (pc->null_byte >= plan->mask_bytes)
+			plan->mask_bytes = pc->null_byte + 1;
+		if (col->is_fixed) {
+			pc->offset = col->fixed_offset + plan->col_count_size;
+			pc->size = col->col_size;
+		} else {
+			pc->offset = col->var_col_num;
+			if (col->var_col_num >= plan->var_slots)
+				plan->var_slots = col->var_col_num + 1;
+		}
+	}
+	return table->row_plan = plan;
+}
+void mdb_free_row_plan(MdbTableDef *table)
+{
+	if (!table->row_plan)
+		return;
+	g_free(table->row_plan->cols);
+	g_free(table->row_plan);
+	table->row_plan = NULL;
+}
 
 void mdb_table_dump(MdbCatalogEntry *entry)
 {
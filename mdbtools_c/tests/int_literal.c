@@ -0,0 +1,120 @@
+/* MDB Tools - A library for reading MS Access database files
+ * Copyright (C) 2000 Brian Bruns
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * A fractional literal against an integer column is compared as a double,
+ * by the row test and by the page filter alike: "Id = 1.5" matches no row,
+ * "Id >= 1.5" starts at 2 and "Id < 1.5" ends at 1.
+ *
+ * Build it with the engine's sources, as the app target does, and run it
+ * from a writable directory; it exits non-zero on failure.
+ */
+
+#include <stdio.h>
+#include "mdbtools.h"
+
+#define FIRST_ID	-300
+#define LAST_ID		300
+
+static MdbHandle *
+open_scratch(const char *path)
+{
+	unsigned char pg[4096];
+	FILE *f;
+
+	if (!(f = fopen(path, "wb")))
+		return NULL;
+	memset(pg, 0, sizeof(pg));
+	pg[0x14] = 1;	/* Jet4 */
+	fwrite(pg, 1, sizeof(pg), f);
+	pg[0x14] = 0;
+	fwrite(pg, 1, sizeof(pg), f);
+	fclose(f);
+	return mdb_open(path, MDB_NOFLAGS);
+}
+
+static int
+check(MdbTableDef *table, int op, double d)
+{
+	MdbSargNode node;
+	MdbBatch *batch;
+	unsigned int want = 0, rows = 0, batched = 0, got;
+	gint32 id;
+	int ok = 1;
+
+	for (id = FIRST_ID; id <= LAST_ID; id++)
+		want += mdb_test_double(op, d, id);
+
+	memset(&node, 0, sizeof(node));
+	node.op = op;
+	node.col = g_ptr_array_index(table->columns, 0);
+	node.val_type = MDB_DOUBLE;
+	node.value.d = d;
+	table->sarg_tree = &node;
+
+	mdb_rewind_table(table);
+	while (mdb_fetch_row(table))
+		rows++;
+
+	batch = mdb_alloc_batch(table, 64);
+	mdb_rewind_table(table);
+	while ((got = mdb_fetch_batch(table, batch)))
+		batched += got;
+	mdb_free_batch(batch);
+	table->sarg_tree = NULL;
+
+	if (rows != want || batched != want) {
+		fprintf(stderr, "op %d %g: want %u rows, mdb_fetch_row %u, mdb_fetch_batch %u\n",
+			op, d, want, rows, batched);
+		ok = 0;
+	}
+	return ok;
+}
+
+int
+main(void)
+{
+	MdbHandle *mdb;
+	MdbTableDef *table;
+	MdbColumn col;
+	MdbField field;
+	unsigned char row[4096];
+	gint32 id;
+	int ok;
+
+	mdb = open_scratch("int_literal.mdb");
+	table = mdb_create_temp_table(mdb, "Literal");
+	mdb_fill_temp_col(&col, "Id", 0, MDB_LONGINT, 1);
+	mdb_temp_table_add_col(table, &col);
+	mdb_temp_columns_end(table);
+	for (id = FIRST_ID; id <= LAST_ID; id++) {
+		mdb_fill_temp_field(&field, &id, 4, 1, 0, 0, 0);
+		mdb_add_row_to_pg(table, row, mdb_pack_row(table, row, 1, &field));
+	}
+
+	ok = check(table, MDB_EQUAL, 1.5) & check(table, MDB_NEQ, 1.5)
+		& check(table, MDB_GTEQ, 1.5) & check(table, MDB_GT, 1.5)
+		& check(table, MDB_LT, 1.5) & check(table, MDB_LTEQ, 1.5)
+		& check(table, MDB_GT, -2.5) & check(table, MDB_EQUAL, 2.0);
+
+	mdb_free_tabledef(table);
+	mdb_close(mdb);
+	remove("int_literal.mdb");
+	printf("%s\n", ok ? "ok" : "FAILED");
+	return !ok;
+}
@@ -0,0 +1,167 @@
+/* MDB Tools - A library for reading MS Access database files
+ * Copyright (C) 2000 Brian Bruns
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * A sequential scan stops at the end of the table and stays there:
+ * mdb_fetch_row() and mdb_fetch_batch() return 0 after the last row, and
+ * again on every later call, and the batch that runs out says so.
+ *
+ * The rows are packed into a temp table, whose pages are then written out
+ * as the data pages of a table at page 1 of a scratch file, followed by a
+ * page of another table, so the scan runs over real pages and a usage map.
+ *
+ * Build it with the engine's sources, as the app target does, and run it
+ * from a writable directory; it exits non-zero on failure.
+ */
+
+#include <stdio.h>
+#include "mdbtools.h"
+
+static MdbHandle *
+open_scratch(const char *path, unsigned int num_pages, unsigned char **pages)
+{
+	unsigned char pg[4096];
+	unsigned int i;
+	FILE *f;
+
+	if (!(f = fopen(path, "wb")))
+		return NULL;
+	memset(pg, 0, sizeof(pg));
+	pg[0x14] = 1;	/* Jet4 */
+	fwrite(pg, 1, sizeof(pg), f);
+	pg[0x14] = 0;
+	fwrite(pg, 1, sizeof(pg), f);
+	for (i = 0; i < num_pages; i++) {
+		memcpy(pg, pages[i], sizeof(pg));
+		pg[0] = MDB_PAGE_DATA;
+		mdb_put_int32(pg, 4, 1);
+		fwrite(pg, 1, sizeof(pg), f);
+	}
+	memset(pg, 0, sizeof(pg));
+	pg[0] = MDB_PAGE_DATA;
+	mdb_put_int32(pg, 4, 9);
+	fwrite(pg, 1, sizeof(pg), f);
+	fclose(f);
+	return mdb_open(path, MDB_NOFLAGS);
+}
+
+static MdbTableDef *
+new_table(MdbHandle *mdb)
+{
+	MdbTableDef *table = mdb_create_temp_table(mdb, "Scan");
+	MdbColumn col;
+
+	mdb_fill_temp_col(&col, "Id", 0, MDB_LONGINT, 1);
+	mdb_temp_table_add_col(table, &col);
+	mdb_fill_temp_col(&col, "Name", 255, MDB_TEXT, 0);
+	mdb_temp_table_add_col(table, &col);
+	mdb_temp_columns_end(table);
+	return table;
+}
+
+static int
+check(unsigned int num_rows)
+{
+	MdbHandle *tmp_mdb, *mdb;
+	MdbTableDef *tmp, *table;
+	MdbField fields[2];
+	MdbBatch *batch;
+	unsigned char row[4096];
+	char name[40];
+	unsigned int i, j, len, num_pages, fetched, calls, got;
+	gint32 id;
+	int ok = 1;
+
+	tmp_mdb = open_scratch("scan_end_tmp.mdb", 0, NULL);
+	tmp = new_table(tmp_mdb);
+	for (i = 0; i < num_rows; i++) {
+		id = i;
+		memset(name, 0, sizeof(name));
+		snprintf(name, sizeof(name), "r%u", i);
+		/* UCS-2, as stored */
+		len = strlen(name);
+		for (j = len; j-- > 0; ) {
+			name[j * 2] = name[j];
+			name[j * 2 + 1] = 0;
+		}
+		mdb_fill_temp_field(&fields[0], &id, 4, 1, 0, 0, 0);
+		mdb_fill_temp_field(&fields[1], name, len * 2, 0, 0, 0, 1);
+		mdb_add_row_to_pg(tmp, row, mdb_pack_row(tmp, row, 2, fields));
+	}
+	num_pages = tmp->temp_table_pages->len;
+
+	mdb = open_scratch("scan_end.mdb", num_pages, (unsigned char **)tmp->temp_table_pages->pdata);
+	mdb->f->db_key = 0;
+	table = new_table(mdb);
+	table->is_temp_table = 0;
+	table->entry->table_pg = 1;
+	table->strategy = MDB_TABLE_SCAN;
+	table->map_sz = 5 + (num_pages + 8) / 8;
+	table->usage_map = g_malloc0(table->map_sz);
+	mdb_put_int32(table->usage_map, 1, 2);
+	for (i = 0; i <= num_pages; i++)
+		table->usage_map[5 + i / 8] |= 1 << (i % 8);
+
+	mdb_rewind_table(table);
+	for (fetched = 0; mdb_fetch_row(table); fetched++)
+		;
+	if (fetched != num_rows || mdb_fetch_row(table) || mdb_fetch_row(table)) {
+		fprintf(stderr, "%u rows: mdb_fetch_row returned %u, or rows past the end\n",
+			num_rows, fetched);
+		ok = 0;
+	}
+
+	batch = mdb_alloc_batch(table, 100);
+	mdb_rewind_table(table);
+	for (fetched = calls = 0; calls <= num_rows / 100 + 1 && (got = mdb_fetch_batch(table, batch)); calls++) {
+		fetched += got;
+		if (batch->at_end != (fetched == num_rows && got < batch->capacity)) {
+			fprintf(stderr, "%u rows: at_end %d after %u rows\n", num_rows, batch->at_end, fetched);
+			ok = 0;
+		}
+	}
+	if (fetched != num_rows) {
+		fprintf(stderr, "%u rows: mdb_fetch_batch returned %u\n", num_rows, fetched);
+		ok = 0;
+	}
+	for (i = 0; i < 3; i++) {
+		if (mdb_fetch_batch(table, batch) || !batch->at_end) {
+			fprintf(stderr, "%u rows: mdb_fetch_batch returned rows past the end\n", num_rows);
+			ok = 0;
+			break;
+		}
+	}
+
+	mdb_free_batch(batch);
+	mdb_free_tabledef(table);
+	mdb_close(mdb);
+	mdb_free_tabledef(tmp);
+	mdb_close(tmp_mdb);
+	return ok;
+}
+
+int
+main(void)
+{
+	int ok = check(0) & check(1) & check(3000);
+
+	remove("scan_end_tmp.mdb");
+	remove("scan_end.mdb");
+	printf("%s\n", ok ? "ok" : "FAILED");
+	return !ok;
+}
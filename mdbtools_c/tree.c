@@ -0,0 +1,579 @@
+/* MDB Tools - A library for reading MS Access database files
+ * Copyright (C) 2000 Brian Bruns
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Materialized hierarchy of a table whose rows point at a parent row of
+ * the same table, e.g. CAT (hcat, hcatParent).  The tree is worked out
+ * once: each node gets its parent, its root, its depth, its path (the
+ * names from the root down) and its children sorted by name.
+ *
+ * Nodes remember the data page they were read from.  A tree saved with
+ * mdb_tree_save() keeps the checksum of every page (mdb_table_page_sums()),
+ * so mdb_tree_open() only decodes again the rows of pages that changed
+ * since, drops those of pages that are gone, and relinks the rest in
+ * memory.  An unchanged table costs a checksum of its pages and nothing
+ * else.
+ *
+ * A tree never changes once opened, so threads may share it.
+ */
+
+#define MDB_MEM_TAG MDB_MEM_TREE
+
+#include "mdbtools.h"
+
+#define MDB_TREE_MAGIC "MDBTRE01"
+
+struct MdbTree {
+	char *spec;		/* table, columns and separator it was built from */
+	char *sep;
+	MdbTreeNode *nodes;	/* sorted by id */
+	unsigned int num_nodes;
+	unsigned int nodes_size;
+	guint32 *children;	/* node numbers grouped by parent, roots first */
+	unsigned int num_roots;
+	MdbPageSum *sums;	/* pages the nodes were read from, in scan order */
+	unsigned int num_sums;
+};
+
+static MdbTree *mdb_tree_load(const char *path, const char *spec);
+
+static MdbTree *
+mdb_tree_alloc(const char *spec, const char *sep)
+{
+	MdbTree *tree;
+
+	tree = g_malloc0(sizeof(MdbTree));
+	tree->spec = g_strdup(spec);
+	tree->sep = g_strdup(sep);
+	return tree;
+}
+static void
+mdb_tree_free_paths(MdbTree *tree)
+{
+	unsigned int i;
+
+	for (i = 0; i < tree->num_nodes; i++) {
+		g_free((char *)tree->nodes[i].path);
+		tree->nodes[i].path = tree->nodes[i].subpath = NULL;
+	}
+	g_free(tree->children);
+	tree->children = NULL;
+}
+void
+mdb_tree_free(MdbTree *tree)
+{
+	unsigned int i;
+
+	if (!tree)
+		return;
+	mdb_tree_free_paths(tree);
+	for (i = 0; i < tree->num_nodes; i++)
+		g_free((char *)tree->nodes[i].name);
+	g_free(tree->nodes);
+	g_free(tree->sums);
+	g_free(tree->spec);
+	g_free(tree->sep);
+	g_free(tree);
+}
+static void
+mdb_tree_add_node(MdbTree *tree, gint32 id, gint32 parent_id, guint32 pg, const char *name, size_t len)
+{
+	MdbTreeNode *node;
+
+	if (tree->num_nodes == tree->nodes_size) {
+		tree->nodes_size = tree->nodes_size ? tree->nodes_size * 2 : 64;
+		tree->nodes = g_realloc(tree->nodes, tree->nodes_size * sizeof(MdbTreeNode));
+	}
+	node = &tree->nodes[tree->num_nodes++];
+	memset(node, 0, sizeof(MdbTreeNode));
+	node->id = id;
+	node->parent_id = parent_id;
+	node->pg = pg;
+	node->name = g_strndup(name, len);
+}
+
+/* Linking */
+
+static int
+mdb_tree_id_cmp(const void *a, const void *b)
+{
+	const MdbTreeNode *na = a, *nb = b;
+
+	if (na->id != nb->id)
+		return na->id < nb->id ? -1 : 1;
+	return na->pg < nb->pg ? -1 : na->pg > nb->pg;
+}
+static int
+mdb_tree_name_cmp(const void *a, const void *b)
+{
+	const MdbTreeNode *na = *(MdbTreeNode * const *)a;
+	const MdbTreeNode *nb = *(MdbTreeNode * const *)b;
+	int ret;
+
+	if (na->parent != nb->parent)
+		return na->parent < nb->parent ? -1 : 1;
+	if ((ret = g_ascii_strcasecmp(na->name, nb->name)))
+		return ret;
+	return na->id < nb->id ? -1 : na->id > nb->id;
+}
+static int
+mdb_tree_depth_cmp(const void *a, const void *b)
+{
+	const MdbTreeNode *na = *(MdbTreeNode * const *)a;
+	const MdbTreeNode *nb = *(MdbTreeNode * const *)b;
+
+	if (na->depth != nb->depth)
+		return na->depth < nb->depth ? -1 : 1;
+	return na->id < nb->id ? -1 : na->id > nb->id;
+}
+/*
+ * Works out every node's links, depth, root, path and children from the
+ * ids and parent ids alone, after a build or a refresh.  A parent id that
+ * is missing makes a root; so does the node at which a parent cycle is
+ * first met, walking up from each node in id order.  The rest of the
+ * cycle, and whatever hangs off it, stays below that node.
+ */
+static void
+mdb_tree_link(MdbTree *tree)
+{
+	MdbTreeNode *node, **order;
+	guint32 *walk;
+	unsigned int i, j;
+	int n, p;
+	size_t len;
+	char *path;
+
+	mdb_tree_free_paths(tree);
+	qsort(tree->nodes, tree->num_nodes, sizeof(MdbTreeNode), mdb_tree_id_cmp);
+	/* the same id on two pages: keep the first */
+	for (i = j = 0; i < tree->num_nodes; i++) {
+		if (j && tree->nodes[j - 1].id == tree->nodes[i].id) {
+			g_free((char *)tree->nodes[i].name);
+			continue;
+		}
+		tree->nodes[j++] = tree->nodes[i];
+	}
+	tree->num_nodes = j;
+
+	for (i = 0; i < tree->num_nodes; i++) {
+		node = &tree->nodes[i];
+		node->parent = node->parent_id == node->id ? -1 : mdb_tree_find(tree, node->parent_id);
+		node->depth = 0;
+	}
+	/* walk[n] is the walk that first reached node n; a walk that comes back
+	 * to one of its own nodes has found a cycle, which it cuts there */
+	walk = g_malloc0((tree->num_nodes + 1) * sizeof(guint32));
+	for (i = 0; i < tree->num_nodes; i++) {
+		for (n = i; n >= 0 && !walk[n]; n = tree->nodes[n].parent)
+			walk[n] = i + 1;
+		if (n >= 0 && walk[n] == i + 1)
+			tree->nodes[n].parent = -1;
+	}
+	g_free(walk);
+	for (i = 0; i < tree->num_nodes; i++)
+		for (p = tree->nodes[i].parent; p >= 0; p = tree->nodes[p].parent)
+			tree->nodes[i].depth++;
+
+	/* shallowest first, so a parent's path is ready before its children */
+	order = g_malloc((tree->num_nodes + 1) * sizeof(MdbTreeNode *));
+	for (i = 0; i < tree->num_nodes; i++)
+		order[i] = &tree->nodes[i];
+	qsort(order, tree->num_nodes, sizeof(MdbTreeNode *), mdb_tree_depth_cmp);
+	for (i = 0; i < tree->num_nodes; i++) {
+		node = order[i];
+		if (node->parent < 0) {
+			node->root = node - tree->nodes;
+			node->path = g_strdup(node->name);
+			node->subpath = node->path + strlen(node->path);
+			continue;
+		}
+		p = node->parent;
+		node->root = tree->nodes[p].root;
+		len = strlen(tree->nodes[p].path) + strlen(tree->sep) + strlen(node->name);
+		path = g_malloc(len + 1);
+		snprintf(path, len + 1, "%s%s%s", tree->nodes[p].path, tree->sep, node->name);
+		node->path = path;
+		/* below the root: skip the root's name and the separator after it */
+		node->subpath = path + strlen(tree->nodes[node->root].name) + strlen(tree->sep);
+	}
+
+	/* roots sort first as their parent is -1; then each parent's children */
+	for (i = 0; i < tree->num_nodes; i++)
+		order[i] = &tree->nodes[i];
+	qsort(order, tree->num_nodes, sizeof(MdbTreeNode *), mdb_tree_name_cmp);
+	tree->children = g_malloc((tree->num_nodes + 1) * sizeof(guint32));
+	tree->num_roots = 0;
+	for (i = 0; i < tree->num_nodes; i++) {
+		tree->children[i] = order[i] - tree->nodes;
+		tree->nodes[i].num_children = 0;
+	}
+	for (i = 0; i < tree->num_nodes; i++) {
+		node = order[i];
+		if (node->parent < 0) {
+			tree->num_roots++;
+			continue;
+		}
+		if (!tree->nodes[node->parent].num_children++)
+			tree->nodes[node->parent].first_child = i;
+	}
+	g_free(order);
+}
+
+/* Reading */
+
+static int
+mdb_tree_col(MdbTableDef *table, MdbBatch *batch, const char *col_name, MdbBatchKind kind)
+{
+	unsigned int i;
+
+	for (i = 0; i < batch->num_cols; i++) {
+		if (g_ascii_strcasecmp(batch->columns[i].col->name, col_name))
+			continue;
+		if (batch->columns[i].kind != kind) {
+			fprintf(stderr, "Column %s has the wrong type\n", col_name);
+			return -1;
+		}
+		return i;
+	}
+	fprintf(stderr, "Column %s not found in %s\n", col_name, table->name);
+	return -1;
+}
+/*
+ * Adds the rows of the table's pages, or only those of the sorted pages
+ * in filter when it is set.  Rows with a null id or name are left out.
+ */
+static int
+mdb_tree_read_rows(MdbTree *tree, MdbTableDef *table, const char *id_col,
+	const char *parent_col, const char *name_col, const guint32 *filter, unsigned int num_filter)
+{
+	MdbBatch *batch;
+	MdbBatchColumn *ids, *parents, *names;
+	int id_num, parent_num, name_num, count;
+	unsigned int i;
+	gint32 parent_id;
+
+	batch = mdb_alloc_batch(table, 0);
+	id_num = mdb_tree_col(table, batch, id_col, MDB_BATCH_INT32);
+	parent_num = mdb_tree_col(table, batch, parent_col, MDB_BATCH_INT32);
+	name_num = mdb_tree_col(table, batch, name_col, MDB_BATCH_STRING);
+	if (id_num < 0 || parent_num < 0 || name_num < 0) {
+		mdb_free_batch(batch);
+		return 0;
+	}
+	ids = &batch->columns[id_num];
+	parents = &batch->columns[parent_num];
+	names = &batch->columns[name_num];
+	batch->page_filter = filter;
+	batch->num_page_filter = num_filter;
+
+	mdb_rewind_table(table);
+	while ((count = mdb_fetch_batch(table, batch)) > 0) {
+		for (i = 0; i < (unsigned int)count; i++) {
+			if (!(ids->validity[i >> 3] >> (i & 7) & 1) ||
+			    !(names->validity[i >> 3] >> (i & 7) & 1))
+				continue;
+			parent_id = -1;
+			if (parents->validity[i >> 3] >> (i & 7) & 1)
+				parent_id = ((gint32 *)parents->values)[i];
+			mdb_tree_add_node(tree, ((gint32 *)ids->values)[i], parent_id, batch->pages[i],
+				names->data + names->offsets[i], names->offsets[i + 1] - names->offsets[i]);
+		}
+		if (batch->at_end)
+			break;
+	}
+	mdb_free_batch(batch);
+	return 1;
+}
+static int
+mdb_tree_sum_cmp(const void *a, const void *b)
+{
+	const MdbPageSum *sa = a, *sb = b;
+
+	return sa->pg < sb->pg ? -1 : sa->pg > sb->pg;
+}
+static int
+mdb_tree_u32_cmp(const void *a, const void *b)
+{
+	guint32 ua = *(const guint32 *)a, ub = *(const guint32 *)b;
+
+	return ua < ub ? -1 : ua > ub;
+}
+/*
+ * Brings a loaded tree up to date with sums, the table's current pages.
+ * Nodes of pages that are gone or rewritten are dropped and those pages
+ * read again.
+ *
+ * Return value: -1 on error, else the number of pages read.
+ */
+static int
+mdb_tree_refresh(MdbTree *tree, MdbTableDef *table, const char *id_col,
+	const char *parent_col, const char *name_col, MdbPageSum *sums, unsigned int num_sums)
+{
+	MdbPageSum *old, key, *found;
+	guint32 *changed, *changed_found;
+	unsigned int i, j, num_changed = 0;
+	int ok = 1;
+
+	old = g_memdup(tree->sums, tree->num_sums * sizeof(MdbPageSum));
+	qsort(old, tree->num_sums, sizeof(MdbPageSum), mdb_tree_sum_cmp);
+	changed = g_malloc((num_sums + 1) * sizeof(guint32));
+	for (i = 0; i < num_sums; i++) {
+		key.pg = sums[i].pg;
+		found = bsearch(&key, old, tree->num_sums, sizeof(MdbPageSum), mdb_tree_sum_cmp);
+		if (!found || found->sum != sums[i].sum)
+			changed[num_changed++] = sums[i].pg;
+	}
+	g_free(old);
+	qsort(changed, num_changed, sizeof(guint32), mdb_tree_u32_cmp);
+
+	/* keep the nodes of pages that are still there unchanged */
+	old = g_memdup(sums, num_sums * sizeof(MdbPageSum));
+	qsort(old, num_sums, sizeof(MdbPageSum), mdb_tree_sum_cmp);
+	for (i = j = 0; i < tree->num_nodes; i++) {
+		key.pg = tree->nodes[i].pg;
+		changed_found = bsearch(&key.pg, changed, num_changed, sizeof(guint32), mdb_tree_u32_cmp);
+		if (changed_found ||
+		    !bsearch(&key, old, num_sums, sizeof(MdbPageSum), mdb_tree_sum_cmp)) {
+			g_free((char *)tree->nodes[i].name);
+			continue;
+		}
+		tree->nodes[j++] = tree->nodes[i];
+	}
+	g_free(old);
+	/* paths and children point into nodes that moved */
+	if (j != tree->num_nodes || num_changed)
+		mdb_tree_free_paths(tree);
+	tree->num_nodes = j;
+
+	if (num_changed)
+		ok = mdb_tree_read_rows(tree, table, id_col, parent_col, name_col, changed, num_changed);
+	g_free(changed);
+	return ok ? (int)num_changed : -1;
+}
+static char *
+mdb_tree_spec(const char *table_name, const char *id_col, const char *parent_col,
+	const char *name_col, const char *sep)
+{
+	return g_strdup_printf("%s.%s.%s.%s|%s", table_name, id_col, parent_col, name_col, sep);
+}
+
+/**
+ * mdb_tree_open:
+ * @mdb: Handle to open MDB database file
+ * @table_name: table holding the hierarchy, e.g. "CAT"
+ * @id_col: its integer id column, e.g. "hcat"
+ * @parent_col: its integer parent id column, e.g. "hcatParent"; null, or
+ * an id not in the table, makes a root
+ * @name_col: its name column, e.g. "szFull"
+ * @sep: put between the names of a path, e.g. " : "
+ * @path: file the tree is kept in between runs, or NULL
+ *
+ * Opens the tree saved at @path and updates it from the pages of
+ * @table_name that changed since it was saved, saving it again if any
+ * did.  Without a saved tree, builds it from every row and saves it.
+ *
+ * Return value: the tree, or NULL if the table or a column is missing.
+ */
+MdbTree *
+mdb_tree_open(MdbHandle *mdb, const char *table_name, const char *id_col,
+	const char *parent_col, const char *name_col, const char *sep, const char *path)
+{
+	MdbTableDef *table;
+	MdbTree *tree = NULL;
+	MdbPageSum *sums;
+	unsigned int num_sums;
+	char *spec;
+	int read, built = 0;
+
+	table = mdb_read_table_by_name(mdb, (gchar *)table_name, MDB_TABLE);
+	if (!table) {
+		fprintf(stderr, "Table %s not found\n", table_name);
+		return NULL;
+	}
+	mdb_read_columns(table);
+	num_sums = mdb_table_page_sums(table, &sums);
+
+	spec = mdb_tree_spec(table_name, id_col, parent_col, name_col, sep);
+	if (path)
+		tree = mdb_tree_load(path, spec);
+	if (tree) {
+		read = mdb_tree_refresh(tree, table, id_col, parent_col, name_col, sums, num_sums);
+	} else {
+		tree = mdb_tree_alloc(spec, sep);
+		read = mdb_tree_read_rows(tree, table, id_col, parent_col, name_col, NULL, 0) ? (int)num_sums : -1;
+		built = 1;
+	}
+	g_free(spec);
+	mdb_free_tabledef(table);
+	if (read < 0) {
+		mdb_free_page_sums(sums);
+		mdb_tree_free(tree);
+		return NULL;
+	}
+
+	g_free(tree->sums);
+	tree->sums = g_memdup(sums, num_sums * sizeof(MdbPageSum));
+	tree->num_sums = num_sums;
+	mdb_free_page_sums(sums);
+	if (!tree->children)
+		mdb_tree_link(tree);
+	if ((read || built) && path)
+		mdb_tree_save(tree, path);
+	return tree;
+}
+
+/* Persistence */
+
+/**
+ * mdb_tree_save:
+ * @tree: tree to save
+ * @path: file to write
+ *
+ * Saves the rows behind @tree and the checksums of the pages they came
+ * from, for mdb_tree_open(), written as described in persist.c.
+ *
+ * Return value: 1 on success, 0 on failure.
+ */
+int
+mdb_tree_save(MdbTree *tree, const char *path)
+{
+	MdbTreeNode *node;
+	char *tmp_path;
+	FILE *f;
+	unsigned int i;
+	int ok;
+
+	if (!(f = mdb_persist_create(path, MDB_TREE_MAGIC, tree->spec, &tmp_path)))
+		return 0;
+	ok = mdb_persist_write(f, &tree->num_sums, sizeof(guint32)) &&
+		mdb_persist_write(f, tree->sums, tree->num_sums * sizeof(MdbPageSum)) &&
+		mdb_persist_write(f, &tree->num_nodes, sizeof(guint32));
+	for (i = 0; ok && i < tree->num_nodes; i++) {
+		node = &tree->nodes[i];
+		ok = mdb_persist_write(f, &node->id, sizeof(gint32)) &&
+			mdb_persist_write(f, &node->parent_id, sizeof(gint32)) &&
+			mdb_persist_write(f, &node->pg, sizeof(guint32)) &&
+			mdb_persist_write_str(f, node->name);
+	}
+	return mdb_persist_commit(f, tmp_path, path, ok);
+}
+/* the tree saved at path, not yet linked, if it was built from spec */
+static MdbTree *
+mdb_tree_load(const char *path, const char *spec)
+{
+	MdbTree *tree;
+	char *name;
+	guint32 count, i, pg;
+	gint32 id, parent_id;
+	FILE *f;
+
+	if (!(f = mdb_persist_open(path, MDB_TREE_MAGIC, spec)))
+		return NULL;
+	tree = mdb_tree_alloc(spec, strchr(spec, '|') + 1);
+	if (!mdb_persist_read(f, &count, sizeof(guint32)) || count > 0xffffff)
+		goto fail;
+	tree->sums = g_malloc((count + 1) * sizeof(MdbPageSum));
+	tree->num_sums = count;
+	if (!mdb_persist_read(f, tree->sums, count * sizeof(MdbPageSum)) ||
+	    !mdb_persist_read(f, &count, sizeof(guint32)))
+		goto fail;
+	for (i = 0; i < count; i++) {
+		if (!mdb_persist_read(f, &id, sizeof(gint32)) ||
+		    !mdb_persist_read(f, &parent_id, sizeof(gint32)) ||
+		    !mdb_persist_read(f, &pg, sizeof(guint32)) ||
+		    !(name = mdb_persist_read_str(f)))
+			goto fail;
+		mdb_tree_add_node(tree, id, parent_id, pg, name, strlen(name));
+		g_free(name);
+	}
+	fclose(f);
+	return tree;
+fail:
+	mdb_tree_free(tree);
+	fclose(f);
+	return NULL;
+}
+
+/* Access */
+
+/**
+ * mdb_tree_num_nodes:
+ * @tree: tree
+ *
+ * Return value: number of nodes; node numbers run from 0 to one less,
+ * in id order.
+ */
+unsigned int
+mdb_tree_num_nodes(MdbTree *tree)
+{
+	return tree->num_nodes;
+}
+/**
+ * mdb_tree_node:
+ * @tree: tree
+ * @n: node number
+ *
+ * Return value: the node, owned by @tree, or NULL if @n is out of range.
+ */
+const MdbTreeNode *
+mdb_tree_node(MdbTree *tree, int n)
+{
+	if (n < 0 || (unsigned int)n >= tree->num_nodes)
+		return NULL;
+	return &tree->nodes[n];
+}
+/**
+ * mdb_tree_find:
+ * @tree: tree
+ * @id: id to look for
+ *
+ * Return value: number of the node with @id, or -1.
+ */
+int
+mdb_tree_find(MdbTree *tree, gint32 id)
+{
+	unsigned int lo = 0, hi = tree->num_nodes, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (tree->nodes[mid].id < id)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo < tree->num_nodes && tree->nodes[lo].id == id ? (int)lo : -1;
+}
+/**
+ * mdb_tree_children:
+ * @tree: tree
+ * @n: node number, or -1 for the roots
+ * @count: receives the number of children
+ *
+ * Return value: the numbers of the children of @n sorted by name, case
+ * insensitively.
+ */
+const guint32 *
+mdb_tree_children(MdbTree *tree, int n, unsigned int *count)
+{
+	if (n < 0) {
+		*count = tree->num_roots;
+		return tree->children;
+	}
+	*count = tree->nodes[n].num_children;
+	return tree->children + tree->nodes[n].first_child;
+}
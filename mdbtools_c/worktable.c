@@ -16,8 +16,11 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#define MDB_MEM_TAG MDB_MEM_TEMPTABLE
+
 #include "mdbtools.h"
 #include "mdbprivate.h"
+#include <errno.h>
 
 /*
  * Temp table routines.  These are currently used to generate mock results for
@@ -64,9 +67,175 @@ mdb_create_temp_table(MdbHandle *mdb, char *name)
 	table->columns = g_ptr_array_new();
 	table->is_temp_table = 1;
 	table->temp_table_pages = g_ptr_array_new();
+	table->temp_mem_budget = MDB_TEMP_MEM_BUDGET;
+	table->temp_spill_fd = -1;
 
 	return table;
 }
+/*
+ * Temp table pages live in memory up to the table's budget; past it each
+ * page is written to an unlinked scratch file as soon as it fills, and read
+ * back into mdb->pg_buf when a scan reaches it.
+ */
+
+/**
+ * mdb_temp_table_set_budget:
+ * @table: temp table
+ * @bytes: memory its pages may use before they are spilled to disk
+ *
+ * Pages already spilled stay on disk; SIZE_MAX never spills.
+ */
+void
+mdb_temp_table_set_budget(MdbTableDef *table, size_t bytes)
+{
+	table->temp_mem_budget = bytes;
+}
+static int
+mdb_temp_table_open_spill(void)
+{
+	const char *dir = getenv("TMPDIR");
+	char *path;
+	int fd;
+
+	/* TMPDIR points inside the app container on iOS, where tmpfile()'s
+	 * /var/tmp isn't writable */
+	if (!dir || !*dir)
+		dir = "/tmp";
+	path = g_strdup_printf("%s/mdbtempXXXXXX", dir);
+	fd = mkstemp(path);
+	if (fd == -1) {
+		fprintf(stderr, "Unable to create temp table spill file in %s: %s\n",
+			dir, strerror(errno));
+	} else {
+		unlink(path);
+	}
+	g_free(path);
+	return fd;
+}
+/* write page pg (1 based) to the spill file and free it; on failure it
+ * stays in memory */
+static int
+mdb_temp_table_spill_pg(MdbTableDef *table, guint32 pg)
+{
+	size_t pg_size = table->entry->mdb->fmt->pg_size;
+	void *page = g_ptr_array_index(table->temp_table_pages, pg - 1);
+	ssize_t len;
+
+	if (!page)
+		return 1;
+	if (table->temp_spill_fd == -1) {
+		table->temp_spill_fd = mdb_temp_table_open_spill();
+		if (table->temp_spill_fd == -1) {
+			/* don't keep trying for every page */
+			table->temp_mem_budget = SIZE_MAX;
+			return 0;
+		}
+	}
+	do {
+		len = pwrite(table->temp_spill_fd, page, pg_size, (off_t)(pg - 1) * pg_size);
+	} while (len == -1 && errno == EINTR);
+	if (len != (ssize_t)pg_size) {
+		fprintf(stderr, "Unable to spill temp table page %u\n", pg);
+		return 0;
+	}
+	g_free(page);
+	g_ptr_array_index(table->temp_table_pages, pg - 1) = NULL;
+	table->temp_mem_pages--;
+	return 1;
+}
+/**
+ * mdb_temp_table_new_pg:
+ * @table: temp table
+ *
+ * Appends an empty data page to @table.  If the table is over its memory
+ * budget, the page before it, which is now full, is spilled first.
+ *
+ * Return value: the new page, owned by the table.
+ */
+void *
+mdb_temp_table_new_pg(MdbTableDef *table)
+{
+	GPtrArray *pages = table->temp_table_pages;
+	size_t pg_size = table->entry->mdb->fmt->pg_size;
+	void *new_pg;
+
+	if (pages->len && (size_t)(table->temp_mem_pages + 1) * pg_size > table->temp_mem_budget)
+		mdb_temp_table_spill_pg(table, pages->len);
+	new_pg = mdb_new_data_pg(table->entry);
+	g_ptr_array_add(pages, new_pg);
+	table->temp_mem_pages++;
+	return new_pg;
+}
+/* mdb->cur_pg for a temp page: above any real page number, which only has
+ * 24 bits in a row pointer, and new on every load so a later read of any
+ * other page into pg_buf is noticed */
+static guint32
+mdb_temp_pg_token(void)
+{
+	static guint32 loads;
+
+	return 0x80000000u | __atomic_add_fetch(&loads, 1, __ATOMIC_RELAXED);
+}
+/**
+ * mdb_temp_table_read_pg:
+ * @table: temp table
+ * @pg: page number, 1 based
+ *
+ * Makes page @pg of @table current in mdb->pg_buf, reading it back from
+ * the spill file if need be.  Nothing is copied when the page is still
+ * there from the previous call, so a scan copies each page once rather
+ * than once per row.
+ *
+ * Return value: 1 on success, 0 if there is no such page or it can't be
+ * read.
+ */
+int
+mdb_temp_table_read_pg(MdbTableDef *table, guint32 pg)
+{
+	MdbHandle *mdb = table->entry->mdb;
+	size_t pg_size = mdb->fmt->pg_size;
+	void *page;
+	ssize_t len;
+
+	if (!pg || pg > table->temp_table_pages->len)
+		return 0;
+	if (table->temp_cur_pg == pg && mdb->cur_pg == table->temp_pg_token)
+		return 1;
+
+	page = g_ptr_array_index(table->temp_table_pages, pg - 1);
+	if (page) {
+		memcpy(mdb->pg_buf, page, pg_size);
+	} else {
+		do {
+			len = pread(table->temp_spill_fd, mdb->pg_buf, pg_size, (off_t)(pg - 1) * pg_size);
+		} while (len == -1 && errno == EINTR);
+		if (len != (ssize_t)pg_size) {
+			fprintf(stderr, "Unable to read spilled temp table page %u\n", pg);
+			/* pg_buf no longer holds what cur_pg says */
+			mdb->cur_pg = 0;
+			table->temp_cur_pg = 0;
+			return 0;
+		}
+	}
+	table->temp_pg_token = mdb_temp_pg_token();
+	table->temp_cur_pg = pg;
+	mdb->cur_pg = table->temp_pg_token;
+	mdb->cur_pos = 0;
+	return 1;
+}
+void
+mdb_temp_table_free_pages(MdbTableDef *table)
+{
+	guint i;
+
+	for (i=0; i<table->temp_table_pages->len; i++)
+		g_free(g_ptr_array_index(table->temp_table_pages,i));
+	g_ptr_array_free(table->temp_table_pages, TRUE);
+	table->temp_table_pages = NULL;
+	if (table->temp_spill_fd != -1)
+		close(table->temp_spill_fd);
+	table->temp_spill_fd = -1;
+}
 void
 mdb_temp_table_add_col(MdbTableDef *table, MdbColumn *col)
 {
@@ -76,6 +245,7 @@ mdb_temp_table_add_col(MdbTableDef *table, MdbColumn *col)
 		col->var_col_num = table->num_var_cols++;
 	g_ptr_array_add(table->columns, g_memdup2(col, sizeof(MdbColumn)));
 	table->num_cols++;
+	mdb_free_row_plan(table);
 }
 /*
  * Should be called after setting up all temp table columns
@@ -93,4 +263,5 @@ void mdb_temp_columns_end(MdbTableDef *table)
 			start += col->col_size;
 		}
 	}
+	mdb_build_row_plan(table);
 }
@@ -19,6 +19,11 @@
 #include <time.h>
 #include <inttypes.h>
 #include "mdbprivate.h"
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 //static int mdb_copy_index_pg(MdbTableDef *table, MdbIndex *idx, MdbIndexPage *ipg);
 static int mdb_add_row_to_leaf_pg(MdbTableDef *table, MdbIndex *idx, MdbIndexPage *ipg, MdbField *idx_fields, guint32 pgnum, guint16 rownum);
@@ -79,28 +84,26 @@ mdb_write_pg(MdbHandle *mdb, unsigned long pg)
 	off_t offset = pg * mdb->fmt->pg_size;
 	unsigned char *buf = mdb->pg_buf;
 
-    fseeko(mdb->f->stream, 0, SEEK_END);
 	/* is page beyond current size + 1 ? */
-	if (ftello(mdb->f->stream) < offset + mdb->fmt->pg_size) {
+	if (mdbi_file_size(mdb->f) < offset + mdb->fmt->pg_size) {
 		fprintf(stderr,"offset %" PRIu64 " is beyond EOF\n",(uint64_t)offset);
 		return 0;
 	}
-	fseeko(mdb->f->stream, offset, SEEK_SET);
 
 	if (pg != 0 && mdb->f->db_key != 0)
 	{
-		buf = g_memdup2(mdb->pg_buf, mdb->fmt->pg_size);
+		buf = mdb_mem_memdup(MDB_MEM_PAGE_CACHE, mdb->pg_buf, mdb->fmt->pg_size);
 		unsigned int tmp_key = mdb->f->db_key ^ pg;
 		mdbi_rc4((unsigned char*)&tmp_key, 4, buf, mdb->fmt->pg_size);
 	}
 
-	len = fwrite(buf, 1, mdb->fmt->pg_size, mdb->f->stream);
+	len = mdbi_write_page(mdb, buf, pg, offset);
 
 	if (buf != mdb->pg_buf) {
 		g_free(buf);
 	}
 
-	if (ferror(mdb->f->stream)) {
+	if (len == -1) {
 		perror("write");
 		return 0;
 	} else if (len<mdb->fmt->pg_size) {
@@ -197,110 +200,379 @@ mdb_crack_row3(MdbHandle *mdb, unsigned int row_start, unsigned int row_end,
 int
 mdb_crack_row(MdbTableDef *table, int row_start, size_t row_size, MdbField *fields)
 {
-	MdbColumn *col;
-	MdbCatalogEntry *entry = table->entry;
-	MdbHandle *mdb = entry->mdb;
-	void *pg_buf = mdb->pg_buf;
+	MdbHandle *mdb = table->entry->mdb;
+	MdbRowPlan *plan = table->row_plan;
+	const MdbRowPlanCol *pc;
+	unsigned char *pg_buf = mdb->pg_buf;
+	unsigned char *row = pg_buf + row_start;
 	unsigned int row_var_cols=0, row_cols;
 	unsigned char *nullmask;
 	unsigned int bitmask_sz;
-	unsigned int *var_col_offsets = NULL;
+	unsigned int var_col_buf[MDB_MAX_COLS+1];
+	unsigned int *var_col_offsets = var_col_buf;
 	unsigned int fixed_cols_found, row_fixed_cols;
-	unsigned int col_count_size;
-	unsigned int i;
-    unsigned int row_end = row_start + row_size - 1;
+	unsigned int i, col_start;
+	unsigned int row_end = row_start + row_size - 1;
+	int debug = mdb_get_option(MDB_DEBUG_ROW);
 
-	if (mdb_get_option(MDB_DEBUG_ROW)) {
+	if (debug) {
 		mdb_buffer_dump(pg_buf, row_start, row_size);
 	}
 
-	if (IS_JET3(mdb)) {
+	if (!plan || plan->num_cols != table->num_cols)
+		plan = mdb_build_row_plan(table);
+
+	if (plan->jet3) {
 		row_cols = mdb_get_byte(pg_buf, row_start);
-		col_count_size = 1;
 	} else {
 		row_cols = mdb_get_int16(pg_buf, row_start);
-		col_count_size = 2;
 	}
 
 	bitmask_sz = (row_cols + 7) / 8;
-    if (bitmask_sz + !IS_JET3(mdb) >= row_end) {
-        fprintf(stderr, "warning: Invalid page buffer detected in mdb_crack_row.\n");
-        return -1;
-    }
+	if (bitmask_sz + !plan->jet3 >= row_end) {
+		mdb_log(MDB_LOG_DATA, MDB_LOG_WARN, "Invalid page buffer detected in mdb_crack_row.");
+		return -1;
+	}
 
-	nullmask = (unsigned char*)pg_buf + row_end - bitmask_sz + 1;
+	nullmask = pg_buf + row_end - bitmask_sz + 1;
 
 	/* read table of variable column locations */
-	if (table->num_var_cols > 0) {
-		row_var_cols = IS_JET3(mdb) ?
+	if (plan->num_var_cols > 0) {
+		int success;
+		row_var_cols = plan->jet3 ?
 			mdb_get_byte(pg_buf, row_end - bitmask_sz) :
 			mdb_get_int16(pg_buf, row_end - bitmask_sz - 1);
-		var_col_offsets = g_malloc((row_var_cols+1)*sizeof(int));
-        int success = 0;
-		if (IS_JET3(mdb)) {
+		/* only a corrupt row has more than the engine's column limit */
+		if (row_var_cols > MDB_MAX_COLS)
+			var_col_offsets = g_malloc((row_var_cols+1)*sizeof(int));
+		if (plan->jet3) {
 			success = mdb_crack_row3(mdb, row_start, row_end, bitmask_sz,
                     row_var_cols, var_col_offsets);
 		} else {
 			success = mdb_crack_row4(mdb, row_start, row_end, bitmask_sz,
                     row_var_cols, var_col_offsets);
 		}
-        if (!success) {
-            fprintf(stderr, "warning: Invalid page buffer detected in mdb_crack_row.\n");
-            g_free(var_col_offsets);
-            return -1;
-        }
+		if (!success) {
+			mdb_log(MDB_LOG_DATA, MDB_LOG_WARN, "Invalid page buffer detected in mdb_crack_row.");
+			if (var_col_offsets != var_col_buf)
+				g_free(var_col_offsets);
+			return -1;
+		}
 	}
 
 	fixed_cols_found = 0;
 	row_fixed_cols = row_cols - row_var_cols;
 
-	if (mdb_get_option(MDB_DEBUG_ROW)) {
+	if (debug) {
 		fprintf(stdout,"bitmask_sz %d\n", bitmask_sz);
 		fprintf(stdout,"row_var_cols %d\n", row_var_cols);
 		fprintf(stdout,"row_fixed_cols %d\n", row_fixed_cols);
 	}
 
-	for (i=0;i<table->num_cols;i++) {
-		unsigned int byte_num, bit_num;
-		unsigned int col_start;
-		col = g_ptr_array_index(table->columns,i);
-		fields[i].colnum = i;
-		fields[i].is_fixed = col->is_fixed;
-		byte_num = col->col_num / 8;
-		bit_num = col->col_num % 8;
+	for (i=0, pc=plan->cols; i<plan->num_cols; i++, pc++) {
+		MdbField *f = &fields[i];
+		f->colnum = i;
+		f->is_fixed = pc->is_fixed;
 		/* logic on nulls is reverse, 1 is not null, 0 is null */
-		fields[i].is_null = nullmask[byte_num] & (1 << bit_num) ? 0 : 1;
-
-		if ((fields[i].is_fixed)
-		 && (fixed_cols_found < row_fixed_cols)) {
-			col_start = col->fixed_offset + col_count_size;
-			fields[i].start = row_start + col_start;
-			fields[i].value = (char*)pg_buf + row_start + col_start;
-			fields[i].siz = col->col_size;
+		f->is_null = !(nullmask[pc->null_byte] & pc->null_bit);
+
+		if (pc->is_fixed && fixed_cols_found < row_fixed_cols) {
+			f->start = row_start + pc->offset;
+			f->value = (char*)row + pc->offset;
+			f->siz = pc->size;
 			fixed_cols_found++;
-		/* Use col->var_col_num because a deleted column is still
+		/* Use the var_col_num because a deleted column is still
 		 * present in the variable column offsets table for the row */
-		} else if ((!fields[i].is_fixed)
-		 && (col->var_col_num < row_var_cols)) {
-			col_start = var_col_offsets[col->var_col_num];
-			fields[i].start = row_start + col_start;
-			fields[i].value = (char*)pg_buf + row_start + col_start;
-			fields[i].siz = var_col_offsets[(col->var_col_num)+1] -
-		                col_start;
+		} else if (!pc->is_fixed && pc->offset < row_var_cols) {
+			col_start = var_col_offsets[pc->offset];
+			f->start = row_start + col_start;
+			f->value = (char*)row + col_start;
+			f->siz = var_col_offsets[pc->offset+1] - col_start;
 		} else {
-			fields[i].start = 0;
-			fields[i].value = NULL;
-			fields[i].siz = 0;
-			fields[i].is_null = 1;
+			f->start = 0;
+			f->value = NULL;
+			f->siz = 0;
+			f->is_null = 1;
 		}
-		if ((size_t)(fields[i].start + fields[i].siz) > row_start + row_size) {
-			fprintf(stderr, "warning: Invalid data location detected in mdb_crack_row. Table:%s Column:%i\n",table->name, i);
-			g_free(var_col_offsets);
+		if ((size_t)(f->start + f->siz) > row_start + row_size) {
+			mdb_log(MDB_LOG_DATA, MDB_LOG_WARN, "Invalid data location detected in mdb_crack_row. Table:%s Column:%i",table->name, i);
+			if (var_col_offsets != var_col_buf)
+				g_free(var_col_offsets);
 			return -1;
 		}
 	}
 
-	g_free(var_col_offsets);
+	if (var_col_offsets != var_col_buf)
+		g_free(var_col_offsets);
+	return row_cols;
+}
+
+
+/*
+ * Page at a time decoding.  mdb_crack_page() reads every row header on the
+ * page up front, transposes the rows' null masks into one validity bitmap
+ * per column and copies out the JET4 offset tables, so that filling a
+ * row's fields is just a few array loads.
+ */
+
+static inline unsigned int
+mdb_le16(const unsigned char *p)
+{
+	return p[0] | (p[1] << 8);
+}
+/* Transpose an 8x8 bit matrix: bit 8*r+c moves to bit 8*c+r.  With byte r
+ * holding row r's null mask byte, byte c comes out as column c's validity
+ * over the 8 rows. */
+static guint64
+mdb_transpose8(guint64 x)
+{
+	guint64 t;
+
+	t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+	x = x ^ t ^ (t << 7);
+	t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+	x = x ^ t ^ (t << 14);
+	t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+	x = x ^ t ^ (t << 28);
+	return x;
+}
+/* JET4 stores the offset table backwards from @end, one little-endian
+ * int16 per entry: out[i] = int16 at end - 2*i. */
+static void
+mdb_read_offsets_rev(unsigned char *pg_buf, unsigned int end,
+	unsigned int n, guint16 *out)
+{
+	unsigned int i = 0;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#if defined(__ARM_NEON)
+	for (; i + 8 <= n; i += 8) {
+		uint16x8_t v = vreinterpretq_u16_u8(vld1q_u8(pg_buf + end - 2*(i+7)));
+		v = vrev64q_u16(v);
+		vst1q_u16(out + i, vextq_u16(v, v, 4));
+	}
+#elif defined(__SSE2__)
+	for (; i + 8 <= n; i += 8) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(pg_buf + end - 2*(i+7)));
+		v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0,1,2,3));
+		v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0,1,2,3));
+		_mm_storeu_si128((__m128i *)(out + i), _mm_shuffle_epi32(v, _MM_SHUFFLE(1,0,3,2)));
+	}
+#endif
+#endif
+	for (; i < n; i++)
+		out[i] = mdb_le16(pg_buf + end - 2*i);
+}
+MdbPageRows *
+mdb_alloc_page_rows(void)
+{
+	return g_malloc0(sizeof(MdbPageRows));
+}
+void
+mdb_free_page_rows(MdbPageRows *pr)
+{
+	if (!pr)
+		return;
+	g_free(pr->row_start);
+	g_free(pr->row_size);
+	g_free(pr->row_cols);
+	g_free(pr->row_var_cols);
+	g_free(pr->validity);
+	g_free(pr->var_offsets);
+	g_free(pr->selection);
+	g_free(pr->scratch);
+	g_free(pr);
+}
+static void
+mdb_page_rows_reserve(MdbPageRows *pr, unsigned int rows, unsigned int mask_rows,
+	unsigned int var_stride)
+{
+	unsigned int capacity = pr->capacity;
+
+	if (rows > capacity || var_stride > pr->var_stride) {
+		while (capacity < rows)
+			capacity = capacity ? capacity * 2 : 64;
+		if (var_stride < pr->var_stride)
+			var_stride = pr->var_stride;
+		pr->row_start = g_realloc(pr->row_start, capacity * sizeof(int));
+		pr->row_size = g_realloc(pr->row_size, capacity * sizeof(guint16));
+		pr->row_cols = g_realloc(pr->row_cols, capacity * sizeof(guint16));
+		pr->row_var_cols = g_realloc(pr->row_var_cols, capacity * sizeof(guint16));
+		g_free(pr->var_offsets);
+		pr->var_offsets = g_malloc((size_t)capacity * var_stride * sizeof(guint16));
+		pr->selection = g_realloc(pr->selection, (capacity + 63) / 64 * sizeof(guint64));
+		pr->scratch = g_realloc(pr->scratch, capacity * sizeof(double));
+		pr->capacity = capacity;
+		pr->var_stride = var_stride;
+	}
+	pr->mask_stride = (pr->capacity + 7) / 8;
+	if ((size_t)mask_rows * pr->mask_stride > pr->validity_size) {
+		pr->validity_size = (size_t)mask_rows * pr->mask_stride;
+		g_free(pr->validity);
+		pr->validity = g_malloc(pr->validity_size);
+	}
+	memset(pr->validity, 0, (size_t)mask_rows * pr->mask_stride);
+}
+/**
+ * mdb_crack_page:
+ * @table: table whose data page is in mdb->pg_buf
+ * @pr: decode buffers from mdb_alloc_page_rows(), reused between pages
+ *
+ * Decodes the header of every row slot on the current page at once: the
+ * row directory, column counts, null masks (transposed 8 rows at a time
+ * into per-column validity bitmaps) and variable column offset tables.
+ * Slots that are empty, invalid or deleted (unless table->noskip_del is
+ * set) get a row_start of -1.  The page buffer must not change before the
+ * rows are read with mdb_page_row_fields().
+ *
+ * Return value: number of row slots on the page.
+ */
+unsigned int
+mdb_crack_page(MdbTableDef *table, MdbPageRows *pr)
+{
+	MdbHandle *mdb = table->entry->mdb;
+	MdbRowPlan *plan = table->row_plan;
+	unsigned char *pg_buf = mdb->pg_buf;
+	unsigned int rows, r, k, j, row_end, bitmask_sz, row_var_cols, n;
+	unsigned int rco = mdb->fmt->row_count_offset, pg_size = mdb->fmt->pg_size;
+	unsigned int var_col_buf[MDB_MAX_COLS+1];
+	unsigned int row_start, next_start, row_size, flags;
+	guint64 x;
+
+	if (!plan || plan->num_cols != table->num_cols)
+		plan = mdb_build_row_plan(table);
+
+	rows = mdb_le16(pg_buf + rco);
+	if (rows > 1000)
+		rows = 1001;	/* mdb_find_row() refuses slots past this */
+	mdb_page_rows_reserve(pr, rows, plan->mask_bytes * 8, plan->var_slots + 1);
+	pr->num_rows = rows;
+
+	for (r = 0; r < rows; r++) {
+		pr->row_start[r] = -1;
+		pr->row_cols[r] = 0;
+		/* the row directory, as mdb_find_row() reads it */
+		flags = mdb_le16(pg_buf + rco + 2 + r*2);
+		row_start = flags & 0x1fff;
+		next_start = r == 0 ? pg_size : mdb_le16(pg_buf + rco + r*2) & 0x1fff;
+		if (row_start >= pg_size || row_start >= next_start || next_start > pg_size)
+			continue;
+		row_size = next_start - row_start;
+		/* deleted rows are skipped before their header is looked at */
+		if ((flags & 0x4000) && !table->noskip_del)
+			continue;
+		row_end = row_start + row_size - 1;
+		n = plan->jet3 ? pg_buf[row_start] : mdb_le16(pg_buf + row_start);
+		bitmask_sz = (n + 7) / 8;
+		if (bitmask_sz + !plan->jet3 >= row_end) {
+			mdb_log(MDB_LOG_DATA, MDB_LOG_WARN, "Invalid page buffer detected in mdb_crack_row.");
+			continue;
+		}
+		row_var_cols = 0;
+		if (plan->num_var_cols > 0) {
+			row_var_cols = plan->jet3 ?
+				pg_buf[row_end - bitmask_sz] :
+				mdb_le16(pg_buf + row_end - bitmask_sz - 1);
+			if (plan->jet3 ?
+				row_var_cols > MDB_MAX_COLS || !mdb_crack_row3(mdb, row_start,
+					row_end, bitmask_sz, row_var_cols, var_col_buf) :
+				bitmask_sz + 3 + row_var_cols*2 + 2 > row_end) {
+				mdb_log(MDB_LOG_DATA, MDB_LOG_WARN, "Invalid page buffer detected in mdb_crack_row.");
+				continue;
+			}
+			/* only the slots some column refers to are kept */
+			k = row_var_cols < plan->var_slots ? row_var_cols : plan->var_slots;
+			if (plan->jet3) {
+				for (j = 0; j <= k; j++)
+					pr->var_offsets[r * pr->var_stride + j] = var_col_buf[j];
+			} else {
+				mdb_read_offsets_rev(pg_buf, row_end - bitmask_sz - 3,
+					k + 1, pr->var_offsets + r * pr->var_stride);
+			}
+		}
+		pr->row_start[r] = row_start;
+		pr->row_size[r] = row_size;
+		pr->row_cols[r] = n;
+		pr->row_var_cols[r] = row_var_cols;
+	}
+
+	/* null masks, 8 row slots by mask byte at a time */
+	for (r = 0; r < rows; r += 8) {
+		for (j = 0; j < plan->mask_bytes; j++) {
+			x = 0;
+			for (k = 0; k < 8 && r + k < rows; k++) {
+				n = pr->row_cols[r+k];
+				if (pr->row_start[r+k] < 0 || j >= (n + 7) / 8)
+					continue;
+				row_end = pr->row_start[r+k] + pr->row_size[r+k] - 1;
+				x |= (guint64)pg_buf[row_end - (n + 7) / 8 + 1 + j] << (8*k);
+			}
+			if (!x)
+				continue;
+			x = mdb_transpose8(x);
+			for (k = 0; k < 8; k++)
+				pr->validity[(j*8 + k) * pr->mask_stride + r/8] = x >> (8*k);
+		}
+	}
+	return rows;
+}
+/**
+ * mdb_page_row_fields:
+ * @table: table the page belongs to
+ * @pr: page decoded by mdb_crack_page()
+ * @row: row slot
+ * @fields: receives num_cols fields, as from mdb_crack_row()
+ *
+ * Return value: number of columns in the row, 0 if the slot is to be
+ * skipped, or -1 if the row is invalid.
+ */
+int
+mdb_page_row_fields(MdbTableDef *table, MdbPageRows *pr, unsigned int row, MdbField *fields)
+{
+	MdbRowPlan *plan = table->row_plan;
+	const MdbRowPlanCol *pc;
+	unsigned char *pg_buf = table->entry->mdb->pg_buf;
+	const unsigned char *valid = pr->validity + row / 8;
+	unsigned char bit = 1 << (row % 8);
+	const guint16 *var_offsets;
+	unsigned int i, fixed_cols_found = 0, row_fixed_cols, row_var_cols, row_cols;
+	unsigned int col_start, row_end;
+	int row_start;
+
+	if (row >= pr->num_rows || (row_start = pr->row_start[row]) < 0)
+		return 0;
+	row_cols = pr->row_cols[row];
+	row_end = row_start + pr->row_size[row];
+	row_var_cols = pr->row_var_cols[row];
+	row_fixed_cols = row_cols - row_var_cols;
+	var_offsets = pr->var_offsets + row * pr->var_stride;
+
+	for (i=0, pc=plan->cols; i<plan->num_cols; i++, pc++) {
+		MdbField *f = &fields[i];
+		f->colnum = i;
+		f->is_fixed = pc->is_fixed;
+		f->is_null = !(valid[pc->null_pos * pr->mask_stride] & bit);
+		if (pc->is_fixed && fixed_cols_found < row_fixed_cols) {
+			f->start = row_start + pc->offset;
+			f->siz = pc->size;
+			fixed_cols_found++;
+		} else if (!pc->is_fixed && pc->offset < row_var_cols) {
+			col_start = var_offsets[pc->offset];
+			f->start = row_start + col_start;
+			f->siz = var_offsets[pc->offset+1] - col_start;
+		} else {
+			f->start = 0;
+			f->value = NULL;
+			f->siz = 0;
+			f->is_null = 1;
+			continue;
+		}
+		f->value = (char*)pg_buf + f->start;
+		if ((size_t)(f->start + f->siz) > row_end) {
+			mdb_log(MDB_LOG_DATA, MDB_LOG_WARN, "Invalid data location detected in mdb_crack_row. Table:%s Column:%i",table->name, i);
+			return -1;
+		}
+	}
 	return row_cols;
 }
 
@@ -495,7 +767,7 @@ void *
 mdb_new_leaf_pg(MdbCatalogEntry *entry)
 {
 	MdbHandle *mdb = entry->mdb;
-	void *new_pg = g_malloc0(mdb->fmt->pg_size);
+	void *new_pg = mdb_mem_malloc0(MDB_MEM_PAGE_CACHE, mdb->fmt->pg_size);
 		
 	mdb_put_int16(new_pg, 0, 0x0104);
 	mdb_put_int32(new_pg, 4, entry->table_pg);
@@ -506,7 +778,9 @@ void *
 mdb_new_data_pg(MdbCatalogEntry *entry)
 {
 	MdbFormatConstants *fmt = entry->mdb->fmt;
-	void *new_pg = g_malloc0(fmt->pg_size);
+	/* temp tables have no definition page; their pages live until the table is freed */
+	void *new_pg = mdb_mem_malloc0(entry->table_pg ? MDB_MEM_PAGE_CACHE : MDB_MEM_TEMPTABLE,
+		fmt->pg_size);
 		
 	mdb_put_int16(new_pg, 0, 0x0101);
 	mdb_put_int16(new_pg, 2, fmt->pg_size - fmt->row_count_offset - 2);
@@ -537,12 +811,9 @@ mdb_update_indexes(MdbTableDef *table, int num_fields, MdbField *fields, guint32
 	 * 3. Money has built-in "Validate and Repair" that rebuilds indexes
 	 * 4. Transaction will be visible after one repair cycle
 	 */
-	fprintf(stderr, "[mdb_update_indexes] Table has %u indexes\n", table->num_idxs);
-	fprintf(stderr, "[mdb_update_indexes] ⚠️  SKIPPING ALL INDEX UPDATES\n");
-	fprintf(stderr, "[mdb_update_indexes] Reason: Complex indexes (multi-column, TEXT fields)\n");
-	fprintf(stderr, "[mdb_update_indexes] Solution: Money Desktop will rebuild on next open\n");
-	fprintf(stderr, "[mdb_update_indexes] User must run 'File > Validate and Repair' once\n");
-	fprintf(stderr, "[mdb_update_indexes] Index updates complete (skipped)\n");
+	mdb_log(MDB_LOG_INDEX, MDB_LOG_INFO,
+		"mdb_update_indexes: skipping %u indexes of %s, Money rebuilds them on 'File > Validate and Repair'",
+		table->num_idxs, table->name);
 	return 1;
 	
 	/* NOTE: The code below is preserved but unreachable (dead code)
@@ -556,7 +827,7 @@ mdb_update_indexes(MdbTableDef *table, int num_fields, MdbField *fields, guint32
 	 * Money Desktop requires index B-tree pages to be updated
 	 * for transactions to be visible in the UI
 	 */
-	fprintf(stderr, "[mdb_update_indexes] Updating %u indexes for row at page %u, row %u\n", 
+	mdb_log(MDB_LOG_INDEX, MDB_LOG_DEBUG, "mdb_update_indexes: Updating %u indexes for row at page %u, row %u", 
 	        table->num_idxs, pgnum, rownum);
 	
 	/* CRITICAL FIX: Skip index updates if there are too many (>10)
@@ -568,10 +839,9 @@ mdb_update_indexes(MdbTableDef *table, int num_fields, MdbField *fields, guint32
 	 * We only update the primary key index (usually index 0)
 	 */
 	if (table->num_idxs > 10) {
-		fprintf(stderr, "[mdb_update_indexes] WARNING: Table has %u indexes (too many)\n", 
-		        table->num_idxs);
-		fprintf(stderr, "[mdb_update_indexes] Will only update first 2 indexes (primary + one other)\n");
-		fprintf(stderr, "[mdb_update_indexes] Money Desktop will rebuild other indexes automatically\n");
+		mdb_log(MDB_LOG_INDEX, MDB_LOG_WARN,
+			"mdb_update_indexes: %s has %u indexes, updating only the first 2",
+			table->name, table->num_idxs);
 	}
 	
 	/* Limit to first 2 indexes to prevent freeze */
@@ -579,29 +849,29 @@ mdb_update_indexes(MdbTableDef *table, int num_fields, MdbField *fields, guint32
 	
 	for (i=0; i<max_indexes; i++) {
 		idx = g_ptr_array_index (table->indices, i);
-		fprintf(stderr, "[mdb_update_indexes] Processing index %u/%u: %s (type %d)\n", 
+		mdb_log(MDB_LOG_INDEX, MDB_LOG_DEBUG, "mdb_update_indexes: Processing index %u/%u: %s (type %d)", 
 		        i+1, max_indexes, idx->name, idx->index_type);
 		
 		if (idx->index_type==1) {
-			fprintf(stderr, "[mdb_update_indexes] Updating index %s...\n", idx->name);
+			mdb_log(MDB_LOG_INDEX, MDB_LOG_DEBUG, "mdb_update_indexes: Updating index %s...", idx->name);
 			if (!mdb_update_index(table, idx, num_fields, fields, pgnum, rownum)) {
-				fprintf(stderr, "[mdb_update_indexes] WARNING: Failed to update index %s\n", idx->name);
+				mdb_log(MDB_LOG_INDEX, MDB_LOG_WARN, "mdb_update_indexes: Failed to update index %s", idx->name);
 				/* Continue with other indexes instead of failing completely */
 			} else {
-				fprintf(stderr, "[mdb_update_indexes] ✓ Index %s updated successfully\n", idx->name);
+				mdb_log(MDB_LOG_INDEX, MDB_LOG_DEBUG, "mdb_update_indexes: Index %s updated successfully", idx->name);
 			}
 		} else {
-			fprintf(stderr, "[mdb_update_indexes] Skipping index %s (type %d != 1)\n", 
+			mdb_log(MDB_LOG_INDEX, MDB_LOG_DEBUG, "mdb_update_indexes: Skipping index %s (type %d != 1)", 
 			        idx->name, idx->index_type);
 		}
 	}
 	
 	if (table->num_idxs > max_indexes) {
-		fprintf(stderr, "[mdb_update_indexes] Skipped %u indexes (will be rebuilt by Money)\n", 
+		mdb_log(MDB_LOG_INDEX, MDB_LOG_INFO, "mdb_update_indexes: Skipped %u indexes (will be rebuilt by Money)", 
 		        table->num_idxs - max_indexes);
 	}
 	
-	fprintf(stderr, "[mdb_update_indexes] Index updates complete\n");
+	mdb_log(MDB_LOG_INDEX, MDB_LOG_DEBUG, "mdb_update_indexes: Index updates complete");
 	return 1;
 }
 
@@ -613,7 +883,7 @@ mdb_init_index_chain(MdbTableDef *table, MdbIndex *idx)
 
 	table->scan_idx = idx;
 	table->chain = g_malloc0(sizeof(MdbIndexChain));
-	table->mdbidx = mdb_clone_handle(mdb);
+	table->mdbidx = mdb_open_cursor(mdb);
 	mdb_read_pg(table->mdbidx, table->scan_idx->first_pg);
 
 	return 1;
@@ -629,25 +899,27 @@ mdb_update_index(MdbTableDef *table, MdbIndex *idx, unsigned int num_fields, Mdb
 	unsigned int i, j;
 	MdbIndexChain *chain;
 	MdbField idx_fields[10];
-	
-	fprintf(stderr, "[mdb_update_index] START: index '%s', num_keys=%u\n", idx->name, idx->num_keys);
+
+	/* only key fields found below are filled in */
+	memset(idx_fields, 0, sizeof(idx_fields));
+	mdb_log(MDB_LOG_INDEX, MDB_LOG_DEBUG, "mdb_update_index: START: index '%s', num_keys=%u", idx->name, idx->num_keys);
 
 	/* SAFETY CHECK 1: Skip unsupported index types */
 	if (idx->num_keys > 1) {
-		fprintf(stderr, "[mdb_update_index] SKIP: multikey indexes not supported (num_keys=%u)\n", idx->num_keys);
+		mdb_log(MDB_LOG_INDEX, MDB_LOG_INFO, "mdb_update_index: SKIP: multikey indexes not supported (num_keys=%u)", idx->num_keys);
 		return 1; /* Return success to continue with other indexes */
 	}
 	
 	/* SAFETY CHECK 2: Validate index has a valid first page */
 	if (idx->first_pg == 0 || idx->first_pg > 100000) {
-		fprintf(stderr, "[mdb_update_index] SKIP: invalid first_pg=%u\n", idx->first_pg);
+		mdb_log(MDB_LOG_INDEX, MDB_LOG_INFO, "mdb_update_index: SKIP: invalid first_pg=%u", idx->first_pg);
 		return 1;
 	}
 	
 	/* SAFETY CHECK 3: Check if key column exists in fields */
 	int keycol = idx->key_col_num[0];
 	if (keycol < 1 || keycol > (int)table->num_cols) {
-		fprintf(stderr, "[mdb_update_index] SKIP: invalid key_col_num=%d (table has %u cols)\n", 
+		mdb_log(MDB_LOG_INDEX, MDB_LOG_INFO, "mdb_update_index: SKIP: invalid key_col_num=%d (table has %u cols)", 
 		        keycol, table->num_cols);
 		return 1;
 	}
@@ -655,17 +927,17 @@ mdb_update_index(MdbTableDef *table, MdbIndex *idx, unsigned int num_fields, Mdb
 	/* SAFETY CHECK 4: Get column and verify it's fixed-length */
 	MdbColumn *col = g_ptr_array_index(table->columns, keycol - 1);
 	if (!col) {
-		fprintf(stderr, "[mdb_update_index] SKIP: column %d not found\n", keycol);
+		mdb_log(MDB_LOG_INDEX, MDB_LOG_INFO, "mdb_update_index: SKIP: column %d not found", keycol);
 		return 1;
 	}
 	
 	if (!col->is_fixed) {
-		fprintf(stderr, "[mdb_update_index] SKIP: variable-length key columns not supported (col '%s')\n", 
+		mdb_log(MDB_LOG_INDEX, MDB_LOG_INFO, "mdb_update_index: SKIP: variable-length key columns not supported (col '%s')", 
 		        col->name);
 		return 1;
 	}
 	
-	fprintf(stderr, "[mdb_update_index] Index validated: key_col=%d ('%s'), type=%d, size=%d\n",
+	mdb_log(MDB_LOG_INDEX, MDB_LOG_DEBUG, "mdb_update_index: Index validated: key_col=%d ('%s'), type=%d, size=%d",
 	        keycol, col->name, col->col_type, col->col_size);
 
 	/* Map index keys to fields */
@@ -681,13 +953,13 @@ mdb_update_index(MdbTableDef *table, MdbIndex *idx, unsigned int num_fields, Mdb
 			}
 		}
 		if (!found) {
-			fprintf(stderr, "[mdb_update_index] SKIP: key column %d not found in fields\n", 
+			mdb_log(MDB_LOG_INDEX, MDB_LOG_INFO, "mdb_update_index: SKIP: key column %d not found in fields", 
 			        idx->key_col_num[i]);
 			return 1;
 		}
 	}
 
-	fprintf(stderr, "[mdb_update_index] Attempting to find row in B-tree...\n");
+	mdb_log(MDB_LOG_INDEX, MDB_LOG_DEBUG, "mdb_update_index: Attempting to find row in B-tree...");
 
 	chain = g_malloc0(sizeof(MdbIndexChain));
 
@@ -695,31 +967,31 @@ mdb_update_index(MdbTableDef *table, MdbIndex *idx, unsigned int num_fields, Mdb
 	/* It may try to read encrypted pages that can't be decrypted */
 	mdb_index_find_row(mdb, idx, chain, pgnum, rownum);
 	
-	fprintf(stderr, "[mdb_update_index] Found row, chain depth=%d\n", chain->cur_depth);
+	mdb_log(MDB_LOG_INDEX, MDB_LOG_DEBUG, "mdb_update_index: Found row, chain depth=%d", chain->cur_depth);
 	
 	/* SAFETY CHECK 5: Verify chain depth is reasonable */
 	if (chain->cur_depth <= 0 || chain->cur_depth > MDB_MAX_INDEX_DEPTH) {
-		fprintf(stderr, "[mdb_update_index] SKIP: invalid chain depth=%d\n", chain->cur_depth);
-		g_free(chain);
+		mdb_log(MDB_LOG_INDEX, MDB_LOG_INFO, "mdb_update_index: SKIP: invalid chain depth=%d", chain->cur_depth);
+		mdb_free_index_chain(chain);
 		return 1;
 	}
 	
-	fprintf(stderr, "[mdb_update_index] Adding row to leaf page...\n");
+	mdb_log(MDB_LOG_INDEX, MDB_LOG_DEBUG, "mdb_update_index: Adding row to leaf page...");
 	
 	//printf("chain depth = %d\n", chain->cur_depth);
 	//printf("pg = %" G_GUINT32_FORMAT "\n",
 		//chain->pages[chain->cur_depth-1].pg);
 	//mdb_copy_index_pg(table, idx, &chain->pages[chain->cur_depth-1]);
-	int result = mdb_add_row_to_leaf_pg(table, idx, &chain->pages[chain->cur_depth-1], idx_fields, pgnum, rownum);
+	int result = mdb_add_row_to_leaf_pg(table, idx, chain->pages[chain->cur_depth-1], idx_fields, pgnum, rownum);
 	
-	g_free(chain);
+	mdb_free_index_chain(chain);
 	
 	if (!result) {
-		fprintf(stderr, "[mdb_update_index] FAILED: mdb_add_row_to_leaf_pg returned 0\n");
+		mdb_log(MDB_LOG_INDEX, MDB_LOG_WARN, "mdb_update_index: FAILED: mdb_add_row_to_leaf_pg returned 0");
 		return 0;
 	}
 	
-	fprintf(stderr, "[mdb_update_index] SUCCESS: index '%s' updated\n", idx->name);
+	mdb_log(MDB_LOG_INDEX, MDB_LOG_DEBUG, "mdb_update_index: SUCCESS: index '%s' updated", idx->name);
 	return 1;
 }
 
@@ -759,6 +1031,7 @@ mdb_insert_row(MdbTableDef *table, int num_fields, MdbField *fields)
 		fprintf(stderr, "write failed!\n");
 		return 0;
 	}
+	mdb_result_cache_invalidate(table);
 
 	mdb_update_indexes(table, num_fields, fields, pgnum, rownum);
  
@@ -780,16 +1053,16 @@ mdb_add_row_to_pg(MdbTableDef *table, unsigned char *row_buffer, int new_row_siz
 
 	if (table->is_temp_table) {
 		GPtrArray *pages = table->temp_table_pages;
+		/* the last page is never spilled */
 		if (pages->len == 0) {
-			new_pg = mdb_new_data_pg(entry);
-			g_ptr_array_add(pages, new_pg);
+			new_pg = mdb_temp_table_new_pg(table);
 		} else {
 			new_pg = g_ptr_array_index(pages, pages->len - 1);
-			if (mdb_get_int16(new_pg, 2) < new_row_size + 2) {
-				new_pg = mdb_new_data_pg(entry);
-				g_ptr_array_add(pages, new_pg);
-			}
+			if (mdb_get_int16(new_pg, 2) < new_row_size + 2)
+				new_pg = mdb_temp_table_new_pg(table);
 		}
+		/* a copy of the page in pg_buf is now stale */
+		table->temp_cur_pg = 0;
 
 		num_rows = mdb_get_int16(new_pg, fmt->row_count_offset);
 		pos = (num_rows == 0) ? fmt->pg_size :
@@ -963,6 +1236,7 @@ int i, pos;
 		fprintf(stderr, "write failed!\n");
 		return 1;
 	}
+	mdb_result_cache_invalidate(table);
 	return 0;
 }
 static int
@@ -1050,6 +1324,8 @@ mdb_copy_index_pg(MdbTableDef *table, MdbIndex *idx, MdbIndexPage *ipg)
 	memcpy((char*)new_pg + ipg->offset + 1, key_hash, col->col_size);
 	pg_row = (pgnum << 8) | ((rownum-1) & 0xff);
 	mdb_put_int32_msb(new_pg, ipg->offset + 5, pg_row);
+	mdb_index_page_reserve(ipg, row + 2);
+	if (row >= ipg->num_starts) ipg->idx_starts[row + 1] = 0;
 	ipg->idx_starts[row++] = ipg->offset + ipg->len;
 	//ipg->idx_starts[row] = ipg->offset + ipg->len;
 	if (mdb_get_option(MDB_DEBUG_WRITE)) {